@@ -899,6 +899,206 @@ static int analyze_blame(DBusConnection *bus) {
         return 0;
 }
 
+static int analyze_load_time(DBusConnection *bus) {
+        _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
+        DBusMessageIter iter, sub;
+        struct unit_times *times = NULL;
+        unsigned c = 0, n_units = 0, i;
+        char ts[FORMAT_TIMESPAN_MAX];
+        usec_t total = 0;
+        int r;
+
+        r = bus_method_call_with_reply(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "ListUnits",
+                        &reply,
+                        NULL,
+                        DBUS_TYPE_INVALID);
+        if (r < 0)
+                return r;
+
+        if (!dbus_message_iter_init(reply, &iter) ||
+            dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(&iter) != DBUS_TYPE_STRUCT)  {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        for (dbus_message_iter_recurse(&iter, &sub);
+             dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next(&sub)) {
+                struct unit_info u;
+                struct unit_times *t;
+
+                if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_STRUCT) {
+                        log_error("Failed to parse reply.");
+                        r = -EIO;
+                        goto finish;
+                }
+
+                if (c >= n_units) {
+                        struct unit_times *w;
+
+                        n_units = MAX(2*c, 16u);
+                        w = realloc(times, sizeof(struct unit_times) * n_units);
+                        if (!w) {
+                                r = log_oom();
+                                goto finish;
+                        }
+
+                        times = w;
+                }
+
+                t = times + c;
+                zero(*t);
+
+                r = bus_parse_unit_info(&sub, &u);
+                if (r < 0)
+                        goto finish;
+
+                if (bus_get_uint64_property(bus, u.unit_path,
+                                            "org.freedesktop.systemd1.Unit",
+                                            "LoadTimeUSec",
+                                            &t->time) < 0) {
+                        r = -EIO;
+                        goto finish;
+                }
+
+                t->name = strdup(u.id);
+                if (!t->name) {
+                        r = log_oom();
+                        goto finish;
+                }
+
+                total += t->time;
+                c++;
+        }
+
+        qsort(times, c, sizeof(struct unit_times), compare_unit_time);
+
+        for (i = 0; i < c; i++)
+                printf("%16s %s\n", format_timespan(ts, sizeof(ts), times[i].time, 1), times[i].name);
+
+        printf("\nLoading %u units took %s in total.\n", c, format_timespan(ts, sizeof(ts), total, 1));
+        r = 0;
+
+finish:
+        free_unit_times(times, c);
+        return r;
+}
+
+struct generator_time {
+        const char *name;
+        const char *result;
+        usec_t time;
+};
+
+static int compare_generator_time(const void *a, const void *b) {
+        return compare(((struct generator_time *)b)->time,
+                       ((struct generator_time *)a)->time);
+}
+
+static int analyze_generators(DBusConnection *bus) {
+        _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
+        _cleanup_free_ struct generator_time *times = NULL;
+        DBusMessageIter iter, sub, sub2;
+        const char *interface = "org.freedesktop.systemd1.Manager";
+        const char *property = "GeneratorTimes";
+        unsigned c = 0, n = 0, i;
+        char ts[FORMAT_TIMESPAN_MAX];
+        usec_t total;
+        int r;
+
+        r = bus_method_call_with_reply(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.DBus.Properties",
+                        "Get",
+                        &reply,
+                        NULL,
+                        DBUS_TYPE_STRING, &interface,
+                        DBUS_TYPE_STRING, &property,
+                        DBUS_TYPE_INVALID);
+        if (r < 0)
+                return r;
+
+        if (!dbus_message_iter_init(reply, &iter) ||
+            dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_VARIANT)  {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        dbus_message_iter_recurse(&iter, &sub);
+
+        if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(&sub) != DBUS_TYPE_STRUCT)  {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        for (dbus_message_iter_recurse(&sub, &sub2);
+             dbus_message_iter_get_arg_type(&sub2) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next(&sub2)) {
+                DBusMessageIter sub3;
+                struct generator_time *t;
+
+                if (dbus_message_iter_get_arg_type(&sub2) != DBUS_TYPE_STRUCT) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                if (c >= n) {
+                        struct generator_time *w;
+
+                        n = MAX(2*c, 16u);
+                        w = realloc(times, sizeof(struct generator_time) * n);
+                        if (!w)
+                                return log_oom();
+
+                        times = w;
+                }
+
+                t = times + c;
+
+                dbus_message_iter_recurse(&sub2, &sub3);
+
+                if (bus_iter_get_basic_and_next(&sub3, DBUS_TYPE_STRING, &t->name, true) < 0 ||
+                    bus_iter_get_basic_and_next(&sub3, DBUS_TYPE_UINT64, &t->time, true) < 0 ||
+                    bus_iter_get_basic_and_next(&sub3, DBUS_TYPE_STRING, &t->result, false) < 0) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                c++;
+        }
+
+        r = bus_get_uint64_property(bus,
+                                    "/org/freedesktop/systemd1",
+                                    "org.freedesktop.systemd1.Manager",
+                                    "GeneratorsUSec",
+                                    &total);
+        if (r < 0)
+                return r;
+
+        if (c > 0)
+                qsort(times, c, sizeof(struct generator_time), compare_generator_time);
+
+        for (i = 0; i < c; i++) {
+                if (streq(times[i].result, "success"))
+                        printf("%16s %s\n", format_timespan(ts, sizeof(ts), times[i].time, 1), times[i].name);
+                else
+                        printf("%16s %s (%s)\n", format_timespan(ts, sizeof(ts), times[i].time, 1), times[i].name, times[i].result);
+        }
+
+        printf("\nRunning %u generators took %s.\n", c, format_timespan(ts, sizeof(ts), total, 1));
+
+        return 0;
+}
+
 static int analyze_time(DBusConnection *bus) {
         _cleanup_free_ char *buf = NULL;
         int r;
@@ -911,6 +1111,97 @@ static int analyze_time(DBusConnection *bus) {
         return 0;
 }
 
+static int analyze_event_sources(DBusConnection *bus) {
+        _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
+        DBusMessageIter iter, sub, sub2;
+        const char *interface = "org.freedesktop.systemd1.Manager";
+        const char *property = "EventSourceStatistics";
+        int r;
+
+        r = bus_method_call_with_reply(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.DBus.Properties",
+                        "Get",
+                        &reply,
+                        NULL,
+                        DBUS_TYPE_STRING, &interface,
+                        DBUS_TYPE_STRING, &property,
+                        DBUS_TYPE_INVALID);
+        if (r < 0)
+                return r;
+
+        if (!dbus_message_iter_init(reply, &iter) ||
+            dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_VARIANT)  {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        dbus_message_iter_recurse(&iter, &sub);
+
+        if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(&sub) != DBUS_TYPE_STRUCT)  {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        dbus_message_iter_recurse(&sub, &sub2);
+
+        printf("%-18s %12s %16s %16s\n", "SOURCE", "DISPATCHED", "TOTAL", "AVERAGE");
+
+        while (dbus_message_iter_get_arg_type(&sub2) != DBUS_TYPE_INVALID) {
+                DBusMessageIter sub3, sub4;
+                const char *name;
+                uint64_t n, usec, *histogram;
+                char ts[FORMAT_TIMESPAN_MAX], ta[FORMAT_TIMESPAN_MAX];
+                int k, n_buckets;
+
+                if (dbus_message_iter_get_arg_type(&sub2) != DBUS_TYPE_STRUCT) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                dbus_message_iter_recurse(&sub2, &sub3);
+
+                if (bus_iter_get_basic_and_next(&sub3, DBUS_TYPE_STRING, &name, true) < 0 ||
+                    bus_iter_get_basic_and_next(&sub3, DBUS_TYPE_UINT64, &n, true) < 0 ||
+                    bus_iter_get_basic_and_next(&sub3, DBUS_TYPE_UINT64, &usec, true) < 0 ||
+                    dbus_message_iter_get_arg_type(&sub3) != DBUS_TYPE_ARRAY ||
+                    dbus_message_iter_get_element_type(&sub3) != DBUS_TYPE_UINT64) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                dbus_message_iter_recurse(&sub3, &sub4);
+                dbus_message_iter_get_fixed_array(&sub4, &histogram, &n_buckets);
+
+                printf("%-18s %12"PRIu64" %16s %16s\n",
+                       name, n,
+                       format_timespan(ts, sizeof(ts), usec, 1),
+                       format_timespan(ta, sizeof(ta), n > 0 ? usec / n : 0, 1));
+
+                /* Bucket 0 counts dispatches below 1us, bucket k
+                 * those below 2^k us, the last one everything
+                 * slower than that. */
+                for (k = 0; k < n_buckets; k++) {
+                        bool last = k == n_buckets - 1;
+
+                        if (histogram[k] <= 0)
+                                continue;
+
+                        printf("%21s %-8s %10"PRIu64"\n",
+                               last ? ">=" : "<",
+                               format_timespan(ts, sizeof(ts), last ? 1ULL << (k - 1) : 1ULL << k, 1),
+                               histogram[k]);
+                }
+
+                dbus_message_iter_next(&sub2);
+        }
+
+        return 0;
+}
+
 static int graph_one_property(const char *name, const char *prop, DBusMessageIter *iter, char* patterns[]) {
 
         static const char * const colors[] = {
@@ -1134,7 +1425,10 @@ static void analyze_help(void)
                "  blame               Print list of running units ordered by time to init\n"
                "  critical-chain      Print a tree of the time critical chain of units\n"
                "  plot                Output SVG graphic showing service initialization\n"
-               "  dot                 Dump dependency graph (in dot(1) format)\n\n",
+               "  dot                 Dump dependency graph (in dot(1) format)\n"
+               "  load-time           Print list of units ordered by time to load their configuration\n"
+               "  event-sources       Print dispatch statistics of the manager event sources\n"
+               "  generators          Print list of generators ordered by time they took to run\n\n",
                program_invocation_short_name);
 
         /* When updating this list, including descriptions, apply
@@ -1259,6 +1553,12 @@ int main(int argc, char *argv[]) {
                 r = analyze_plot(bus);
         else if (streq(argv[optind], "dot"))
                 r = dot(bus, argv+optind+1);
+        else if (streq(argv[optind], "load-time"))
+                r = analyze_load_time(bus);
+        else if (streq(argv[optind], "event-sources"))
+                r = analyze_event_sources(bus);
+        else if (streq(argv[optind], "generators"))
+                r = analyze_generators(bus);
         else
                 log_error("Unknown operation '%s'.", argv[optind]);
 
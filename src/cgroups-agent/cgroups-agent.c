@@ -22,10 +22,38 @@
 #include <dbus/dbus.h>
 
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "log.h"
+#include "util.h"
+#include "def.h"
 #include "dbus-common.h"
 
+static int send_datagram(const char *group) {
+        union {
+                struct sockaddr sa;
+                struct sockaddr_un un;
+        } sa = {
+                .un.sun_family = AF_UNIX,
+                .un.sun_path = SYSTEMD_CGROUP_AGENT_SOCKET,
+        };
+        _cleanup_close_ int fd = -1;
+        ssize_t n;
+
+        fd = socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+        if (fd < 0)
+                return -errno;
+
+        n = sendto(fd, group, strlen(group), 0, &sa.sa,
+                   offsetof(struct sockaddr_un, sun_path) + strlen(sa.un.sun_path));
+        if (n < 0)
+                return -errno;
+
+        return 0;
+}
+
 int main(int argc, char *argv[]) {
         DBusError error;
         DBusConnection *bus = NULL;
@@ -39,11 +67,18 @@ int main(int argc, char *argv[]) {
                 goto finish;
         }
 
+        /* If PID 1 listens on its own socket for this, a single
+         * datagram is all we need */
+        if (send_datagram(argv[1]) >= 0) {
+                r = EXIT_SUCCESS;
+                goto finish;
+        }
+
         log_set_target(LOG_TARGET_AUTO);
         log_parse_environment();
         log_open();
 
-        /* We send this event to the private D-Bus socket and then the
+        /* Otherwise we send this event to the private D-Bus socket and then the
          * system instance will forward this to the system bus. We do
          * this to avoid an activation loop when we start dbus when we
          * are called when the dbus service is shut down. */
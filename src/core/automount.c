@@ -141,13 +141,21 @@ int automount_add_one_mount_link(Automount *a, Mount *m) {
 }
 
 static int automount_add_mount_links(Automount *a) {
-        Unit *other;
-        int r;
+        _cleanup_free_ Mount **mounts = NULL;
+        int n, k, r;
 
         assert(a);
 
-        LIST_FOREACH(units_by_type, other, UNIT(a)->manager->units_by_type[UNIT_MOUNT]) {
-                r = automount_add_one_mount_link(a, MOUNT(other));
+        r = unit_add_indexed_path(UNIT(a), a->where, false);
+        if (r < 0)
+                return r;
+
+        n = unit_get_mounts_for_paths(UNIT(a), &mounts);
+        if (n < 0)
+                return n;
+
+        for (k = 0; k < n; k++) {
+                r = automount_add_one_mount_link(a, mounts[k]);
                 if (r < 0)
                         return r;
         }
@@ -24,15 +24,12 @@
 #include "list.h"
 #include "fileio.h"
 
-int cgroup_attribute_apply(CGroupAttribute *a, CGroupBonding *b) {
-        _cleanup_free_ char *path = NULL, *v = NULL;
+static int cgroup_attribute_write(CGroupAttribute *a, CGroupBonding *b) {
+        _cleanup_free_ char *v = NULL;
         int r;
 
         assert(a);
-
-        b = cgroup_bonding_find_list(b, a->controller);
-        if (!b)
-                return 0;
+        assert(b);
 
         if (a->semantics && a->semantics->map_write) {
                 r = a->semantics->map_write(a->semantics, a->value, &v);
@@ -40,27 +37,46 @@ int cgroup_attribute_apply(CGroupAttribute *a, CGroupBonding *b) {
                         return r;
         }
 
-        r = cg_get_path(a->controller, b->path, a->name, &path);
+        r = cgroup_bonding_set_attribute(b, a->name, v ? v : a->value);
         if (r < 0)
-                return r;
-
-        r = write_string_file(path, v ? v : a->value);
-        if (r < 0)
-                log_warning("Failed to write '%s' to %s: %s", v ? v : a->value, path, strerror(-r));
+                log_warning("Failed to write '%s' to %s:%s/%s: %s",
+                            v ? v : a->value, b->controller, b->path, a->name, strerror(-r));
 
         return r;
 }
 
+int cgroup_attribute_apply(CGroupAttribute *a, CGroupBonding *b) {
+        assert(a);
+
+        b = cgroup_bonding_find_list(b, a->controller);
+        if (!b)
+                return 0;
+
+        return cgroup_attribute_write(a, b);
+}
+
 int cgroup_attribute_apply_list(CGroupAttribute *first, CGroupBonding *b) {
-        CGroupAttribute *a;
+        CGroupBonding *i;
         int r = 0;
 
-        LIST_FOREACH(by_unit, a, first) {
-                int k;
+        /* Write all attributes of one group in a row, so that they
+         * all go to the directory we already have open */
+        LIST_FOREACH(by_unit, i, b) {
+                CGroupAttribute *a;
+
+                if (cgroup_bonding_find_list(b, i->controller) != i)
+                        continue;
+
+                LIST_FOREACH(by_unit, a, first) {
+                        int k;
+
+                        if (!streq(a->controller, i->controller))
+                                continue;
 
-                k = cgroup_attribute_apply(a, b);
-                if (r == 0)
-                        r = k;
+                        k = cgroup_attribute_write(a, i);
+                        if (r == 0)
+                                r = k;
+                }
         }
 
         return r;
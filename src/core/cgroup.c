@@ -32,6 +32,44 @@
 #include "log.h"
 #include "strv.h"
 #include "path-util.h"
+#include "fileio.h"
+
+static void cgroup_bonding_open_dir(CGroupBonding *b) {
+        _cleanup_free_ char *fs = NULL;
+
+        assert(b);
+        assert(b->dir_fd < 0);
+
+        /* Failing to open the group is not fatal, we'll simply go
+         * by path then */
+        if (cg_get_path(b->controller, b->path, NULL, &fs) < 0)
+                return;
+
+        b->dir_fd = open(fs, O_RDONLY|O_DIRECTORY|O_CLOEXEC|O_NOCTTY);
+}
+
+static int write_string_at(int dir_fd, const char *name, const char *line) {
+        _cleanup_close_ int fd = -1;
+        const char *t;
+        size_t l;
+
+        assert(dir_fd >= 0);
+        assert(name);
+        assert(line);
+
+        fd = openat(dir_fd, name, O_WRONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        t = endswith(line, "\n") ? line : strappenda(line, "\n");
+        l = strlen(t);
+
+        errno = 0;
+        if (write(fd, t, l) != (ssize_t) l)
+                return errno ? -errno : -EIO;
+
+        return 0;
+}
 
 int cgroup_bonding_realize(CGroupBonding *b) {
         int r;
@@ -40,6 +78,10 @@ int cgroup_bonding_realize(CGroupBonding *b) {
         assert(b->path);
         assert(b->controller);
 
+        /* The group might be created anew, don't keep the files of
+         * an earlier incarnation */
+        cgroup_bonding_close_fds(b);
+
         r = cg_create(b->controller, b->path, NULL);
         if (r < 0) {
                 log_warning("Failed to create cgroup %s:%s: %s", b->controller, b->path, strerror(-r));
@@ -48,6 +90,8 @@ int cgroup_bonding_realize(CGroupBonding *b) {
 
         b->realized = true;
 
+        cgroup_bonding_open_dir(b);
+
         return 0;
 }
 
@@ -84,6 +128,8 @@ void cgroup_bonding_free(CGroupBonding *b, bool trim) {
         if (b->realized && b->ours && trim)
                 cg_trim(b->controller, b->path, false);
 
+        cgroup_bonding_close_fds(b);
+
         free(b->controller);
         free(b->path);
         free(b);
@@ -99,8 +145,12 @@ void cgroup_bonding_free_list(CGroupBonding *first, bool remove_or_trim) {
 void cgroup_bonding_trim(CGroupBonding *b, bool delete_root) {
         assert(b);
 
-        if (b->realized && b->ours)
+        if (b->realized && b->ours) {
+                if (delete_root)
+                        cgroup_bonding_close_fds(b);
+
                 cg_trim(b->controller, b->path, delete_root);
+        }
 }
 
 void cgroup_bonding_trim_list(CGroupBonding *first, bool delete_root) {
@@ -118,6 +168,20 @@ int cgroup_bonding_install(CGroupBonding *b, pid_t pid, const char *cgroup_suffi
         assert(b);
         assert(pid >= 0);
 
+        /* If the group is open already, we can skip creating it and
+         * looking up its tasks file. Note that this is also called
+         * in forked children, hence must not cache anything. */
+        if (!cgroup_suffix && b->dir_fd >= 0) {
+                char c[DECIMAL_STR_MAX(pid_t) + 2];
+
+                snprintf(c, sizeof(c), "%lu\n", (unsigned long) (pid > 0 ? pid : getpid()));
+
+                if (write_string_at(b->dir_fd, "tasks", c) >= 0) {
+                        b->realized = true;
+                        return 0;
+                }
+        }
+
         if (cgroup_suffix) {
                 p = strjoin(b->path, "/", cgroup_suffix, NULL);
                 if (!p)
@@ -273,6 +337,19 @@ int cgroup_bonding_kill_list(CGroupBonding *first, int sig, bool sigcont, bool r
                         ret = r;
         }
 
+        /* Remember which unit the processes we just signalled belong
+         * to, so that we need not read /proc when they die. Only as
+         * PID 1 the ones whose parent dies first are reparented to
+         * us, everything else is reaped by somebody else and never
+         * reaches manager_dispatch_sigchld(). */
+        if (first->unit && getpid() == 1) {
+                Iterator i;
+                void *p;
+
+                SET_FOREACH(p, s, i)
+                        unit_track_pid(first->unit, PTR_TO_LONG(p));
+        }
+
 finish:
         if (allocated_set)
                 set_free(allocated_set);
@@ -493,6 +570,10 @@ int cgroup_notify_empty(Manager *m, const char *group) {
                 }
 
                 if (t > 0) {
+                        /* None of the processes we know of is
+                         * around anymore */
+                        unit_untrack_all_pids(b->unit);
+
                         /* If it is empty, let's delete it */
                         cgroup_bonding_trim_list(b->unit->cgroup_bondings, true);
 
@@ -626,3 +707,157 @@ pid_t cgroup_bonding_search_main_pid_list(CGroupBonding *first) {
         return 0;
 
 }
+
+void cgroup_bonding_close_fds(CGroupBonding *b) {
+        assert(b);
+
+        if (b->dir_fd >= 0) {
+                close_nointr_nofail(b->dir_fd);
+                b->dir_fd = -1;
+        }
+}
+
+void cgroup_bonding_close_fds_list(CGroupBonding *first) {
+        CGroupBonding *b;
+
+        LIST_FOREACH(by_unit, b, first)
+                cgroup_bonding_close_fds(b);
+}
+
+int cgroup_bonding_set_attribute(CGroupBonding *b, const char *name, const char *value) {
+        _cleanup_free_ char *path = NULL;
+        int r;
+
+        assert(b);
+        assert(name);
+        assert(value);
+
+        if (b->dir_fd >= 0) {
+                r = write_string_at(b->dir_fd, name, value);
+                if (r >= 0)
+                        return r;
+        }
+
+        r = cg_get_path(b->controller, b->path, name, &path);
+        if (r < 0)
+                return r;
+
+        return write_string_file(path, value);
+}
+
+static int cgroup_bonding_read_usage(CGroupBonding *b, const char *controller, const char *attribute, char **contents) {
+        _cleanup_free_ char *fs = NULL;
+        int r;
+
+        assert(b);
+        assert(controller);
+        assert(attribute);
+        assert(contents);
+
+        if (!b->realized)
+                return -ENOENT;
+
+        /* The counters are opened for each sample and closed right
+         * away, so that the number of units we account does not
+         * count against our file descriptor limit */
+        r = cg_get_path(controller, b->path, attribute, &fs);
+        if (r < 0)
+                return r;
+
+        return read_full_file(fs, contents, NULL);
+}
+
+static int parse_io_service_bytes(const char *s, CGroupUsage *usage) {
+        uint64_t rd = 0, wr = 0;
+
+        assert(s);
+        assert(usage);
+
+        /* Lines look like "8:0 Read 4096", followed by one "Total"
+         * line for all devices */
+
+        while (*s) {
+                char op[8];
+                unsigned long long v;
+                size_t l;
+
+                l = strcspn(s, "\n");
+
+                if (sscanf(s, "%*u:%*u %7s %llu", op, &v) == 2) {
+                        if (streq(op, "Read"))
+                                rd += v;
+                        else if (streq(op, "Write"))
+                                wr += v;
+                } else if (l > 0 && !startswith(s, "Total "))
+                        return -EINVAL;
+
+                s += l;
+                if (*s)
+                        s++;
+        }
+
+        usage->io_read_bytes = rd;
+        usage->io_write_bytes = wr;
+
+        return 0;
+}
+
+int cgroup_usage_parse(CGroupUsage *usage, const char *attribute, const char *contents) {
+        _cleanup_free_ char *t = NULL;
+
+        assert(usage);
+        assert(attribute);
+        assert(contents);
+
+        if (streq(attribute, "blkio.io_service_bytes"))
+                return parse_io_service_bytes(contents, usage);
+
+        t = strdup(contents);
+        if (!t)
+                return -ENOMEM;
+
+        if (streq(attribute, "cpuacct.usage"))
+                return safe_atou64(strstrip(t), &usage->cpu_nsec);
+
+        if (streq(attribute, "memory.usage_in_bytes"))
+                return safe_atou64(strstrip(t), &usage->memory_bytes);
+
+        return -ENOENT;
+}
+
+int cgroup_bonding_get_usage_list(CGroupBonding *first, CGroupUsage *usage) {
+        static const char * const table[][3] = {
+                /* cpuacct is usually mounted together with cpu,
+                 * hence try the cpu group too */
+                { "cpuacct", "cpu",  "cpuacct.usage" },
+                { "memory",  NULL,   "memory.usage_in_bytes" },
+                { "blkio",   NULL,   "blkio.io_service_bytes" },
+        };
+        bool found = false;
+        unsigned i;
+
+        assert(usage);
+
+        /* Samples the counters of all controllers of the unit that
+         * we know about. */
+
+        usage->cpu_nsec = usage->memory_bytes = (uint64_t) -1;
+        usage->io_read_bytes = usage->io_write_bytes = (uint64_t) -1;
+
+        for (i = 0; i < ELEMENTSOF(table); i++) {
+                _cleanup_free_ char *contents = NULL;
+                CGroupBonding *b;
+
+                b = cgroup_bonding_find_list(first, table[i][0]);
+                if (!b && table[i][1])
+                        b = cgroup_bonding_find_list(first, table[i][1]);
+                if (!b)
+                        continue;
+
+                if (cgroup_bonding_read_usage(b, table[i][0], table[i][2], &contents) >= 0 &&
+                    cgroup_usage_parse(usage, table[i][2], contents) >= 0)
+                        found = true;
+        }
+
+        return found;
+}
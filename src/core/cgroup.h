@@ -47,8 +47,22 @@ struct CGroupBonding {
 
         /* This cgroup is realized */
         bool realized:1;
+
+        /* The group directory, open from realizing the group until
+         * the process has been spawned into it, so that attributes
+         * and tasks can be written relative to it */
+        int dir_fd;
 };
 
+/* Resource usage of a unit, (uint64_t) -1 where the controller is
+ * not used for the unit */
+typedef struct CGroupUsage {
+        uint64_t cpu_nsec;
+        uint64_t memory_bytes;
+        uint64_t io_read_bytes;
+        uint64_t io_write_bytes;
+} CGroupUsage;
+
 int cgroup_bonding_realize(CGroupBonding *b);
 int cgroup_bonding_realize_list(CGroupBonding *first);
 
@@ -83,6 +97,12 @@ char *cgroup_bonding_to_string(CGroupBonding *b);
 pid_t cgroup_bonding_search_main_pid(CGroupBonding *b);
 pid_t cgroup_bonding_search_main_pid_list(CGroupBonding *b);
 
+void cgroup_bonding_close_fds(CGroupBonding *b);
+void cgroup_bonding_close_fds_list(CGroupBonding *first);
+int cgroup_bonding_set_attribute(CGroupBonding *b, const char *name, const char *value);
+int cgroup_bonding_get_usage_list(CGroupBonding *first, CGroupUsage *usage);
+int cgroup_usage_parse(CGroupUsage *usage, const char *attribute, const char *contents);
+
 #include "manager.h"
 
 int manager_setup_cgroup(Manager *m);
@@ -141,10 +141,14 @@
         "  <method name=\"ListUnits\">\n"                               \
         "   <arg name=\"units\" type=\"a(ssssssouso)\" direction=\"out\"/>\n" \
         "  </method>\n"                                                 \
+        "  <method name=\"ListResourceUsage\">\n"                       \
+        "   <arg name=\"usage\" type=\"a(stttt)\" direction=\"out\"/>\n" \
+        "  </method>\n"                                                 \
         "  <method name=\"ListJobs\">\n"                                \
         "   <arg name=\"jobs\" type=\"a(usssoo)\" direction=\"out\"/>\n" \
         "  </method>\n"                                                 \
         "  <method name=\"Subscribe\"/>\n"                              \
+        "  <method name=\"SubscribeBatched\"/>\n"                       \
         "  <method name=\"Unsubscribe\"/>\n"                            \
         "  <method name=\"Dump\">\n"                                    \
         "   <arg name=\"dump\" type=\"s\" direction=\"out\"/>\n"        \
@@ -257,7 +261,10 @@
         "   <arg name=\"userspace\" type=\"t\"/>\n"                     \
         "   <arg name=\"total\" type=\"t\"/>\n"                         \
         "  </signal>"                                                   \
-        "  <signal name=\"UnitFilesChanged\"/>\n"
+        "  <signal name=\"UnitFilesChanged\"/>\n"                       \
+        "  <signal name=\"UnitsChanged\">\n"                            \
+        "   <arg name=\"units\" type=\"a(sosss)\"/>\n"                  \
+        "  </signal>\n"
 
 #define BUS_MANAGER_INTERFACE_PROPERTIES_GENERAL                        \
         "  <property name=\"Version\" type=\"s\" access=\"read\"/>\n"   \
@@ -281,6 +288,13 @@
         "  <property name=\"NJobs\" type=\"u\" access=\"read\"/>\n"     \
         "  <property name=\"NInstalledJobs\" type=\"u\" access=\"read\"/>\n" \
         "  <property name=\"NFailedJobs\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"NFastPathJobs\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"NSignals\" type=\"u\" access=\"read\"/>\n"  \
+        "  <property name=\"NCoalescedChanges\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"NBatchedChanges\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"NDeviceEvents\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"NCoalescedDeviceEvents\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"DeviceEventsPerSec\" type=\"u\" access=\"read\"/>\n" \
         "  <property name=\"Progress\" type=\"d\" access=\"read\"/>\n"  \
         "  <property name=\"Environment\" type=\"as\" access=\"read\"/>\n" \
         "  <property name=\"ConfirmSpawn\" type=\"b\" access=\"read\"/>\n" \
@@ -292,7 +306,10 @@
         "  <property name=\"DefaultStandardError\" type=\"s\" access=\"read\"/>\n" \
         "  <property name=\"RuntimeWatchdogUSec\" type=\"t\" access=\"readwrite\"/>\n" \
         "  <property name=\"ShutdownWatchdogUSec\" type=\"t\" access=\"readwrite\"/>\n" \
-        "  <property name=\"Virtualization\" type=\"s\" access=\"read\"/>\n"
+        "  <property name=\"Virtualization\" type=\"s\" access=\"read\"/>\n" \
+        "  <property name=\"EventSourceStatistics\" type=\"a(sttat)\" access=\"read\"/>\n" \
+        "  <property name=\"GeneratorTimes\" type=\"a(sts)\" access=\"read\"/>\n" \
+        "  <property name=\"GeneratorsUSec\" type=\"t\" access=\"read\"/>\n"
 
 #define BUS_MANAGER_INTERFACE_END                                       \
         " </interface>\n"
@@ -444,6 +461,22 @@ static int bus_manager_append_n_jobs(DBusMessageIter *i, const char *property, v
         return 0;
 }
 
+static int bus_manager_append_device_events_per_sec(DBusMessageIter *i, const char *property, void *data) {
+        Manager *m = data;
+        uint32_t u;
+
+        assert(i);
+        assert(property);
+        assert(m);
+
+        u = device_events_per_sec(m);
+
+        if (!dbus_message_iter_append_basic(i, DBUS_TYPE_UINT32, &u))
+                return -ENOMEM;
+
+        return 0;
+}
+
 static int bus_manager_append_progress(DBusMessageIter *i, const char *property, void *data) {
         double d;
         Manager *m = data;
@@ -479,6 +512,77 @@ static int bus_manager_append_virt(DBusMessageIter *i, const char *property, voi
         return 0;
 }
 
+static int bus_manager_append_event_sources(DBusMessageIter *i, const char *property, void *data) {
+        Manager *m = data;
+        DBusMessageIter sub, sub2, sub3;
+        WatchType t;
+
+        assert(i);
+        assert(property);
+        assert(m);
+
+        if (!dbus_message_iter_open_container(i, DBUS_TYPE_ARRAY, "(sttat)", &sub))
+                return -ENOMEM;
+
+        for (t = 0; t < _WATCH_TYPE_MAX; t++) {
+                const char *name;
+                const uint64_t *h;
+
+                if (m->n_dispatched[t] <= 0)
+                        continue;
+
+                name = watch_type_to_string(t);
+                h = m->dispatch_histogram[t];
+
+                if (!dbus_message_iter_open_container(&sub, DBUS_TYPE_STRUCT, NULL, &sub2) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &name) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &m->n_dispatched[t]) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &m->dispatch_usec[t]) ||
+                    !dbus_message_iter_open_container(&sub2, DBUS_TYPE_ARRAY, "t", &sub3) ||
+                    !dbus_message_iter_append_fixed_array(&sub3, DBUS_TYPE_UINT64, &h, MANAGER_DISPATCH_HISTOGRAM_MAX) ||
+                    !dbus_message_iter_close_container(&sub2, &sub3) ||
+                    !dbus_message_iter_close_container(&sub, &sub2))
+                        return -ENOMEM;
+        }
+
+        if (!dbus_message_iter_close_container(i, &sub))
+                return -ENOMEM;
+
+        return 0;
+}
+
+static int bus_manager_append_generator_times(DBusMessageIter *i, const char *property, void *data) {
+        Manager *m = data;
+        DBusMessageIter sub, sub2;
+        unsigned k;
+
+        assert(i);
+        assert(property);
+        assert(m);
+
+        if (!dbus_message_iter_open_container(i, DBUS_TYPE_ARRAY, "(sts)", &sub))
+                return -ENOMEM;
+
+        for (k = 0; k < m->n_generator_times; k++) {
+                GeneratorTime *g = m->generator_times + k;
+                const char *result;
+
+                result = generator_result_to_string(g->result);
+
+                if (!dbus_message_iter_open_container(&sub, DBUS_TYPE_STRUCT, NULL, &sub2) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &g->name) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &g->usec) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &result) ||
+                    !dbus_message_iter_close_container(&sub, &sub2))
+                        return -ENOMEM;
+        }
+
+        if (!dbus_message_iter_close_container(i, &sub))
+                return -ENOMEM;
+
+        return 0;
+}
+
 static DBusMessage *message_from_file_changes(
                 DBusMessage *m,
                 UnitFileChange *changes,
@@ -586,6 +690,13 @@ static const BusProperty bus_manager_properties[] = {
         { "NJobs",                       bus_manager_append_n_jobs,      "u",  0                                                },
         { "NInstalledJobs",              bus_property_append_uint32,     "u",  offsetof(Manager, n_installed_jobs)              },
         { "NFailedJobs",                 bus_property_append_uint32,     "u",  offsetof(Manager, n_failed_jobs)                 },
+        { "NFastPathJobs",               bus_property_append_uint32,     "u",  offsetof(Manager, n_fast_path_jobs)              },
+        { "NSignals",                    bus_property_append_uint32,     "u",  offsetof(Manager, n_bus_signals)                 },
+        { "NCoalescedChanges",           bus_property_append_uint32,     "u",  offsetof(Manager, n_bus_changes_coalesced)       },
+        { "NBatchedChanges",             bus_property_append_uint32,     "u",  offsetof(Manager, n_bus_changes_batched)         },
+        { "NDeviceEvents",               bus_property_append_uint32,     "u",  offsetof(Manager, n_device_events)               },
+        { "NCoalescedDeviceEvents",      bus_property_append_uint32,     "u",  offsetof(Manager, n_device_events_coalesced)     },
+        { "DeviceEventsPerSec",          bus_manager_append_device_events_per_sec, "u", 0                                       },
         { "Progress",                    bus_manager_append_progress,    "d",  0                                                },
         { "Environment",                 bus_property_append_strv,       "as", offsetof(Manager, environment),                  true },
         { "ConfirmSpawn",                bus_property_append_bool,       "b",  offsetof(Manager, confirm_spawn)                 },
@@ -598,6 +709,9 @@ static const BusProperty bus_manager_properties[] = {
         { "RuntimeWatchdogUSec",         bus_property_append_usec,       "t",  offsetof(Manager, runtime_watchdog),             false, bus_manager_set_runtime_watchdog_usec },
         { "ShutdownWatchdogUSec",        bus_property_append_usec,       "t",  offsetof(Manager, shutdown_watchdog),            false, bus_property_set_usec },
         { "Virtualization",              bus_manager_append_virt,        "s",  0,                                               },
+        { "EventSourceStatistics",       bus_manager_append_event_sources, "a(sttat)", 0                                        },
+        { "GeneratorTimes",              bus_manager_append_generator_times, "a(sts)", 0                                        },
+        { "GeneratorsUSec",              bus_property_append_usec,       "t",  offsetof(Manager, generators_usec)               },
         { NULL, }
 };
 
@@ -1104,6 +1218,49 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                 if (!dbus_message_iter_close_container(&iter, &sub))
                         goto oom;
 
+        } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "ListResourceUsage")) {
+                DBusMessageIter iter, sub;
+                Iterator i;
+                Unit *u;
+                const char *k;
+
+                SELINUX_ACCESS_CHECK(connection, message, "status");
+
+                reply = dbus_message_new_method_return(message);
+                if (!reply)
+                        goto oom;
+
+                dbus_message_iter_init_append(reply, &iter);
+
+                if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(stttt)", &sub))
+                        goto oom;
+
+                /* Only units that have a cgroup with counters are
+                 * listed, counters of controllers a unit is not in
+                 * are (uint64_t) -1 */
+                HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                        DBusMessageIter sub2;
+                        CGroupUsage usage;
+
+                        if (k != u->id)
+                                continue;
+
+                        if (cgroup_bonding_get_usage_list(u->cgroup_bondings, &usage) <= 0)
+                                continue;
+
+                        if (!dbus_message_iter_open_container(&sub, DBUS_TYPE_STRUCT, NULL, &sub2) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &u->id) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &usage.cpu_nsec) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &usage.memory_bytes) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &usage.io_read_bytes) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &usage.io_write_bytes) ||
+                            !dbus_message_iter_close_container(&sub, &sub2))
+                                goto oom;
+                }
+
+                if (!dbus_message_iter_close_container(&iter, &sub))
+                        goto oom;
+
         } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "ListJobs")) {
                 DBusMessageIter iter, sub;
                 Iterator i;
@@ -1164,12 +1321,18 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                 if (!dbus_message_iter_close_container(&iter, &sub))
                         goto oom;
 
-        } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "Subscribe")) {
+        } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "Subscribe") ||
+                   dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "SubscribeBatched")) {
+                bool batched;
+                const char *sender;
                 char *client;
                 Set *s;
 
                 SELINUX_ACCESS_CHECK(connection, message, "status");
 
+                batched = streq(dbus_message_get_member(message), "SubscribeBatched");
+                sender = bus_message_get_sender_with_fallback(message);
+
                 s = BUS_CONNECTION_SUBSCRIBED(m, connection);
                 if (!s) {
                         s = set_new(string_hash_func, string_compare_func);
@@ -1182,7 +1345,7 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                         }
                 }
 
-                client = strdup(bus_message_get_sender_with_fallback(message));
+                client = strdup(sender);
                 if (!client)
                         goto oom;
 
@@ -1190,6 +1353,32 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                 if (r < 0)
                         return bus_send_error_reply(connection, message, NULL, r);
 
+                /* Clients that want batched signals are in both
+                 * sets, and don't get PropertiesChanged and UnitNew
+                 * signals for units unless somebody else wants
+                 * them */
+                if (batched) {
+                        s = BUS_CONNECTION_SUBSCRIBED_BATCHED(m, connection);
+                        if (!s) {
+                                s = set_new(string_hash_func, string_compare_func);
+                                if (!s)
+                                        goto oom;
+
+                                if (!dbus_connection_set_data(connection, m->subscribed_batched_data_slot, s, NULL)) {
+                                        set_free(s);
+                                        goto oom;
+                                }
+                        }
+
+                        client = strdup(sender);
+                        if (!client)
+                                goto oom;
+
+                        r = set_consume(s, client);
+                        if (r < 0)
+                                return bus_send_error_reply(connection, message, NULL, r);
+                }
+
                 reply = dbus_message_new_method_return(message);
                 if (!reply)
                         goto oom;
@@ -1206,6 +1395,7 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                 }
 
                 free(client);
+                free(set_remove(BUS_CONNECTION_SUBSCRIBED_BATCHED(m, connection), (char*) bus_message_get_sender_with_fallback(message)));
 
                 reply = dbus_message_new_method_return(message);
                 if (!reply)
@@ -85,12 +85,12 @@ static int bus_unit_append_dependencies(DBusMessageIter *i, const char *property
         Unit *u;
         Iterator j;
         DBusMessageIter sub;
-        Set *s = data;
+        DependencyList *l = data;
 
         if (!dbus_message_iter_open_container(i, DBUS_TYPE_ARRAY, "s", &sub))
                 return -ENOMEM;
 
-        SET_FOREACH(u, s, j)
+        DEPENDENCY_LIST_FOREACH(u, l, j)
                 if (!dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &u->id))
                         return -ENOMEM;
 
@@ -714,7 +714,9 @@ void bus_unit_send_change_signal(Unit *u) {
         if (!u->id)
                 return;
 
-        if (!bus_has_subscriber(u->manager)) {
+        /* Clients that asked for batched signals learn about this
+         * unit from UnitsChanged */
+        if (!bus_has_unbatched_subscriber(u->manager)) {
                 u->sent_dbus_new_signal = true;
                 return;
         }
@@ -775,6 +777,72 @@ oom:
         log_oom();
 }
 
+void bus_unit_send_batched_change_signal(Manager *m, Unit **units, unsigned n_units) {
+        _cleanup_dbus_message_unref_ DBusMessage *message = NULL;
+        DBusMessageIter iter, sub;
+        unsigned k;
+
+        assert(m);
+        assert(units || n_units <= 0);
+
+        /* Sends one signal with the new state of all units that
+         * changed in this iteration of the event loop */
+
+        if (n_units <= 0)
+                return;
+
+        message = dbus_message_new_signal("/org/freedesktop/systemd1",
+                                          "org.freedesktop.systemd1.Manager",
+                                          "UnitsChanged");
+        if (!message)
+                goto oom;
+
+        dbus_message_iter_init_append(message, &iter);
+
+        if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(sosss)", &sub))
+                goto oom;
+
+        for (k = 0; k < n_units; k++) {
+                _cleanup_free_ char *p = NULL;
+                const char *load_state, *active_state, *sub_state;
+                DBusMessageIter sub2;
+                Unit *u = units[k];
+
+                if (!u->id)
+                        continue;
+
+                p = unit_dbus_path(u);
+                if (!p)
+                        goto oom;
+
+                load_state = unit_load_state_to_string(u->load_state);
+                active_state = unit_active_state_to_string(unit_active_state(u));
+                sub_state = unit_sub_state_to_string(u);
+
+                if (!dbus_message_iter_open_container(&sub, DBUS_TYPE_STRUCT, NULL, &sub2) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &u->id) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_OBJECT_PATH, &p) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &load_state) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &active_state) ||
+                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &sub_state) ||
+                    !dbus_message_iter_close_container(&sub, &sub2))
+                        goto oom;
+
+                m->n_bus_changes_batched++;
+        }
+
+        if (!dbus_message_iter_close_container(&iter, &sub))
+                goto oom;
+
+        if (bus_broadcast(m, message) < 0)
+                goto oom;
+
+        return;
+
+oom:
+        log_oom();
+}
+
 void bus_unit_send_removed_signal(Unit *u) {
         _cleanup_free_ char *p = NULL;
         _cleanup_dbus_message_unref_ DBusMessage *m = NULL;
@@ -1313,6 +1381,7 @@ const BusProperty bus_unit_properties[] = {
         { "ConditionTimestampMonotonic", bus_property_append_usec,    "t", offsetof(Unit, condition_timestamp.monotonic)      },
         { "ConditionResult",      bus_property_append_bool,           "b", offsetof(Unit, condition_result)                   },
         { "LoadError",            bus_unit_append_load_error,      "(ss)", 0 },
+        { "LoadTimeUSec",         bus_property_append_usec,           "t", offsetof(Unit, load_usec)                          },
         { NULL, }
 };
 
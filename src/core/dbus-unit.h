@@ -122,6 +122,7 @@
         "  <property name=\"ConditionTimestampMonotonic\" type=\"t\" access=\"read\"/>\n" \
         "  <property name=\"ConditionResult\" type=\"b\" access=\"read\"/>\n" \
         "  <property name=\"LoadError\" type=\"(ss)\" access=\"read\"/>\n" \
+        "  <property name=\"LoadTimeUSec\" type=\"t\" access=\"read\"/>\n" \
         " </interface>\n"
 
 #define BUS_UNIT_CGROUP_INTERFACE                                       \
@@ -158,6 +159,7 @@ extern const BusProperty bus_unit_properties[];
 extern const BusProperty bus_unit_cgroup_properties[];
 
 void bus_unit_send_change_signal(Unit *u);
+void bus_unit_send_batched_change_signal(Manager *m, Unit **units, unsigned n_units);
 void bus_unit_send_removed_signal(Unit *u);
 
 DBusHandlerResult bus_unit_queue_job(
@@ -174,6 +174,7 @@ static void bus_remove_watch(DBusWatch *bus_watch, void *data) {
 
         assert(w->type == WATCH_DBUS_WATCH);
         assert_se(epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, w->fd, NULL) >= 0);
+        m->watch_generation++;
 
         if (w->fd_is_dupped)
                 close_nointr_nofail(w->fd);
@@ -285,6 +286,7 @@ static void bus_remove_timeout(DBusTimeout *timeout, void *data) {
         assert(w->type == WATCH_DBUS_TIMEOUT);
 
         assert_se(epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, w->fd, NULL) >= 0);
+        m->watch_generation++;
         close_nointr_nofail(w->fd);
         free(w);
 }
@@ -342,6 +344,8 @@ static DBusHandlerResult api_bus_message_filter(DBusConnection *connection, DBus
                         if (set_remove(BUS_CONNECTION_SUBSCRIBED(m, connection), (char*) name))
                                 log_debug("Subscription client vanished: %s (left: %u)", name, set_size(BUS_CONNECTION_SUBSCRIBED(m, connection)));
 
+                        free(set_remove(BUS_CONNECTION_SUBSCRIBED_BATCHED(m, connection), (char*) name));
+
                         if (old_owner[0] == 0)
                                 old_owner = NULL;
 
@@ -1150,6 +1154,10 @@ int bus_init(Manager *m, bool try_bus_connect) {
                 if (!dbus_connection_allocate_data_slot(&m->subscribed_data_slot))
                         goto oom;
 
+        if (m->subscribed_batched_data_slot < 0)
+                if (!dbus_connection_allocate_data_slot(&m->subscribed_batched_data_slot))
+                        goto oom;
+
         if (try_bus_connect) {
                 if ((r = bus_init_system(m)) < 0 ||
                     (r = bus_init_api(m)) < 0)
@@ -1191,6 +1199,8 @@ static void shutdown_connection(Manager *m, DBusConnection *c) {
                 set_free(s);
         }
 
+        set_free_free(BUS_CONNECTION_SUBSCRIBED_BATCHED(m, c));
+
         if (m->queued_message_connection == c) {
                 m->queued_message_connection = NULL;
 
@@ -1267,6 +1277,9 @@ void bus_done(Manager *m) {
 
         if (m->subscribed_data_slot >= 0)
                 dbus_connection_free_data_slot(&m->subscribed_data_slot);
+
+        if (m->subscribed_batched_data_slot >= 0)
+                dbus_connection_free_data_slot(&m->subscribed_batched_data_slot);
 }
 
 static void query_pid_pending_cb(DBusPendingCall *pending, void *userdata) {
@@ -1381,6 +1394,8 @@ int bus_broadcast(Manager *m, DBusMessage *message) {
                 if (c != m->system_bus || m->running_as == SYSTEMD_SYSTEM)
                         oom = !dbus_connection_send(c, message, NULL);
 
+        m->n_bus_signals++;
+
         return oom ? -ENOMEM : 0;
 }
 
@@ -1401,6 +1416,48 @@ bool bus_has_subscriber(Manager *m) {
         return false;
 }
 
+static bool bus_connection_has_unbatched_subscriber(Manager *m, DBusConnection *c) {
+        assert(m);
+        assert(c);
+
+        /* Clients that asked for batched signals are in both sets */
+        return set_size(BUS_CONNECTION_SUBSCRIBED(m, c)) > set_size(BUS_CONNECTION_SUBSCRIBED_BATCHED(m, c));
+}
+
+bool bus_has_unbatched_subscriber(Manager *m) {
+        Iterator i;
+        DBusConnection *c;
+
+        assert(m);
+
+        SET_FOREACH(c, m->bus_connections_for_dispatch, i)
+                if (bus_connection_has_unbatched_subscriber(m, c))
+                        return true;
+
+        SET_FOREACH(c, m->bus_connections, i)
+                if (bus_connection_has_unbatched_subscriber(m, c))
+                        return true;
+
+        return false;
+}
+
+bool bus_has_batched_subscriber(Manager *m) {
+        Iterator i;
+        DBusConnection *c;
+
+        assert(m);
+
+        SET_FOREACH(c, m->bus_connections_for_dispatch, i)
+                if (!set_isempty(BUS_CONNECTION_SUBSCRIBED_BATCHED(m, c)))
+                        return true;
+
+        SET_FOREACH(c, m->bus_connections, i)
+                if (!set_isempty(BUS_CONNECTION_SUBSCRIBED_BATCHED(m, c)))
+                        return true;
+
+        return false;
+}
+
 bool bus_connection_has_subscriber(Manager *m, DBusConnection *c) {
         assert(m);
         assert(c);
@@ -1489,3 +1546,35 @@ finish:
         if (message)
                 dbus_message_unref(message);
 }
+
+void bus_forward_agent_released(Manager *m, const char *path) {
+        DBusMessage *message;
+
+        assert(m);
+        assert(path);
+
+        /* Forward a release notification we got from the cgroups
+         * agent directly to the system bus, so that user instances
+         * are notified as well */
+        if (!m->system_bus)
+                return;
+
+        message = dbus_message_new_signal("/org/freedesktop/systemd1/agent", "org.freedesktop.systemd1.Agent", "Released");
+        if (!message) {
+                log_oom();
+                return;
+        }
+
+        if (!dbus_message_append_args(message,
+                                      DBUS_TYPE_STRING, &path,
+                                      DBUS_TYPE_INVALID)) {
+                log_oom();
+                goto finish;
+        }
+
+        if (!dbus_connection_send(m->system_bus, message, NULL))
+                log_oom();
+
+finish:
+        dbus_message_unref(message);
+}
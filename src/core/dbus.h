@@ -38,13 +38,17 @@ int bus_query_pid(Manager *m, const char *name);
 int bus_broadcast(Manager *m, DBusMessage *message);
 
 bool bus_has_subscriber(Manager *m);
+bool bus_has_unbatched_subscriber(Manager *m);
+bool bus_has_batched_subscriber(Manager *m);
 bool bus_connection_has_subscriber(Manager *m, DBusConnection *c);
 
 int bus_fdset_add_all(Manager *m, FDSet *fds);
 
 void bus_broadcast_finished(Manager *m, usec_t firmware_usec, usec_t loader_usec, usec_t kernel_usec, usec_t initrd_usec, usec_t userspace_usec, usec_t total_usec);
+void bus_forward_agent_released(Manager *m, const char *path);
 
 #define BUS_CONNECTION_SUBSCRIBED(m, c) dbus_connection_get_data((c), (m)->subscribed_data_slot)
+#define BUS_CONNECTION_SUBSCRIBED_BATCHED(m, c) dbus_connection_get_data((c), (m)->subscribed_batched_data_slot)
 #define BUS_PENDING_CALL_NAME(m, p) dbus_pending_call_get_data((p), (m)->name_data_slot)
 
 extern const char * const bus_interface_table[];
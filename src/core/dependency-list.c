@@ -0,0 +1,214 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "dependency-list.h"
+#include "macro.h"
+
+/* Lists longer than this get an index */
+#define DEPENDENCY_LIST_INDEX_MIN 16
+
+void dependency_list_free(DependencyList *l) {
+        if (!l)
+                return;
+
+        hashmap_free(l->index);
+        free(l);
+}
+
+static void dependency_list_build_index(DependencyList *l) {
+        unsigned k;
+
+        assert(l);
+        assert(!l->index);
+
+        /* If this fails we simply keep searching linearly */
+        l->index = hashmap_new(trivial_hash_func, trivial_compare_func);
+        if (!l->index)
+                return;
+
+        for (k = 0; k < l->n_units; k++)
+                if (hashmap_put(l->index, l->units[k], UINT_TO_PTR(k + 1)) < 0) {
+                        hashmap_free(l->index);
+                        l->index = NULL;
+                        return;
+                }
+}
+
+/* Returns the index + 1 of the unit, or 0 */
+static unsigned dependency_list_find(DependencyList *l, struct Unit *u) {
+        unsigned k;
+
+        if (!l)
+                return 0;
+
+        if (l->index)
+                return PTR_TO_UINT(hashmap_get(l->index, u));
+
+        for (k = 0; k < l->n_units; k++)
+                if (l->units[k] == u)
+                        return k + 1;
+
+        return 0;
+}
+
+bool dependency_list_contains(DependencyList *l, struct Unit *u) {
+        return dependency_list_find(l, u) > 0;
+}
+
+int dependency_list_put(DependencyList **l, struct Unit *u) {
+        DependencyList *n;
+        int r;
+
+        assert(l);
+        assert(u);
+
+        if (dependency_list_find(*l, u) > 0)
+                return 0;
+
+        if (!*l || (*l)->n_units >= (*l)->n_allocated) {
+                unsigned a;
+
+                a = *l ? (*l)->n_allocated * 2 : 2;
+
+                n = realloc(*l, offsetof(DependencyList, units) + a * sizeof(struct Unit*));
+                if (!n)
+                        return -ENOMEM;
+
+                if (!*l) {
+                        n->n_units = 0;
+                        n->index = NULL;
+                }
+
+                n->n_allocated = a;
+                *l = n;
+        }
+
+        n = *l;
+
+        if (n->index) {
+                r = hashmap_put(n->index, u, UINT_TO_PTR(n->n_units + 1));
+                if (r < 0)
+                        return r;
+        }
+
+        n->units[n->n_units++] = u;
+
+        if (!n->index && n->n_units > DEPENDENCY_LIST_INDEX_MIN)
+                dependency_list_build_index(n);
+
+        return 1;
+}
+
+struct Unit *dependency_list_remove(DependencyList *l, struct Unit *u) {
+        unsigned k;
+
+        k = dependency_list_find(l, u);
+        if (k <= 0)
+                return NULL;
+
+        k--;
+
+        if (l->index)
+                hashmap_remove(l->index, u);
+
+        /* Fill the hole with the last entry */
+        l->n_units--;
+        if (k < l->n_units) {
+                l->units[k] = l->units[l->n_units];
+
+                if (l->index)
+                        hashmap_replace(l->index, l->units[k], UINT_TO_PTR(k + 1));
+        }
+
+        return u;
+}
+
+int dependency_list_replace(DependencyList *l, struct Unit *old, struct Unit *u) {
+        unsigned k;
+        int r;
+
+        assert(u);
+
+        k = dependency_list_find(l, old);
+        if (k <= 0)
+                return -ENOENT;
+
+        if (dependency_list_find(l, u) > 0)
+                return -EEXIST;
+
+        if (l->index) {
+                r = hashmap_put(l->index, u, UINT_TO_PTR(k));
+                if (r < 0)
+                        return r;
+
+                hashmap_remove(l->index, old);
+        }
+
+        l->units[k - 1] = u;
+        return 0;
+}
+
+int dependency_list_move(DependencyList **l, DependencyList **other) {
+        unsigned k;
+        int r;
+
+        assert(l);
+        assert(other);
+
+        if (!*other)
+                return 0;
+
+        if (!*l) {
+                *l = *other;
+                *other = NULL;
+                return 0;
+        }
+
+        for (k = 0; k < (*other)->n_units; k++) {
+                r = dependency_list_put(l, (*other)->units[k]);
+                if (r < 0)
+                        return r;
+        }
+
+        dependency_list_free(*other);
+        *other = NULL;
+
+        return 0;
+}
+
+struct Unit *dependency_list_iterate(DependencyList *l, Iterator *i) {
+        unsigned k;
+
+        assert(i);
+
+        /* The iterator is simply the index of the next entry */
+        k = PTR_TO_UINT(*i);
+        if (!l || k >= l->n_units)
+                return NULL;
+
+        *i = (Iterator) UINT_TO_PTR(k + 1);
+        return l->units[k];
+}
@@ -0,0 +1,68 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdbool.h>
+
+#include "hashmap.h"
+
+/* The units a unit has one type of dependency on. Most of these are
+ * empty or have only a handful of entries, hence they are kept in a
+ * plain array, which is searched linearly. Only long lists get a
+ * hashmap on the side to find entries in it. The order of the entries
+ * changes when entries are removed. */
+
+typedef struct DependencyList {
+        unsigned n_units;
+        unsigned n_allocated;
+
+        /* Maps units to their index + 1, for long lists only */
+        Hashmap *index;
+
+        struct Unit *units[];
+} DependencyList;
+
+void dependency_list_free(DependencyList *l);
+
+bool dependency_list_contains(DependencyList *l, struct Unit *u);
+
+int dependency_list_put(DependencyList **l, struct Unit *u);
+struct Unit *dependency_list_remove(DependencyList *l, struct Unit *u);
+int dependency_list_replace(DependencyList *l, struct Unit *old, struct Unit *u);
+int dependency_list_move(DependencyList **l, DependencyList **other);
+
+struct Unit *dependency_list_iterate(DependencyList *l, Iterator *i);
+
+static inline unsigned dependency_list_size(DependencyList *l) {
+        return l ? l->n_units : 0;
+}
+
+static inline bool dependency_list_isempty(DependencyList *l) {
+        return dependency_list_size(l) == 0;
+}
+
+static inline struct Unit *dependency_list_first(DependencyList *l) {
+        return dependency_list_isempty(l) ? NULL : l->units[0];
+}
+
+#define DEPENDENCY_LIST_FOREACH(u, l, i) \
+        for ((i) = ITERATOR_FIRST, (u) = dependency_list_iterate((l), &(i)); (u); (u) = dependency_list_iterate((l), &(i)))
@@ -32,12 +32,27 @@
 #include "def.h"
 #include "path-util.h"
 
+/* How many udev events to handle at most in one go */
+#define DEVICE_EVENT_BATCH_MAX 256
+
 static const UnitActiveState state_translation_table[_DEVICE_STATE_MAX] = {
         [DEVICE_DEAD] = UNIT_INACTIVE,
         [DEVICE_PLUGGED] = UNIT_ACTIVE
 };
 
+static Hashmap **device_shard(Hashmap **shards, const char *path) {
+        assert(shards);
+        assert(path);
+
+        return shards + string_hash_func(path) % MANAGER_DEVICE_SHARDS;
+}
+
+static Device *device_get_by_sysfs(Manager *m, const char *sysfs) {
+        return hashmap_get(*device_shard(m->devices_by_sysfs, sysfs), sysfs);
+}
+
 static void device_unset_sysfs(Device *d) {
+        Hashmap **shard;
         Device *first;
 
         assert(d);
@@ -47,18 +62,91 @@ static void device_unset_sysfs(Device *d) {
 
         /* Remove this unit from the chain of devices which share the
          * same sysfs path. */
-        first = hashmap_get(UNIT(d)->manager->devices_by_sysfs, d->sysfs);
+        shard = device_shard(UNIT(d)->manager->devices_by_sysfs, d->sysfs);
+        first = hashmap_get(*shard, d->sysfs);
         LIST_REMOVE(Device, same_sysfs, first, d);
 
         if (first)
-                hashmap_remove_and_replace(UNIT(d)->manager->devices_by_sysfs, d->sysfs, first->sysfs, first);
+                hashmap_remove_and_replace(*shard, d->sysfs, first->sysfs, first);
         else
-                hashmap_remove(UNIT(d)->manager->devices_by_sysfs, d->sysfs);
+                hashmap_remove(*shard, d->sysfs);
 
         free(d->sysfs);
         d->sysfs = NULL;
 }
 
+static int device_set_sysfs(Device *d, const char *sysfs) {
+        Hashmap **shard;
+        Device *first;
+        int r;
+
+        assert(d);
+        assert(sysfs);
+        assert(!d->sysfs);
+
+        shard = device_shard(UNIT(d)->manager->devices_by_sysfs, sysfs);
+
+        r = hashmap_ensure_allocated(shard, string_hash_func, string_compare_func);
+        if (r < 0)
+                return r;
+
+        d->sysfs = strdup(sysfs);
+        if (!d->sysfs)
+                return -ENOMEM;
+
+        first = hashmap_get(*shard, sysfs);
+        LIST_PREPEND(Device, same_sysfs, first, d);
+
+        r = hashmap_replace(*shard, d->sysfs, first);
+        if (r < 0) {
+                LIST_REMOVE(Device, same_sysfs, first, d);
+                free(d->sysfs);
+                d->sysfs = NULL;
+                return r;
+        }
+
+        return 0;
+}
+
+int device_index_path(Device *d, const char *path) {
+        Hashmap **shard;
+        int r;
+
+        assert(d);
+        assert(path);
+
+        if (strv_contains(d->paths, path))
+                return 0;
+
+        shard = device_shard(UNIT(d)->manager->devices_by_path, path);
+
+        r = hashmap_ensure_allocated(shard, string_hash_func, string_compare_func);
+        if (r < 0)
+                return r;
+
+        r = strv_extend(&d->paths, path);
+        if (r < 0)
+                return r;
+
+        r = hashmap_put(*shard, d->paths[strv_length(d->paths) - 1], d);
+        if (r < 0 && r != -EEXIST)
+                return r;
+
+        return 0;
+}
+
+static void device_unindex_paths(Device *d) {
+        char **p;
+
+        assert(d);
+
+        STRV_FOREACH(p, d->paths)
+                hashmap_remove_value(*device_shard(UNIT(d)->manager->devices_by_path, *p), *p, d);
+
+        strv_free(d->paths);
+        d->paths = NULL;
+}
+
 static void device_init(Unit *u) {
         Device *d = DEVICE(u);
 
@@ -82,6 +170,7 @@ static void device_done(Unit *u) {
         assert(d);
 
         device_unset_sysfs(d);
+        device_unindex_paths(d);
 }
 
 static void device_set_state(Device *d, DeviceState state) {
@@ -157,8 +246,9 @@ static int device_add_escaped_name(Unit *u, const char *dn) {
         return 0;
 }
 
-static int device_find_escape_name(Manager *m, const char *dn, Unit **_u) {
+int device_find_escape_name(Manager *m, const char *dn, Unit **_u) {
         char *e;
+        Device *d;
         Unit *u;
 
         assert(m);
@@ -166,6 +256,14 @@ static int device_find_escape_name(Manager *m, const char *dn, Unit **_u) {
         assert(dn[0] == '/');
         assert(_u);
 
+        /* Units we have seen in a udev event before are indexed by
+         * path, only for the others we need to escape the name */
+        d = hashmap_get(*device_shard(m->devices_by_path, dn), dn);
+        if (d) {
+                *_u = UNIT(d);
+                return 1;
+        }
+
         e = unit_name_from_path(dn, ".device");
         if (!e)
                 return -ENOMEM;
@@ -218,26 +316,15 @@ static int device_update_unit(Manager *m, struct udev_device *dev, const char *p
          * initialized. Hence initialize it if necessary. */
 
         if (!DEVICE(u)->sysfs) {
-                Device *first;
-
-                if (!(DEVICE(u)->sysfs = strdup(sysfs))) {
-                        r = -ENOMEM;
-                        goto fail;
-                }
-
-                if (!m->devices_by_sysfs)
-                        if (!(m->devices_by_sysfs = hashmap_new(string_hash_func, string_compare_func))) {
-                                r = -ENOMEM;
-                                goto fail;
-                        }
-
-                first = hashmap_get(m->devices_by_sysfs, sysfs);
-                LIST_PREPEND(Device, same_sysfs, first, DEVICE(u));
-
-                if ((r = hashmap_replace(m->devices_by_sysfs, DEVICE(u)->sysfs, first)) < 0)
+                r = device_set_sysfs(DEVICE(u), sysfs);
+                if (r < 0)
                         goto fail;
         }
 
+        r = device_index_path(DEVICE(u), path);
+        if (r < 0)
+                goto fail;
+
         if ((model = udev_device_get_property_value(dev, "ID_MODEL_FROM_DATABASE")) ||
             (model = udev_device_get_property_value(dev, "ID_MODEL"))) {
                 if ((r = unit_set_description(u, model)) < 0)
@@ -315,6 +402,17 @@ fail:
         return r;
 }
 
+static void device_set_plugged(Manager *m, const char *sysfs) {
+        Device *d, *l;
+
+        assert(m);
+        assert(sysfs);
+
+        l = device_get_by_sysfs(m, sysfs);
+        LIST_FOREACH(same_sysfs, d, l)
+                device_set_state(d, DEVICE_PLUGGED);
+}
+
 static int device_process_new_device(Manager *m, struct udev_device *dev, bool update_state) {
         const char *sysfs, *dn;
         struct udev_list_entry *item = NULL, *first = NULL;
@@ -363,13 +461,8 @@ static int device_process_new_device(Manager *m, struct udev_device *dev, bool u
         }
 
         if (update_state) {
-                Device *d, *l;
-
                 manager_dispatch_load_queue(m);
-
-                l = hashmap_get(m->devices_by_sysfs, sysfs);
-                LIST_FOREACH(same_sysfs, d, l)
-                        device_set_state(d, DEVICE_PLUGGED);
+                device_set_plugged(m, sysfs);
         }
 
         return 0;
@@ -394,7 +487,7 @@ static int device_process_path(Manager *m, const char *path, bool update_state)
 
 static int device_process_removed_device(Manager *m, struct udev_device *dev) {
         const char *sysfs;
-        Device *d;
+        Device *d, *l;
 
         assert(m);
         assert(dev);
@@ -402,9 +495,15 @@ static int device_process_removed_device(Manager *m, struct udev_device *dev) {
         if (!(sysfs = udev_device_get_syspath(dev)))
                 return -ENOMEM;
 
-        /* Remove all units of this sysfs path */
-        while ((d = hashmap_get(m->devices_by_sysfs, sysfs))) {
-                device_unset_sysfs(d);
+        /* Remove all units of this sysfs path, taking the whole
+         * chain out of the index at once */
+        l = hashmap_remove(*device_shard(m->devices_by_sysfs, sysfs), sysfs);
+        while ((d = l)) {
+                LIST_REMOVE(Device, same_sysfs, l, d);
+
+                free(d->sysfs);
+                d->sysfs = NULL;
+
                 device_set_state(d, DEVICE_DEAD);
         }
 
@@ -469,6 +568,8 @@ fail:
 }
 
 static void device_shutdown(Manager *m) {
+        unsigned i;
+
         assert(m);
 
         if (m->udev_monitor) {
@@ -481,8 +582,13 @@ static void device_shutdown(Manager *m) {
                 m->udev = NULL;
         }
 
-        hashmap_free(m->devices_by_sysfs);
-        m->devices_by_sysfs = NULL;
+        for (i = 0; i < MANAGER_DEVICE_SHARDS; i++) {
+                hashmap_free(m->devices_by_sysfs[i]);
+                m->devices_by_sysfs[i] = NULL;
+
+                hashmap_free(m->devices_by_path[i]);
+                m->devices_by_path[i] = NULL;
+        }
 }
 
 static int device_enumerate(Manager *m) {
@@ -558,10 +664,136 @@ fail:
         return r;
 }
 
-void device_fd_event(Manager *m, int events) {
+typedef struct DeviceEvent {
         struct udev_device *dev;
+        bool remove;
+} DeviceEvent;
+
+static int device_queue_event(Manager *m, DeviceEvent *batch, unsigned *n, Hashmap **pending, struct udev_device *dev) {
+        const char *action, *ready, *sysfs;
+        DeviceEvent *e;
+        bool remove;
+        int r;
+
+        assert(m);
+        assert(batch);
+        assert(n);
+        assert(pending);
+        assert(dev);
+
+        action = udev_device_get_action(dev);
+        if (!action) {
+                log_error("Failed to get udev action string.");
+                udev_device_unref(dev);
+                return 0;
+        }
+
+        sysfs = udev_device_get_syspath(dev);
+        if (!sysfs) {
+                udev_device_unref(dev);
+                return -ENOMEM;
+        }
+
+        ready = udev_device_get_property_value(dev, "SYSTEMD_READY");
+        remove = streq(action, "remove") || (ready && parse_boolean(ready) == 0);
+
+        m->n_device_events++;
+
+        /* A change of a device that is still waiting in the batch
+         * supersedes the event we have for it, as long as neither
+         * of them removes it */
+        e = hashmap_get(*pending, sysfs);
+        if (e && !remove && streq(action, "change")) {
+                /* The key points into the old device, hence drop
+                 * it before we let go of that */
+                hashmap_remove(*pending, sysfs);
+                udev_device_unref(e->dev);
+                e->dev = dev;
+
+                r = hashmap_put(*pending, sysfs, e);
+                if (r < 0)
+                        return r;
+
+                m->n_device_events_coalesced++;
+                return 0;
+        }
+
+        e = batch + (*n)++;
+        e->dev = dev;
+        e->remove = remove;
+
+        if (remove) {
+                hashmap_remove(*pending, sysfs);
+                return 0;
+        }
+
+        r = hashmap_ensure_allocated(pending, string_hash_func, string_compare_func);
+        if (r < 0)
+                return r;
+
+        return hashmap_replace(*pending, sysfs, e);
+}
+
+static void device_update_event_rate(Manager *m, unsigned n) {
+        usec_t ts;
+
+        assert(m);
+
+        ts = now(CLOCK_MONOTONIC);
+
+        if (m->device_events_rate_begin <= 0)
+                m->device_events_rate_begin = ts;
+
+        m->device_events_rate_count += n;
+
+        if (ts - m->device_events_rate_begin >= USEC_PER_SEC) {
+                m->device_events_per_sec = (unsigned) ((uint64_t) m->device_events_rate_count * USEC_PER_SEC / (ts - m->device_events_rate_begin));
+                m->device_events_rate_begin = ts;
+                m->device_events_rate_count = 0;
+        }
+}
+
+unsigned device_events_per_sec(Manager *m) {
+        usec_t ts;
+
+        assert(m);
+
+        if (m->device_events_rate_begin <= 0)
+                return 0;
+
+        /* The rate is only updated when events come in. If the
+         * current window is over already, nothing came in to close
+         * it, hence count what it has seen so far. This way the
+         * rate goes down when things go quiet. */
+        ts = now(CLOCK_MONOTONIC);
+        if (ts - m->device_events_rate_begin >= USEC_PER_SEC)
+                return (unsigned) ((uint64_t) m->device_events_rate_count * USEC_PER_SEC / (ts - m->device_events_rate_begin));
+
+        return m->device_events_per_sec;
+}
+
+static void device_plug_batch(Manager *m, DeviceEvent *batch, unsigned n) {
+        unsigned k;
+
+        assert(m);
+        assert(batch || n == 0);
+
+        if (n == 0)
+                return;
+
+        manager_dispatch_load_queue(m);
+
+        for (k = 0; k < n; k++)
+                if (batch[k].dev && !batch[k].remove)
+                        device_set_plugged(m, udev_device_get_syspath(batch[k].dev));
+}
+
+void device_fd_event(Manager *m, int events) {
+        DeviceEvent batch[DEVICE_EVENT_BATCH_MAX];
+        Hashmap *pending = NULL;
+        unsigned n = 0, n_received = 0, n_coalesced, k, start;
+        usec_t ts;
         int r;
-        const char *action, *ready;
 
         assert(m);
 
@@ -574,35 +806,72 @@ void device_fd_event(Manager *m, int events) {
                         return;
         }
 
-        if (!(dev = udev_monitor_receive_device(m->udev_monitor))) {
-                /*
-                 * libudev might filter-out devices which pass the bloom filter,
-                 * so getting NULL here is not necessarily an error
-                 */
-                return;
-        }
+        /* Drain what is queued on the socket, up to a limit so that
+         * we get back to the main loop eventually. Repeated changes
+         * of the same device are merged, and only the last one is
+         * processed. */
+        n_coalesced = m->n_device_events_coalesced;
+        while (n < DEVICE_EVENT_BATCH_MAX && n_received < DEVICE_EVENT_BATCH_MAX * 4) {
+                struct udev_device *dev;
+
+                errno = 0;
+                dev = udev_monitor_receive_device(m->udev_monitor);
+                if (!dev) {
+                        /* libudev might filter-out devices which
+                         * pass the bloom filter, so getting NULL
+                         * here is not necessarily an error, and
+                         * means that nothing is queued anymore */
+                        if (errno == ENOBUFS)
+                                log_warning("udev event queue overran, device events were lost.");
+                        break;
+                }
 
-        if (!(action = udev_device_get_action(dev))) {
-                log_error("Failed to get udev action string.");
-                goto fail;
+                n_received++;
+
+                r = device_queue_event(m, batch, &n, &pending, dev);
+                if (r < 0) {
+                        log_error("Failed to queue udev device event: %s", strerror(-r));
+                        break;
+                }
         }
 
-        ready = udev_device_get_property_value(dev, "SYSTEMD_READY");
+        hashmap_free(pending);
 
-        if (streq(action, "remove") || (ready && parse_boolean(ready) == 0)) {
-                if ((r = device_process_removed_device(m, dev)) < 0) {
-                        log_error("Failed to process udev device event: %s", strerror(-r));
-                        goto fail;
-                }
-        } else {
-                if ((r = device_process_new_device(m, dev, true)) < 0) {
+        ts = now(CLOCK_MONOTONIC);
+
+        /* New units are loaded and plugged together, but a removal
+         * has to see everything before it plugged */
+        for (k = 0, start = 0; k < n; k++) {
+                if (batch[k].remove) {
+                        device_plug_batch(m, batch + start, k - start);
+                        start = k + 1;
+
+                        r = device_process_removed_device(m, batch[k].dev);
+                } else
+                        r = device_process_new_device(m, batch[k].dev, false);
+
+                if (r < 0) {
                         log_error("Failed to process udev device event: %s", strerror(-r));
-                        goto fail;
+
+                        udev_device_unref(batch[k].dev);
+                        batch[k].dev = NULL;
                 }
         }
 
-fail:
-        udev_device_unref(dev);
+        device_plug_batch(m, batch + start, n - start);
+
+        for (k = 0; k < n; k++)
+                udev_device_unref(batch[k].dev);
+
+        device_update_event_rate(m, n_received);
+
+        n_coalesced = m->n_device_events_coalesced - n_coalesced;
+        if (n > 1 || n_coalesced > 0) {
+                ts = now(CLOCK_MONOTONIC) - ts;
+                log_debug("Processed %u udev events in %llu us (%llu us per device), %u coalesced, %u events/s.",
+                          n, (unsigned long long) ts, (unsigned long long) (ts / n),
+                          n_coalesced, m->device_events_per_sec);
+        }
 }
 
 static const char* const device_state_table[_DEVICE_STATE_MAX] = {
@@ -45,6 +45,10 @@ struct Device {
 
         LIST_FIELDS(struct Device, same_sysfs);
 
+        /* The paths this unit is indexed under in
+         * m->devices_by_path */
+        char **paths;
+
         DeviceState state;
 };
 
@@ -52,5 +56,11 @@ extern const UnitVTable device_vtable;
 
 void device_fd_event(Manager *m, int events);
 
+unsigned device_events_per_sec(Manager *m);
+
+/* How udev events find the units of the paths of a device */
+int device_index_path(Device *d, const char *path);
+int device_find_escape_name(Manager *m, const char *dn, Unit **_u);
+
 const char* device_state_to_string(DeviceState i) _const_;
 DeviceState device_state_from_string(const char *s) _pure_;
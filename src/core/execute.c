@@ -38,6 +38,8 @@
 #include <linux/fs.h>
 #include <linux/oom.h>
 #include <sys/poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <linux/seccomp-bpf.h>
 #include <glob.h>
 #include <libgen.h>
@@ -56,6 +58,7 @@
 #include "ioprio.h"
 #include "securebits.h"
 #include "cgroup.h"
+#include "cgroup-util.h"
 #include "namespace.h"
 #include "tcpwrap.h"
 #include "exit-status.h"
@@ -204,7 +207,9 @@ static int open_null_as(int flags, int nfd) {
 }
 
 static int connect_logger_as(const ExecContext *context, ExecOutput output, const char *ident, const char *unit_id, int nfd) {
-        int fd, r;
+        char header[LINE_MAX];
+        int fd, r, l;
+        ssize_t k;
         union sockaddr_union sa = {
                 .un.sun_family = AF_UNIX,
                 .un.sun_path = "/run/systemd/journal/stdout",
@@ -230,7 +235,11 @@ static int connect_logger_as(const ExecContext *context, ExecOutput output, cons
                 return -errno;
         }
 
-        dprintf(fd,
+        /* This runs in the vfork() child too, hence no dprintf(),
+         * which allocates a FILE. journald reads the header line by
+         * line into a LINE_MAX buffer, so nothing longer would work
+         * anyway. */
+        l = snprintf(header, sizeof(header),
                 "%s\n"
                 "%s\n"
                 "%i\n"
@@ -246,6 +255,17 @@ static int connect_logger_as(const ExecContext *context, ExecOutput output, cons
                 output == EXEC_OUTPUT_KMSG || output == EXEC_OUTPUT_KMSG_AND_CONSOLE,
                 is_terminal_output(output));
 
+        if (l < 0 || (size_t) l >= sizeof(header)) {
+                close_nointr_nofail(fd);
+                return -ENOBUFS;
+        }
+
+        k = loop_write(fd, header, l, false);
+        if (k != l) {
+                close_nointr_nofail(fd);
+                return k < 0 ? (int) k : -EIO;
+        }
+
         if (fd != nfd) {
                 r = dup2(fd, nfd) < 0 ? -errno : nfd;
                 close_nointr_nofail(fd);
@@ -340,7 +360,7 @@ static int setup_input(const ExecContext *context, int socket_fd, bool apply_tty
         }
 }
 
-static int setup_output(const ExecContext *context, int fileno, int socket_fd, const char *ident, const char *unit_id, bool apply_tty_stdin) {
+static int setup_output(const ExecContext *context, int fileno, int socket_fd, const char *ident, const char *unit_id, bool apply_tty_stdin, int *logger_error) {
         ExecOutput o;
         ExecInput i;
         int r;
@@ -409,6 +429,13 @@ static int setup_output(const ExecContext *context, int fileno, int socket_fd, c
         case EXEC_OUTPUT_JOURNAL_AND_CONSOLE:
                 r = connect_logger_as(context, o, ident, unit_id, fileno);
                 if (r < 0) {
+                        /* Children sharing our address space may
+                         * not log, let the caller do it for them */
+                        if (logger_error) {
+                                *logger_error = r;
+                                return open_null_as(O_WRONLY, fileno);
+                        }
+
                         log_struct_unit(LOG_CRIT, unit_id,
                                 "MESSAGE=Failed to connect std%s of %s to the journal socket: %s",
                                 fileno == STDOUT_FILENO ? "out" : "err",
@@ -977,6 +1004,606 @@ static int apply_seccomp(uint32_t *syscall_filter) {
         return 0;
 }
 
+/* Data shared between exec_spawn_vfork() and a child created with
+ * CLONE_VM|CLONE_VFORK. The child runs on its own stack, but in our
+ * address space: it must not allocate memory, log, or modify any
+ * global state. Everything it needs is hence prepared here in
+ * advance, and failures are passed back for us to log. */
+typedef struct ExecSpawnData {
+        const ExecContext *context;
+        const char *path;
+        char **argv;
+        char **env;
+
+        const char *directory;
+        bool apply_permissions;
+        bool apply_chroot;
+        bool apply_tty_stdin;
+
+        const int *fds;
+        unsigned n_fds;
+        int socket_fd;
+
+        char **cgroup_tasks;
+        char **cgroup_tasks_optional;
+
+        char *listen_pid;
+
+        const char *ident;
+        const char *unit_id;
+
+        /* Filled in by the child */
+        int logger_error[2];
+        int error;
+        int exit_status;
+} ExecSpawnData;
+
+#define SPAWN_STACK_SIZE (256*1024)
+
+static void *spawn_stack = NULL;
+
+static bool exec_spawn_may_vfork(const ExecContext *context, char **argv, bool confirm_spawn, int idle_pipe[2]) {
+        char **a;
+
+        assert(context);
+
+        /* Only commands whose setup consists of plain system calls
+         * may be spawned without copying our page tables. User and
+         * group lookups, PAM, tcpwrap, namespaces, and terminal
+         * handling all need NSS, memory allocation or may block for
+         * a long time, and hence require a real fork(). */
+
+        if (confirm_spawn || idle_pipe)
+                return false;
+
+        if (context->user || context->group || !strv_isempty(context->supplementary_groups))
+                return false;
+
+        if (context->pam_name || context->tcpwrap_name || context->utmp_id)
+                return false;
+
+        if (context->private_network ||
+            context->private_tmp ||
+            !strv_isempty(context->read_write_dirs) ||
+            !strv_isempty(context->read_only_dirs) ||
+            !strv_isempty(context->inaccessible_dirs) ||
+            context->mount_flags != 0)
+                return false;
+
+        if (is_terminal_input(context->std_input) ||
+            context->std_output == EXEC_OUTPUT_TTY ||
+            context->std_error == EXEC_OUTPUT_TTY ||
+            context->tty_reset ||
+            context->tty_vhangup ||
+            context->tty_vt_disallocate)
+                return false;
+
+        if (context->capability_bounding_set_drop ||
+            context->capabilities ||
+            context->control_group_persistent >= 0)
+                return false;
+
+        /* $LISTEN_PID is only known in the child, hence we cannot
+         * substitute it into the command line in advance */
+        STRV_FOREACH(a, argv)
+                if (strstr(*a, "LISTEN_PID"))
+                        return false;
+
+        return true;
+}
+
+/* Like close_all_fds(), but without allocating memory, so that it may
+ * be called in a child sharing our address space. Other threads might
+ * open fds right until we are cloned, hence they have to be looked for
+ * in the child. */
+static int close_all_fds_vfork(const int except[], unsigned n_except) {
+        union {
+                struct dirent64 de;
+                uint8_t raw[4096];
+        } buf;
+        int dir_fd, r = 0;
+        bool again = true;
+
+        dir_fd = open("/proc/self/fd", O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+        if (dir_fd < 0) {
+                struct rlimit rl;
+                int fd;
+
+                if (getrlimit(RLIMIT_NOFILE, &rl) < 0)
+                        return -errno;
+
+                for (fd = 3; fd < (int) rl.rlim_max; fd++) {
+                        if (fd_in_set(fd, except, n_except))
+                                continue;
+
+                        if (close_nointr(fd) < 0)
+                                if (errno != EBADF && r == 0)
+                                        r = -errno;
+                }
+
+                return r;
+        }
+
+        /* Closing fds while reading the directory might make us
+         * miss entries, hence go on until nothing is left */
+        while (again) {
+                again = false;
+
+                if (lseek(dir_fd, 0, SEEK_SET) < 0) {
+                        r = -errno;
+                        break;
+                }
+
+                for (;;) {
+                        long n, i;
+
+                        n = syscall(SYS_getdents64, dir_fd, buf.raw, sizeof(buf.raw));
+                        if (n < 0) {
+                                r = -errno;
+                                goto finish;
+                        }
+                        if (n == 0)
+                                break;
+
+                        for (i = 0; i < n; ) {
+                                struct dirent64 *de = (struct dirent64*) (buf.raw + i);
+                                int fd;
+
+                                i += de->d_reclen;
+
+                                if (safe_atoi(de->d_name, &fd) < 0)
+                                        continue;
+
+                                if (fd < 3 || fd == dir_fd)
+                                        continue;
+
+                                if (fd_in_set(fd, except, n_except))
+                                        continue;
+
+                                if (close_nointr(fd) < 0) {
+                                        if (errno != EBADF && r == 0)
+                                                r = -errno;
+                                } else
+                                        again = true;
+                        }
+                }
+        }
+
+finish:
+        close_nointr(dir_fd);
+        return r;
+}
+
+static int get_cgroup_tasks(CGroupBonding *first, const char *cgroup_suffix, char ***essential, char ***optional) {
+        CGroupBonding *b;
+        int r;
+
+        assert(essential);
+        assert(optional);
+
+        LIST_FOREACH(by_unit, b, first) {
+                _cleanup_free_ char *p = NULL;
+                char *fs;
+
+                if (cgroup_suffix) {
+                        p = strjoin(b->path, "/", cgroup_suffix, NULL);
+                        if (!p)
+                                return -ENOMEM;
+                }
+
+                /* The group has just been realized and is still open,
+                 * no need to create or check it again */
+                if (!p && b->dir_fd >= 0)
+                        r = cg_get_path(b->controller, b->path, "tasks", &fs);
+                else {
+                        r = cg_create(b->controller, p ? p : b->path, NULL);
+                        if (r >= 0)
+                                r = cg_get_path_and_check(b->controller, p ? p : b->path, "tasks", &fs);
+                }
+                if (r < 0) {
+                        if (b->essential)
+                                return r;
+
+                        continue;
+                }
+
+                r = strv_push(b->essential ? essential : optional, fs);
+                if (r < 0) {
+                        free(fs);
+                        return r;
+                }
+        }
+
+        return 0;
+}
+
+static int write_pid_to(const char *fn, pid_t pid) {
+        char t[DECIMAL_STR_MAX(pid_t) + 2];
+        int fd, r = 0;
+
+        fd = open(fn, O_WRONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        snprintf(t, sizeof(t), "%lu\n", (unsigned long) pid);
+        if (write(fd, t, strlen(t)) < 0)
+                r = -errno;
+
+        close_nointr(fd);
+        return r;
+}
+
+static int exec_child_vfork(void *userdata) {
+        ExecSpawnData *d = userdata;
+        const ExecContext *context = d->context;
+        char **t;
+        sigset_t ss;
+        unsigned i;
+        pid_t pid;
+        int err, r;
+
+        /* glibc's cached PID is our parent's */
+        pid = (pid_t) syscall(SYS_getpid);
+
+        /* Our parent blocked all signals before cloning us, so no
+         * handler could have run on our stack so far. Reset them
+         * before we unblock anything. */
+        default_signals(SIGNALS_CRASH_HANDLER,
+                        SIGNALS_IGNORE, -1);
+
+        if (context->ignore_sigpipe)
+                ignore_signals(SIGPIPE, -1);
+
+        assert_se(sigemptyset(&ss) == 0);
+        if (sigprocmask(SIG_SETMASK, &ss, NULL) < 0) {
+                err = -errno;
+                r = EXIT_SIGNAL_MASK;
+                goto fail;
+        }
+
+        err = close_all_fds_vfork(d->socket_fd >= 0 ? &d->socket_fd : d->fds,
+                                  d->socket_fd >= 0 ? 1 : d->n_fds);
+        if (err < 0) {
+                r = EXIT_FDS;
+                goto fail;
+        }
+
+        if (!context->same_pgrp)
+                if (setsid() < 0) {
+                        err = -errno;
+                        r = EXIT_SETSID;
+                        goto fail;
+                }
+
+        if (d->socket_fd >= 0)
+                fd_nonblock(d->socket_fd, false);
+
+        err = setup_input(context, d->socket_fd, d->apply_tty_stdin);
+        if (err < 0) {
+                r = EXIT_STDIN;
+                goto fail;
+        }
+
+        err = setup_output(context, STDOUT_FILENO, d->socket_fd, d->ident, d->unit_id, d->apply_tty_stdin, &d->logger_error[0]);
+        if (err < 0) {
+                r = EXIT_STDOUT;
+                goto fail;
+        }
+
+        err = setup_output(context, STDERR_FILENO, d->socket_fd, d->ident, d->unit_id, d->apply_tty_stdin, &d->logger_error[1]);
+        if (err < 0) {
+                r = EXIT_STDERR;
+                goto fail;
+        }
+
+        STRV_FOREACH(t, d->cgroup_tasks) {
+                err = write_pid_to(*t, pid);
+                if (err < 0) {
+                        r = EXIT_CGROUP;
+                        goto fail;
+                }
+        }
+
+        STRV_FOREACH(t, d->cgroup_tasks_optional)
+                write_pid_to(*t, pid);
+
+        if (context->oom_score_adjust_set) {
+                char a[DECIMAL_STR_MAX(int) + 1];
+                int fd;
+
+                snprintf(a, sizeof(a), "%i", context->oom_score_adjust);
+
+                fd = open("/proc/self/oom_score_adj", O_WRONLY|O_CLOEXEC|O_NOCTTY);
+                if (fd < 0 || write(fd, a, strlen(a)) < 0) {
+                        err = -errno;
+                        r = EXIT_OOM_ADJUST;
+                        goto fail;
+                }
+
+                close_nointr(fd);
+        }
+
+        if (context->nice_set)
+                if (setpriority(PRIO_PROCESS, 0, context->nice) < 0) {
+                        err = -errno;
+                        r = EXIT_NICE;
+                        goto fail;
+                }
+
+        if (context->cpu_sched_set) {
+                struct sched_param param = {
+                        .sched_priority = context->cpu_sched_priority,
+                };
+
+                if (sched_setscheduler(0,
+                                       context->cpu_sched_policy |
+                                       (context->cpu_sched_reset_on_fork ?
+                                        SCHED_RESET_ON_FORK : 0),
+                                       &param) < 0) {
+                        err = -errno;
+                        r = EXIT_SETSCHEDULER;
+                        goto fail;
+                }
+        }
+
+        if (context->cpuset)
+                if (sched_setaffinity(0, CPU_ALLOC_SIZE(context->cpuset_ncpus), context->cpuset) < 0) {
+                        err = -errno;
+                        r = EXIT_CPUAFFINITY;
+                        goto fail;
+                }
+
+        if (context->ioprio_set)
+                if (ioprio_set(IOPRIO_WHO_PROCESS, 0, context->ioprio) < 0) {
+                        err = -errno;
+                        r = EXIT_IOPRIO;
+                        goto fail;
+                }
+
+        if (context->timer_slack_nsec != (nsec_t) -1)
+                if (prctl(PR_SET_TIMERSLACK, context->timer_slack_nsec) < 0) {
+                        err = -errno;
+                        r = EXIT_TIMERSLACK;
+                        goto fail;
+                }
+
+        umask(context->umask);
+
+        if (d->apply_chroot && context->root_directory)
+                if (chroot(context->root_directory) < 0) {
+                        err = -errno;
+                        r = EXIT_CHROOT;
+                        goto fail;
+                }
+
+        if (chdir(d->directory) < 0) {
+                err = -errno;
+                r = EXIT_CHDIR;
+                goto fail;
+        }
+
+        if (d->n_fds > 0) {
+                int *fds;
+
+                /* shift_fds() sorts the array, work on a copy */
+                fds = alloca(sizeof(int) * d->n_fds);
+                memcpy(fds, d->fds, sizeof(int) * d->n_fds);
+
+                err = shift_fds(fds, d->n_fds);
+                if (err >= 0)
+                        err = flags_fds(fds, d->n_fds, context->non_blocking);
+                if (err < 0) {
+                        r = EXIT_FDS;
+                        goto fail;
+                }
+        }
+
+        if (d->apply_permissions) {
+
+                for (i = 0; i < RLIMIT_NLIMITS; i++) {
+                        if (!context->rlimit[i])
+                                continue;
+
+                        if (setrlimit_closest(i, context->rlimit[i]) < 0) {
+                                err = -errno;
+                                r = EXIT_LIMITS;
+                                goto fail;
+                        }
+                }
+
+                if (prctl(PR_GET_SECUREBITS) != context->secure_bits)
+                        if (prctl(PR_SET_SECUREBITS, context->secure_bits) < 0) {
+                                err = -errno;
+                                r = EXIT_SECUREBITS;
+                                goto fail;
+                        }
+
+                if (context->no_new_privileges)
+                        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0) {
+                                err = -errno;
+                                r = EXIT_NO_NEW_PRIVILEGES;
+                                goto fail;
+                        }
+
+                if (context->syscall_filter) {
+                        err = apply_seccomp(context->syscall_filter);
+                        if (err < 0) {
+                                r = EXIT_SECCOMP;
+                                goto fail;
+                        }
+                }
+        }
+
+        /* The placeholder was sized for any PID */
+        if (d->listen_pid)
+                snprintf(d->listen_pid + strlen("LISTEN_PID="), DECIMAL_STR_MAX(pid_t), "%lu", (unsigned long) pid);
+
+        execve(d->path, d->argv, d->env);
+        err = -errno;
+        r = EXIT_EXEC;
+
+fail:
+        d->error = err;
+        d->exit_status = r;
+        _exit(r);
+}
+
+/* Returns the PID of the new process, or 0 if the command cannot be
+ * spawned this way after all and a full fork() is needed. */
+static pid_t exec_spawn_vfork(ExecCommand *command,
+                              char **argv,
+                              ExecContext *context,
+                              int fds[], unsigned n_fds,
+                              int socket_fd,
+                              char **environment,
+                              char **files_env,
+                              bool apply_permissions,
+                              bool apply_chroot,
+                              bool apply_tty_stdin,
+                              CGroupBonding *cgroup_bondings,
+                              const char *cgroup_suffix,
+                              const char *unit_id) {
+
+        _cleanup_strv_free_ char **our_env = NULL, **final_env = NULL, **final_argv = NULL,
+                **cgroup_tasks = NULL, **cgroup_tasks_optional = NULL;
+        _cleanup_free_ char *directory = NULL;
+        unsigned n_env = 0, i;
+        ExecSpawnData d = {};
+        sigset_t ss, saved_ss;
+        pid_t pid;
+        int r;
+
+        if (!spawn_stack) {
+                spawn_stack = mmap(NULL, SPAWN_STACK_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_STACK, -1, 0);
+                if (spawn_stack == MAP_FAILED) {
+                        spawn_stack = NULL;
+                        return 0;
+                }
+        }
+
+        r = get_cgroup_tasks(cgroup_bondings, cgroup_suffix, &cgroup_tasks, &cgroup_tasks_optional);
+        if (r < 0)
+                return 0;
+
+        our_env = new0(char*, 3);
+        if (!our_env)
+                return log_oom();
+
+        if (n_fds > 0) {
+                char *p;
+
+                /* Reserve room for the child to fill in its PID */
+                p = new(char, strlen("LISTEN_PID=") + DECIMAL_STR_MAX(pid_t));
+                if (!p)
+                        return log_oom();
+
+                memset(stpcpy(p, "LISTEN_PID="), '0', DECIMAL_STR_MAX(pid_t) - 1);
+                p[strlen("LISTEN_PID=") + DECIMAL_STR_MAX(pid_t) - 1] = 0;
+                our_env[n_env++] = p;
+
+                if (asprintf(our_env + n_env++, "LISTEN_FDS=%u", n_fds) < 0)
+                        return log_oom();
+        }
+
+        final_env = strv_env_merge(4,
+                                   environment,
+                                   our_env,
+                                   context->environment,
+                                   files_env,
+                                   NULL);
+        if (!final_env)
+                return log_oom();
+
+        final_argv = replace_env_argv(argv, final_env);
+        if (!final_argv)
+                return log_oom();
+
+        final_env = strv_env_clean(final_env);
+
+        if (n_fds > 0) {
+                char **e;
+
+                STRV_FOREACH(e, final_env)
+                        if (streq(*e, our_env[0])) {
+                                d.listen_pid = *e;
+                                break;
+                        }
+        }
+
+        if (apply_chroot)
+                d.directory = context->working_directory ? context->working_directory : "/";
+        else {
+                if (asprintf(&directory, "%s/%s",
+                             context->root_directory ? context->root_directory : "",
+                             context->working_directory ? context->working_directory : "") < 0)
+                        return log_oom();
+
+                d.directory = directory;
+        }
+
+        if (_unlikely_(log_get_max_level() >= LOG_PRI(LOG_DEBUG))) {
+                _cleanup_free_ char *line = NULL;
+
+                line = exec_command_line(final_argv);
+                if (line)
+                        log_struct_unit(LOG_DEBUG,
+                                        unit_id,
+                                        "EXECUTABLE=%s", command->path,
+                                        "MESSAGE=Executing: %s", line,
+                                        NULL);
+        }
+
+        d.context = context;
+        d.path = command->path;
+        d.argv = final_argv;
+        d.env = final_env;
+        d.apply_permissions = apply_permissions;
+        d.apply_chroot = apply_chroot;
+        d.apply_tty_stdin = apply_tty_stdin;
+        d.fds = fds;
+        d.n_fds = n_fds;
+        d.socket_fd = socket_fd;
+        d.cgroup_tasks = cgroup_tasks;
+        d.cgroup_tasks_optional = cgroup_tasks_optional;
+        d.ident = path_get_file_name(command->path);
+        d.unit_id = unit_id;
+
+        /* Make sure none of our signal handlers runs in the child
+         * before it had a chance to reset them */
+        assert_se(sigfillset(&ss) == 0);
+        assert_se(sigprocmask(SIG_SETMASK, &ss, &saved_ss) == 0);
+
+        /* We are suspended until the child called execve() or
+         * exited, so that it can freely use our memory. */
+        pid = clone(exec_child_vfork, (uint8_t*) spawn_stack + SPAWN_STACK_SIZE, CLONE_VM|CLONE_VFORK|SIGCHLD, &d);
+        r = pid < 0 ? -errno : 0;
+
+        assert_se(sigprocmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        if (r < 0)
+                return r;
+
+        for (i = 0; i < ELEMENTSOF(d.logger_error); i++)
+                if (d.logger_error[i] < 0)
+                        log_struct_unit(LOG_CRIT, unit_id,
+                                        "MESSAGE=Failed to connect std%s of %s to the journal socket: %s",
+                                        i == 0 ? "out" : "err",
+                                        unit_id, strerror(-d.logger_error[i]),
+                                        "ERRNO=%d", -d.logger_error[i],
+                                        NULL);
+
+        if (d.exit_status != 0)
+                log_struct(LOG_ERR, MESSAGE_ID(SD_MESSAGE_SPAWN_FAILED),
+                           "EXECUTABLE=%s", command->path,
+                           "MESSAGE=Failed at step %s spawning %s: %s",
+                                  exit_status_to_string(d.exit_status, EXIT_STATUS_SYSTEMD),
+                                  command->path, strerror(-d.error),
+                           "ERRNO=%d", -d.error,
+                           NULL);
+
+        return pid;
+}
+
 int exec_spawn(ExecCommand *command,
                char **argv,
                ExecContext *context,
@@ -1043,8 +1670,10 @@ int exec_spawn(ExecCommand *command,
         free(line);
 
         r = cgroup_bonding_realize_list(cgroup_bondings);
-        if (r < 0)
+        if (r < 0) {
+                cgroup_bonding_close_fds_list(cgroup_bondings);
                 return r;
+        }
 
         /* We must initialize the attributes in the parent, before we
         fork, because we really need them initialized before making
@@ -1055,13 +1684,31 @@ int exec_spawn(ExecCommand *command,
 
         if (context->private_tmp && !context->tmp_dir && !context->var_tmp_dir) {
                 r = setup_tmpdirs(&context->tmp_dir, &context->var_tmp_dir);
-                if (r < 0)
+                if (r < 0) {
+                        cgroup_bonding_close_fds_list(cgroup_bondings);
                         return r;
+                }
         }
 
-        pid = fork();
-        if (pid < 0)
-                return -errno;
+        pid = 0;
+        if (exec_spawn_may_vfork(context, argv, confirm_spawn, idle_pipe)) {
+                pid = exec_spawn_vfork(command, argv, context, fds, n_fds, socket_fd,
+                                       environment, files_env,
+                                       apply_permissions, apply_chroot, apply_tty_stdin,
+                                       cgroup_bondings, cgroup_suffix, unit_id);
+                if (pid < 0) {
+                        cgroup_bonding_close_fds_list(cgroup_bondings);
+                        return pid;
+                }
+        }
+
+        if (pid == 0)
+                pid = fork();
+        if (pid < 0) {
+                r = -errno;
+                cgroup_bonding_close_fds_list(cgroup_bondings);
+                return r;
+        }
 
         if (pid == 0) {
                 int i, err;
@@ -1173,13 +1820,13 @@ int exec_spawn(ExecCommand *command,
                         goto fail_child;
                 }
 
-                err = setup_output(context, STDOUT_FILENO, socket_fd, path_get_file_name(command->path), unit_id, apply_tty_stdin);
+                err = setup_output(context, STDOUT_FILENO, socket_fd, path_get_file_name(command->path), unit_id, apply_tty_stdin, NULL);
                 if (err < 0) {
                         r = EXIT_STDOUT;
                         goto fail_child;
                 }
 
-                err = setup_output(context, STDERR_FILENO, socket_fd, path_get_file_name(command->path), unit_id, apply_tty_stdin);
+                err = setup_output(context, STDERR_FILENO, socket_fd, path_get_file_name(command->path), unit_id, apply_tty_stdin, NULL);
                 if (err < 0) {
                         r = EXIT_STDERR;
                         goto fail_child;
@@ -1564,6 +2211,11 @@ int exec_spawn(ExecCommand *command,
          * killed too). */
         cgroup_bonding_install_list(cgroup_bondings, pid, cgroup_suffix);
 
+        /* The group directories are only kept open while spawning,
+         * so that the number of units does not count against our
+         * file descriptor limit */
+        cgroup_bonding_close_fds_list(cgroup_bondings);
+
         exec_status_start(&command->exec_status, pid);
 
         *ret = pid;
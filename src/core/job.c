@@ -37,6 +37,7 @@
 #include "special.h"
 #include "sync.h"
 #include "virt.h"
+#include "serialize.h"
 
 JobBusClient* job_bus_client_new(DBusConnection *connection, const char *name) {
         JobBusClient *cl;
@@ -107,10 +108,8 @@ void job_free(Job *j) {
         if (j->timer_watch.type != WATCH_INVALID) {
                 assert(j->timer_watch.type == WATCH_JOB_TIMER);
                 assert(j->timer_watch.data.job == j);
-                assert(j->timer_watch.fd >= 0);
 
-                assert_se(epoll_ctl(j->manager->epoll_fd, EPOLL_CTL_DEL, j->timer_watch.fd, NULL) >= 0);
-                close_nointr_nofail(j->timer_watch.fd);
+                manager_unwatch_timer(j->manager, &j->timer_watch);
         }
 
         while ((cl = j->bus_client_list)) {
@@ -444,7 +443,7 @@ bool job_is_runnable(Job *j) {
                  * dependencies, regardless whether they are
                  * starting or stopping something. */
 
-                SET_FOREACH(other, j->unit->dependencies[UNIT_AFTER], i)
+                UNIT_FOREACH_DEPENDENCY(other, j->unit, UNIT_AFTER, i)
                         if (other->job)
                                 return false;
         }
@@ -452,7 +451,7 @@ bool job_is_runnable(Job *j) {
         /* Also, if something else is being stopped and we should
          * change state after it, then lets wait. */
 
-        SET_FOREACH(other, j->unit->dependencies[UNIT_BEFORE], i)
+        UNIT_FOREACH_DEPENDENCY(other, j->unit, UNIT_BEFORE, i)
                 if (other->job &&
                     (other->job->type == JOB_STOP ||
                      other->job->type == JOB_RESTART))
@@ -796,19 +795,19 @@ int job_finish_and_invalidate(Job *j, JobResult result, bool recursive) {
                 if (t == JOB_START ||
                     t == JOB_VERIFY_ACTIVE) {
 
-                        SET_FOREACH(other, u->dependencies[UNIT_REQUIRED_BY], i)
+                        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUIRED_BY, i)
                                 if (other->job &&
                                     (other->job->type == JOB_START ||
                                      other->job->type == JOB_VERIFY_ACTIVE))
                                         job_finish_and_invalidate(other->job, JOB_DEPENDENCY, true);
 
-                        SET_FOREACH(other, u->dependencies[UNIT_BOUND_BY], i)
+                        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_BOUND_BY, i)
                                 if (other->job &&
                                     (other->job->type == JOB_START ||
                                      other->job->type == JOB_VERIFY_ACTIVE))
                                         job_finish_and_invalidate(other->job, JOB_DEPENDENCY, true);
 
-                        SET_FOREACH(other, u->dependencies[UNIT_REQUIRED_BY_OVERRIDABLE], i)
+                        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUIRED_BY_OVERRIDABLE, i)
                                 if (other->job &&
                                     !other->job->override &&
                                     (other->job->type == JOB_START ||
@@ -817,7 +816,7 @@ int job_finish_and_invalidate(Job *j, JobResult result, bool recursive) {
 
                 } else if (t == JOB_STOP) {
 
-                        SET_FOREACH(other, u->dependencies[UNIT_CONFLICTED_BY], i)
+                        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_CONFLICTED_BY, i)
                                 if (other->job &&
                                     (other->job->type == JOB_START ||
                                      other->job->type == JOB_VERIFY_ACTIVE))
@@ -847,10 +846,10 @@ int job_finish_and_invalidate(Job *j, JobResult result, bool recursive) {
 
 finish:
         /* Try to start the next jobs that can be started */
-        SET_FOREACH(other, u->dependencies[UNIT_AFTER], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_AFTER, i)
                 if (other->job)
                         job_add_to_run_queue(other->job);
-        SET_FOREACH(other, u->dependencies[UNIT_BEFORE], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_BEFORE, i)
                 if (other->job)
                         job_add_to_run_queue(other->job);
 
@@ -860,12 +859,7 @@ finish:
 }
 
 int job_start_timer(Job *j) {
-        struct itimerspec its = {};
-        struct epoll_event ev = {
-                .data.ptr = &j->timer_watch,
-                .events = EPOLLIN,
-        };
-        int fd, r;
+        int r;
 
         if (j->unit->job_timeout <= 0 ||
             j->timer_watch.type == WATCH_JOB_TIMER)
@@ -873,34 +867,16 @@ int job_start_timer(Job *j) {
 
         assert(j->timer_watch.type == WATCH_INVALID);
 
-        if ((fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) < 0) {
-                r = -errno;
-                goto fail;
-        }
-
-        timespec_store(&its.it_value, j->unit->job_timeout);
-
-        if (timerfd_settime(fd, 0, &its, NULL) < 0) {
-                r = -errno;
-                goto fail;
-        }
-
-        if (epoll_ctl(j->manager->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
-                r = -errno;
-                goto fail;
-        }
+        r = manager_watch_timer(j->manager, &j->timer_watch, CLOCK_MONOTONIC,
+                                now(CLOCK_MONOTONIC) + j->unit->job_timeout);
+        if (r < 0)
+                return r;
 
         j->timer_watch.type = WATCH_JOB_TIMER;
-        j->timer_watch.fd = fd;
+        j->timer_watch.fd = -1;
         j->timer_watch.data.job = j;
 
         return 0;
-
-fail:
-        if (fd >= 0)
-                close_nointr_nofail(fd);
-
-        return r;
 }
 
 void job_add_to_run_queue(Job *j) {
@@ -950,54 +926,40 @@ void job_timer_event(Job *j, uint64_t n_elapsed, Watch *w) {
 }
 
 int job_serialize(Job *j, FILE *f, FDSet *fds) {
-        fprintf(f, "job-id=%u\n", j->id);
-        fprintf(f, "job-type=%s\n", job_type_to_string(j->type));
-        fprintf(f, "job-state=%s\n", job_state_to_string(j->state));
-        fprintf(f, "job-override=%s\n", yes_no(j->override));
-        fprintf(f, "job-irreversible=%s\n", yes_no(j->irreversible));
-        fprintf(f, "job-sent-dbus-new-signal=%s\n", yes_no(j->sent_dbus_new_signal));
-        fprintf(f, "job-ignore-order=%s\n", yes_no(j->ignore_order));
+        Serializer *s = j->manager->serializer;
+
+        serialize_item_format(s, f, "job-id", "%u", j->id);
+        serialize_item(s, f, "job-type", job_type_to_string(j->type));
+        serialize_item(s, f, "job-state", job_state_to_string(j->state));
+        serialize_item(s, f, "job-override", yes_no(j->override));
+        serialize_item(s, f, "job-irreversible", yes_no(j->irreversible));
+        serialize_item(s, f, "job-sent-dbus-new-signal", yes_no(j->sent_dbus_new_signal));
+        serialize_item(s, f, "job-ignore-order", yes_no(j->ignore_order));
         /* Cannot save bus clients. Just note the fact that we're losing
          * them. job_send_message() will fallback to broadcasting. */
-        fprintf(f, "job-forgot-bus-clients=%s\n",
-                yes_no(j->forgot_bus_clients || j->bus_client_list));
-        if (j->timer_watch.type == WATCH_JOB_TIMER) {
-                int copy = fdset_put_dup(fds, j->timer_watch.fd);
-                if (copy < 0)
-                        return copy;
-                fprintf(f, "job-timer-watch-fd=%d\n", copy);
-        }
+        serialize_item(s, f, "job-forgot-bus-clients",
+                       yes_no(j->forgot_bus_clients || j->bus_client_list));
+        if (j->timer_watch.type == WATCH_JOB_TIMER)
+                serialize_item_format(s, f, "job-timer-watch-usec", "%llu",
+                                      (unsigned long long) j->timer_watch.timer.next_elapse);
 
         /* End marker */
-        fputc('\n', f);
+        serialize_end(s, f);
         return 0;
 }
 
 int job_deserialize(Job *j, FILE *f, FDSet *fds) {
-        for (;;) {
-                char line[LINE_MAX], *l, *v;
-                size_t k;
-
-                if (!fgets(line, sizeof(line), f)) {
-                        if (feof(f))
-                                return 0;
-                        return -errno;
-                }
+        Deserializer *d = j->manager->deserializer;
 
-                char_array_0(line);
-                l = strstrip(line);
+        assert(d);
 
-                /* End marker */
-                if (l[0] == 0)
-                        return 0;
-
-                k = strcspn(l, "=");
+        for (;;) {
+                char *l, *v;
+                int r;
 
-                if (l[k] == '=') {
-                        l[k] = 0;
-                        v = l+k+1;
-                } else
-                        v = l+k;
+                r = deserialize_next(d, f, &l, &v);
+                if (r <= 0)
+                        return r;
 
                 if (streq(l, "job-id")) {
                         if (safe_atou32(v, &j->id) < 0)
@@ -1046,35 +1008,46 @@ int job_deserialize(Job *j, FILE *f, FDSet *fds) {
                                 log_debug("Failed to parse job forgot_bus_clients flag %s", v);
                         else
                                 j->forgot_bus_clients = j->forgot_bus_clients || b;
+                } else if (streq(l, "job-timer-watch-usec")) {
+                        unsigned long long u;
+                        if (safe_atollu(v, &u) < 0)
+                                log_debug("Failed to parse job-timer-watch-usec value %s", v);
+                        else {
+                                j->timer_watch.type = WATCH_JOB_TIMER;
+                                j->timer_watch.timer.next_elapse = (usec_t) u;
+                                j->timer_watch.data.job = j;
+                        }
                 } else if (streq(l, "job-timer-watch-fd")) {
+                        struct itimerspec its;
                         int fd;
+
+                        /* Older versions passed the timerfd itself,
+                         * convert it into an absolute time */
                         if (safe_atoi(v, &fd) < 0 || fd < 0 || !fdset_contains(fds, fd))
                                 log_debug("Failed to parse job-timer-watch-fd value %s", v);
                         else {
-                                if (j->timer_watch.type == WATCH_JOB_TIMER)
-                                        close_nointr_nofail(j->timer_watch.fd);
+                                fd = fdset_remove(fds, fd);
 
-                                j->timer_watch.type = WATCH_JOB_TIMER;
-                                j->timer_watch.fd = fdset_remove(fds, fd);
-                                j->timer_watch.data.job = j;
+                                if (timerfd_gettime(fd, &its) < 0)
+                                        log_debug("Failed to query job timer: %m");
+                                else {
+                                        j->timer_watch.type = WATCH_JOB_TIMER;
+                                        j->timer_watch.timer.next_elapse = now(CLOCK_MONOTONIC) + timespec_load(&its.it_value);
+                                        j->timer_watch.data.job = j;
+                                }
+
+                                close_nointr_nofail(fd);
                         }
                 }
         }
 }
 
 int job_coldplug(Job *j) {
-        struct epoll_event ev = {
-                .data.ptr = &j->timer_watch,
-                .events = EPOLLIN,
-        };
-
         if (j->timer_watch.type != WATCH_JOB_TIMER)
                 return 0;
 
-        if (epoll_ctl(j->manager->epoll_fd, EPOLL_CTL_ADD, j->timer_watch.fd, &ev) < 0)
-                return -errno;
-
-        return 0;
+        return manager_watch_timer(j->manager, &j->timer_watch, CLOCK_MONOTONIC,
+                                   j->timer_watch.timer.next_elapse);
 }
 
 void job_shutdown_magic(Job *j) {
@@ -134,6 +134,7 @@ struct Job {
         LIST_FIELDS(Job, transaction);
         LIST_FIELDS(Job, run_queue);
         LIST_FIELDS(Job, dbus_queue);
+        LIST_FIELDS(Job, transaction_queue);
 
         LIST_HEAD(JobDependency, subject_list);
         LIST_HEAD(JobDependency, object_list);
@@ -142,6 +143,10 @@ struct Job {
         Job* marker;
         unsigned generation;
 
+        /* Used when looking for ordering cycles */
+        unsigned order_index;
+        unsigned order_lowlink;
+
         uint32_t id;
 
         JobType type;
@@ -163,6 +168,8 @@ struct Job {
         bool ignore_order:1;
         bool forgot_bus_clients:1;
         bool irreversible:1;
+        bool in_transaction_queue:1;
+        bool order_on_stack:1;
 };
 
 JobBusClient* job_bus_client_new(DBusConnection *connection, const char *name);
@@ -0,0 +1,530 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "load-cache.h"
+#include "load-fragment.h"
+#include "load-dropin.h"
+#include "conf-parser.h"
+#include "unit-name.h"
+#include "path-util.h"
+#include "strv.h"
+#include "log.h"
+
+/* Don't bother with threads for fewer files than this per thread */
+#define PREFETCH_PER_THREAD_MIN 16
+#define PREFETCH_THREADS_MAX 8
+
+typedef struct LoadCacheEntry {
+        ConfigFile *file;
+
+        /* The last reload this entry was used in */
+        unsigned generation;
+} LoadCacheEntry;
+
+typedef struct PrefetchItem {
+        char *name;
+        ConfigFile *file;
+} PrefetchItem;
+
+typedef struct PrefetchThread {
+        Manager *manager;
+        PrefetchItem *items;
+        unsigned n_items;
+        unsigned first;
+        unsigned step;
+} PrefetchThread;
+
+static void load_cache_entry_free(LoadCacheEntry *e) {
+        if (!e)
+                return;
+
+        config_file_free(e->file);
+        free(e);
+}
+
+static int load_cache_put(Manager *m, ConfigFile *c) {
+        LoadCacheEntry *e;
+        int r;
+
+        assert(m);
+        assert(c);
+
+        r = hashmap_ensure_allocated(&m->load_cache, string_hash_func, string_compare_func);
+        if (r < 0)
+                return r;
+
+        e = hashmap_get(m->load_cache, c->filename);
+        if (e) {
+                /* The key is owned by the old file, hence replace
+                 * the entry as a whole */
+                hashmap_remove(m->load_cache, c->filename);
+                load_cache_entry_free(e);
+        }
+
+        e = new0(LoadCacheEntry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        e->file = c;
+        e->generation = m->load_cache_generation;
+
+        r = hashmap_put(m->load_cache, c->filename, e);
+        if (r < 0) {
+                free(e);
+                return r;
+        }
+
+        return 0;
+}
+
+int load_cache_parse(Unit *u, const char *filename, FILE *f, bool allow_include) {
+        _cleanup_fclose_ FILE *ours = NULL;
+        LoadCacheEntry *e;
+        ConfigFile *c;
+        struct stat st;
+        int r;
+
+        assert(u);
+        assert(filename);
+
+        if (!f) {
+                f = ours = fopen(filename, "re");
+                if (!f) {
+                        log_error("Failed to open configuration file '%s': %m", filename);
+                        return -errno;
+                }
+        }
+
+        if (fstat(fileno(f), &st) < 0)
+                return -errno;
+
+        e = hashmap_get(u->manager->load_cache, filename);
+        if (e && config_file_is_current(e->file, &st)) {
+                e->generation = u->manager->load_cache_generation;
+                c = e->file;
+        } else {
+                r = config_file_read(filename, f, &c);
+                if (r < 0) {
+                        log_error("Failed to read configuration file '%s': %s", filename, strerror(-r));
+                        return r;
+                }
+
+                r = load_cache_put(u->manager, c);
+                if (r < 0) {
+                        config_file_free(c);
+                        return r;
+                }
+        }
+
+        return config_file_parse(u->id, c, UNIT_VTABLE(u)->sections,
+                                 config_item_perf_lookup,
+                                 (void*) load_fragment_gperf_lookup, false, allow_include, u);
+}
+
+static void prefetch_one(Manager *m, PrefetchItem *i) {
+        char **p;
+
+        assert(m);
+        assert(i);
+
+        /* This runs on a worker thread while the main thread waits
+         * for us: we may look at the manager, but must not change
+         * it, nor log. */
+
+        STRV_FOREACH(p, m->lookup_paths.unit_path) {
+                _cleanup_free_ char *fn = NULL;
+                _cleanup_fclose_ FILE *f = NULL;
+                LoadCacheEntry *e;
+                struct stat st;
+                int fd;
+
+                fn = path_make_absolute(i->name, *p);
+                if (!fn)
+                        return;
+
+                path_kill_slashes(fn);
+
+                if (path_cache_lookup(m->unit_path_cache, fn) == 0)
+                        continue;
+
+                /* Symlinks are left to load_from_path(), since
+                 * it needs to know their names */
+                fd = open(fn, O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW);
+                if (fd < 0) {
+                        if (errno == ENOENT)
+                                continue;
+
+                        return;
+                }
+
+                f = fdopen(fd, "re");
+                if (!f) {
+                        close_nointr_nofail(fd);
+                        return;
+                }
+
+                if (fstat(fd, &st) < 0)
+                        return;
+
+                e = hashmap_get(m->load_cache, fn);
+                if (e && config_file_is_current(e->file, &st))
+                        return;
+
+                config_file_read(fn, f, &i->file);
+                return;
+        }
+}
+
+static void *prefetch_thread(void *p) {
+        PrefetchThread *t = p;
+        unsigned i;
+
+        for (i = t->first; i < t->n_items; i += t->step)
+                prefetch_one(t->manager, t->items + i);
+
+        return NULL;
+}
+
+void load_cache_prefetch(Manager *m, char **names) {
+        PrefetchThread threads[PREFETCH_THREADS_MAX];
+        pthread_t tids[PREFETCH_THREADS_MAX];
+        PrefetchItem *items;
+        unsigned n_items, n_threads, i;
+        long n_cpus;
+
+        assert(m);
+
+        n_items = strv_length(names);
+        if (n_items <= 0)
+                return;
+
+        /* Reading ahead on the main thread would not buy us
+         * anything */
+        n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n_cpus <= 1)
+                return;
+
+        n_threads = MIN((unsigned) n_cpus, (unsigned) PREFETCH_THREADS_MAX);
+        n_threads = MIN(n_threads, n_items / PREFETCH_PER_THREAD_MIN);
+        if (n_threads <= 1)
+                return;
+
+        items = new0(PrefetchItem, n_items);
+        if (!items)
+                return;
+
+        for (i = 0; i < n_items; i++)
+                items[i].name = names[i];
+
+        for (i = 0; i < n_threads; i++) {
+                threads[i].manager = m;
+                threads[i].items = items;
+                threads[i].n_items = n_items;
+                threads[i].first = i;
+                threads[i].step = n_threads;
+        }
+
+        /* The main thread takes the first share itself. If we cannot
+         * start a thread, we do its share ourselves too. */
+        for (i = 1; i < n_threads; i++)
+                if (pthread_create(tids + i, NULL, prefetch_thread, threads + i) != 0) {
+                        prefetch_thread(threads + i);
+                        tids[i] = 0;
+                }
+
+        prefetch_thread(threads);
+
+        for (i = 1; i < n_threads; i++)
+                if (tids[i] != 0)
+                        pthread_join(tids[i], NULL);
+
+        for (i = 0; i < n_items; i++)
+                if (items[i].file)
+                        if (load_cache_put(m, items[i].file) < 0)
+                                config_file_free(items[i].file);
+
+        free(items);
+}
+
+void load_cache_prefetch_queue(Manager *m) {
+        _cleanup_strv_free_ char **names = NULL;
+        Unit *u;
+
+        assert(m);
+
+        /* New units are prepended to the load queue, hence the ones
+         * we have not looked at yet are all at its head */
+        LIST_FOREACH(load_queue, u, m->load_queue) {
+                if (u->load_prefetched)
+                        break;
+
+                u->load_prefetched = true;
+
+                if (u->load_state != UNIT_STUB)
+                        continue;
+
+                if (strv_extend(&names, u->id) < 0)
+                        return;
+
+                if (u->instance) {
+                        char *t;
+
+                        t = unit_name_template(u->id);
+                        if (!t)
+                                return;
+
+                        if (strv_push(&names, t) < 0) {
+                                free(t);
+                                return;
+                        }
+                }
+        }
+
+        load_cache_prefetch(m, names);
+}
+
+static int find_unit_file(Manager *m, const char *name, char **ret) {
+        char **p;
+
+        assert(m);
+        assert(name);
+        assert(ret);
+
+        STRV_FOREACH(p, m->lookup_paths.unit_path) {
+                char *fn;
+
+                fn = path_make_absolute(name, *p);
+                if (!fn)
+                        return -ENOMEM;
+
+                path_kill_slashes(fn);
+
+                if (path_cache_exists(m->unit_path_cache, fn)) {
+                        *ret = fn;
+                        return 1;
+                }
+
+                free(fn);
+        }
+
+        return 0;
+}
+
+/* Returns the file the unit would be loaded from now under the given
+ * name, in the same order load_from_path() looks for it */
+static int find_unit_file_for(Unit *u, const char *name, char **ret) {
+        _cleanup_free_ char *template = NULL;
+        int r;
+
+        assert(u);
+        assert(name);
+        assert(ret);
+
+        r = find_unit_file(u->manager, name, ret);
+        if (r != 0)
+                return r;
+
+        if (!unit_name_is_instance(name))
+                return 0;
+
+        template = unit_name_template(name);
+        if (!template)
+                return -ENOMEM;
+
+        return find_unit_file(u->manager, template, ret);
+}
+
+static bool file_changed(Manager *m, const char *filename) {
+        _cleanup_fclose_ FILE *f = NULL;
+        LoadCacheEntry *e;
+        ConfigFile *c;
+        struct stat st;
+        bool changed;
+        unsigned k;
+
+        assert(m);
+        assert(filename);
+
+        e = hashmap_get(m->load_cache, filename);
+        if (!e)
+                return true;
+
+        /* We don't keep track of included files */
+        for (k = 0; k < e->file->n_lines; k++)
+                if (startswith(e->file->lines[k].text, ".include"))
+                        return true;
+
+        f = fopen(filename, "re");
+        if (!f)
+                return true;
+
+        if (fstat(fileno(f), &st) < 0)
+                return true;
+
+        if (config_file_is_current(e->file, &st)) {
+                e->generation = m->load_cache_generation;
+                return false;
+        }
+
+        /* Generators write their output anew on each reload, hence
+         * compare the contents rather than the timestamps */
+        if (config_file_read(filename, f, &c) < 0)
+                return true;
+
+        changed = !config_file_equal(c, e->file);
+
+        /* This frees e */
+        if (load_cache_put(m, c) < 0) {
+                config_file_free(c);
+                return true;
+        }
+
+        return changed;
+}
+
+LoadCacheCheck load_cache_check_unit(Unit *u) {
+        _cleanup_strv_free_ char **dropins = NULL, **links = NULL;
+        struct stat st;
+        Iterator i;
+        char **p, *t;
+        int r;
+
+        assert(u);
+
+        /* Not found so far? If a file turned up it may be loaded on
+         * its own, unless it is an alias of another unit, which
+         * would have to be merged. */
+        if (u->load_state == UNIT_ERROR &&
+            u->load_error == -ENOENT &&
+            !u->fragment_path) {
+                bool found = false;
+
+                SET_FOREACH(t, u->names, i) {
+                        _cleanup_free_ char *fn = NULL;
+
+                        r = find_unit_file_for(u, t, &fn);
+                        if (r < 0)
+                                return LOAD_CACHE_CHANGED;
+                        if (r == 0)
+                                continue;
+
+                        if (lstat(fn, &st) < 0 || S_ISLNK(st.st_mode))
+                                return LOAD_CACHE_CHANGED;
+
+                        found = true;
+                }
+
+                return found ? LOAD_CACHE_FOUND : LOAD_CACHE_UNCHANGED;
+        }
+
+        if (u->fragment_path) {
+                struct stat a;
+
+                if (stat(u->fragment_path, &a) < 0)
+                        return LOAD_CACHE_CHANGED;
+
+                /* Every name of the unit, including the ones merged
+                 * in through alias symlinks, has to lead to the same
+                 * file still, or the unit has been masked, unmasked,
+                 * shadowed by a file elsewhere, or an alias has been
+                 * retargeted */
+                SET_FOREACH(t, u->names, i) {
+                        _cleanup_free_ char *fn = NULL;
+
+                        r = find_unit_file_for(u, t, &fn);
+                        if (r <= 0)
+                                return LOAD_CACHE_CHANGED;
+
+                        if (stat(fn, &st) < 0 ||
+                            a.st_dev != st.st_dev ||
+                            a.st_ino != st.st_ino)
+                                return LOAD_CACHE_CHANGED;
+                }
+
+                if (u->load_state == UNIT_MASKED) {
+                        if (null_or_empty_path(u->fragment_path) <= 0)
+                                return LOAD_CACHE_CHANGED;
+                } else if (file_changed(u->manager, u->fragment_path))
+                        return LOAD_CACHE_CHANGED;
+        } else {
+                /* A unit without a file must not have got one */
+                SET_FOREACH(t, u->names, i) {
+                        _cleanup_free_ char *fn = NULL;
+
+                        if (find_unit_file_for(u, t, &fn) != 0)
+                                return LOAD_CACHE_CHANGED;
+                }
+        }
+
+        if (u->source_path) {
+                if (stat(u->source_path, &st) < 0 ||
+                    timespec_load(&st.st_mtim) != u->source_mtime)
+                        return LOAD_CACHE_CHANGED;
+        }
+
+        dropins = unit_find_dropin_paths(u);
+        if (!strv_equal(dropins, u->dropin_paths))
+                return LOAD_CACHE_CHANGED;
+
+        STRV_FOREACH(p, dropins)
+                if (file_changed(u->manager, *p))
+                        return LOAD_CACHE_CHANGED;
+
+        if (unit_find_dependency_links(u, &links) < 0)
+                return LOAD_CACHE_CHANGED;
+
+        if (!strv_equal(links, u->dependency_links))
+                return LOAD_CACHE_CHANGED;
+
+        return LOAD_CACHE_UNCHANGED;
+}
+
+void load_cache_trim(Manager *m) {
+        LoadCacheEntry *e;
+        Iterator i;
+
+        assert(m);
+
+        /* Forget about files not used since the last reload, they
+         * were most likely removed */
+        HASHMAP_FOREACH(e, m->load_cache, i)
+                if (e->generation != m->load_cache_generation) {
+                        hashmap_remove(m->load_cache, e->file->filename);
+                        load_cache_entry_free(e);
+                }
+}
+
+void load_cache_flush(Manager *m) {
+        LoadCacheEntry *e;
+
+        assert(m);
+
+        while ((e = hashmap_steal_first(m->load_cache)))
+                load_cache_entry_free(e);
+
+        hashmap_free(m->load_cache);
+        m->load_cache = NULL;
+}
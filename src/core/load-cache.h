@@ -0,0 +1,48 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "unit.h"
+
+/* Keeps the unit files we read around, so that reloading does not
+ * need to read unchanged files again, and reads unit files ahead of
+ * loading on worker threads */
+
+int load_cache_parse(Unit *u, const char *filename, FILE *f, bool allow_include);
+
+void load_cache_prefetch(Manager *m, char **names);
+void load_cache_prefetch_queue(Manager *m);
+
+typedef enum LoadCacheCheck {
+        LOAD_CACHE_UNCHANGED,
+        LOAD_CACHE_FOUND,       /* a unit not found so far can be loaded now */
+        LOAD_CACHE_CHANGED
+} LoadCacheCheck;
+
+/* Compares a loaded unit with the unit files currently on disk */
+LoadCacheCheck load_cache_check_unit(Unit *u);
+
+void load_cache_trim(Manager *m);
+void load_cache_flush(Manager *m);
@@ -26,77 +26,18 @@
 #include "load-dropin.h"
 #include "log.h"
 #include "strv.h"
+#include "path-util.h"
 #include "unit-name.h"
 #include "conf-parser.h"
 #include "load-fragment.h"
+#include "load-cache.h"
 #include "conf-files.h"
 
-static int iterate_dir(
-                Unit *u,
-                const char *path,
-                UnitDependency dependency,
-                char ***strv) {
-
-        _cleanup_closedir_ DIR *d = NULL;
-        int r;
-
-        assert(u);
-        assert(path);
-
-        /* The config directories are special, since the order of the
-         * drop-ins matters */
-        if (dependency < 0)  {
-                r = strv_extend(strv, path);
-                if (r < 0)
-                        return log_oom();
-
-                return 0;
-        }
-
-        d = opendir(path);
-        if (!d) {
-                if (errno == ENOENT)
-                        return 0;
-
-                return -errno;
-        }
-
-        for (;;) {
-                struct dirent *de;
-                union dirent_storage buf;
-                _cleanup_free_ char *f = NULL;
-                int k;
-
-                k = readdir_r(d, &buf.de, &de);
-                if (k != 0) {
-                        log_error("Failed to read directory %s: %s", path, strerror(k));
-                        return -k;
-                }
-
-                if (!de)
-                        break;
-
-                if (ignore_file(de->d_name))
-                        continue;
-
-                f = strjoin(path, "/", de->d_name, NULL);
-                if (!f)
-                        return log_oom();
-
-                r = unit_add_dependency_by_name(u, dependency, de->d_name, f, true);
-                if (r < 0)
-                        log_error("Cannot add dependency %s to %s, ignoring: %s", de->d_name, u->id, strerror(-r));
-        }
-
-        return 0;
-}
-
 static int process_dir(
                 Unit *u,
                 const char *unit_path,
                 const char *name,
                 const char *suffix,
-                UnitDependency dependency,
                 char ***strv) {
 
         int r;
@@ -111,15 +52,15 @@ static int process_dir(
         if (!path)
                 return log_oom();
 
-        if (u->manager->unit_path_cache &&
-            !set_get(u->manager->unit_path_cache, path))
-                r = 0;
-        else
-                r = iterate_dir(u, path, dependency, strv);
-        free(path);
-
-        if (r < 0)
-                return r;
+        if (path_cache_lookup(u->manager->unit_path_cache, path) == 0)
+                free(path);
+        else {
+                r = strv_push(strv, path);
+                if (r < 0) {
+                        free(path);
+                        return log_oom();
+                }
+        }
 
         if (u->instance) {
                 char *template;
@@ -135,17 +76,63 @@ static int process_dir(
                 if (!path)
                         return log_oom();
 
-                if (u->manager->unit_path_cache &&
-                    !set_get(u->manager->unit_path_cache, path))
-                        r = 0;
-                else
-                        r = iterate_dir(u, path, dependency, strv);
-                free(path);
+                if (path_cache_lookup(u->manager->unit_path_cache, path) == 0)
+                        free(path);
+                else {
+                        r = strv_push(strv, path);
+                        if (r < 0) {
+                                free(path);
+                                return log_oom();
+                        }
+                }
+        }
 
-                if (r < 0)
+        return 0;
+}
+
+int unit_find_dependency_links(Unit *u, char ***links) {
+        _cleanup_strv_free_ char **dirs = NULL, **l = NULL;
+        Iterator i;
+        char *t, **p;
+        int r;
+
+        assert(u);
+        assert(links);
+
+        SET_FOREACH(t, u->names, i)
+                STRV_FOREACH(p, u->manager->lookup_paths.unit_path) {
+                        r = process_dir(u, *p, t, ".wants", &dirs);
+                        if (r < 0)
+                                return r;
+
+                        r = process_dir(u, *p, t, ".requires", &dirs);
+                        if (r < 0)
+                                return r;
+                }
+
+        STRV_FOREACH(p, dirs) {
+                _cleanup_strv_free_ char **e = NULL;
+                char **m;
+
+                r = path_cache_list(u->manager->unit_path_cache, *p, &e);
+                if (r < 0) {
+                        log_error("Failed to read directory %s: %s", *p, strerror(-r));
                         return r;
+                }
+
+                m = strv_merge(l, e);
+                if (!m)
+                        return log_oom();
+
+                strv_free(l);
+                l = m;
         }
 
+        /* Sorted, so that the lists can be compared regardless of
+         * the order the file system returns the entries in */
+        *links = strv_sort(l);
+        l = NULL;
+
         return 0;
 }
 
@@ -163,7 +150,7 @@ char **unit_find_dropin_paths(Unit *u) {
 
                 STRV_FOREACH(p, u->manager->lookup_paths.unit_path) {
                         /* This loads the drop-in config snippets */
-                        r = process_dir(u, *p, t, ".d", _UNIT_DEPENDENCY_INVALID, &strv);
+                        r = process_dir(u, *p, t, ".d", &strv);
                         if (r < 0)
                                 return NULL;
                 }
@@ -183,26 +170,31 @@ char **unit_find_dropin_paths(Unit *u) {
 }
 
 int unit_load_dropin(Unit *u) {
-        Iterator i;
-        char *t, **f;
+        char **f;
         int r;
 
         assert(u);
 
         /* Load dependencies from supplementary drop-in directories */
 
-        SET_FOREACH(t, u->names, i) {
-                char **p;
+        r = unit_find_dependency_links(u, &u->dependency_links);
+        if (r < 0)
+                return r;
 
-                STRV_FOREACH(p, u->manager->lookup_paths.unit_path) {
-                        r = process_dir(u, *p, t, ".wants", UNIT_WANTS, NULL);
-                        if (r < 0)
-                                return r;
+        STRV_FOREACH(f, u->dependency_links) {
+                _cleanup_free_ char *dir = NULL;
+                UnitDependency d;
 
-                        r = process_dir(u, *p, t, ".requires", UNIT_REQUIRES, NULL);
-                        if (r < 0)
-                                return r;
-                }
+                r = path_get_parent(*f, &dir);
+                if (r < 0)
+                        return log_oom();
+
+                d = endswith(dir, ".wants") ? UNIT_WANTS : UNIT_REQUIRES;
+
+                r = unit_add_dependency_by_name(u, d, path_get_file_name(*f), *f, true);
+                if (r < 0)
+                        log_error("Cannot add dependency %s to %s, ignoring: %s",
+                                  path_get_file_name(*f), u->id, strerror(-r));
         }
 
         u->dropin_paths = unit_find_dropin_paths(u);
@@ -210,9 +202,7 @@ int unit_load_dropin(Unit *u) {
                 return 0;
 
         STRV_FOREACH(f, u->dropin_paths) {
-                r = config_parse(u->id, *f, NULL,
-                                 UNIT_VTABLE(u)->sections, config_item_perf_lookup,
-                                 (void*) load_fragment_gperf_lookup, false, false, u);
+                r = load_cache_parse(u, *f, NULL, false);
                 if (r < 0)
                         return r;
         }
@@ -26,4 +26,5 @@
 /* Read service data supplementary drop-in directories */
 
 char **unit_find_dropin_paths(Unit *u);
+int unit_find_dependency_links(Unit *u, char ***links);
 int unit_load_dropin(Unit *u);
@@ -51,6 +51,7 @@
 #include "path-util.h"
 #include "syscall-list.h"
 #include "env-util.h"
+#include "load-cache.h"
 
 #ifndef HAVE_SYSV_COMPAT
 int config_parse_warn_compat(const char *unit,
@@ -1275,7 +1276,7 @@ int config_parse_trigger_unit(
         assert(rvalue);
         assert(data);
 
-        if (!set_isempty(u->dependencies[UNIT_TRIGGERS])) {
+        if (!dependency_list_isempty(u->dependencies[UNIT_TRIGGERS])) {
                 log_syntax(unit, LOG_ERR, filename, line, EINVAL,
                            "Multiple units to trigger specified, ignoring: %s", rvalue);
                 return 0;
@@ -1901,25 +1902,13 @@ int config_parse_unit_requires_mounts_for(const char *unit,
                                           void *data,
                                           void *userdata) {
 
-        Unit *u = userdata;
-        int r;
-        bool empty_before;
-
         assert(filename);
         assert(lvalue);
         assert(rvalue);
         assert(data);
 
-        empty_before = !u->requires_mounts_for;
-
-        r = config_parse_path_strv(unit, filename, line, section, lvalue, ltype,
-                                   rvalue, data, userdata);
-
-        /* Make it easy to find units with requires_mounts set */
-        if (empty_before && u->requires_mounts_for)
-                LIST_PREPEND(Unit, has_requires_mounts_for, u->manager->has_requires_mounts_for, u);
-
-        return r;
+        return config_parse_path_strv(unit, filename, line, section, lvalue, ltype,
+                                      rvalue, data, userdata);
 }
 
 int config_parse_documentation(const char *unit,
@@ -2220,8 +2209,7 @@ static int load_from_path(Unit *u, const char *path) {
                                 goto finish;
                         }
 
-                        if (u->manager->unit_path_cache &&
-                            !set_get(u->manager->unit_path_cache, filename))
+                        if (path_cache_lookup(u->manager->unit_path_cache, filename) == 0)
                                 r = -ENOENT;
                         else
                                 r = open_follow(&filename, &f, symlink_names, &id);
@@ -2268,9 +2256,7 @@ static int load_from_path(Unit *u, const char *path) {
                 u->load_state = UNIT_MASKED;
         else {
                 /* Now, parse the file contents */
-                r = config_parse(u->id, filename, f, UNIT_VTABLE(u)->sections,
-                                 config_item_perf_lookup,
-                                 (void*) load_fragment_gperf_lookup, false, true, u);
+                r = load_cache_parse(u, filename, f, true);
                 if (r < 0)
                         goto finish;
 
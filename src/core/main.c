@@ -98,6 +98,9 @@ static usec_t arg_shutdown_watchdog = 10 * USEC_PER_MINUTE;
 static struct rlimit *arg_default_rlimit[RLIMIT_NLIMITS] = {};
 static uint64_t arg_capability_bounding_set_drop = 0;
 static nsec_t arg_timer_slack_nsec = (nsec_t) -1;
+static usec_t arg_timer_accuracy_usec = DEFAULT_TIMER_ACCURACY_USEC;
+static bool arg_incremental_reload = false;
+static SerializeFormat arg_reexecute_serialization = SERIALIZE_TEXT;
 
 static FILE* serialization = NULL;
 
@@ -625,6 +628,8 @@ static int config_parse_join_controllers(const char *unit,
         return 0;
 }
 
+static DEFINE_CONFIG_PARSE_ENUM(config_parse_serialize_format, serialize_format, SerializeFormat, "Failed to parse serialization format");
+
 static int parse_config_file(void) {
 
         const ConfigTableItem items[] = {
@@ -645,6 +650,9 @@ static int parse_config_file(void) {
                 { "Manager", "ShutdownWatchdogSec",   config_parse_sec,          0, &arg_shutdown_watchdog   },
                 { "Manager", "CapabilityBoundingSet", config_parse_bounding_set, 0, &arg_capability_bounding_set_drop },
                 { "Manager", "TimerSlackNSec",        config_parse_nsec,         0, &arg_timer_slack_nsec    },
+                { "Manager", "TimerAccuracySec",      config_parse_sec,          0, &arg_timer_accuracy_usec },
+                { "Manager", "IncrementalReload",     config_parse_bool,         0, &arg_incremental_reload  },
+                { "Manager", "ReexecuteSerialization", config_parse_serialize_format, 0, &arg_reexecute_serialization },
                 { "Manager", "DefaultLimitCPU",       config_parse_limit,        0, &arg_default_rlimit[RLIMIT_CPU]},
                 { "Manager", "DefaultLimitFSIZE",     config_parse_limit,        0, &arg_default_rlimit[RLIMIT_FSIZE]},
                 { "Manager", "DefaultLimitDATA",      config_parse_limit,        0, &arg_default_rlimit[RLIMIT_DATA]},
@@ -1067,7 +1075,9 @@ static int prepare_reexecute(Manager *m, FILE **_f, FDSet **_fds, bool switching
                 goto fail;
         }
 
-        r = manager_serialize(m, f, fds, switching_root);
+        /* The binary we execute might be older, and not understand
+         * the binary format, hence only use it when told to */
+        r = manager_serialize(m, f, fds, arg_reexecute_serialization, switching_root);
         if (r < 0) {
                 log_error("Failed to serialize state: %s", strerror(-r));
                 goto fail;
@@ -1625,6 +1635,8 @@ int main(int argc, char *argv[]) {
         m->default_std_error = arg_default_std_error;
         m->runtime_watchdog = arg_runtime_watchdog;
         m->shutdown_watchdog = arg_shutdown_watchdog;
+        m->timer_accuracy_usec = arg_timer_accuracy_usec;
+        m->incremental_reload = arg_incremental_reload;
         m->userspace_timestamp = userspace_timestamp;
         m->kernel_timestamp = kernel_timestamp;
         m->firmware_timestamp = firmware_timestamp;
@@ -71,6 +71,9 @@
 #include "path-util.h"
 #include "audit-fd.h"
 #include "env-util.h"
+#include "def.h"
+#include "load-cache.h"
+#include "install.h"
 
 /* As soon as 16 units are in our GC queue, make sure to run a gc sweep */
 #define GC_QUEUE_ENTRIES_MAX 16
@@ -83,6 +86,11 @@
 #define JOBS_IN_PROGRESS_PERIOD_SEC 1
 #define JOBS_IN_PROGRESS_PERIOD_DIVISOR 3
 
+/* How many events to fetch from epoll at once, and how many priority
+ * classes we dispatch them in */
+#define EPOLL_EVENTS_MAX 64
+#define EVENT_PRIORITY_MAX 4
+
 /* Where clients shall send notification messages to */
 #define NOTIFY_SOCKET "@/org/freedesktop/systemd1/notify"
 
@@ -144,6 +152,70 @@ static int manager_setup_notify(Manager *m) {
         return 0;
 }
 
+static int manager_setup_cgroups_agent(Manager *m) {
+        union {
+                struct sockaddr sa;
+                struct sockaddr_un un;
+        } sa = {
+                .un.sun_family = AF_UNIX,
+                .un.sun_path = SYSTEMD_CGROUP_AGENT_SOCKET,
+        };
+        struct epoll_event ev = {
+                .events = EPOLLIN,
+                .data.ptr = &m->cgroups_agent_watch,
+        };
+        int one = 1, r;
+
+        /* The release agent passes the groups that ran empty to us
+         * as datagrams on this socket, which is a lot cheaper for it
+         * than connecting to the bus. If this fails, we still get
+         * them via D-Bus. */
+        if (m->running_as != SYSTEMD_SYSTEM || getpid() != 1)
+                return 0;
+
+        m->cgroups_agent_watch.type = WATCH_CGROUPS_AGENT;
+        m->cgroups_agent_watch.fd = socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC|SOCK_NONBLOCK, 0);
+        if (m->cgroups_agent_watch.fd < 0) {
+                log_warning("Failed to allocate cgroups agent socket: %m");
+                return 0;
+        }
+
+        /* Many groups might run empty at the same time, make sure
+         * we don't lose any of the notifications */
+        fd_inc_rcvbuf(m->cgroups_agent_watch.fd, 8*1024*1024);
+
+        unlink(SYSTEMD_CGROUP_AGENT_SOCKET);
+
+        RUN_WITH_UMASK(0077)
+                r = bind(m->cgroups_agent_watch.fd, &sa.sa,
+                         offsetof(struct sockaddr_un, sun_path) + strlen(sa.un.sun_path));
+        if (r < 0) {
+                log_warning("Failed to bind cgroups agent socket: %m");
+                goto fail;
+        }
+
+        r = setsockopt(m->cgroups_agent_watch.fd, SOL_SOCKET, SO_PASSCRED, &one, sizeof(one));
+        if (r < 0) {
+                log_warning("SO_PASSCRED failed: %m");
+                goto fail;
+        }
+
+        r = epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, m->cgroups_agent_watch.fd, &ev);
+        if (r < 0) {
+                log_warning("Failed to add cgroups agent socket fd to epoll: %m");
+                goto fail;
+        }
+
+        log_debug("Using cgroups agent socket %s", SYSTEMD_CGROUP_AGENT_SOCKET);
+
+        return 0;
+
+fail:
+        close_nointr_nofail(m->cgroups_agent_watch.fd);
+        watch_init(&m->cgroups_agent_watch);
+        return 0;
+}
+
 static int manager_jobs_in_progress_mod_timer(Manager *m) {
         struct itimerspec its = {
                 .it_value.tv_sec = JOBS_IN_PROGRESS_WAIT_SEC,
@@ -205,6 +277,7 @@ static void manager_unwatch_jobs_in_progress(Manager *m) {
                 return;
 
         assert_se(epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, m->jobs_in_progress_watch.fd, NULL) >= 0);
+        m->watch_generation++;
         close_nointr_nofail(m->jobs_in_progress_watch.fd);
         watch_init(&m->jobs_in_progress_watch);
         m->jobs_in_progress_iteration = 0;
@@ -440,17 +513,24 @@ int manager_new(SystemdRunningAs running_as, Manager **_m) {
                 return -ENOMEM;
 
         m->running_as = running_as;
-        m->name_data_slot = m->conn_data_slot = m->subscribed_data_slot = -1;
+        m->name_data_slot = m->conn_data_slot = m->subscribed_data_slot = m->subscribed_batched_data_slot = -1;
         m->exit_code = _MANAGER_EXIT_CODE_INVALID;
         m->pin_cgroupfs_fd = -1;
         m->idle_pipe[0] = m->idle_pipe[1] = -1;
 
         watch_init(&m->signal_watch);
+        watch_init(&m->cgroups_agent_watch);
         watch_init(&m->mount_watch);
+        watch_init(&m->mount_rescan_watch);
         watch_init(&m->swap_watch);
         watch_init(&m->udev_watch);
         watch_init(&m->time_change_watch);
         watch_init(&m->jobs_in_progress_watch);
+        watch_init(&m->unit_path_cache_watch);
+        watch_init(&m->monotonic_timer_watch);
+        watch_init(&m->realtime_timer_watch);
+
+        m->timer_accuracy_usec = DEFAULT_TIMER_ACCURACY_USEC;
 
         m->epoll_fd = m->dev_autofs_fd = -1;
         m->current_job_id = 1; /* start as id #1, so that we can leave #0 around as "null-like" value */
@@ -476,6 +556,9 @@ int manager_new(SystemdRunningAs running_as, Manager **_m) {
         if (!(m->watch_pids = hashmap_new(trivial_hash_func, trivial_compare_func)))
                 goto fail;
 
+        if (!(m->pid_units = hashmap_new(trivial_hash_func, trivial_compare_func)))
+                goto fail;
+
         if (!(m->cgroup_bondings = hashmap_new(string_hash_func, string_compare_func)))
                 goto fail;
 
@@ -498,6 +581,10 @@ int manager_new(SystemdRunningAs running_as, Manager **_m) {
         if (r < 0)
                 goto fail;
 
+        r = manager_setup_cgroups_agent(m);
+        if (r < 0)
+                goto fail;
+
         r = manager_setup_time_change(m);
         if (r < 0)
                 goto fail;
@@ -563,7 +650,7 @@ static void unit_gc_sweep(Unit *u, unsigned gc_marker) {
 
         is_bad = true;
 
-        SET_FOREACH(other, u->dependencies[UNIT_REFERENCED_BY], i) {
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REFERENCED_BY, i) {
                 unit_gc_sweep(other, gc_marker);
 
                 if (other->gc_marker == gc_marker + GC_OFFSET_GOOD)
@@ -684,19 +771,28 @@ void manager_free(Manager *m) {
         hashmap_free(m->units);
         hashmap_free(m->jobs);
         hashmap_free(m->watch_pids);
+        hashmap_free(m->pid_units);
         hashmap_free(m->watch_bus);
 
+        assert(hashmap_isempty(m->units_by_path_prefix));
+        path_index_free(m->units_by_path_prefix);
+
         if (m->epoll_fd >= 0)
                 close_nointr_nofail(m->epoll_fd);
         if (m->signal_watch.fd >= 0)
                 close_nointr_nofail(m->signal_watch.fd);
         if (m->notify_watch.fd >= 0)
                 close_nointr_nofail(m->notify_watch.fd);
+        if (m->cgroups_agent_watch.fd >= 0)
+                close_nointr_nofail(m->cgroups_agent_watch.fd);
         if (m->time_change_watch.fd >= 0)
                 close_nointr_nofail(m->time_change_watch.fd);
         if (m->jobs_in_progress_watch.fd >= 0)
                 close_nointr_nofail(m->jobs_in_progress_watch.fd);
 
+        timer_queue_free(m->monotonic_timers);
+        timer_queue_free(m->realtime_timers);
+
         free(m->notify_socket);
 
         lookup_paths_free(&m->lookup_paths);
@@ -705,7 +801,9 @@ void manager_free(Manager *m) {
         strv_free(m->default_controllers);
 
         hashmap_free(m->cgroup_bondings);
-        set_free_free(m->unit_path_cache);
+        unit_file_set_path_cache(NULL);
+        path_cache_free(m->unit_path_cache);
+        load_cache_flush(m);
 
         close_pipe(m->idle_pipe);
 
@@ -758,61 +856,43 @@ int manager_coldplug(Manager *m) {
 }
 
 static void manager_build_unit_path_cache(Manager *m) {
-        char **i;
-        _cleanup_free_ DIR *d = NULL;
         int r;
 
         assert(m);
 
-        set_free_free(m->unit_path_cache);
-
-        m->unit_path_cache = set_new(string_hash_func, string_compare_func);
-        if (!m->unit_path_cache) {
-                log_error("Failed to allocate unit path cache.");
-                return;
-        }
-
-        /* This simply builds a list of files we know exist, so that
+        /* This simply keeps a list of files we know exist, so that
          * we don't always have to go to disk */
 
-        STRV_FOREACH(i, m->lookup_paths.unit_path) {
-                struct dirent *de;
+        if (!m->unit_path_cache) {
+                struct epoll_event ev = {
+                        .events = EPOLLIN,
+                        .data.ptr = &m->unit_path_cache_watch,
+                };
 
-                d = opendir(*i);
-                if (!d) {
-                        if (errno != ENOENT)
-                                log_error("Failed to open directory %s: %m", *i);
-                        continue;
+                r = path_cache_new(&m->unit_path_cache);
+                if (r < 0) {
+                        log_error("Failed to allocate unit path cache: %s", strerror(-r));
+                        return;
                 }
 
-                while ((de = readdir(d))) {
-                        char *p;
-
-                        if (ignore_file(de->d_name))
-                                continue;
-
-                        p = strjoin(streq(*i, "/") ? "" : *i, "/", de->d_name, NULL);
-                        if (!p) {
-                                r = -ENOMEM;
-                                goto fail;
-                        }
+                m->unit_path_cache_watch.type = WATCH_UNIT_PATH_CACHE;
+                m->unit_path_cache_watch.fd = path_cache_fd(m->unit_path_cache);
 
-                        r = set_consume(m->unit_path_cache, p);
-                        if (r < 0)
-                                goto fail;
+                if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, m->unit_path_cache_watch.fd, &ev) < 0) {
+                        log_error("Failed to add unit path cache fd to epoll: %m");
+                        path_cache_free(m->unit_path_cache);
+                        m->unit_path_cache = NULL;
+                        watch_init(&m->unit_path_cache_watch);
+                        return;
                 }
 
-                closedir(d);
-                d = NULL;
+                /* Let the enable/disable logic use it too */
+                unit_file_set_path_cache(m->unit_path_cache);
         }
 
-        return;
-
-fail:
-        log_error("Failed to build unit path cache: %s", strerror(-r));
-
-        set_free_free(m->unit_path_cache);
-        m->unit_path_cache = NULL;
+        r = path_cache_set_roots(m->unit_path_cache, m->lookup_paths.unit_path);
+        if (r < 0)
+                log_error("Failed to build unit path cache: %s", strerror(-r));
 }
 
 int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
@@ -876,6 +956,7 @@ int manager_add_job(Manager *m, JobType type, Unit *unit, JobMode mode, bool ove
         Transaction *tr;
         Job *j;
         Iterator i;
+        bool fast;
 
         assert(m);
         assert(type < _JOB_TYPE_MAX);
@@ -936,12 +1017,20 @@ int manager_add_job(Manager *m, JobType type, Unit *unit, JobMode mode, bool ove
 
         job_type_collapse(&type, unit);
 
+        /* If everything the job would pull in is in the requested
+         * state already, there's no need to build the transaction
+         * for it */
+        fast = (mode == JOB_REPLACE || mode == JOB_FAIL) &&
+                transaction_dependencies_redundant(unit, type) > 0;
+        if (fast)
+                m->n_fast_path_jobs++;
+
         tr = transaction_new(mode == JOB_REPLACE_IRREVERSIBLY);
         if (!tr)
                 return -ENOMEM;
 
         r = transaction_add_job_and_dependencies(tr, type, unit, NULL, true, override, false,
-                                                 mode == JOB_IGNORE_DEPENDENCIES || mode == JOB_IGNORE_REQUIREMENTS,
+                                                 fast || mode == JOB_IGNORE_DEPENDENCIES || mode == JOB_IGNORE_REQUIREMENTS,
                                                  mode == JOB_IGNORE_DEPENDENCIES, e);
         if (r < 0)
                 goto tr_abort;
@@ -1013,13 +1102,29 @@ unsigned manager_dispatch_load_queue(Manager *m) {
 
         m->dispatching_load_queue = true;
 
+        /* Unit files might have been created just before we were
+         * asked to load them, make sure we know about them */
+        if (m->unit_path_cache)
+                path_cache_flush(m->unit_path_cache);
+
         /* Dispatches the load queue. Takes a unit from the queue and
          * tries to load its data until the queue is empty */
 
         while ((u = m->load_queue)) {
+                usec_t ts;
+
                 assert(u->in_load_queue);
 
+                /* Read the files of all units queued since the
+                 * last round in parallel, before we parse them
+                 * one by one below */
+                if (!u->load_prefetched)
+                        load_cache_prefetch_queue(m);
+
+                ts = now(CLOCK_MONOTONIC);
                 unit_load(u);
+                u->load_usec = now(CLOCK_MONOTONIC) - ts;
+
                 n++;
         }
 
@@ -1166,6 +1271,10 @@ unsigned manager_dispatch_run_queue(Manager *m) {
 }
 
 unsigned manager_dispatch_dbus_queue(Manager *m) {
+        _cleanup_free_ Unit **batch = NULL;
+        size_t batch_allocated = 0;
+        unsigned n_batch = 0;
+        bool batched;
         Job *j;
         Unit *u;
         unsigned n = 0;
@@ -1177,13 +1286,27 @@ unsigned manager_dispatch_dbus_queue(Manager *m) {
 
         m->dispatching_dbus_queue = true;
 
+        /* All changes of a unit since the last dispatch have been
+         * merged into one queue entry. Clients that asked for it get
+         * all of them in one signal. */
+        batched = m->dbus_unit_queue && bus_has_batched_subscriber(m);
+
         while ((u = m->dbus_unit_queue)) {
                 assert(u->in_dbus_queue);
 
                 bus_unit_send_change_signal(u);
                 n++;
+
+                if (batched) {
+                        if (GREEDY_REALLOC(batch, batch_allocated, n_batch + 1))
+                                batch[n_batch++] = u;
+                        else
+                                log_oom();
+                }
         }
 
+        bus_unit_send_batched_change_signal(m, batch, n_batch);
+
         while ((j = m->dbus_job_queue)) {
                 assert(j->in_dbus_queue);
 
@@ -1195,6 +1318,42 @@ unsigned manager_dispatch_dbus_queue(Manager *m) {
         return n;
 }
 
+static Unit *manager_get_unit_by_pid(Manager *m, pid_t pid) {
+        Unit *u;
+
+        assert(m);
+
+        u = hashmap_get(m->watch_pids, LONG_TO_PTR(pid));
+        if (u)
+                return u;
+
+        return cgroup_unit_by_pid(m, pid);
+}
+
+Unit *manager_get_unit_by_child(Manager *m, pid_t pid) {
+        Unit *u;
+
+        assert(m);
+
+        /* Processes we forked ourselves are watched, and the ones
+         * we found in a cgroup when killing it are tracked. Only
+         * for everything else we need to look into /proc. The PID
+         * table is only good for children we are about to reap:
+         * tracked processes might have been reaped by somebody else,
+         * and their PID reused by something that sends us a
+         * notification message. */
+
+        u = hashmap_get(m->watch_pids, LONG_TO_PTR(pid));
+        if (u)
+                return u;
+
+        u = hashmap_get(m->pid_units, LONG_TO_PTR(pid));
+        if (u)
+                return u;
+
+        return cgroup_unit_by_pid(m, pid);
+}
+
 static int manager_process_notify_fd(Manager *m) {
         ssize_t n;
 
@@ -1243,13 +1402,10 @@ static int manager_process_notify_fd(Manager *m) {
 
                 ucred = (struct ucred*) CMSG_DATA(&control.cmsghdr);
 
-                u = hashmap_get(m->watch_pids, LONG_TO_PTR(ucred->pid));
+                u = manager_get_unit_by_pid(m, ucred->pid);
                 if (!u) {
-                        u = cgroup_unit_by_pid(m, ucred->pid);
-                        if (!u) {
-                                log_warning("Cannot find unit for notify message of PID %lu.", (unsigned long) ucred->pid);
-                                continue;
-                        }
+                        log_warning("Cannot find unit for notify message of PID %lu.", (unsigned long) ucred->pid);
+                        continue;
                 }
 
                 assert((size_t) n < sizeof(buf));
@@ -1267,12 +1423,114 @@ static int manager_process_notify_fd(Manager *m) {
         return 0;
 }
 
+static int manager_process_cgroups_agent_fd(Manager *m) {
+        Set *groups;
+        char *group;
+        unsigned n = 0;
+        int r = 0;
+
+        assert(m);
+
+        groups = set_new(string_hash_func, string_compare_func);
+        if (!groups)
+                return log_oom();
+
+        /* First collect everything that is queued, so that a group
+         * that is reported more than once is only checked once */
+        for (;;) {
+                char buf[PATH_MAX+1];
+                struct iovec iovec = {
+                        .iov_base = buf,
+                        .iov_len = sizeof(buf)-1,
+                };
+
+                union {
+                        struct cmsghdr cmsghdr;
+                        uint8_t buf[CMSG_SPACE(sizeof(struct ucred))];
+                } control = {};
+
+                struct msghdr msghdr = {
+                        .msg_iov = &iovec,
+                        .msg_iovlen = 1,
+                        .msg_control = &control,
+                        .msg_controllen = sizeof(control),
+                };
+                struct ucred *ucred;
+                ssize_t k;
+
+                k = recvmsg(m->cgroups_agent_watch.fd, &msghdr, MSG_DONTWAIT);
+                if (k < 0) {
+                        if (errno == EAGAIN || errno == EINTR)
+                                break;
+
+                        r = -errno;
+                        break;
+                }
+
+                if (msghdr.msg_controllen < CMSG_LEN(sizeof(struct ucred)) ||
+                    control.cmsghdr.cmsg_level != SOL_SOCKET ||
+                    control.cmsghdr.cmsg_type != SCM_CREDENTIALS ||
+                    control.cmsghdr.cmsg_len != CMSG_LEN(sizeof(struct ucred))) {
+                        log_warning("Received cgroups agent message without credentials. Ignoring.");
+                        continue;
+                }
+
+                ucred = (struct ucred*) CMSG_DATA(&control.cmsghdr);
+                if (ucred->uid != 0) {
+                        log_warning("Received cgroups agent message from unprivileged process %lu. Ignoring.", (unsigned long) ucred->pid);
+                        continue;
+                }
+
+                if (k == 0 || (msghdr.msg_flags & MSG_TRUNC)) {
+                        log_warning("Received invalid cgroups agent message. Ignoring.");
+                        continue;
+                }
+
+                buf[k] = 0;
+                n++;
+
+                if (set_get(groups, buf))
+                        continue;
+
+                group = strdup(buf);
+                if (!group) {
+                        r = log_oom();
+                        break;
+                }
+
+                if (set_put(groups, group) < 0) {
+                        free(group);
+                        r = log_oom();
+                        break;
+                }
+        }
+
+        if (n > 0)
+                log_debug("Got %u cgroup release notifications for %u groups.", n, set_size(groups));
+
+        while ((group = set_steal_first(groups))) {
+                cgroup_notify_empty(m, group);
+
+                /* The user instances still listen on the bus for
+                 * this. Groups below our own hierarchy are of no
+                 * interest to them. */
+                if (!m->cgroup_hierarchy || !path_startswith(group, m->cgroup_hierarchy))
+                        bus_forward_agent_released(m, group);
+
+                free(group);
+        }
+
+        set_free(groups);
+
+        return r;
+}
+
 static int manager_dispatch_sigchld(Manager *m) {
         assert(m);
 
         for (;;) {
                 siginfo_t si = {};
-                Unit *u;
+                Unit *u, *t;
                 int r;
 
                 /* First we call waitd() for a PID and do not reap the
@@ -1292,7 +1550,10 @@ static int manager_dispatch_sigchld(Manager *m) {
                 if (si.si_pid <= 0)
                         break;
 
-                if (si.si_code == CLD_EXITED || si.si_code == CLD_KILLED || si.si_code == CLD_DUMPED) {
+                /* Reading the name costs a trip to /proc, hence
+                 * don't bother unless it is actually logged */
+                if (log_get_max_level() >= LOG_DEBUG &&
+                    (si.si_code == CLD_EXITED || si.si_code == CLD_KILLED || si.si_code == CLD_DUMPED)) {
                         _cleanup_free_ char *name = NULL;
 
                         get_process_comm(si.si_pid, &name);
@@ -1308,9 +1569,7 @@ static int manager_dispatch_sigchld(Manager *m) {
                         return r;
 
                 /* And now figure out the unit this belongs to */
-                u = hashmap_get(m->watch_pids, LONG_TO_PTR(si.si_pid));
-                if (!u)
-                        u = cgroup_unit_by_pid(m, si.si_pid);
+                u = manager_get_unit_by_child(m, si.si_pid);
 
                 /* And now, we actually reap the zombie. */
                 if (waitid(P_PID, si.si_pid, &si, WEXITED) < 0) {
@@ -1320,6 +1579,10 @@ static int manager_dispatch_sigchld(Manager *m) {
                         return -errno;
                 }
 
+                t = hashmap_get(m->pid_units, LONG_TO_PTR(si.si_pid));
+                if (t)
+                        unit_untrack_pid(t, si.si_pid);
+
                 if (si.si_code != CLD_EXITED && si.si_code != CLD_KILLED && si.si_code != CLD_DUMPED)
                         continue;
 
@@ -1586,6 +1849,129 @@ static int manager_process_signal_fd(Manager *m) {
         return 0;
 }
 
+static TimerQueue **manager_timer_queue(Manager *m, clockid_t clock_id, Watch **w) {
+        assert(m);
+
+        switch (clock_id) {
+
+        case CLOCK_MONOTONIC:
+                if (w)
+                        *w = &m->monotonic_timer_watch;
+                return &m->monotonic_timers;
+
+        case CLOCK_REALTIME:
+                if (w)
+                        *w = &m->realtime_timer_watch;
+                return &m->realtime_timers;
+
+        default:
+                assert_not_reached("Unsupported clock");
+        }
+}
+
+int manager_watch_timer(Manager *m, Watch *w, clockid_t clock_id, usec_t usec) {
+        TimerQueue **q;
+        Watch *qw;
+        int r;
+
+        assert(m);
+        assert(w);
+
+        /* Queues the timer watch w to elapse at the absolute time
+         * usec. Setting up type and data of the watch is left to
+         * the caller. */
+
+        q = manager_timer_queue(m, clock_id, &qw);
+
+        if (!*q) {
+                struct epoll_event ev = {
+                        .data.ptr = qw,
+                        .events = EPOLLIN,
+                };
+
+                r = timer_queue_new(clock_id, q);
+                if (r < 0)
+                        return r;
+
+                timer_queue_set_accuracy(*q, m->timer_accuracy_usec);
+
+                qw->type = WATCH_TIMER_QUEUE;
+                qw->fd = timer_queue_get_fd(*q);
+
+                if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, qw->fd, &ev) < 0) {
+                        r = -errno;
+                        timer_queue_free(*q);
+                        *q = NULL;
+                        watch_init(qw);
+                        return r;
+                }
+        }
+
+        return timer_queue_put(*q, &w->timer, usec);
+}
+
+void manager_unwatch_timer(Manager *m, Watch *w) {
+        assert(m);
+        assert(w);
+
+        timer_queue_remove(&w->timer);
+}
+
+static int manager_arm_timers(Manager *m) {
+        int r;
+
+        assert(m);
+
+        /* Program the timerfds for the earliest timers, if that
+         * changed since the last iteration */
+
+        if (m->monotonic_timers) {
+                r = timer_queue_arm(m->monotonic_timers);
+                if (r < 0)
+                        return r;
+        }
+
+        if (m->realtime_timers) {
+                r = timer_queue_arm(m->realtime_timers);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static void manager_dispatch_timers(Manager *m, Watch *w) {
+        TimerQueueEntry *e;
+        TimerQueue *q;
+        usec_t n;
+
+        assert(m);
+        assert(w);
+
+        q = w == &m->realtime_timer_watch ? m->realtime_timers : m->monotonic_timers;
+        assert(q);
+
+        timer_queue_flush(q);
+
+        /* Handlers may add and remove timers while we go, whatever
+         * they queue is left for the next wakeup, even if it is due
+         * right away */
+        n = now(timer_queue_get_clock(q));
+
+        while ((e = timer_queue_pop_elapsed(q, n))) {
+                Watch *t = container_of(e, Watch, timer);
+
+                if (t->type == WATCH_UNIT_TIMER)
+                        UNIT_VTABLE(t->data.unit)->timer_event(t->data.unit, 1, t);
+                else if (t->type == WATCH_MOUNT)
+                        mount_rescan_timer_event(m);
+                else {
+                        assert(t->type == WATCH_JOB_TIMER);
+                        job_timer_event(t->data.job, 1, t);
+                }
+        }
+}
+
 static int process_event(Manager *m, struct epoll_event *ev) {
         int r;
         Watch *w;
@@ -1622,34 +2008,27 @@ static int process_event(Manager *m, struct epoll_event *ev) {
 
                 break;
 
-        case WATCH_FD:
+        case WATCH_CGROUPS_AGENT:
 
-                /* Some fd event, to be dispatched to the units */
-                UNIT_VTABLE(w->data.unit)->fd_event(w->data.unit, w->fd, ev->events, w);
-                break;
+                /* Some groups ran empty? */
+                if (ev->events != EPOLLIN)
+                        return -EINVAL;
 
-        case WATCH_UNIT_TIMER:
-        case WATCH_JOB_TIMER: {
-                uint64_t v;
-                ssize_t k;
+                if ((r = manager_process_cgroups_agent_fd(m)) < 0)
+                        return r;
 
-                /* Some timer event, to be dispatched to the units */
-                k = read(w->fd, &v, sizeof(v));
-                if (k != sizeof(v)) {
+                break;
 
-                        if (k < 0 && (errno == EINTR || errno == EAGAIN))
-                                break;
+        case WATCH_FD:
 
-                        log_error("Failed to read timer event counter: %s", k < 0 ? strerror(-k) : "Short read");
-                        return k < 0 ? -errno : -EIO;
-                }
+                /* Some fd event, to be dispatched to the units */
+                UNIT_VTABLE(w->data.unit)->fd_event(w->data.unit, w->fd, ev->events, w);
+                break;
 
-                if (w->type == WATCH_UNIT_TIMER)
-                        UNIT_VTABLE(w->data.unit)->timer_event(w->data.unit, v, w);
-                else
-                        job_timer_event(w->data.job, v, w);
+        case WATCH_TIMER_QUEUE:
+                /* Some unit or job timers elapsed */
+                manager_dispatch_timers(m, w);
                 break;
-        }
 
         case WATCH_MOUNT:
                 /* Some mount table change, intended for the mount subsystem */
@@ -1686,6 +2065,7 @@ static int process_event(Manager *m, struct epoll_event *ev) {
                 /* Restart the watch */
                 epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, m->time_change_watch.fd,
                           NULL);
+                m->watch_generation++;
                 close_nointr_nofail(m->time_change_watch.fd);
                 watch_init(&m->time_change_watch);
                 manager_setup_time_change(m);
@@ -1698,6 +2078,13 @@ static int process_event(Manager *m, struct epoll_event *ev) {
                 break;
         }
 
+        case WATCH_UNIT_PATH_CACHE:
+                /* Some unit file was created or removed */
+                r = path_cache_flush(m->unit_path_cache);
+                if (r < 0)
+                        log_warning("Failed to update unit path cache: %s", strerror(-r));
+                break;
+
         case WATCH_JOBS_IN_PROGRESS: {
                 uint64_t v;
 
@@ -1716,17 +2103,112 @@ static int process_event(Manager *m, struct epoll_event *ev) {
         return 0;
 }
 
-int manager_loop(Manager *m) {
-        int r;
+static int event_priority(const struct epoll_event *ev) {
+        const Watch *w = ev->data.ptr;
 
-        RATELIMIT_DEFINE(rl, 1*USEC_PER_SEC, 50000);
+        /* Lower values are dispatched first. Signals (and thus
+         * SIGCHLD) go before everything else, then the sources that
+         * report state changes of units, then the bus, and finally
+         * timers, which are the least urgent. */
 
-        assert(m);
-        m->exit_code = MANAGER_RUNNING;
+        switch (w->type) {
+
+        case WATCH_SIGNAL:
+                return 0;
+
+        case WATCH_NOTIFY:
+        case WATCH_CGROUPS_AGENT:
+        case WATCH_FD:
+        case WATCH_MOUNT:
+        case WATCH_SWAP:
+        case WATCH_UDEV:
+        case WATCH_TIME_CHANGE:
+        case WATCH_UNIT_PATH_CACHE:
+                return 1;
+
+        case WATCH_DBUS_WATCH:
+        case WATCH_DBUS_TIMEOUT:
+                return 2;
+
+        default:
+                return 3;
+        }
+}
+
+static void manager_account_dispatch(Manager *m, WatchType t, usec_t usec) {
+        unsigned k = 0;
 
-        /* Release the path cache */
-        set_free_free(m->unit_path_cache);
-        m->unit_path_cache = NULL;
+        assert(m);
+
+        if (t < 0 || t >= _WATCH_TYPE_MAX)
+                return;
+
+        m->n_dispatched[t]++;
+        m->dispatch_usec[t] += usec;
+
+        while (usec > 0 && k < MANAGER_DISPATCH_HISTOGRAM_MAX - 1) {
+                usec >>= 1;
+                k++;
+        }
+
+        m->dispatch_histogram[t][k]++;
+}
+
+static int manager_dispatch_events(Manager *m, struct epoll_event *events, unsigned n) {
+        int priority[EPOLL_EVENTS_MAX];
+        unsigned generation, i;
+        int p, r;
+
+        assert(m);
+        assert(events);
+        assert(n <= EPOLL_EVENTS_MAX);
+
+        /* Dispatches a batch of events in order of priority. Since
+         * a handler might remove or free the watch of an event we
+         * have not dispatched yet, we stop as soon as any watch is
+         * removed. As all our fds are level triggered, whatever we
+         * skipped will simply be reported again by the next
+         * epoll_wait(). */
+
+        for (i = 0; i < n; i++)
+                priority[i] = event_priority(events + i);
+
+        generation = m->watch_generation;
+
+        for (p = 0; p < EVENT_PRIORITY_MAX; p++)
+                for (i = 0; i < n; i++) {
+                        WatchType t;
+                        usec_t ts;
+
+                        if (priority[i] != p)
+                                continue;
+
+                        if (m->watch_generation != generation ||
+                            m->exit_code != MANAGER_RUNNING)
+                                return 0;
+
+                        t = ((Watch*) events[i].data.ptr)->type;
+
+                        /* Only charge each source for its own
+                         * handler */
+                        ts = now(CLOCK_MONOTONIC);
+                        r = process_event(m, events + i);
+                        if (r < 0)
+                                return r;
+
+                        manager_account_dispatch(m, t, now(CLOCK_MONOTONIC) - ts);
+                }
+
+        return 0;
+}
+
+int manager_loop(Manager *m) {
+        int r;
+
+        RATELIMIT_DEFINE(rl, 1*USEC_PER_SEC, 50000);
+
+        assert(m);
+        m->exit_code = MANAGER_RUNNING;
 
         manager_check_finished(m);
 
@@ -1737,7 +2219,7 @@ int manager_loop(Manager *m) {
                 return r;
 
         while (m->exit_code == MANAGER_RUNNING) {
-                struct epoll_event event;
+                struct epoll_event events[EPOLL_EVENTS_MAX];
                 int n;
                 int wait_msec = -1;
 
@@ -1780,7 +2262,11 @@ int manager_loop(Manager *m) {
                 } else
                         wait_msec = -1;
 
-                n = epoll_wait(m->epoll_fd, &event, 1, wait_msec);
+                r = manager_arm_timers(m);
+                if (r < 0)
+                        return r;
+
+                n = epoll_wait(m->epoll_fd, events, ELEMENTSOF(events), wait_msec);
                 if (n < 0) {
 
                         if (errno == EINTR)
@@ -1790,9 +2276,7 @@ int manager_loop(Manager *m) {
                 } else if (n == 0)
                         continue;
 
-                assert(n == 1);
-
-                r = process_event(m, &event);
+                r = manager_dispatch_events(m, events, n);
                 if (r < 0)
                         return r;
         }
@@ -2035,7 +2519,8 @@ int manager_open_serialization(Manager *m, FILE **_f) {
         return 0;
 }
 
-int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root) {
+int manager_serialize(Manager *m, FILE *f, FDSet *fds, SerializeFormat format, bool switching_root) {
+        Serializer *s;
         Iterator i;
         Unit *u;
         const char *t;
@@ -2045,22 +2530,28 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root) {
         assert(m);
         assert(f);
         assert(fds);
+        assert(!m->serializer);
+
+        r = serializer_new(&s, f, format);
+        if (r < 0)
+                return r;
 
+        m->serializer = s;
         m->n_reloading ++;
 
-        fprintf(f, "current-job-id=%i\n", m->current_job_id);
-        fprintf(f, "taint-usr=%s\n", yes_no(m->taint_usr));
-        fprintf(f, "n-installed-jobs=%u\n", m->n_installed_jobs);
-        fprintf(f, "n-failed-jobs=%u\n", m->n_failed_jobs);
+        serialize_item_format(s, f, "current-job-id", "%i", m->current_job_id);
+        serialize_item(s, f, "taint-usr", yes_no(m->taint_usr));
+        serialize_item_format(s, f, "n-installed-jobs", "%u", m->n_installed_jobs);
+        serialize_item_format(s, f, "n-failed-jobs", "%u", m->n_failed_jobs);
 
-        dual_timestamp_serialize(f, "firmware-timestamp", &m->firmware_timestamp);
-        dual_timestamp_serialize(f, "kernel-timestamp", &m->kernel_timestamp);
-        dual_timestamp_serialize(f, "loader-timestamp", &m->loader_timestamp);
-        dual_timestamp_serialize(f, "initrd-timestamp", &m->initrd_timestamp);
+        serialize_dual_timestamp(s, f, "firmware-timestamp", &m->firmware_timestamp);
+        serialize_dual_timestamp(s, f, "kernel-timestamp", &m->kernel_timestamp);
+        serialize_dual_timestamp(s, f, "loader-timestamp", &m->loader_timestamp);
+        serialize_dual_timestamp(s, f, "initrd-timestamp", &m->initrd_timestamp);
 
         if (!in_initrd()) {
-                dual_timestamp_serialize(f, "userspace-timestamp", &m->userspace_timestamp);
-                dual_timestamp_serialize(f, "finish-timestamp", &m->finish_timestamp);
+                serialize_dual_timestamp(s, f, "userspace-timestamp", &m->userspace_timestamp);
+                serialize_dual_timestamp(s, f, "finish-timestamp", &m->finish_timestamp);
         }
 
         if (!switching_root) {
@@ -2069,11 +2560,11 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root) {
 
                         ce = cescape(*e);
                         if (ce)
-                                fprintf(f, "env=%s\n", *e);
+                                serialize_item(s, f, "env", ce);
                 }
         }
 
-        fputc('\n', f);
+        serialize_end(s, f);
 
         HASHMAP_FOREACH_KEY(u, t, m->units, i) {
                 if (u->id != t)
@@ -2083,20 +2574,24 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root) {
                         continue;
 
                 /* Start marker */
-                fputs(u->id, f);
-                fputc('\n', f);
+                serialize_marker(s, f, u->id);
 
-                if ((r = unit_serialize(u, f, fds, !switching_root)) < 0) {
-                        m->n_reloading --;
-                        return r;
-                }
+                r = unit_serialize(u, f, fds, !switching_root);
+                if (r < 0)
+                        goto finish;
         }
 
+        r = ferror(f) ? -EIO : 0;
+
+finish:
         assert(m->n_reloading > 0);
         m->n_reloading --;
 
-        if (ferror(f))
-                return -EIO;
+        m->serializer = NULL;
+        serializer_free(s);
+
+        if (r < 0)
+                return r;
 
         r = bus_fdset_add_all(m, fds);
         if (r < 0)
@@ -2106,78 +2601,81 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root) {
 }
 
 int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
+        Deserializer *d;
         int r = 0;
 
         assert(m);
         assert(f);
+        assert(!m->deserializer);
 
-        log_debug("Deserializing state...");
+        r = deserializer_new(&d, f);
+        if (r < 0)
+                return r;
 
+        log_debug("Deserializing state (%s format)...",
+                  serialize_format_to_string(deserializer_format(d)));
+
+        m->deserializer = d;
         m->n_reloading ++;
 
         for (;;) {
-                char line[LINE_MAX], *l;
-
-                if (!fgets(line, sizeof(line), f)) {
-                        if (feof(f))
-                                r = 0;
-                        else
-                                r = -errno;
+                char *l, *v;
 
+                r = deserialize_next(d, f, &l, &v);
+                if (r < 0)
                         goto finish;
-                }
-
-                char_array_0(line);
-                l = strstrip(line);
+                if (r == 0) {
+                        if (feof(f))
+                                goto finish;
 
-                if (l[0] == 0)
                         break;
+                }
 
-                if (startswith(l, "current-job-id=")) {
+                if (streq(l, "current-job-id")) {
                         uint32_t id;
 
-                        if (safe_atou32(l+15, &id) < 0)
-                                log_debug("Failed to parse current job id value %s", l+15);
+                        if (safe_atou32(v, &id) < 0)
+                                log_debug("Failed to parse current job id value %s", v);
                         else
                                 m->current_job_id = MAX(m->current_job_id, id);
-                } else if (startswith(l, "n-installed-jobs=")) {
+                } else if (streq(l, "n-installed-jobs")) {
                         uint32_t n;
 
-                        if (safe_atou32(l+17, &n) < 0)
-                                log_debug("Failed to parse installed jobs counter %s", l+17);
+                        if (safe_atou32(v, &n) < 0)
+                                log_debug("Failed to parse installed jobs counter %s", v);
                         else
                                 m->n_installed_jobs += n;
-                } else if (startswith(l, "n-failed-jobs=")) {
+                } else if (streq(l, "n-failed-jobs")) {
                         uint32_t n;
 
-                        if (safe_atou32(l+14, &n) < 0)
-                                log_debug("Failed to parse failed jobs counter %s", l+14);
+                        if (safe_atou32(v, &n) < 0)
+                                log_debug("Failed to parse failed jobs counter %s", v);
                         else
                                 m->n_failed_jobs += n;
-                } else if (startswith(l, "taint-usr=")) {
+                } else if (streq(l, "taint-usr")) {
                         int b;
 
-                        if ((b = parse_boolean(l+10)) < 0)
-                                log_debug("Failed to parse taint /usr flag %s", l+10);
+                        if ((b = parse_boolean(v)) < 0)
+                                log_debug("Failed to parse taint /usr flag %s", v);
                         else
                                 m->taint_usr = m->taint_usr || b;
-                } else if (startswith(l, "firmware-timestamp="))
-                        dual_timestamp_deserialize(l+19, &m->firmware_timestamp);
-                else if (startswith(l, "loader-timestamp="))
-                        dual_timestamp_deserialize(l+17, &m->loader_timestamp);
-                else if (startswith(l, "kernel-timestamp="))
-                        dual_timestamp_deserialize(l+17, &m->kernel_timestamp);
-                else if (startswith(l, "initrd-timestamp="))
-                        dual_timestamp_deserialize(l+17, &m->initrd_timestamp);
-                else if (startswith(l, "userspace-timestamp="))
-                        dual_timestamp_deserialize(l+20, &m->userspace_timestamp);
-                else if (startswith(l, "finish-timestamp="))
-                        dual_timestamp_deserialize(l+17, &m->finish_timestamp);
-                else if (startswith(l, "env=")) {
+                } else if (streq(l, "firmware-timestamp"))
+                        dual_timestamp_deserialize(v, &m->firmware_timestamp);
+                else if (streq(l, "loader-timestamp"))
+                        dual_timestamp_deserialize(v, &m->loader_timestamp);
+                else if (streq(l, "kernel-timestamp"))
+                        dual_timestamp_deserialize(v, &m->kernel_timestamp);
+                else if (streq(l, "initrd-timestamp"))
+                        dual_timestamp_deserialize(v, &m->initrd_timestamp);
+                else if (streq(l, "userspace-timestamp"))
+                        dual_timestamp_deserialize(v, &m->userspace_timestamp);
+                else if (streq(l, "finish-timestamp"))
+                        dual_timestamp_deserialize(v, &m->finish_timestamp);
+                else if (streq(l, "env")) {
                         _cleanup_free_ char *uce = NULL;
                         char **e;
 
-                        uce = cunescape(l+4);
+                        uce = cunescape(v);
                         if (!uce) {
                                 r = -ENOMEM;
                                 goto finish;
@@ -2197,21 +2695,20 @@ int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
 
         for (;;) {
                 Unit *u;
-                char name[UNIT_NAME_MAX+2];
+                char *name, *v;
 
                 /* Start marker */
-                if (!fgets(name, sizeof(name), f)) {
+                r = deserialize_next(d, f, &name, &v);
+                if (r < 0)
+                        goto finish;
+                if (r == 0) {
                         if (feof(f))
-                                r = 0;
-                        else
-                                r = -errno;
+                                goto finish;
 
-                        goto finish;
+                        continue;
                 }
 
-                char_array_0(name);
-
-                r = manager_load_unit(m, strstrip(name), NULL, NULL, &u);
+                r = manager_load_unit(m, name, NULL, NULL, &u);
                 if (r < 0)
                         goto finish;
 
@@ -2221,14 +2718,15 @@ int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
         }
 
 finish:
-        if (ferror(f)) {
+        if (ferror(f))
                 r = -EIO;
-                goto finish;
-        }
 
         assert(m->n_reloading > 0);
         m->n_reloading --;
 
+        m->deserializer = NULL;
+        deserializer_free(d);
+
         return r;
 }
 
@@ -2254,19 +2752,148 @@ int manager_distribute_fds(Manager *m, FDSet *fds) {
         return 0;
 }
 
+/* Returns how many units that could not be found so far now have a
+ * unit file, or -EAGAIN if the configuration of any loaded unit
+ * changed */
+static int manager_check_units_changed(Manager *m) {
+        Iterator i;
+        Unit *u;
+        char *k;
+        int n = 0;
+
+        assert(m);
+
+        /* The SysV rcN.d links are only looked at when enumerating */
+        if (service_sysv_dirs_changed(m)) {
+                log_debug("SysV init script directories changed.");
+                return -EAGAIN;
+        }
+
+        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                LoadCacheCheck c;
+
+                /* Aliases are checked with the unit they belong to */
+                if (u->id != k)
+                        continue;
+
+                /* Units not loaded yet will read the new files
+                 * anyway */
+                if (u->load_state == UNIT_STUB ||
+                    u->load_state == UNIT_MERGED)
+                        continue;
+
+                c = load_cache_check_unit(u);
+                if (c == LOAD_CACHE_CHANGED) {
+                        log_debug("Configuration of %s changed.", u->id);
+                        return -EAGAIN;
+                }
+
+                if (c == LOAD_CACHE_FOUND)
+                        n++;
+        }
+
+        return n;
+}
+
+static void manager_load_found_units(Manager *m) {
+        Iterator i;
+        Unit *u;
+        char *k;
+
+        assert(m);
+
+        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                if (u->id != k ||
+                    u->load_state != UNIT_ERROR ||
+                    u->load_error != -ENOENT ||
+                    u->fragment_path)
+                        continue;
+
+                if (load_cache_check_unit(u) != LOAD_CACHE_FOUND)
+                        continue;
+
+                log_debug("Found unit file for %s.", u->id);
+
+                u->load_state = UNIT_STUB;
+                u->load_error = 0;
+                unit_add_to_load_queue(u);
+        }
+
+        manager_dispatch_load_queue(m);
+}
+
 int manager_reload(Manager *m) {
-        int r, q;
-        FILE *f;
-        FDSet *fds;
+        _cleanup_strv_free_ char **names = NULL;
+        char span[FORMAT_TIMESPAN_MAX];
+        usec_t begin;
+        int r = 0, q;
+        FILE *f = NULL;
+        FDSet *fds = NULL;
+        Iterator i;
+        Unit *u;
+        char *k;
 
         assert(m);
 
-        r = manager_open_serialization(m, &f);
-        if (r < 0)
-                return r;
+        begin = now(CLOCK_MONOTONIC);
 
         m->n_reloading ++;
 
+        /* Remember which units to read ahead once the new unit
+         * paths are known */
+        HASHMAP_FOREACH_KEY(u, k, m->units, i)
+                if (u->id == k && u->fragment_path)
+                        if (strv_extend(&names, k) < 0) {
+                                m->n_reloading --;
+                                return -ENOMEM;
+                        }
+
+        manager_undo_generators(m);
+        lookup_paths_free(&m->lookup_paths);
+
+        /* Find new unit paths */
+        manager_run_generators(m);
+
+        q = lookup_paths_init(
+                        &m->lookup_paths, m->running_as, true,
+                        m->generator_unit_path,
+                        m->generator_unit_path_early,
+                        m->generator_unit_path_late);
+        if (q < 0)
+                r = q;
+
+        manager_build_unit_path_cache(m);
+
+        m->load_cache_generation++;
+
+        if (m->incremental_reload) {
+                /* If no loaded unit changed there is no need to
+                 * tear everything down, only units that are found
+                 * now need to be loaded. Device, mount and swap units
+                 * need not be enumerated again either, they are kept
+                 * up to date by their own events. If any unit
+                 * changed, everything is reloaded below. */
+                q = manager_check_units_changed(m);
+                if (q >= 0) {
+                        m->n_reloading--;
+
+                        if (q > 0)
+                                manager_load_found_units(m);
+
+                        load_cache_trim(m);
+
+                        log_info("Reloaded in %s, no loaded unit changed, %i new unit files found.",
+                                 format_timespan(span, sizeof(span), now(CLOCK_MONOTONIC) - begin, USEC_PER_MSEC), q);
+                        return r;
+                }
+        }
+
+        q = manager_open_serialization(m, &f);
+        if (q < 0) {
+                m->n_reloading --;
+                return q;
+        }
+
         fds = fdset_new();
         if (!fds) {
                 m->n_reloading --;
@@ -2274,9 +2901,12 @@ int manager_reload(Manager *m) {
                 goto finish;
         }
 
-        r = manager_serialize(m, f, fds, false);
-        if (r < 0) {
+        /* We read this back ourselves, hence can use the faster
+         * format no matter what */
+        q = manager_serialize(m, f, fds, SERIALIZE_BINARY, false);
+        if (q < 0) {
                 m->n_reloading --;
+                r = q;
                 goto finish;
         }
 
@@ -2288,21 +2918,8 @@ int manager_reload(Manager *m) {
 
         /* From here on there is no way back. */
         manager_clear_jobs_and_units(m);
-        manager_undo_generators(m);
-        lookup_paths_free(&m->lookup_paths);
 
-        /* Find new unit paths */
-        manager_run_generators(m);
-
-        q = lookup_paths_init(
-                        &m->lookup_paths, m->running_as, true,
-                        m->generator_unit_path,
-                        m->generator_unit_path_early,
-                        m->generator_unit_path_late);
-        if (q < 0)
-                r = q;
-
-        manager_build_unit_path_cache(m);
+        load_cache_prefetch(m, names);
 
         /* First, enumerate what we can from all config files */
         q = manager_enumerate(m);
@@ -2322,9 +2939,14 @@ int manager_reload(Manager *m) {
         if (q < 0)
                 r = q;
 
+        load_cache_trim(m);
+
         assert(m->n_reloading > 0);
         m->n_reloading--;
 
+        log_info("Reloaded all units in %s.",
+                 format_timespan(span, sizeof(span), now(CLOCK_MONOTONIC) - begin, USEC_PER_MSEC));
+
 finish:
         if (f)
                 fclose(f);
@@ -2466,6 +3088,9 @@ void manager_check_finished(Manager *m) {
 
         bus_broadcast_finished(m, firmware_usec, loader_usec, kernel_usec, initrd_usec, userspace_usec, total_usec);
 
+        log_debug("Sent %u D-Bus signals during startup, %u unit changes were coalesced, %u sent batched.",
+                  m->n_bus_signals, m->n_bus_changes_coalesced, m->n_bus_changes_batched);
+
         sd_notifyf(false,
                    "READY=1\nSTATUS=Startup finished in %s.",
                    format_timespan(sum, sizeof(sum), total_usec, USEC_PER_MSEC));
@@ -2527,15 +3152,285 @@ static void trim_generator_dir(Manager *m, char **generator) {
         return;
 }
 
+static void generator_times_free(Manager *m) {
+        unsigned i;
+
+        assert(m);
+
+        for (i = 0; i < m->n_generator_times; i++)
+                free(m->generator_times[i].name);
+
+        free(m->generator_times);
+        m->generator_times = NULL;
+        m->n_generator_times = 0;
+}
+
+static int generator_time_compare(const void *a, const void *b) {
+        const GeneratorTime *x = a, *y = b;
+
+        return strcmp(x->name, y->name);
+}
+
+static int generator_load(const char *path, DIR *d, GeneratorTime **ret, unsigned *n_ret) {
+        GeneratorTime *g = NULL;
+        size_t allocated = 0;
+        unsigned n = 0;
+        struct dirent *de;
+
+        assert(path);
+        assert(d);
+        assert(ret);
+        assert(n_ret);
+
+        while ((de = readdir(d))) {
+                if (!dirent_is_file(de))
+                        continue;
+
+                if (!GREEDY_REALLOC(g, allocated, n + 1))
+                        goto oom;
+
+                g[n].name = strdup(de->d_name);
+                if (!g[n].name)
+                        goto oom;
+
+                g[n].usec = 0;
+                g[n].result = GENERATOR_SUCCESS;
+                n++;
+        }
+
+        /* Start them in a stable order, so that the same ones run
+         * side by side on every boot */
+        if (n > 0)
+                qsort(g, n, sizeof(GeneratorTime), generator_time_compare);
+
+        *ret = g;
+        *n_ret = n;
+        return 0;
+
+oom:
+        while (n > 0)
+                free(g[--n].name);
+        free(g);
+
+        return -ENOMEM;
+}
+
+static pid_t generator_spawn(const char *path, const char *name, char *argv[]) {
+        _cleanup_free_ char *p = NULL;
+        pid_t pid;
+
+        p = strjoin(path, "/", name, NULL);
+        if (!p) {
+                log_oom();
+                return -ENOMEM;
+        }
+
+        pid = fork();
+        if (pid < 0) {
+                log_error("Failed to fork: %m");
+                return -errno;
+        }
+
+        if (pid == 0) {
+                sigset_t ss;
+
+                /* Child */
+
+                reset_all_signal_handlers();
+                assert_se(sigemptyset(&ss) == 0);
+                assert_se(sigprocmask(SIG_SETMASK, &ss, NULL) == 0);
+
+                argv[0] = p;
+                execv(p, argv);
+
+                log_error("Failed to execute %s: %m", p);
+                _exit(EXIT_FAILURE);
+        }
+
+        log_debug("Spawned %s as %lu", p, (unsigned long) pid);
+
+        return pid;
+}
+
+static void generator_execute_all(Manager *m, const char *path, DIR *d, char *argv[], unsigned n_workers, usec_t timeout_usec) {
+        _cleanup_free_ pid_t *pids = NULL;
+        _cleanup_free_ usec_t *starts = NULL;
+        GeneratorTime *g = NULL;
+        unsigned n = 0, i, next = 0, n_running = 0;
+        bool got_sigchld = false;
+        sigset_t mask;
+        usec_t begin;
+
+        assert(m);
+        assert(path);
+        assert(d);
+        assert(n_workers > 0);
+
+        if (generator_load(path, d, &g, &n) < 0) {
+                log_oom();
+                return;
+        }
+
+        m->generator_times = g;
+        m->n_generator_times = n;
+
+        if (n <= 0)
+                return;
+
+        pids = new0(pid_t, n);
+        starts = new0(usec_t, n);
+        if (!pids || !starts) {
+                log_oom();
+                return;
+        }
+
+        /* SIGCHLD is blocked and delivered to our signalfd, so we
+         * can simply wait for it here */
+        assert_se(sigemptyset(&mask) == 0);
+        assert_se(sigaddset(&mask, SIGCHLD) == 0);
+
+        begin = now(CLOCK_MONOTONIC);
+
+        for (;;) {
+                struct timespec ts;
+                usec_t n_usec, deadline = (usec_t) -1;
+                bool reaped = false;
+
+                while (n_running < n_workers && next < n) {
+                        pid_t pid;
+
+                        pid = generator_spawn(path, g[next].name, argv);
+                        if (pid < 0)
+                                g[next].result = GENERATOR_FAILURE;
+                        else {
+                                pids[next] = pid;
+                                starts[next] = now(CLOCK_MONOTONIC);
+                                n_running++;
+                        }
+
+                        next++;
+                }
+
+                if (n_running <= 0)
+                        break;
+
+                n_usec = now(CLOCK_MONOTONIC);
+
+                for (i = 0; i < next; i++) {
+                        siginfo_t si = {};
+
+                        if (pids[i] <= 0)
+                                continue;
+
+                        if (waitid(P_PID, pids[i], &si, WEXITED|WNOHANG) < 0) {
+                                if (errno == EINTR)
+                                        continue;
+
+                                log_error("waitid() failed: %m");
+                                g[i].result = GENERATOR_FAILURE;
+                                pids[i] = 0;
+                                n_running--;
+                                reaped = true;
+                                continue;
+                        }
+
+                        if (si.si_pid <= 0) {
+                                usec_t timeout;
+
+                                timeout = starts[i] + timeout_usec;
+                                if (timeout > n_usec) {
+                                        deadline = MIN(deadline, timeout);
+                                        continue;
+                                }
+
+                                /* All generators write to the same
+                                 * directories, hence there is no
+                                 * telling what this one wrote so
+                                 * far. It stays. */
+                                if (g[i].result != GENERATOR_TIMEOUT) {
+                                        log_warning("Generator %s/%s timed out, killing. Units it generated until now are used anyway.", path, g[i].name);
+                                        kill(pids[i], SIGKILL);
+                                        g[i].result = GENERATOR_TIMEOUT;
+                                }
+
+                                continue;
+                        }
+
+                        g[i].usec = n_usec - starts[i];
+
+                        if (g[i].result != GENERATOR_TIMEOUT) {
+                                if (is_clean_exit(si.si_code, si.si_status, NULL))
+                                        log_debug("%s/%s exited successfully.", path, g[i].name);
+                                else {
+                                        if (si.si_code == CLD_EXITED)
+                                                log_error("%s/%s exited with exit status %i.", path, g[i].name, si.si_status);
+                                        else
+                                                log_error("%s/%s terminated by signal %s.", path, g[i].name, signal_to_string(si.si_status));
+
+                                        g[i].result = GENERATOR_FAILURE;
+                                }
+                        }
+
+                        pids[i] = 0;
+                        n_running--;
+                        reaped = true;
+                }
+
+                if (reaped)
+                        continue;
+
+                /* Wait for some generator to finish, or the next
+                 * one to time out. Killed ones will go away quickly,
+                 * check back soon for them. */
+                if (deadline == (usec_t) -1)
+                        deadline = n_usec + 10 * USEC_PER_MSEC;
+
+                timespec_store(&ts, deadline - n_usec);
+
+                if (sigtimedwait(&mask, NULL, &ts) == SIGCHLD)
+                        got_sigchld = true;
+        }
+
+        m->generators_usec = now(CLOCK_MONOTONIC) - begin;
+
+        /* We might have swallowed the notification about some other
+         * child exiting, let's make sure it is seen */
+        if (got_sigchld)
+                kill(getpid(), SIGCHLD);
+}
+
 void manager_run_generators(Manager *m) {
+        unsigned n_workers;
+        long ncpus;
+
+        assert(m);
+
+        /* The generators write to separate files, hence can run
+         * side by side. Most of their time is spent on loading and
+         * on I/O however, so there is no point in running a lot
+         * more of them at a time than there are CPUs. */
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_workers = MAX(ncpus > 0 ? (unsigned) ncpus * 2 : 0, 8U);
+
+        manager_run_generators_from(m,
+                                    m->running_as == SYSTEMD_SYSTEM ? SYSTEM_GENERATOR_PATH : USER_GENERATOR_PATH,
+                                    n_workers,
+                                    DEFAULT_GENERATOR_TIMEOUT_USEC);
+}
+
+void manager_run_generators_from(Manager *m, const char *generator_path, unsigned n_workers, usec_t timeout_usec) {
         DIR *d = NULL;
-        const char *generator_path;
         const char *argv[5];
         int r;
 
         assert(m);
+        assert(generator_path);
+
+        /* Don't keep reporting the times of an earlier run if this
+         * one does not get to run anything */
+        generator_times_free(m);
+        m->generators_usec = 0;
 
-        generator_path = m->running_as == SYSTEMD_SYSTEM ? SYSTEM_GENERATOR_PATH : USER_GENERATOR_PATH;
         d = opendir(generator_path);
         if (!d) {
                 if (errno == ENOENT)
@@ -2558,14 +3453,14 @@ void manager_run_generators(Manager *m) {
         if (r < 0)
                 goto finish;
 
-        argv[0] = NULL; /* Leave this empty, execute_directory() will fill something in */
+        argv[0] = NULL; /* Leave this empty, generator_spawn() will fill something in */
         argv[1] = m->generator_unit_path;
         argv[2] = m->generator_unit_path_early;
         argv[3] = m->generator_unit_path_late;
         argv[4] = NULL;
 
         RUN_WITH_UMASK(0022) {
-                execute_directory(generator_path, d, (char**) argv);
+                generator_execute_all(m, generator_path, d, (char**) argv, n_workers, timeout_usec);
         }
 
         trim_generator_dir(m, &m->generator_unit_path);
@@ -2594,6 +3489,9 @@ static void remove_generator_dir(Manager *m, char **generator) {
 void manager_undo_generators(Manager *m) {
         assert(m);
 
+        generator_times_free(m);
+        m->generators_usec = 0;
+
         remove_generator_dir(m, &m->generator_unit_path);
         remove_generator_dir(m, &m->generator_unit_path_early);
         remove_generator_dir(m, &m->generator_unit_path_late);
@@ -2712,3 +3610,32 @@ void watch_init(Watch *w) {
         w->type = WATCH_INVALID;
         w->fd = -1;
 }
+
+static const char* const watch_type_table[_WATCH_TYPE_MAX] = {
+        [WATCH_INVALID] = "invalid",
+        [WATCH_SIGNAL] = "signal",
+        [WATCH_NOTIFY] = "notify",
+        [WATCH_FD] = "fd",
+        [WATCH_UNIT_TIMER] = "unit-timer",
+        [WATCH_JOB_TIMER] = "job-timer",
+        [WATCH_MOUNT] = "mount",
+        [WATCH_SWAP] = "swap",
+        [WATCH_UDEV] = "udev",
+        [WATCH_DBUS_WATCH] = "dbus-watch",
+        [WATCH_DBUS_TIMEOUT] = "dbus-timeout",
+        [WATCH_TIME_CHANGE] = "time-change",
+        [WATCH_JOBS_IN_PROGRESS] = "jobs-in-progress",
+        [WATCH_TIMER_QUEUE] = "timer-queue",
+        [WATCH_UNIT_PATH_CACHE] = "unit-path-cache",
+        [WATCH_CGROUPS_AGENT] = "cgroups-agent"
+};
+
+DEFINE_STRING_TABLE_LOOKUP(watch_type, WatchType);
+
+static const char* const generator_result_table[_GENERATOR_RESULT_MAX] = {
+        [GENERATOR_SUCCESS] = "success",
+        [GENERATOR_FAILURE] = "failure",
+        [GENERATOR_TIMEOUT] = "timeout"
+};
+
+DEFINE_STRING_TABLE_LOOKUP(generator_result, GeneratorResult);
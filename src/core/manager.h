@@ -27,13 +27,28 @@
 #include <dbus/dbus.h>
 
 #include "fdset.h"
+#include "timer-queue.h"
+#include "path-cache.h"
+#include "path-index.h"
+#include "mount-table.h"
+#include "ratelimit.h"
+#include "serialize.h"
 
 /* Enforce upper limit how many names we allow */
 #define MANAGER_MAX_NAMES 131072 /* 128K */
 
+/* Handler run times are accounted in log2 buckets of usec, the
+ * first one covers everything below 1us, the last one everything
+ * above 16ms */
+#define MANAGER_DISPATCH_HISTOGRAM_MAX 16
+
+/* Number of hashmaps the device unit indexes are spread over */
+#define MANAGER_DEVICE_SHARDS 64
+
 typedef struct Manager Manager;
 typedef enum WatchType WatchType;
 typedef struct Watch Watch;
+typedef struct GeneratorTime GeneratorTime;
 
 typedef enum ManagerExitCode {
         MANAGER_RUNNING,
@@ -62,7 +77,12 @@ enum WatchType {
         WATCH_DBUS_WATCH,
         WATCH_DBUS_TIMEOUT,
         WATCH_TIME_CHANGE,
-        WATCH_JOBS_IN_PROGRESS
+        WATCH_JOBS_IN_PROGRESS,
+        WATCH_TIMER_QUEUE,
+        WATCH_UNIT_PATH_CACHE,
+        WATCH_CGROUPS_AGENT,
+        _WATCH_TYPE_MAX,
+        _WATCH_TYPE_INVALID = -1
 };
 
 struct Watch {
@@ -74,10 +94,28 @@ struct Watch {
                 DBusWatch *bus_watch;
                 DBusTimeout *bus_timeout;
         } data;
+
+        /* For unit and job timers, which have no fd of their own */
+        TimerQueueEntry timer;
+
         bool fd_is_dupped:1;
         bool socket_accept:1;
 };
 
+typedef enum GeneratorResult {
+        GENERATOR_SUCCESS,
+        GENERATOR_FAILURE,
+        GENERATOR_TIMEOUT,
+        _GENERATOR_RESULT_MAX,
+        _GENERATOR_RESULT_INVALID = -1
+} GeneratorResult;
+
+struct GeneratorTime {
+        char *name;
+        usec_t usec;
+        GeneratorResult result;
+};
+
 #include "unit.h"
 #include "job.h"
 #include "hashmap.h"
@@ -100,8 +138,9 @@ struct Manager {
          * type we maintain a per type linked list */
         LIST_HEAD(Unit, units_by_type[_UNIT_TYPE_MAX]);
 
-        /* To optimize iteration of units that have requires_mounts_for set */
-        LIST_HEAD(Unit, has_requires_mounts_for);
+        /* Path prefix => PathIndexEntry, to find the units whose
+         * paths lie on a mount point and vice versa */
+        Hashmap *units_by_path_prefix;
 
         /* Units that need to be loaded */
         LIST_HEAD(Unit, load_queue); /* this is actually more a stack than a queue, but uh. */
@@ -123,20 +162,52 @@ struct Manager {
         LIST_HEAD(Unit, gc_queue);
 
         Hashmap *watch_pids;  /* pid => Unit object n:1 */
+        Hashmap *pid_units;   /* pid => Unit object n:1, see Unit::pids */
 
         char *notify_socket;
 
         Watch notify_watch;
+        Watch cgroups_agent_watch;
         Watch signal_watch;
         Watch time_change_watch;
         Watch jobs_in_progress_watch;
 
+        /* All unit and job timers, multiplexed onto one timerfd
+         * per clock */
+        TimerQueue *monotonic_timers, *realtime_timers;
+        Watch monotonic_timer_watch, realtime_timer_watch;
+        usec_t timer_accuracy_usec;
+
+        /* Skip the full reload if no loaded unit's configuration
+         * changed */
+        bool incremental_reload;
+
         int epoll_fd;
 
+        /* Increased whenever a watch is removed, which invalidates
+         * all epoll events fetched before that */
+        unsigned watch_generation;
+
+        /* Per event source dispatch statistics */
+        uint64_t n_dispatched[_WATCH_TYPE_MAX];
+        usec_t dispatch_usec[_WATCH_TYPE_MAX];
+        uint64_t dispatch_histogram[_WATCH_TYPE_MAX][MANAGER_DISPATCH_HISTOGRAM_MAX];
+
         unsigned n_snapshots;
 
         LookupPaths lookup_paths;
-        Set *unit_path_cache;
+
+        /* What the SysV directories looked like when the units were
+         * enumerated, see service_sysv_dirs_changed() */
+        uint64_t sysv_dirs_signature;
+
+        /* Which unit files exist, kept up to date with inotify */
+        PathCache *unit_path_cache;
+        Watch unit_path_cache_watch;
+
+        /* Unit files read so far, see load-cache.c */
+        Hashmap *load_cache;
+        unsigned load_cache_generation;
 
         char **environment;
         char **default_controllers;
@@ -155,15 +226,42 @@ struct Manager {
         char *generator_unit_path_early;
         char *generator_unit_path_late;
 
+        /* How long each generator took the last time they were
+         * run, and how long all of them took together */
+        GeneratorTime *generator_times;
+        unsigned n_generator_times;
+        usec_t generators_usec;
+
+        /* Set while serializing or deserializing our state */
+        Serializer *serializer;
+        Deserializer *deserializer;
+
         /* Data specific to the device subsystem */
         struct udev* udev;
         struct udev_monitor* udev_monitor;
         Watch udev_watch;
-        Hashmap *devices_by_sysfs;
+        /* Device units by sysfs path, and by every path (sysfs
+         * path, device node, symlink, alias) they were named
+         * after. Split up by hash of the path, so that the chains
+         * stay short with many thousands of devices. */
+        Hashmap *devices_by_sysfs[MANAGER_DEVICE_SHARDS];
+        Hashmap *devices_by_path[MANAGER_DEVICE_SHARDS];
+
+        /* udev events received and changes merged into a later one
+         * of the same device, plus the rate over the last full
+         * second, see device_events_per_sec() */
+        unsigned n_device_events;
+        unsigned n_device_events_coalesced;
+        usec_t device_events_rate_begin;
+        unsigned device_events_rate_count;
+        unsigned device_events_per_sec;
 
         /* Data specific to the mount subsystem */
         FILE *proc_self_mountinfo;
         Watch mount_watch;
+        MountTable *mount_table;
+        Watch mount_rescan_watch;
+        RateLimit mount_rescan_ratelimit;
 
         /* Data specific to the swap filesystem */
         FILE *proc_swaps;
@@ -186,6 +284,7 @@ struct Manager {
         int32_t name_data_slot;
         int32_t conn_data_slot;
         int32_t subscribed_data_slot;
+        int32_t subscribed_batched_data_slot;
 
         uint32_t current_job_id;
         uint32_t default_unit_job_id;
@@ -228,6 +327,16 @@ struct Manager {
         unsigned n_installed_jobs;
         unsigned n_failed_jobs;
 
+        /* Jobs enqueued without building a transaction for their
+         * dependencies, since these were all satisfied already */
+        unsigned n_fast_path_jobs;
+
+        /* D-Bus signals sent, unit changes merged into one that was
+         * still queued, and unit changes sent in UnitsChanged */
+        unsigned n_bus_signals;
+        unsigned n_bus_changes_coalesced;
+        unsigned n_bus_changes_batched;
+
         /* Jobs in progress watching */
         unsigned n_running_jobs;
         unsigned n_on_console;
@@ -249,6 +358,7 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds);
 
 Job *manager_get_job(Manager *m, uint32_t id);
 Unit *manager_get_unit(Manager *m, const char *name);
+Unit *manager_get_unit_by_child(Manager *m, pid_t pid);
 
 int manager_get_job_from_dbus_path(Manager *m, const char *s, Job **_j);
 
@@ -278,7 +388,7 @@ void manager_dispatch_bus_query_pid_done(Manager *m, const char *name, pid_t pid
 
 int manager_open_serialization(Manager *m, FILE **_f);
 
-int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root);
+int manager_serialize(Manager *m, FILE *f, FDSet *fds, SerializeFormat format, bool switching_root);
 int manager_deserialize(Manager *m, FILE *f, FDSet *fds);
 int manager_distribute_fds(Manager *m, FDSet *fds);
 
@@ -296,6 +406,7 @@ bool manager_unit_inactive_or_pending(Manager *m, const char *name);
 void manager_check_finished(Manager *m);
 
 void manager_run_generators(Manager *m);
+void manager_run_generators_from(Manager *m, const char *generator_path, unsigned n_workers, usec_t timeout_usec);
 void manager_undo_generators(Manager *m);
 
 void manager_recheck_journal(Manager *m);
@@ -304,3 +415,12 @@ void manager_set_show_status(Manager *m, bool b);
 void manager_status_printf(Manager *m, bool ephemeral, const char *status, const char *format, ...) _printf_attr_(4,5);
 
 void watch_init(Watch *w);
+
+int manager_watch_timer(Manager *m, Watch *w, clockid_t clock_id, usec_t usec);
+void manager_unwatch_timer(Manager *m, Watch *w);
+
+const char *watch_type_to_string(WatchType t) _const_;
+WatchType watch_type_from_string(const char *s) _pure_;
+
+const char *generator_result_to_string(GeneratorResult r) _const_;
+GeneratorResult generator_result_from_string(const char *s) _pure_;
@@ -42,6 +42,13 @@
 #include "bus-errors.h"
 #include "exit-status.h"
 #include "def.h"
+#include "ratelimit.h"
+
+/* Reread /proc/self/mountinfo right away at most this often, and
+ * batch up what happens beyond that */
+#define MOUNT_RESCAN_INTERVAL_USEC (1*USEC_PER_SEC)
+#define MOUNT_RESCAN_BURST 20
+#define MOUNT_RESCAN_DELAY_USEC (100*USEC_PER_MSEC)
 
 static const UnitActiveState state_translation_table[_MOUNT_STATE_MAX] = {
         [MOUNT_DEAD] = UNIT_INACTIVE,
@@ -154,92 +161,101 @@ _pure_ static MountParameters* get_mount_parameters(Mount *m) {
         return get_mount_parameters_fragment(m);
 }
 
-static int mount_add_mount_links(Mount *m) {
-        Unit *other;
+static int mount_add_one_mount_link(Mount *m, Mount *n) {
+        MountParameters *pm, *pn;
         int r;
-        MountParameters *pm;
 
         assert(m);
+        assert(n);
 
-        pm = get_mount_parameters_fragment(m);
-
-        /* Adds in links to other mount points that might lie below or
-         * above us in the hierarchy */
-
-        LIST_FOREACH(units_by_type, other, UNIT(m)->manager->units_by_type[UNIT_MOUNT]) {
-                Mount *n = MOUNT(other);
-                MountParameters *pn;
+        if (n == m)
+                return 0;
 
-                if (n == m)
-                        continue;
+        if (UNIT(n)->load_state != UNIT_LOADED)
+                return 0;
 
-                if (UNIT(n)->load_state != UNIT_LOADED)
-                        continue;
+        pm = get_mount_parameters_fragment(m);
+        pn = get_mount_parameters_fragment(n);
 
-                pn = get_mount_parameters_fragment(n);
+        if (path_startswith(m->where, n->where)) {
 
-                if (path_startswith(m->where, n->where)) {
+                if ((r = unit_add_dependency(UNIT(m), UNIT_AFTER, UNIT(n), true)) < 0)
+                        return r;
 
-                        if ((r = unit_add_dependency(UNIT(m), UNIT_AFTER, UNIT(n), true)) < 0)
+                if (pn)
+                        if ((r = unit_add_dependency(UNIT(m), UNIT_REQUIRES, UNIT(n), true)) < 0)
                                 return r;
 
-                        if (pn)
-                                if ((r = unit_add_dependency(UNIT(m), UNIT_REQUIRES, UNIT(n), true)) < 0)
-                                        return r;
+        } else if (path_startswith(n->where, m->where)) {
 
-                } else if (path_startswith(n->where, m->where)) {
+                if ((r = unit_add_dependency(UNIT(n), UNIT_AFTER, UNIT(m), true)) < 0)
+                        return r;
 
-                        if ((r = unit_add_dependency(UNIT(n), UNIT_AFTER, UNIT(m), true)) < 0)
+                if (pm)
+                        if ((r = unit_add_dependency(UNIT(n), UNIT_REQUIRES, UNIT(m), true)) < 0)
                                 return r;
 
-                        if (pm)
-                                if ((r = unit_add_dependency(UNIT(n), UNIT_REQUIRES, UNIT(m), true)) < 0)
-                                        return r;
-
-                } else if (pm && pm->what && path_startswith(pm->what, n->where)) {
+        } else if (pm && pm->what && path_startswith(pm->what, n->where)) {
 
-                        if ((r = unit_add_dependency(UNIT(m), UNIT_AFTER, UNIT(n), true)) < 0)
-                                return r;
+                if ((r = unit_add_dependency(UNIT(m), UNIT_AFTER, UNIT(n), true)) < 0)
+                        return r;
 
-                        if ((r = unit_add_dependency(UNIT(m), UNIT_REQUIRES, UNIT(n), true)) < 0)
-                                return r;
+                if ((r = unit_add_dependency(UNIT(m), UNIT_REQUIRES, UNIT(n), true)) < 0)
+                        return r;
 
-                } else if (pn && pn->what && path_startswith(pn->what, m->where)) {
+        } else if (pn && pn->what && path_startswith(pn->what, m->where)) {
 
-                        if ((r = unit_add_dependency(UNIT(n), UNIT_AFTER, UNIT(m), true)) < 0)
-                                return r;
+                if ((r = unit_add_dependency(UNIT(n), UNIT_AFTER, UNIT(m), true)) < 0)
+                        return r;
 
-                        if ((r = unit_add_dependency(UNIT(n), UNIT_REQUIRES, UNIT(m), true)) < 0)
-                                return r;
-                }
+                if ((r = unit_add_dependency(UNIT(n), UNIT_REQUIRES, UNIT(m), true)) < 0)
+                        return r;
         }
 
         return 0;
 }
 
-static int mount_add_swap_links(Mount *m) {
+static int mount_add_mount_links(Mount *m) {
+        _cleanup_free_ Mount **mounts = NULL;
+        MountParameters *pm;
         Unit *other;
-        int r;
+        Iterator i;
+        int n, k, r;
 
         assert(m);
 
-        LIST_FOREACH(units_by_type, other, UNIT(m)->manager->units_by_type[UNIT_SWAP]) {
-                r = swap_add_one_mount_link(SWAP(other), m);
+        pm = get_mount_parameters_fragment(m);
+
+        /* Adds in links to other mount points that might lie below or
+         * above us in the hierarchy. The ones above are found via the
+         * prefixes of our own paths, the ones below are those that
+         * put a path below our mount point into the index. */
+
+        r = unit_add_indexed_path(UNIT(m), m->where, true);
+        if (r < 0)
+                return r;
+
+        if (pm && pm->what && path_is_absolute(pm->what)) {
+                r = unit_add_indexed_path(UNIT(m), pm->what, false);
                 if (r < 0)
                         return r;
         }
 
-        return 0;
-}
+        n = unit_get_mounts_for_paths(UNIT(m), &mounts);
+        if (n < 0)
+                return n;
 
-static int mount_add_path_links(Mount *m) {
-        Unit *other;
-        int r;
+        for (k = 0; k < n; k++) {
+                r = mount_add_one_mount_link(m, mounts[k]);
+                if (r < 0)
+                        return r;
+        }
 
-        assert(m);
+        DEPENDENCY_LIST_FOREACH(other, path_index_get_units(UNIT(m)->manager->units_by_path_prefix, m->where), i) {
+                if (other->type != UNIT_MOUNT)
+                        continue;
 
-        LIST_FOREACH(units_by_type, other, UNIT(m)->manager->units_by_type[UNIT_PATH]) {
-                r = path_add_one_mount_link(PATH(other), m);
+                r = mount_add_one_mount_link(m, MOUNT(other));
                 if (r < 0)
                         return r;
         }
@@ -247,46 +263,48 @@ static int mount_add_path_links(Mount *m) {
         return 0;
 }
 
-static int mount_add_automount_links(Mount *m) {
+static int mount_add_links_below(Mount *m) {
         Unit *other;
+        Iterator i;
         int r;
 
         assert(m);
 
-        LIST_FOREACH(units_by_type, other, UNIT(m)->manager->units_by_type[UNIT_AUTOMOUNT]) {
-                r = automount_add_one_mount_link(AUTOMOUNT(other), m);
-                if (r < 0)
-                        return r;
-        }
+        /* Adds in links from all units that have a path below our
+         * mount point, each according to its type */
 
-        return 0;
-}
+        DEPENDENCY_LIST_FOREACH(other, path_index_get_units(UNIT(m)->manager->units_by_path_prefix, m->where), i) {
 
-static int mount_add_socket_links(Mount *m) {
-        Unit *other;
-        int r;
+                switch (other->type) {
 
-        assert(m);
+                case UNIT_SOCKET:
+                        r = socket_add_one_mount_link(SOCKET(other), m);
+                        break;
 
-        LIST_FOREACH(units_by_type, other, UNIT(m)->manager->units_by_type[UNIT_SOCKET]) {
-                r = socket_add_one_mount_link(SOCKET(other), m);
-                if (r < 0)
-                        return r;
-        }
+                case UNIT_SWAP:
+                        r = swap_add_one_mount_link(SWAP(other), m);
+                        break;
 
-        return 0;
-}
+                case UNIT_PATH:
+                        r = path_add_one_mount_link(PATH(other), m);
+                        break;
 
-static int mount_add_requires_mounts_links(Mount *m) {
-        Unit *other;
-        int r;
+                case UNIT_AUTOMOUNT:
+                        r = automount_add_one_mount_link(AUTOMOUNT(other), m);
+                        break;
 
-        assert(m);
+                default:
+                        r = 0;
+                }
 
-        LIST_FOREACH(has_requires_mounts_for, other, UNIT(m)->manager->has_requires_mounts_for) {
-                r = unit_add_one_mount_link(other, m);
                 if (r < 0)
                         return r;
+
+                if (other->requires_mounts_for) {
+                        r = unit_add_one_mount_link(other, m);
+                        if (r < 0)
+                                return r;
+                }
         }
 
         return 0;
@@ -527,7 +545,7 @@ static int mount_fix_timeouts(Mount *m) {
                 return r;
         }
 
-        SET_FOREACH(other, UNIT(m)->dependencies[UNIT_AFTER], i) {
+        UNIT_FOREACH_DEPENDENCY(other, UNIT(m), UNIT_AFTER, i) {
                 if (other->type != UNIT_DEVICE)
                         continue;
 
@@ -617,23 +635,7 @@ static int mount_add_extras(Mount *m) {
         if (r < 0)
                 return r;
 
-        r = mount_add_socket_links(m);
-        if (r < 0)
-                return r;
-
-        r = mount_add_swap_links(m);
-        if (r < 0)
-                return r;
-
-        r = mount_add_path_links(m);
-        if (r < 0)
-                return r;
-
-        r = mount_add_requires_mounts_links(m);
-        if (r < 0)
-                return r;
-
-        r = mount_add_automount_links(m);
+        r = mount_add_links_below(m);
         if (r < 0)
                 return r;
 
@@ -694,7 +696,7 @@ static int mount_notify_automount(Mount *m, int status) {
 
         assert(m);
 
-        SET_FOREACH(p, UNIT(m)->dependencies[UNIT_TRIGGERED_BY], i)
+        UNIT_FOREACH_DEPENDENCY(p, UNIT(m), UNIT_TRIGGERED_BY, i)
                 if (p->type == UNIT_AUTOMOUNT) {
                          r = automount_send_ready(AUTOMOUNT(p), status);
                          if (r < 0)
@@ -1614,87 +1616,47 @@ fail:
 }
 
 static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
-        int r = 0;
-        unsigned i;
-        char *device, *path, *options, *options2, *fstype, *d, *p, *o;
+        MountTableEntry **changed;
+        unsigned n, i;
+        int r;
 
         assert(m);
 
-        rewind(m->proc_self_mountinfo);
+        /* Only the entries that are new or changed since the last
+         * time are passed on */
+        r = mount_table_update(m->mount_table, m->proc_self_mountinfo);
+        if (r < 0)
+                return r;
 
-        for (i = 1;; i++) {
+        changed = mount_table_get_changed(m->mount_table, &n);
+        for (i = 0; i < n; i++) {
                 int k;
 
-                device = path = options = options2 = fstype = d = p = o = NULL;
-
-                if ((k = fscanf(m->proc_self_mountinfo,
-                                "%*s "       /* (1) mount id */
-                                "%*s "       /* (2) parent id */
-                                "%*s "       /* (3) major:minor */
-                                "%*s "       /* (4) root */
-                                "%ms "       /* (5) mount point */
-                                "%ms"        /* (6) mount options */
-                                "%*[^-]"     /* (7) optional fields */
-                                "- "         /* (8) separator */
-                                "%ms "       /* (9) file system type */
-                                "%ms"        /* (10) mount source */
-                                "%ms"        /* (11) mount options 2 */
-                                "%*[^\n]",   /* some rubbish at the end */
-                                &path,
-                                &options,
-                                &fstype,
-                                &device,
-                                &options2)) != 5) {
-
-                        if (k == EOF)
-                                break;
-
-                        log_warning("Failed to parse /proc/self/mountinfo:%u.", i);
-                        goto clean_up;
-                }
-
-                o = strjoin(options, ",", options2, NULL);
-                if (!o) {
-                        r = -ENOMEM;
-                        goto finish;
-                }
-
-                if (!(d = cunescape(device)) ||
-                    !(p = cunescape(path))) {
-                        r = -ENOMEM;
-                        goto finish;
-                }
-
-                if ((k = mount_add_one(m, d, p, o, fstype, 0, set_flags)) < 0)
+                k = mount_add_one(m,
+                                  changed[i]->what,
+                                  changed[i]->where,
+                                  changed[i]->options,
+                                  changed[i]->fstype,
+                                  0,
+                                  set_flags);
+                if (k < 0)
                         r = k;
-
-clean_up:
-                free(device);
-                free(path);
-                free(options);
-                free(options2);
-                free(fstype);
-                free(d);
-                free(p);
-                free(o);
         }
 
-finish:
-        free(device);
-        free(path);
-        free(options);
-        free(options2);
-        free(fstype);
-        free(d);
-        free(p);
-        free(o);
-
         return r;
 }
 
 static void mount_shutdown(Manager *m) {
         assert(m);
 
+        if (m->mount_rescan_watch.type == WATCH_MOUNT) {
+                manager_unwatch_timer(m, &m->mount_rescan_watch);
+                watch_init(&m->mount_rescan_watch);
+        }
+
+        mount_table_free(m->mount_table);
+        m->mount_table = NULL;
+
         if (m->proc_self_mountinfo) {
                 fclose(m->proc_self_mountinfo);
                 m->proc_self_mountinfo = NULL;
@@ -1720,6 +1682,17 @@ static int mount_enumerate(Manager *m) {
 
                 if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, m->mount_watch.fd, &ev) < 0)
                         return -errno;
+
+                RATELIMIT_INIT(m->mount_rescan_ratelimit, MOUNT_RESCAN_INTERVAL_USEC, MOUNT_RESCAN_BURST);
+        }
+
+        /* All entries need to be applied, we might be reloading */
+        if (m->mount_table)
+                mount_table_clear(m->mount_table);
+        else {
+                r = mount_table_new(&m->mount_table);
+                if (r < 0)
+                        goto fail;
         }
 
         r = mount_load_proc_self_mountinfo(m, false);
@@ -1733,82 +1706,182 @@ fail:
         return r;
 }
 
-void mount_fd_event(Manager *m, int events) {
+static void mount_process_proc_self_mountinfo(Mount *mount) {
+        assert(mount);
+
+        if (!mount->is_mounted) {
+                /* This has just been unmounted. */
+
+                mount->from_proc_self_mountinfo = false;
+
+                switch (mount->state) {
+
+                case MOUNT_MOUNTED:
+                        mount_enter_dead(mount, MOUNT_SUCCESS);
+                        break;
+
+                default:
+                        mount_set_state(mount, mount->state);
+                        break;
+
+                }
+
+        } else if (mount->just_mounted || mount->just_changed) {
+
+                /* New or changed mount entry */
+
+                switch (mount->state) {
+
+                case MOUNT_DEAD:
+                case MOUNT_FAILED:
+                        mount_enter_mounted(mount, MOUNT_SUCCESS);
+                        break;
+
+                case MOUNT_MOUNTING:
+                        mount_enter_mounting_done(mount);
+                        break;
+
+                default:
+                        /* Nothing really changed, but let's
+                         * issue an notification call
+                         * nonetheless, in case somebody is
+                         * waiting for this. (e.g. file system
+                         * ro/rw remounts.) */
+                        mount_set_state(mount, mount->state);
+                        break;
+                }
+        }
+
+        /* Reset the flags for later calls */
+        mount->is_mounted = mount->just_mounted = mount->just_changed = false;
+}
+
+static int mount_add_touched(Manager *m, Set *touched, const char *where) {
+        _cleanup_free_ char *e = NULL;
         Unit *u;
         int r;
 
         assert(m);
-        assert(events & EPOLLPRI);
+        assert(touched);
+        assert(where);
 
-        /* The manager calls this for every fd event happening on the
-         * /proc/self/mountinfo file, which informs us about mounting
-         * table changes */
+        e = unit_name_from_path(where, ".mount");
+        if (!e)
+                return -ENOMEM;
+
+        u = manager_get_unit(m, e);
+        if (!u)
+                return 0;
+
+        r = set_put(touched, u);
+        if (r < 0 && r != -EEXIST)
+                return r;
+
+        return 0;
+}
+
+static void mount_rescan(Manager *m) {
+        _cleanup_set_free_ Set *touched = NULL;
+        MountTableEntry **changed;
+        unsigned n, i;
+        char **w;
+        bool full;
+        Unit *u;
+        Iterator j;
+        int r;
+
+        assert(m);
+
+        /* Without a previous copy of the table to compare with, all
+         * mount units have to be looked at */
+        full = mount_table_size(m->mount_table) <= 0;
 
         r = mount_load_proc_self_mountinfo(m, true);
         if (r < 0) {
                 log_error("Failed to reread /proc/self/mountinfo: %s", strerror(-r));
+                goto fail;
+        }
 
-                /* Reset flags, just in case, for later calls */
-                LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT]) {
-                        Mount *mount = MOUNT(u);
+        manager_dispatch_load_queue(m);
 
-                        mount->is_mounted = mount->just_mounted = mount->just_changed = false;
-                }
+        if (full) {
+                LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT])
+                        mount_process_proc_self_mountinfo(MOUNT(u));
 
                 return;
         }
 
-        manager_dispatch_load_queue(m);
-
-        LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT]) {
-                Mount *mount = MOUNT(u);
+        touched = set_new(trivial_hash_func, trivial_compare_func);
+        if (!touched) {
+                r = -ENOMEM;
+                goto fail;
+        }
 
-                if (!mount->is_mounted) {
-                        /* This has just been unmounted. */
+        changed = mount_table_get_changed(m->mount_table, &n);
+        for (i = 0; i < n; i++) {
+                r = mount_add_touched(m, touched, changed[i]->where);
+                if (r < 0)
+                        goto fail;
+        }
 
-                        mount->from_proc_self_mountinfo = false;
+        STRV_FOREACH(w, mount_table_get_removed(m->mount_table)) {
+                r = mount_add_touched(m, touched, *w);
+                if (r < 0)
+                        goto fail;
+        }
 
-                        switch (mount->state) {
+        SET_FOREACH(u, touched, j)
+                mount_process_proc_self_mountinfo(MOUNT(u));
 
-                        case MOUNT_MOUNTED:
-                                mount_enter_dead(mount, MOUNT_SUCCESS);
-                                break;
+        return;
 
-                        default:
-                                mount_set_state(mount, mount->state);
-                                break;
+fail:
+        /* Reset flags, just in case, for later calls, and compare
+         * against nothing next time */
+        LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT]) {
+                Mount *mount = MOUNT(u);
 
-                        }
+                mount->is_mounted = mount->just_mounted = mount->just_changed = false;
+        }
 
-                } else if (mount->just_mounted || mount->just_changed) {
+        mount_table_clear(m->mount_table);
+}
 
-                        /* New or changed mount entry */
+void mount_fd_event(Manager *m, int events) {
+        int r;
 
-                        switch (mount->state) {
+        assert(m);
+        assert(events & EPOLLPRI);
 
-                        case MOUNT_DEAD:
-                        case MOUNT_FAILED:
-                                mount_enter_mounted(mount, MOUNT_SUCCESS);
-                                break;
+        /* The manager calls this for every fd event happening on the
+         * /proc/self/mountinfo file, which informs us about mounting
+         * table changes */
 
-                        case MOUNT_MOUNTING:
-                                mount_enter_mounting_done(mount);
-                                break;
+        if (m->mount_rescan_watch.type == WATCH_MOUNT)
+                return;
 
-                        default:
-                                /* Nothing really changed, but let's
-                                 * issue an notification call
-                                 * nonetheless, in case somebody is
-                                 * waiting for this. (e.g. file system
-                                 * ro/rw remounts.) */
-                                mount_set_state(mount, mount->state);
-                                break;
-                        }
+        /* If mounts come and go in quick succession, collect them
+         * for a while and look at them all at once */
+        if (!ratelimit_test(&m->mount_rescan_ratelimit)) {
+                r = manager_watch_timer(m, &m->mount_rescan_watch, CLOCK_MONOTONIC,
+                                        now(CLOCK_MONOTONIC) + MOUNT_RESCAN_DELAY_USEC);
+                if (r >= 0) {
+                        m->mount_rescan_watch.type = WATCH_MOUNT;
+                        return;
                 }
 
-                /* Reset the flags for later calls */
-                mount->is_mounted = mount->just_mounted = mount->just_changed = false;
+                log_warning("Failed to delay rereading /proc/self/mountinfo: %s", strerror(-r));
         }
+
+        mount_rescan(m);
+}
+
+void mount_rescan_timer_event(Manager *m) {
+        assert(m);
+        assert(m->mount_rescan_watch.type == WATCH_MOUNT);
+
+        watch_init(&m->mount_rescan_watch);
+        mount_rescan(m);
 }
 
 static void mount_reset_failed(Unit *u) {
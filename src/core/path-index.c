@@ -0,0 +1,158 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "path-index.h"
+#include "path-util.h"
+#include "util.h"
+
+static void path_index_entry_free(PathIndexEntry *e) {
+        if (!e)
+                return;
+
+        dependency_list_free(e->units);
+        free(e->path);
+        free(e);
+}
+
+void path_index_free(Hashmap *index) {
+        PathIndexEntry *e;
+
+        while ((e = hashmap_steal_first(index)))
+                path_index_entry_free(e);
+
+        hashmap_free(index);
+}
+
+static PathIndexEntry *path_index_entry_get(Hashmap **index, const char *prefix) {
+        PathIndexEntry *e;
+
+        e = hashmap_get(*index, prefix);
+        if (e)
+                return e;
+
+        e = new0(PathIndexEntry, 1);
+        if (!e)
+                return NULL;
+
+        e->path = strdup(prefix);
+        if (!e->path) {
+                free(e);
+                return NULL;
+        }
+
+        if (hashmap_put(*index, e->path, e) < 0) {
+                path_index_entry_free(e);
+                return NULL;
+        }
+
+        return e;
+}
+
+int path_index_add(Hashmap **index, const char *path, struct Unit *u, bool owner) {
+        PathIndexEntry *e;
+        char *p;
+        int r;
+
+        assert(index);
+        assert(path);
+        assert(u);
+
+        r = hashmap_ensure_allocated(index, string_hash_func, string_compare_func);
+        if (r < 0)
+                return r;
+
+        p = strdupa(path);
+        path_kill_slashes(p);
+
+        e = path_index_entry_get(index, p);
+        if (!e)
+                return -ENOMEM;
+
+        if (owner)
+                e->owner = u;
+
+        /* Once the unit is found in an entry it has been added to all
+         * entries further up too */
+        do {
+                e = path_index_entry_get(index, p);
+                if (!e)
+                        return -ENOMEM;
+
+                r = dependency_list_put(&e->units, u);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+        } while (path_strip_last_component(p));
+
+        return 0;
+}
+
+void path_index_remove(Hashmap *index, const char *path, struct Unit *u) {
+        PathIndexEntry *e;
+        char *p;
+
+        assert(path);
+        assert(u);
+
+        p = strdupa(path);
+        path_kill_slashes(p);
+
+        do {
+                e = hashmap_get(index, p);
+                if (!e)
+                        continue;
+
+                if (e->owner == u)
+                        e->owner = NULL;
+
+                dependency_list_remove(e->units, u);
+
+                if (dependency_list_isempty(e->units)) {
+                        assert(!e->owner);
+
+                        hashmap_remove(index, e->path);
+                        path_index_entry_free(e);
+                }
+        } while (path_strip_last_component(p));
+}
+
+struct Unit *path_index_get_owner(Hashmap *index, const char *path) {
+        PathIndexEntry *e;
+
+        assert(path);
+
+        e = hashmap_get(index, path);
+        return e ? e->owner : NULL;
+}
+
+DependencyList *path_index_get_units(Hashmap *index, const char *path) {
+        PathIndexEntry *e;
+
+        assert(path);
+
+        e = hashmap_get(index, path);
+        return e ? e->units : NULL;
+}
@@ -0,0 +1,52 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdbool.h>
+
+#include "hashmap.h"
+#include "dependency-list.h"
+
+/* Maps every prefix of the paths units have registered to the units
+ * below it, so that the mount units a path lies on and the units with
+ * paths on a mount point can be found without looking at all units of
+ * a type. A path prefix is a hashmap key here, so a lookup is
+ * proportional to the depth of a path, not to the number of units. */
+
+typedef struct PathIndexEntry {
+        char *path;
+
+        /* The unit that owns exactly this path, i.e. the mount unit
+         * mounted here */
+        struct Unit *owner;
+
+        /* All units that registered this path or a path below it */
+        DependencyList *units;
+} PathIndexEntry;
+
+void path_index_free(Hashmap *index);
+
+int path_index_add(Hashmap **index, const char *path, struct Unit *u, bool owner);
+void path_index_remove(Hashmap *index, const char *path, struct Unit *u);
+
+struct Unit *path_index_get_owner(Hashmap *index, const char *path);
+DependencyList *path_index_get_units(Hashmap *index, const char *path);
@@ -326,13 +326,24 @@ int path_add_one_mount_link(Path *p, Mount *m) {
 }
 
 static int path_add_mount_links(Path *p) {
-        Unit *other;
-        int r;
+        _cleanup_free_ Mount **mounts = NULL;
+        PathSpec *s;
+        int n, k, r;
 
         assert(p);
 
-        LIST_FOREACH(units_by_type, other, UNIT(p)->manager->units_by_type[UNIT_MOUNT]) {
-                r = path_add_one_mount_link(p, MOUNT(other));
+        LIST_FOREACH(spec, s, p->specs) {
+                r = unit_add_indexed_path(UNIT(p), s->path, false);
+                if (r < 0)
+                        return r;
+        }
+
+        n = unit_get_mounts_for_paths(UNIT(p), &mounts);
+        if (n < 0)
+                return n;
+
+        for (k = 0; k < n; k++) {
+                r = path_add_one_mount_link(p, mounts[k]);
                 if (r < 0)
                         return r;
         }
@@ -389,7 +400,7 @@ static int path_load(Unit *u) {
 
         if (u->load_state == UNIT_LOADED) {
 
-                if (set_isempty(u->dependencies[UNIT_TRIGGERS])) {
+                if (dependency_list_isempty(u->dependencies[UNIT_TRIGGERS])) {
                         Unit *x;
 
                         r = unit_load_related_unit(u, ".service", &x);
@@ -0,0 +1,495 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "serialize.h"
+#include "hashmap.h"
+#include "util.h"
+#include "log.h"
+
+/* Nothing we serialize comes even close to this, hence anything
+ * longer must be a corrupted file */
+#define STRING_MAX (16U*1024U*1024U)
+
+enum {
+        TAG_KEY = 'K',          /* key string, gets the next index */
+        TAG_ITEM = 'I',         /* key index, value string */
+        TAG_ITEM_INLINE = 'i',  /* key string, value string */
+        TAG_MARKER = 'M',       /* name string */
+        TAG_END = 'E'
+};
+
+struct Serializer {
+        SerializeFormat format;
+
+        /* key => index + 1 */
+        Hashmap *keys;
+        unsigned n_keys;
+};
+
+struct Deserializer {
+        SerializeFormat format;
+
+        char **keys;
+        unsigned n_keys;
+        size_t n_keys_allocated;
+
+        char *buf;
+        size_t allocated;
+
+        char line[LINE_MAX];
+};
+
+int serializer_new(Serializer **ret, FILE *f, SerializeFormat format) {
+        Serializer *s;
+
+        assert(ret);
+        assert(f);
+        assert(format >= 0);
+        assert(format < _SERIALIZE_FORMAT_MAX);
+
+        s = new0(Serializer, 1);
+        if (!s)
+                return -ENOMEM;
+
+        s->format = format;
+
+        if (format == SERIALIZE_BINARY) {
+                s->keys = hashmap_new(string_hash_func, string_compare_func);
+                if (!s->keys) {
+                        free(s);
+                        return -ENOMEM;
+                }
+
+                fwrite(SERIALIZE_MAGIC, 1, sizeof(SERIALIZE_MAGIC) - 1, f);
+                fputc(SERIALIZE_VERSION, f);
+        }
+
+        *ret = s;
+        return 0;
+}
+
+void serializer_free(Serializer *s) {
+        char *k;
+
+        if (!s)
+                return;
+
+        if (s->keys) {
+                while ((k = hashmap_steal_first_key(s->keys)))
+                        free(k);
+
+                hashmap_free(s->keys);
+        }
+
+        free(s);
+}
+
+static void write_varint(FILE *f, uint64_t v) {
+        while (v >= 0x80) {
+                fputc_unlocked((int) ((v & 0x7F) | 0x80), f);
+                v >>= 7;
+        }
+
+        fputc_unlocked((int) v, f);
+}
+
+static void write_string(FILE *f, const char *p, size_t l) {
+        write_varint(f, l);
+        fwrite_unlocked(p, 1, l, f);
+}
+
+static void serialize_item_binary(Serializer *s, FILE *f, const char *key, const char *value, size_t l) {
+        unsigned idx;
+
+        idx = PTR_TO_UINT(hashmap_get(s->keys, key));
+        if (idx == 0) {
+                char *k;
+
+                k = strdup(key);
+                if (!k || hashmap_put(s->keys, k, UINT_TO_PTR(s->n_keys + 1)) < 0) {
+                        free(k);
+
+                        /* We can still send the key along */
+                        fputc_unlocked(TAG_ITEM_INLINE, f);
+                        write_string(f, key, strlen(key));
+                        write_string(f, value, l);
+                        return;
+                }
+
+                fputc_unlocked(TAG_KEY, f);
+                write_string(f, key, strlen(key));
+
+                idx = ++s->n_keys;
+        }
+
+        fputc_unlocked(TAG_ITEM, f);
+        write_varint(f, idx - 1);
+        write_string(f, value, l);
+}
+
+void serialize_item(Serializer *s, FILE *f, const char *key, const char *value) {
+        assert(f);
+        assert(key);
+        assert(value);
+
+        if (!s || s->format == SERIALIZE_TEXT) {
+                fprintf(f, "%s=%s\n", key, value);
+                return;
+        }
+
+        serialize_item_binary(s, f, key, value, strlen(value));
+}
+
+void serialize_item_formatv(Serializer *s, FILE *f, const char *key, const char *format, va_list ap) {
+        char buf[LINE_MAX];
+        va_list aq;
+        int l;
+
+        assert(f);
+        assert(key);
+        assert(format);
+
+        if (!s || s->format == SERIALIZE_TEXT) {
+                fputs(key, f);
+                fputc('=', f);
+                vfprintf(f, format, ap);
+                fputc('\n', f);
+                return;
+        }
+
+        va_copy(aq, ap);
+        l = vsnprintf(buf, sizeof(buf), format, aq);
+        va_end(aq);
+
+        if (l < 0)
+                return;
+
+        if ((size_t) l < sizeof(buf))
+                serialize_item_binary(s, f, key, buf, l);
+        else {
+                _cleanup_free_ char *p = NULL;
+
+                l = vasprintf(&p, format, ap);
+                if (l < 0) {
+                        log_oom();
+                        return;
+                }
+
+                serialize_item_binary(s, f, key, p, l);
+        }
+}
+
+void serialize_item_format(Serializer *s, FILE *f, const char *key, const char *format, ...) {
+        va_list ap;
+
+        va_start(ap, format);
+        serialize_item_formatv(s, f, key, format, ap);
+        va_end(ap);
+}
+
+/* Writes the number backwards, ending right before p, and returns
+ * where it starts */
+static char *format_ull(char *p, unsigned long long u) {
+        do {
+                *(--p) = '0' + (u % 10);
+                u /= 10;
+        } while (u > 0);
+
+        return p;
+}
+
+void serialize_dual_timestamp(Serializer *s, FILE *f, const char *key, dual_timestamp *t) {
+        char buf[DECIMAL_STR_MAX(unsigned long long) * 2 + 1], *p;
+
+        assert(f);
+        assert(key);
+        assert(t);
+
+        if (!dual_timestamp_is_set(t))
+                return;
+
+        if (!s || s->format == SERIALIZE_TEXT) {
+                serialize_item_format(s, f, key, "%llu %llu",
+                                      (unsigned long long) t->realtime,
+                                      (unsigned long long) t->monotonic);
+                return;
+        }
+
+        /* This is the bulk of what we serialize, hence avoid going
+         * through printf() */
+        p = format_ull(buf + sizeof(buf), t->monotonic);
+        *(--p) = ' ';
+        p = format_ull(p, t->realtime);
+
+        serialize_item_binary(s, f, key, p, buf + sizeof(buf) - p);
+}
+
+void serialize_marker(Serializer *s, FILE *f, const char *name) {
+        assert(f);
+        assert(name);
+
+        if (!s || s->format == SERIALIZE_TEXT) {
+                fputs(name, f);
+                fputc('\n', f);
+                return;
+        }
+
+        fputc_unlocked(TAG_MARKER, f);
+        write_string(f, name, strlen(name));
+}
+
+void serialize_end(Serializer *s, FILE *f) {
+        assert(f);
+
+        fputc(!s || s->format == SERIALIZE_TEXT ? '\n' : TAG_END, f);
+}
+
+int deserializer_new(Deserializer **ret, FILE *f) {
+        Deserializer *d;
+        SerializeFormat format = SERIALIZE_TEXT;
+        int c;
+
+        assert(ret);
+        assert(f);
+
+        /* No text serialization starts with a NUL byte */
+        c = getc(f);
+        if (c == 0) {
+                char magic[sizeof(SERIALIZE_MAGIC) - 2];
+
+                if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+                    memcmp(magic, SERIALIZE_MAGIC + 1, sizeof(magic)) != 0) {
+                        log_error("Serialization has an invalid header.");
+                        return -EBADMSG;
+                }
+
+                c = getc(f);
+                if (c == EOF || c > SERIALIZE_VERSION) {
+                        log_error("Serialization is of unsupported version %i.", c);
+                        return -EPROTONOSUPPORT;
+                }
+
+                format = SERIALIZE_BINARY;
+        } else if (c != EOF)
+                ungetc(c, f);
+
+        d = new0(Deserializer, 1);
+        if (!d)
+                return -ENOMEM;
+
+        d->format = format;
+
+        *ret = d;
+        return 0;
+}
+
+void deserializer_free(Deserializer *d) {
+        unsigned i;
+
+        if (!d)
+                return;
+
+        for (i = 0; i < d->n_keys; i++)
+                free(d->keys[i]);
+
+        free(d->keys);
+        free(d->buf);
+        free(d);
+}
+
+SerializeFormat deserializer_format(Deserializer *d) {
+        assert(d);
+
+        return d->format;
+}
+
+static int read_varint(FILE *f, uint64_t *ret) {
+        uint64_t v = 0;
+        unsigned shift;
+
+        for (shift = 0; shift < 64; shift += 7) {
+                int c;
+
+                c = getc_unlocked(f);
+                if (c == EOF)
+                        return ferror(f) ? -EIO : -EBADMSG;
+
+                v |= (uint64_t) (c & 0x7F) << shift;
+
+                if (!(c & 0x80)) {
+                        *ret = v;
+                        return 0;
+                }
+        }
+
+        return -EBADMSG;
+}
+
+/* Reads a string to the given offset into the buffer, and returns
+ * the offset behind its terminating NUL byte */
+static int read_string(Deserializer *d, FILE *f, size_t offset, size_t *end) {
+        uint64_t l;
+        int r;
+
+        r = read_varint(f, &l);
+        if (r < 0)
+                return r;
+
+        if (l > STRING_MAX)
+                return -EBADMSG;
+
+        if (!GREEDY_REALLOC(d->buf, d->allocated, offset + l + 1))
+                return -ENOMEM;
+
+        if (fread_unlocked(d->buf + offset, 1, l, f) != l)
+                return ferror(f) ? -EIO : -EBADMSG;
+
+        d->buf[offset + l] = 0;
+        *end = offset + l + 1;
+
+        return 0;
+}
+
+static int deserialize_next_text(Deserializer *d, FILE *f, char **key, char **value) {
+        char *l;
+        size_t k;
+
+        if (!fgets(d->line, sizeof(d->line), f)) {
+                if (feof(f))
+                        return 0;
+
+                return -errno;
+        }
+
+        char_array_0(d->line);
+        l = strstrip(d->line);
+
+        /* End marker */
+        if (l[0] == 0)
+                return 0;
+
+        k = strcspn(l, "=");
+
+        if (l[k] == '=') {
+                l[k] = 0;
+                *value = l+k+1;
+        } else
+                *value = l+k;
+
+        *key = l;
+        return 1;
+}
+
+int deserialize_next(Deserializer *d, FILE *f, char **key, char **value) {
+        assert(d);
+        assert(f);
+        assert(key);
+        assert(value);
+
+        if (d->format == SERIALIZE_TEXT)
+                return deserialize_next_text(d, f, key, value);
+
+        for (;;) {
+                size_t a, b;
+                uint64_t idx;
+                int c, r;
+
+                c = getc_unlocked(f);
+                switch (c) {
+
+                case EOF:
+                        return ferror(f) ? -EIO : 0;
+
+                case TAG_END:
+                        return 0;
+
+                case TAG_KEY:
+                        r = read_string(d, f, 0, &a);
+                        if (r < 0)
+                                return r;
+
+                        if (!GREEDY_REALLOC(d->keys, d->n_keys_allocated, d->n_keys + 1))
+                                return -ENOMEM;
+
+                        d->keys[d->n_keys] = strdup(d->buf);
+                        if (!d->keys[d->n_keys])
+                                return -ENOMEM;
+
+                        d->n_keys++;
+                        break;
+
+                case TAG_ITEM:
+                        r = read_varint(f, &idx);
+                        if (r < 0)
+                                return r;
+
+                        if (idx >= d->n_keys)
+                                return -EBADMSG;
+
+                        r = read_string(d, f, 0, &a);
+                        if (r < 0)
+                                return r;
+
+                        *key = d->keys[idx];
+                        *value = d->buf;
+                        return 1;
+
+                case TAG_ITEM_INLINE:
+                        r = read_string(d, f, 0, &a);
+                        if (r < 0)
+                                return r;
+
+                        r = read_string(d, f, a, &b);
+                        if (r < 0)
+                                return r;
+
+                        *key = d->buf;
+                        *value = d->buf + a;
+                        return 1;
+
+                case TAG_MARKER:
+                        r = read_string(d, f, 0, &a);
+                        if (r < 0)
+                                return r;
+
+                        /* Markers come with an empty value, like
+                         * in the text format */
+                        *key = d->buf;
+                        *value = d->buf + a - 1;
+                        return 1;
+
+                default:
+                        return -EBADMSG;
+                }
+        }
+}
+
+static const char* const serialize_format_table[_SERIALIZE_FORMAT_MAX] = {
+        [SERIALIZE_TEXT] = "text",
+        [SERIALIZE_BINARY] = "binary"
+};
+
+DEFINE_STRING_TABLE_LOOKUP(serialize_format, SerializeFormat);
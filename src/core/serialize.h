@@ -0,0 +1,83 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "macro.h"
+#include "time-util.h"
+
+/* The state we pass on to ourselves across daemon-reload, reexecution
+ * and switching root is a sequence of key/value items, separated into
+ * sections by end markers, with markers starting the sections of
+ * units and jobs.
+ *
+ * In the text format, every item is a "key=value" line, markers are
+ * lines of their own, and an empty line ends a section.
+ *
+ * The binary format starts with SERIALIZE_MAGIC and a version byte.
+ * Every record then starts with a tag byte, and strings are prefixed
+ * with their length as varint. Keys are sent only once, afterwards
+ * they are referred to by their index. This saves both the formatting
+ * and the parsing of lines, and the key comparisons when reading. */
+
+#define SERIALIZE_MAGIC "\0SDSER"
+#define SERIALIZE_VERSION 1
+
+typedef enum SerializeFormat {
+        SERIALIZE_TEXT,
+        SERIALIZE_BINARY,
+        _SERIALIZE_FORMAT_MAX,
+        _SERIALIZE_FORMAT_INVALID = -1
+} SerializeFormat;
+
+typedef struct Serializer Serializer;
+typedef struct Deserializer Deserializer;
+
+/* Writes the header, if there is one */
+int serializer_new(Serializer **ret, FILE *f, SerializeFormat format);
+void serializer_free(Serializer *s);
+
+/* All of these may be called with a NULL serializer, in which case
+ * the text format is written */
+void serialize_item(Serializer *s, FILE *f, const char *key, const char *value);
+void serialize_item_format(Serializer *s, FILE *f, const char *key, const char *format, ...) _printf_attr_(4,5);
+void serialize_item_formatv(Serializer *s, FILE *f, const char *key, const char *format, va_list ap) _printf_attr_(4,0);
+void serialize_dual_timestamp(Serializer *s, FILE *f, const char *key, dual_timestamp *t);
+void serialize_marker(Serializer *s, FILE *f, const char *name);
+void serialize_end(Serializer *s, FILE *f);
+
+/* Figures out the format from the header */
+int deserializer_new(Deserializer **ret, FILE *f);
+void deserializer_free(Deserializer *d);
+
+SerializeFormat deserializer_format(Deserializer *d) _pure_;
+
+/* Returns 1 and the key and value of the next item or marker (in
+ * which case the value is empty), 0 at the end of a section or the
+ * file, which can be told apart with feof(). The strings are valid
+ * until the next call. */
+int deserialize_next(Deserializer *d, FILE *f, char **key, char **value);
+
+const char *serialize_format_to_string(SerializeFormat f) _const_;
+SerializeFormat serialize_format_from_string(const char *s) _pure_;
@@ -1500,7 +1500,7 @@ static void service_notify_sockets_dead(Service *s, bool failed_permanent) {
         if (s->socket_fd >= 0)
                 return;
 
-        SET_FOREACH(u, UNIT(s)->dependencies[UNIT_TRIGGERED_BY], i)
+        UNIT_FOREACH_DEPENDENCY(u, UNIT(s), UNIT_TRIGGERED_BY, i)
                 if (u->type == UNIT_SOCKET)
                         socket_notify_service_dead(SOCKET(u), failed_permanent);
 
@@ -1692,7 +1692,7 @@ static int service_collect_fds(Service *s, int **fds, unsigned *n_fds) {
         if (s->socket_fd >= 0)
                 return 0;
 
-        SET_FOREACH(u, UNIT(s)->dependencies[UNIT_TRIGGERED_BY], i) {
+        UNIT_FOREACH_DEPENDENCY(u, UNIT(s), UNIT_TRIGGERED_BY, i) {
                 int *cfds;
                 unsigned cn_fds;
                 Socket *sock;
@@ -2635,10 +2635,10 @@ static int service_serialize(Unit *u, FILE *f, FDSet *fds) {
         if (s->main_exec_status.pid > 0) {
                 unit_serialize_item_format(u, f, "main-exec-status-pid", "%lu",
                                            (unsigned long) s->main_exec_status.pid);
-                dual_timestamp_serialize(f, "main-exec-status-start",
-                                         &s->main_exec_status.start_timestamp);
-                dual_timestamp_serialize(f, "main-exec-status-exit",
-                                         &s->main_exec_status.exit_timestamp);
+                unit_serialize_dual_timestamp(u, f, "main-exec-status-start",
+                                              &s->main_exec_status.start_timestamp);
+                unit_serialize_dual_timestamp(u, f, "main-exec-status-exit",
+                                              &s->main_exec_status.exit_timestamp);
 
                 if (dual_timestamp_is_set(&s->main_exec_status.exit_timestamp)) {
                         unit_serialize_item_format(u, f, "main-exec-status-code", "%i",
@@ -2648,8 +2648,8 @@ static int service_serialize(Unit *u, FILE *f, FDSet *fds) {
                 }
         }
         if (dual_timestamp_is_set(&s->watchdog_timestamp))
-                dual_timestamp_serialize(f, "watchdog-timestamp",
-                                         &s->watchdog_timestamp);
+                unit_serialize_dual_timestamp(u, f, "watchdog-timestamp",
+                                              &s->watchdog_timestamp);
 
         if (s->exec_context.tmp_dir)
                 unit_serialize_item(u, f, "tmp-dir", s->exec_context.tmp_dir);
@@ -3459,6 +3459,57 @@ static void service_notify_message(Unit *u, pid_t pid, char **tags) {
 
 #ifdef HAVE_SYSV_COMPAT
 
+static void sysv_hash(uint64_t *h, const void *p, size_t l) {
+        const uint8_t *b = p;
+        size_t i;
+
+        /* FNV-1a */
+        for (i = 0; i < l; i++) {
+                *h ^= b[i];
+                *h *= 1099511628211ULL;
+        }
+}
+
+static void sysv_hash_dir(uint64_t *h, const char *path) {
+        struct stat st;
+
+        sysv_hash(h, path, strlen(path) + 1);
+
+        if (stat(path, &st) < 0)
+                return;
+
+        /* Adding, removing or retargeting a link or script changes
+         * the modification time of the directory */
+        sysv_hash(h, &st.st_dev, sizeof(st.st_dev));
+        sysv_hash(h, &st.st_ino, sizeof(st.st_ino));
+        sysv_hash(h, &st.st_mtim, sizeof(st.st_mtim));
+}
+
+/* Summarizes the state of the init script and rcN.d directories, so
+ * that we can tell whether service_enumerate() would find anything
+ * new */
+static uint64_t sysv_dirs_signature(Manager *m) {
+        uint64_t h = 14695981039346656037ULL;
+        char **p;
+        unsigned i;
+
+        STRV_FOREACH(p, m->lookup_paths.sysvinit_path)
+                sysv_hash_dir(&h, *p);
+
+        STRV_FOREACH(p, m->lookup_paths.sysvrcnd_path)
+                for (i = 0; i < ELEMENTSOF(rcnd_table); i ++) {
+                        _cleanup_free_ char *path = NULL;
+
+                        path = strjoin(*p, "/", rcnd_table[i].path, NULL);
+                        if (!path)
+                                return 0;
+
+                        sysv_hash_dir(&h, path);
+                }
+
+        return h;
+}
+
 static int service_enumerate(Manager *m) {
         char **p;
         unsigned i;
@@ -3475,6 +3526,8 @@ static int service_enumerate(Manager *m) {
         if (m->running_as != SYSTEMD_SYSTEM)
                 return 0;
 
+        m->sysv_dirs_signature = sysv_dirs_signature(m);
+
         STRV_FOREACH(p, m->lookup_paths.sysvrcnd_path)
                 for (i = 0; i < ELEMENTSOF(rcnd_table); i ++) {
                         struct dirent *de;
@@ -3628,6 +3681,19 @@ finish:
 }
 #endif
 
+bool service_sysv_dirs_changed(Manager *m) {
+        assert(m);
+
+#ifdef HAVE_SYSV_COMPAT
+        if (m->running_as != SYSTEMD_SYSTEM)
+                return false;
+
+        return sysv_dirs_signature(m) != m->sysv_dirs_signature;
+#else
+        return false;
+#endif
+}
+
 static void service_bus_name_owner_change(
                 Unit *u,
                 const char *name,
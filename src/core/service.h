@@ -203,6 +203,10 @@ struct Socket;
 
 int service_set_socket_fd(Service *s, int fd, struct Socket *socket);
 
+/* Whether SysV init scripts or rcN.d links were added or removed
+ * since the units were enumerated */
+bool service_sysv_dirs_changed(Manager *m);
+
 const char* service_state_to_string(ServiceState i) _const_;
 ServiceState service_state_from_string(const char *s) _pure_;
 
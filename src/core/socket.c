@@ -51,6 +51,9 @@
 #include "exit-status.h"
 #include "def.h"
 
+/* How many connections to accept at most per wakeup */
+#define SOCKET_ACCEPT_BATCH_MAX 64
+
 static const UnitActiveState state_translation_table[_SOCKET_STATE_MAX] = {
         [SOCKET_DEAD] = UNIT_INACTIVE,
         [SOCKET_START_PRE] = UNIT_ACTIVATING,
@@ -135,6 +138,9 @@ static void socket_done(Unit *u) {
 
         unit_ref_unset(&s->service);
 
+        free(s->template_path);
+        s->template_path = NULL;
+
         free(s->tcp_congestion);
         s->tcp_congestion = NULL;
 
@@ -148,8 +154,44 @@ static void socket_done(Unit *u) {
         unit_unwatch_timer(u, &s->timer_watch);
 }
 
+static void socket_remember_template(Socket *s, Unit *u) {
+        _cleanup_free_ char *template = NULL;
+        PathCache *c;
+
+        assert(s);
+        assert(u);
+
+        c = UNIT(s)->manager->unit_path_cache;
+        if (!c || !u->fragment_path)
+                return;
+
+        template = unit_name_template(u->id);
+        if (!template)
+                return;
+
+        /* Only if the instance was loaded from the template, an
+         * instance specific unit file must not be reused */
+        if (!streq(path_get_file_name(u->fragment_path), template))
+                return;
+
+        if (!s->template_path || !streq(s->template_path, u->fragment_path)) {
+                char *p;
+
+                p = strdup(u->fragment_path);
+                if (!p)
+                        return;
+
+                free(s->template_path);
+                s->template_path = p;
+        }
+
+        s->template_path_generation = path_cache_generation(c);
+}
+
 static int socket_instantiate_service(Socket *s) {
         char *prefix, *name;
+        const char *path = NULL;
+        PathCache *c;
         int r;
         Unit *u;
 
@@ -174,12 +216,25 @@ static int socket_instantiate_service(Socket *s) {
         if (r < 0)
                 return -ENOMEM;
 
-        r = manager_load_unit(UNIT(s)->manager, name, NULL, NULL, &u);
+        /* Unless any unit file came or went meanwhile, we still
+         * know where the template is. Pick up what inotify has
+         * queued for us first, as the connection might well have
+         * come in after an override of the template was put in
+         * place. */
+        c = UNIT(s)->manager->unit_path_cache;
+        if (s->template_path && c &&
+            path_cache_flush(c) >= 0 &&
+            path_cache_generation(c) == s->template_path_generation)
+                path = s->template_path;
+
+        r = manager_load_unit(UNIT(s)->manager, name, path, NULL, &u);
         free(name);
 
         if (r < 0)
                 return r;
 
+        socket_remember_template(s, u);
+
 #ifdef HAVE_SYSV_COMPAT
         if (SERVICE(u)->is_sysv) {
                 log_error("Using SysV services for socket activation is not supported. Refusing.");
@@ -295,13 +350,36 @@ int socket_add_one_mount_link(Socket *s, Mount *m) {
 }
 
 static int socket_add_mount_links(Socket *s) {
-        Unit *other;
-        int r;
+        _cleanup_free_ Mount **mounts = NULL;
+        SocketPort *p;
+        int n, k, r;
 
         assert(s);
 
-        LIST_FOREACH(units_by_type, other, UNIT(s)->manager->units_by_type[UNIT_MOUNT]) {
-                r = socket_add_one_mount_link(s, MOUNT(other));
+        LIST_FOREACH(port, p, s->ports) {
+                const char *path = NULL;
+
+                if (p->type == SOCKET_SOCKET) {
+                        if (socket_address_family(&p->address) == AF_UNIX &&
+                            p->address.sockaddr.un.sun_path[0] != 0)
+                                path = p->address.sockaddr.un.sun_path;
+                } else if (p->type == SOCKET_FIFO || p->type == SOCKET_SPECIAL)
+                        path = p->path;
+
+                if (!path)
+                        continue;
+
+                r = unit_add_indexed_path(UNIT(s), path, false);
+                if (r < 0)
+                        return r;
+        }
+
+        n = unit_get_mounts_for_paths(UNIT(s), &mounts);
+        if (n < 0)
+                return n;
+
+        for (k = 0; k < n; k++) {
+                r = socket_add_one_mount_link(s, mounts[k]);
                 if (r < 0)
                         return r;
         }
@@ -1477,7 +1555,7 @@ static void socket_enter_running(Socket *s, int cfd) {
 
                 /* If there's already a start pending don't bother to
                  * do anything */
-                SET_FOREACH(u, UNIT(s)->dependencies[UNIT_TRIGGERS], i)
+                UNIT_FOREACH_DEPENDENCY(u, UNIT(s), UNIT_TRIGGERS, i)
                         if (unit_active_or_pending(u)) {
                                 pending = true;
                                 break;
@@ -2026,7 +2104,13 @@ static void socket_fd_event(Unit *u, int fd, uint32_t events, Watch *w) {
         }
 
         if (w->socket_accept) {
-                for (;;) {
+                unsigned n = 0;
+
+                /* Take all connections that are queued, up to a
+                 * limit, so that a storm of connections does not
+                 * cost one iteration of the event loop each. The
+                 * listening socket is non-blocking. */
+                while (n < SOCKET_ACCEPT_BATCH_MAX) {
 
                         cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK);
                         if (cfd < 0) {
@@ -2034,15 +2118,27 @@ static void socket_fd_event(Unit *u, int fd, uint32_t events, Watch *w) {
                                 if (errno == EINTR)
                                         continue;
 
+                                if (errno == EAGAIN && n > 0)
+                                        break;
+
                                 log_error_unit(u->id,
                                                "Failed to accept socket: %m");
                                 goto fail;
                         }
 
-                        break;
+                        n++;
+
+                        socket_apply_socket_options(s, cfd);
+                        socket_enter_running(s, cfd);
+
+                        /* Stop when we ran out of connection slots,
+                         * or the socket went away meanwhile */
+                        if (s->state != SOCKET_LISTENING ||
+                            s->n_connections >= s->max_connections)
+                                break;
                 }
 
-                socket_apply_socket_options(s, cfd);
+                return;
         }
 
         socket_enter_running(s, cfd);
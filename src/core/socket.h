@@ -108,6 +108,14 @@ struct Socket {
         when the next service we spawn. */
         UnitRef service;
 
+        /* For Accept=yes sockets the file the last connection
+         * service was loaded from, if that was the template, and
+         * the unit path cache generation it was found in. As long
+         * as the unit directories did not change, the next instance
+         * will be loaded from there without searching for it. */
+        char *template_path;
+        unsigned template_path_generation;
+
         SocketState state, deserialized_state;
 
         Watch timer_watch;
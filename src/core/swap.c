@@ -158,14 +158,27 @@ int swap_add_one_mount_link(Swap *s, Mount *m) {
 }
 
 static int swap_add_mount_links(Swap *s) {
-        Unit *other;
-        int r;
+        _cleanup_free_ Mount **mounts = NULL;
+        int n, k, r;
 
         assert(s);
 
-        LIST_FOREACH(units_by_type, other, UNIT(s)->manager->units_by_type[UNIT_MOUNT])
-                if ((r = swap_add_one_mount_link(s, MOUNT(other))) < 0)
+        if (!s->what || is_device_path(s->what))
+                return 0;
+
+        r = unit_add_indexed_path(UNIT(s), s->what, false);
+        if (r < 0)
+                return r;
+
+        n = unit_get_mounts_for_paths(UNIT(s), &mounts);
+        if (n < 0)
+                return n;
+
+        for (k = 0; k < n; k++) {
+                r = swap_add_one_mount_link(s, mounts[k]);
+                if (r < 0)
                         return r;
+        }
 
         return 0;
 }
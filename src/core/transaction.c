@@ -60,6 +60,33 @@ void transaction_abort(Transaction *tr) {
         assert(hashmap_isempty(tr->jobs));
 }
 
+static void transaction_add_to_queue(Transaction *tr, Job *j) {
+        assert(tr);
+        assert(j);
+        assert(!j->transaction_prev);
+
+        if (j->in_transaction_queue)
+                return;
+
+        LIST_PREPEND(Job, transaction_queue, tr->queue, j);
+        j->in_transaction_queue = true;
+}
+
+static Job *transaction_pop_queue(Transaction *tr) {
+        Job *j;
+
+        assert(tr);
+
+        j = tr->queue;
+        if (!j)
+                return NULL;
+
+        LIST_REMOVE(Job, transaction_queue, tr->queue, j);
+        j->in_transaction_queue = false;
+
+        return j;
+}
+
 static void transaction_find_jobs_that_matter_to_anchor(Job *j, unsigned generation) {
         JobDependency *l;
 
@@ -231,7 +258,11 @@ static int delete_one_unmergeable_job(Transaction *tr, Job *j) {
         return -EINVAL;
 }
 
-static int transaction_merge_jobs(Transaction *tr, DBusError *e) {
+static void transaction_collect_garbage(Transaction *tr);
+
+static int transaction_merge_jobs(Transaction *tr, JobMode mode, DBusError *e) {
+        _cleanup_free_ Unit **units = NULL;
+        unsigned n_units = 0, n;
         Job *j;
         Iterator i;
         int r;
@@ -239,11 +270,28 @@ static int transaction_merge_jobs(Transaction *tr, DBusError *e) {
         assert(tr);
 
         /* First step, check whether any of the jobs for one specific
-         * task conflict. If so, try to drop one of them. */
-        HASHMAP_FOREACH(j, tr->jobs, i) {
+         * task conflict. If so, try to drop one of them. Dropping
+         * jobs never makes other jobs unmergeable, hence every unit
+         * needs to be looked at only once. Since dropping a job
+         * might drop jobs of other units too, we go by a copy of the
+         * list of units. */
+        units = new(Unit*, hashmap_size(tr->jobs));
+        if (!units)
+                return -ENOMEM;
+
+        HASHMAP_FOREACH(j, tr->jobs, i)
+                if (j->transaction_next)
+                        units[n_units++] = j->unit;
+
+        for (n = 0; n < n_units; n++) {
                 JobType t;
                 Job *k;
 
+        again:
+                j = hashmap_get(tr->jobs, units[n]);
+                if (!j)
+                        continue;
+
                 t = j->type;
                 LIST_FOREACH(transaction, k, j->transaction_next) {
                         if (job_type_merge_and_collapse(&t, k->type, j->unit) >= 0)
@@ -254,11 +302,16 @@ static int transaction_merge_jobs(Transaction *tr, DBusError *e) {
                          * of them */
 
                         r = delete_one_unmergeable_job(tr, j);
-                        if (r >= 0)
+                        if (r >= 0) {
                                 /* Ok, we managed to drop one, now
-                                 * let's ask our callers to call us
-                                 * again after garbage collecting */
-                                return -EAGAIN;
+                                 * let's garbage collect its
+                                 * dependencies and look at this unit
+                                 * again */
+                                if (mode != JOB_ISOLATE)
+                                        transaction_collect_garbage(tr);
+
+                                goto again;
+                        }
 
                         /* We couldn't merge anything. Failure */
                         dbus_set_error(e, BUS_ERROR_TRANSACTION_JOBS_CONFLICTING, "Transaction contains conflicting jobs '%s' and '%s' for %s. Probably contradicting requirement dependencies configured.",
@@ -301,8 +354,8 @@ static void transaction_drop_redundant(Transaction *tr) {
 
         assert(tr);
 
-rescan:
         HASHMAP_FOREACH(j, tr->jobs, i) {
+                Unit *u = j->unit;
                 Job *k;
 
                 LIST_FOREACH(transaction, k, j) {
@@ -313,9 +366,14 @@ rescan:
                                 goto next_unit;
                 }
 
+                /* Whether a job is redundant does not depend on any
+                 * other job, and since we don't delete dependencies
+                 * here, only the entry of this unit goes away, which
+                 * is safe while iterating. */
+
                 /* log_debug("Found redundant job %s/%s, dropping.", j->unit->id, job_type_to_string(j->type)); */
-                transaction_delete_job(tr, j, false);
-                goto rescan;
+                while ((k = hashmap_get(tr->jobs, u)))
+                        transaction_delete_job(tr, k, false);
         next_unit:;
         }
 }
@@ -334,136 +392,282 @@ _pure_ static bool unit_matters_to_anchor(Unit *u, Job *j) {
         return false;
 }
 
-static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsigned generation, DBusError *e) {
+typedef struct OrderFrame {
+        Job *job;
         Iterator i;
+} OrderFrame;
+
+static Job *transaction_next_ordered_job(Transaction *tr, Job *j, Iterator *i) {
         Unit *u;
-        int r;
 
         assert(tr);
         assert(j);
-        assert(!j->transaction_prev);
+        assert(i);
+
+        /* Returns the next job that is ordered after j: either one
+         * in the transaction or, if there is none, an installed one.
+         * We assume that the dependencies are bidirectional, and
+         * hence can ignore UNIT_AFTER. */
 
-        /* Does a recursive sweep through the ordering graph, looking
-         * for a cycle. If we find cycle we try to break it. */
+        while ((u = dependency_list_iterate(j->unit->dependencies[UNIT_BEFORE], i))) {
+                Job *o;
 
-        /* Have we seen this before? */
-        if (j->generation == generation) {
-                Job *k, *delete;
+                o = hashmap_get(tr->jobs, u);
+                if (!o)
+                        o = u->job;
 
-                /* If the marker is NULL we have been here already and
-                 * decided the job was loop-free from here. Hence
-                 * shortcut things and return right-away. */
-                if (!j->marker)
-                        return 0;
+                if (o)
+                        return o;
+        }
 
-                /* So, the marker is not NULL and we already have been
-                 * here. We have a cycle. Let's try to break it. We go
-                 * backwards in our path and try to find a suitable
-                 * job to remove. We use the marker to find our way
-                 * back, since smart how we are we stored our way back
-                 * in there. */
-                log_warning_unit(j->unit->id,
-                                 "Found ordering cycle on %s/%s",
-                                 j->unit->id, job_type_to_string(j->type));
-
-                delete = NULL;
-                for (k = from; k; k = ((k->generation == generation && k->marker != k) ? k->marker : NULL)) {
-
-                        /* logging for j not k here here to provide consistent narrative */
-                        log_info_unit(j->unit->id,
-                                      "Walked on cycle path to %s/%s",
-                                      k->unit->id, job_type_to_string(k->type));
-
-                        if (!delete &&
-                            !unit_matters_to_anchor(k->unit, k)) {
-                                /* Ok, we can drop this one, so let's
-                                 * do so. */
-                                delete = k;
-                        }
+        return NULL;
+}
+
+static int transaction_break_cycle(Transaction *tr, Job *root, unsigned generation, Unit ***cycles, size_t *n_allocated, unsigned *n_cycles, DBusError *e) {
+        Job *j, *k, *from, *d;
+
+        assert(tr);
+        assert(root);
+
+        /* root is the root of a strongly connected component of the
+         * ordering graph with more than one job. Every job of the
+         * component lies on a cycle. Find one, by walking along
+         * the ordering dependencies inside the component until we
+         * get to a job we have already seen. The marker points to
+         * where we came from, so that we can find our way back. */
+
+        root->marker = root;
+        for (k = root;;) {
+                Iterator i = ITERATOR_FIRST;
+                Job *o;
 
-                        /* Check if this in fact was the beginning of
-                         * the cycle */
-                        if (k == j)
+                while ((o = transaction_next_ordered_job(tr, k, &i)))
+                        if (o->generation == generation &&
+                            !o->order_on_stack &&
+                            o->order_lowlink == root->order_index)
                                 break;
-                }
 
+                assert(o);
 
-                if (delete) {
-                        /* logging for j not k here here to provide consistent narrative */
-                        log_warning_unit(j->unit->id,
-                                         "Breaking ordering cycle by deleting job %s/%s",
-                                         delete->unit->id, job_type_to_string(delete->type));
-                        log_error_unit(delete->unit->id,
-                                       "Job %s/%s deleted to break ordering cycle starting with %s/%s",
-                                       delete->unit->id, job_type_to_string(delete->type),
-                                       j->unit->id, job_type_to_string(j->type));
-                        unit_status_printf(delete->unit, ANSI_HIGHLIGHT_RED_ON " SKIP " ANSI_HIGHLIGHT_OFF,
-                                           "Ordering cycle found, skipping %s");
-                        transaction_delete_unit(tr, delete->unit);
-                        return -EAGAIN;
+                if (o->marker) {
+                        j = o;
+                        from = k;
+                        break;
                 }
 
-                log_error("Unable to break cycle");
+                o->marker = k;
+                k = o;
+        }
 
-                dbus_set_error(e, BUS_ERROR_TRANSACTION_ORDER_IS_CYCLIC,
-                               "Transaction order is cyclic. See system logs for details.");
-                return -ENOEXEC;
+        log_warning_unit(j->unit->id,
+                         "Found ordering cycle on %s/%s",
+                         j->unit->id, job_type_to_string(j->type));
+
+        /* Go backwards in our path and try to find a suitable job
+         * to remove. */
+        d = NULL;
+        for (k = from; k; k = k != j ? k->marker : NULL) {
+
+                /* logging for j not k here here to provide consistent narrative */
+                log_info_unit(j->unit->id,
+                              "Walked on cycle path to %s/%s",
+                              k->unit->id, job_type_to_string(k->type));
+
+                if (!d &&
+                    !unit_matters_to_anchor(k->unit, k)) {
+                        /* Ok, we can drop this one, so let's
+                         * do so. */
+                        d = k;
+                }
         }
 
-        /* Make the marker point to where we come from, so that we can
-         * find our way backwards if we want to break a cycle. We use
-         * a special marker for the beginning: we point to
-         * ourselves. */
-        j->marker = from ? from : j;
-        j->generation = generation;
+        if (d) {
+                /* The jobs are deleted once the whole graph has
+                 * been looked at. Remember the unit to delete, then
+                 * the units of the cycle, ending with the one of j,
+                 * terminated by NULL. */
+                if (!GREEDY_REALLOC(*cycles, *n_allocated, *n_cycles + 1))
+                        return -ENOMEM;
 
-        /* We assume that the dependencies are bidirectional, and
-         * hence can ignore UNIT_AFTER */
-        SET_FOREACH(u, j->unit->dependencies[UNIT_BEFORE], i) {
-                Job *o;
+                (*cycles)[(*n_cycles)++] = d->unit;
 
-                /* Is there a job for this unit? */
-                o = hashmap_get(tr->jobs, u);
-                if (!o) {
-                        /* Ok, there is no job for this in the
-                         * transaction, but maybe there is already one
-                         * running? */
-                        o = u->job;
-                        if (!o)
-                                continue;
+                for (k = from; k; k = k != j ? k->marker : NULL) {
+                        if (!GREEDY_REALLOC(*cycles, *n_allocated, *n_cycles + 1))
+                                return -ENOMEM;
+
+                        (*cycles)[(*n_cycles)++] = k->unit;
                 }
 
-                r = transaction_verify_order_one(tr, o, j, generation, e);
-                if (r < 0)
-                        return r;
+                if (!GREEDY_REALLOC(*cycles, *n_allocated, *n_cycles + 1))
+                        return -ENOMEM;
+
+                (*cycles)[(*n_cycles)++] = NULL;
+                return 0;
         }
 
-        /* Ok, let's backtrack, and remember that this entry is not on
-         * our path anymore. */
-        j->marker = NULL;
+        log_error("Unable to break cycle");
 
-        return 0;
+        dbus_set_error(e, BUS_ERROR_TRANSACTION_ORDER_IS_CYCLIC,
+                       "Transaction order is cyclic. See system logs for details.");
+        return -ENOEXEC;
 }
 
-static int transaction_verify_order(Transaction *tr, unsigned *generation, DBusError *e) {
+static Job *transaction_job_of(Transaction *tr, Unit *u) {
         Job *j;
-        int r;
+
+        j = hashmap_get(tr->jobs, u);
+        return j ? j : u->job;
+}
+
+static void transaction_delete_cycle_unit(Transaction *tr, Unit *d, Unit *start) {
+        Job *dj, *sj;
+
+        assert_se(dj = transaction_job_of(tr, d));
+        assert_se(sj = transaction_job_of(tr, start));
+
+        /* logging for start not d here to provide consistent narrative */
+        log_warning_unit(start->id,
+                         "Breaking ordering cycle by deleting job %s/%s",
+                         d->id, job_type_to_string(dj->type));
+        log_error_unit(d->id,
+                       "Job %s/%s deleted to break ordering cycle starting with %s/%s",
+                       d->id, job_type_to_string(dj->type),
+                       start->id, job_type_to_string(sj->type));
+        unit_status_printf(d, ANSI_HIGHLIGHT_RED_ON " SKIP " ANSI_HIGHLIGHT_OFF,
+                           "Ordering cycle found, skipping %s");
+
+        transaction_delete_unit(tr, d);
+}
+
+static int transaction_verify_order(Transaction *tr, unsigned *generation, DBusError *e) {
+        _cleanup_free_ OrderFrame *frames = NULL;
+        _cleanup_free_ Unit **cycles = NULL;
+        size_t frames_allocated = 0, cycles_allocated = 0;
+        unsigned n_frames = 0, n_cycles = 0, next_index = 0, g, k;
+        Job *stack = NULL, *j;
         Iterator i;
-        unsigned g;
+        int r;
 
         assert(tr);
         assert(generation);
 
         /* Check if the ordering graph is cyclic. If it is, try to fix
-         * that up by dropping one of the jobs. */
+         * that up by dropping one job of every cycle we find.
+         *
+         * This is Tarjan's algorithm for strongly connected
+         * components, with an explicit stack of frames instead of
+         * recursion, so that long ordering chains don't exhaust the
+         * stack. Jobs that have been visited carry the current
+         * generation, the marker links the jobs on Tarjan's stack. */
 
         g = (*generation)++;
 
-        HASHMAP_FOREACH(j, tr->jobs, i)
-                if ((r = transaction_verify_order_one(tr, j, NULL, g, e)) < 0)
-                        return r;
+        HASHMAP_FOREACH(j, tr->jobs, i) {
 
-        return 0;
+                if (j->generation == g)
+                        continue;
+
+                for (;;) {
+                        Job *o;
+
+                        if (j) {
+                                /* Enter j */
+                                if (!GREEDY_REALLOC(frames, frames_allocated, n_frames + 1))
+                                        return -ENOMEM;
+
+                                j->generation = g;
+                                j->order_index = j->order_lowlink = next_index++;
+                                j->order_on_stack = true;
+                                j->marker = stack;
+                                stack = j;
+
+                                frames[n_frames].job = j;
+                                frames[n_frames].i = ITERATOR_FIRST;
+                                n_frames++;
+                        }
+
+                        j = frames[n_frames-1].job;
+
+                        o = transaction_next_ordered_job(tr, j, &frames[n_frames-1].i);
+                        if (o) {
+                                if (o->generation != g)
+                                        /* Not seen yet, descend */
+                                        j = o;
+                                else {
+                                        if (o->order_on_stack)
+                                                j->order_lowlink = MIN(j->order_lowlink, o->order_index);
+
+                                        j = NULL;
+                                }
+
+                                continue;
+                        }
+
+                        /* Leave j */
+                        n_frames--;
+
+                        if (n_frames > 0)
+                                frames[n_frames-1].job->order_lowlink = MIN(frames[n_frames-1].job->order_lowlink, j->order_lowlink);
+
+                        if (j->order_lowlink == j->order_index) {
+                                bool cycle = stack != j;
+                                Job *c;
+
+                                /* j is the root of a strongly
+                                 * connected component, pop it from
+                                 * the stack and remember the
+                                 * component in the lowlink */
+                                do {
+                                        c = stack;
+                                        stack = c->marker;
+
+                                        c->order_on_stack = false;
+                                        c->order_lowlink = j->order_index;
+                                        c->marker = NULL;
+                                } while (c != j);
+
+                                if (cycle) {
+                                        r = transaction_break_cycle(tr, j, g, &cycles, &cycles_allocated, &n_cycles, e);
+                                        if (r < 0)
+                                                return r;
+                                }
+                        }
+
+                        if (n_frames <= 0)
+                                break;
+
+                        j = NULL;
+                }
+        }
+
+        if (n_cycles <= 0)
+                return 0;
+
+        /* Deleting a job takes the jobs with it that depend on it,
+         * which might have broken other cycles already. Only delete
+         * a job if its cycle is still complete. If a cycle remains
+         * nonetheless, the next pass will find it. */
+        for (k = 0; k < n_cycles; k++) {
+                Unit *d = cycles[k], *start = NULL;
+                bool complete = true;
+
+                while (cycles[++k]) {
+                        if (!transaction_job_of(tr, cycles[k]))
+                                complete = false;
+
+                        start = cycles[k];
+                }
+
+                if (!complete) {
+                        log_debug_unit(start->id,
+                                       "Ordering cycle starting with %s is already broken.", start->id);
+                        continue;
+                }
+
+                transaction_delete_cycle_unit(tr, d, start);
+        }
+
+        return -EAGAIN;
 }
 
 static void transaction_collect_garbage(Transaction *tr) {
@@ -474,8 +678,13 @@ static void transaction_collect_garbage(Transaction *tr) {
 
         /* Drop jobs that are not required by any other job */
 
-rescan:
-        HASHMAP_FOREACH(j, tr->jobs, i) {
+        HASHMAP_FOREACH(j, tr->jobs, i)
+                transaction_add_to_queue(tr, j);
+
+        while ((j = transaction_pop_queue(tr))) {
+                JobDependency *l;
+                Unit *u = j->unit;
+
                 if (tr->anchor_job == j || j->object_list) {
                         /* log_debug("Keeping job %s/%s because of %s/%s", */
                         /*           j->unit->id, job_type_to_string(j->type), */
@@ -484,9 +693,23 @@ rescan:
                         continue;
                 }
 
+                /* The jobs this one pulled in might be garbage
+                 * now */
+                LIST_FOREACH(subject, l, j->subject_list) {
+                        Job *k;
+
+                        k = hashmap_get(tr->jobs, l->object->unit);
+                        if (k && k != j)
+                                transaction_add_to_queue(tr, k);
+                }
+
                 /* log_debug("Garbage collecting job %s/%s", j->unit->id, job_type_to_string(j->type)); */
                 transaction_delete_job(tr, j, true);
-                goto rescan;
+
+                /* And so might the next job of this unit */
+                j = hashmap_get(tr->jobs, u);
+                if (j)
+                        transaction_add_to_queue(tr, j);
         }
 }
 
@@ -523,11 +746,19 @@ static void transaction_minimize_impact(Transaction *tr) {
         assert(tr);
 
         /* Drops all unnecessary jobs that reverse already active jobs
-         * or that stop a running service. */
+         * or that stop a running service. Whether a job is dropped
+         * doesn't depend on other jobs, hence every unit is looked at
+         * once, but dropping a job might drop jobs of other units
+         * too, so we go by the queue. */
 
-rescan:
-        HASHMAP_FOREACH(j, tr->jobs, i) {
-                LIST_FOREACH(transaction, j, j) {
+        HASHMAP_FOREACH(j, tr->jobs, i)
+                transaction_add_to_queue(tr, j);
+
+        while ((j = transaction_pop_queue(tr))) {
+                Unit *u = j->unit;
+
+        rescan:
+                LIST_FOREACH(transaction, j, hashmap_get(tr->jobs, u)) {
                         bool stops_running_service, changes_existing_job;
 
                         /* If it matters, we shouldn't drop it */
@@ -685,26 +916,14 @@ int transaction_activate(Transaction *tr, Manager *m, JobMode mode, DBusError *e
                  * graph is still cyclic... */
         }
 
-        for (;;) {
-                /* Sixth step: let's drop unmergeable entries if
-                 * necessary and possible, merge entries we can
-                 * merge */
-                r = transaction_merge_jobs(tr, e);
-                if (r >= 0)
-                        break;
-
-                if (r != -EAGAIN) {
-                        log_warning("Requested transaction contains unmergeable jobs: %s", bus_error(e, r));
-                        return r;
-                }
-
-                /* Seventh step: an entry got dropped, let's garbage
-                 * collect its dependencies. */
-                if (mode != JOB_ISOLATE)
-                        transaction_collect_garbage(tr);
-
-                /* Let's see if the resulting transaction still has
-                 * unmergeable entries ... */
+        /* Sixth step: let's drop unmergeable entries if necessary
+         * and possible, merge entries we can merge. Seventh step:
+         * when an entry got dropped, garbage collect its
+         * dependencies. */
+        r = transaction_merge_jobs(tr, mode, e);
+        if (r < 0) {
+                log_warning("Requested transaction contains unmergeable jobs: %s", bus_error(e, r));
+                return r;
         }
 
         /* Eights step: Drop redundant jobs again, if the merging now allows us to drop more. */
@@ -792,6 +1011,17 @@ static void transaction_unlink_job(Transaction *tr, Job *j, bool delete_dependen
         assert(tr);
         assert(j);
 
+        if (j->in_transaction_queue) {
+                LIST_REMOVE(Job, transaction_queue, tr->queue, j);
+                j->in_transaction_queue = false;
+
+                /* The next job of the unit takes our place */
+                if (j->transaction_next) {
+                        j->transaction_next->transaction_prev = NULL;
+                        transaction_add_to_queue(tr, j->transaction_next);
+                }
+        }
+
         if (j->transaction_prev)
                 j->transaction_prev->transaction_next = j->transaction_next;
         else if (j->transaction_next)
@@ -916,7 +1146,7 @@ int transaction_add_job_and_dependencies(
 
                 /* Finally, recursively add in all dependencies. */
                 if (type == JOB_START || type == JOB_RESTART) {
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUIRES], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_REQUIRES, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -927,7 +1157,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_BINDS_TO], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_BINDS_TO, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -938,7 +1168,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUIRES_OVERRIDABLE], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_REQUIRES_OVERRIDABLE, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, !override, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_full_unit(r == -EADDRNOTAVAIL ? LOG_DEBUG : LOG_WARNING, dep->id,
@@ -950,7 +1180,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_WANTS], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_WANTS, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, false, false, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_full_unit(r == -EADDRNOTAVAIL ? LOG_DEBUG : LOG_WARNING, dep->id,
@@ -962,7 +1192,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUISITE], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_REQUISITE, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_VERIFY_ACTIVE, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -973,7 +1203,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUISITE_OVERRIDABLE], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_REQUISITE_OVERRIDABLE, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_VERIFY_ACTIVE, dep, ret, !override, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_full_unit(r == -EADDRNOTAVAIL ? LOG_DEBUG : LOG_WARNING, dep->id,
@@ -985,7 +1215,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_CONFLICTS], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_CONFLICTS, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_STOP, dep, ret, true, override, true, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -996,7 +1226,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_CONFLICTED_BY], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_CONFLICTED_BY, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_STOP, dep, ret, false, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_warning_unit(dep->id,
@@ -1012,7 +1242,7 @@ int transaction_add_job_and_dependencies(
 
                 if (type == JOB_STOP || type == JOB_RESTART) {
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUIRED_BY], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_REQUIRED_BY, i) {
                                 r = transaction_add_job_and_dependencies(tr, type, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -1023,7 +1253,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_BOUND_BY], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_BOUND_BY, i) {
                                 r = transaction_add_job_and_dependencies(tr, type, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -1034,7 +1264,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_CONSISTS_OF], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_CONSISTS_OF, i) {
                                 r = transaction_add_job_and_dependencies(tr, type, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -1049,7 +1279,7 @@ int transaction_add_job_and_dependencies(
 
                 if (type == JOB_RELOAD) {
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_PROPAGATES_RELOAD_TO], i) {
+                        UNIT_FOREACH_DEPENDENCY(dep, ret->unit, UNIT_PROPAGATES_RELOAD_TO, i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_RELOAD, dep, ret, false, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_warning_unit(dep->id,
@@ -1071,6 +1301,120 @@ fail:
         return r;
 }
 
+static int dependencies_redundant(Unit *u, JobType type, Hashmap *seen);
+
+static int job_redundant(Unit *u, JobType type, Hashmap *seen) {
+        Set *following;
+        void *v;
+        int r;
+
+        assert(u);
+        assert(seen);
+
+        /* A unit that would get jobs of two different types would
+         * need merging, leave that to the real thing */
+        v = hashmap_get(seen, u);
+        if (v)
+                return PTR_TO_UINT(v) == (unsigned) type + 1;
+
+        r = hashmap_put(seen, u, UINT_TO_PTR(type + 1));
+        if (r < 0)
+                return r;
+
+        if (u->load_state != UNIT_LOADED)
+                return 0;
+
+        if (u->job || u->nop_job)
+                return 0;
+
+        if (!job_type_is_redundant(type, unit_active_state(u)))
+                return 0;
+
+        if (unit_following_set(u, &following) > 0) {
+                set_free(following);
+                return 0;
+        }
+
+        return dependencies_redundant(u, type, seen);
+}
+
+static int dependencies_redundant(Unit *u, JobType type, Hashmap *seen) {
+        static const struct {
+                JobType type;
+                UnitDependency dependency;
+                JobType pulls_in;
+        } table[] = {
+                { JOB_START, UNIT_REQUIRES,              JOB_START         },
+                { JOB_START, UNIT_BINDS_TO,              JOB_START         },
+                { JOB_START, UNIT_REQUIRES_OVERRIDABLE,  JOB_START         },
+                { JOB_START, UNIT_WANTS,                 JOB_START         },
+                { JOB_START, UNIT_REQUISITE,             JOB_VERIFY_ACTIVE },
+                { JOB_START, UNIT_REQUISITE_OVERRIDABLE, JOB_VERIFY_ACTIVE },
+                { JOB_START, UNIT_CONFLICTS,             JOB_STOP          },
+                { JOB_START, UNIT_CONFLICTED_BY,         JOB_STOP          },
+                { JOB_STOP,  UNIT_REQUIRED_BY,           JOB_STOP          },
+                { JOB_STOP,  UNIT_BOUND_BY,              JOB_STOP          },
+                { JOB_STOP,  UNIT_CONSISTS_OF,           JOB_STOP          },
+        };
+
+        Iterator i;
+        unsigned k;
+        Unit *dep;
+        int r;
+
+        /* Mirrors what transaction_add_job_and_dependencies() pulls
+         * in for start and stop jobs */
+
+        for (k = 0; k < ELEMENTSOF(table); k++) {
+                if (table[k].type != type)
+                        continue;
+
+                UNIT_FOREACH_DEPENDENCY(dep, u, table[k].dependency, i) {
+                        r = job_redundant(dep, table[k].pulls_in, seen);
+                        if (r <= 0)
+                                return r;
+                }
+        }
+
+        return 1;
+}
+
+int transaction_dependencies_redundant(Unit *unit, JobType type) {
+        Hashmap *seen;
+        Set *following;
+        int r;
+
+        assert(unit);
+
+        /* Returns > 0 if all jobs a job of the specified type for
+         * this unit would pull in are redundant, i.e. would be
+         * dropped from the transaction again anyway, so that it is
+         * sufficient to enqueue the job itself. This is typically
+         * the case when starting a service with only default
+         * dependencies on a running system, and much cheaper than
+         * building and then minimizing the transaction for
+         * sysinit.target and everything it pulls in. */
+
+        if (type != JOB_START && type != JOB_STOP)
+                return 0;
+
+        if (unit_following_set(unit, &following) > 0) {
+                set_free(following);
+                return 0;
+        }
+
+        seen = hashmap_new(trivial_hash_func, trivial_compare_func);
+        if (!seen)
+                return -ENOMEM;
+
+        r = hashmap_put(seen, unit, UINT_TO_PTR(type + 1));
+        if (r >= 0)
+                r = dependencies_redundant(unit, type, seen);
+
+        hashmap_free(seen);
+        return r;
+}
+
 int transaction_add_isolate_jobs(Transaction *tr, Manager *m) {
         Iterator i;
         Unit *u;
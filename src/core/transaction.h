@@ -28,12 +28,16 @@ typedef struct Transaction Transaction;
 #include "manager.h"
 #include "job.h"
 #include "hashmap.h"
+#include "list.h"
 
 struct Transaction {
         /* Jobs to be added */
         Hashmap *jobs;      /* Unit object => Job object list 1:1 */
         Job *anchor_job;      /* the job the user asked for */
         bool irreversible;
+
+        /* The first jobs of units that need to be looked at again */
+        LIST_HEAD(Job, queue);
 };
 
 Transaction *transaction_new(bool irreversible);
@@ -50,6 +54,7 @@ int transaction_add_job_and_dependencies(
                 bool ignore_requirements,
                 bool ignore_order,
                 DBusError *e);
+int transaction_dependencies_redundant(Unit *unit, JobType type);
 int transaction_activate(Transaction *tr, Manager *m, JobMode mode, DBusError *e);
 int transaction_add_isolate_jobs(Transaction *tr, Manager *m);
 void transaction_abort(Transaction *tr);
@@ -49,6 +49,7 @@
 #include "label.h"
 #include "fileio-label.h"
 #include "bus-errors.h"
+#include "serialize.h"
 
 const UnitVTable * const unit_vtable[_UNIT_TYPE_MAX] = {
         [UNIT_SERVICE] = &service_vtable,
@@ -314,8 +315,13 @@ void unit_add_to_dbus_queue(Unit *u) {
         assert(u);
         assert(u->type != _UNIT_TYPE_INVALID);
 
-        if (u->load_state == UNIT_STUB || u->in_dbus_queue)
+        if (u->load_state == UNIT_STUB)
+                return;
+
+        if (u->in_dbus_queue) {
+                u->manager->n_bus_changes_coalesced++;
                 return;
+        }
 
         /* Shortcut things if nobody cares */
         if (!bus_has_subscriber(u->manager)) {
@@ -327,31 +333,32 @@ void unit_add_to_dbus_queue(Unit *u) {
         u->in_dbus_queue = true;
 }
 
-static void bidi_set_free(Unit *u, Set *s) {
+static void bidi_list_free(Unit *u, DependencyList *l) {
         Iterator i;
         Unit *other;
 
         assert(u);
 
-        /* Frees the set and makes sure we are dropped from the
+        /* Frees the list and makes sure we are dropped from the
          * inverse pointers */
 
-        SET_FOREACH(other, s, i) {
+        DEPENDENCY_LIST_FOREACH(other, l, i) {
                 UnitDependency d;
 
                 for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
-                        set_remove(other->dependencies[d], u);
+                        dependency_list_remove(other->dependencies[d], u);
 
                 unit_add_to_gc_queue(other);
         }
 
-        set_free(s);
+        dependency_list_free(l);
 }
 
 void unit_free(Unit *u) {
         UnitDependency d;
         Iterator i;
         char *t;
+        char **p;
 
         assert(u);
 
@@ -377,12 +384,13 @@ void unit_free(Unit *u) {
         }
 
         for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
-                bidi_set_free(u, u->dependencies[d]);
+                bidi_list_free(u, u->dependencies[d]);
 
-        if (u->requires_mounts_for) {
-                LIST_REMOVE(Unit, has_requires_mounts_for, u->manager->has_requires_mounts_for, u);
-                strv_free(u->requires_mounts_for);
-        }
+        STRV_FOREACH(p, u->indexed_paths)
+                path_index_remove(u->manager->units_by_path_prefix, *p, u);
+        strv_free(u->indexed_paths);
+
+        strv_free(u->requires_mounts_for);
 
         if (u->type != _UNIT_TYPE_INVALID)
                 LIST_REMOVE(Unit, units_by_type, u->manager->units_by_type[u->type], u);
@@ -401,6 +409,9 @@ void unit_free(Unit *u) {
                 u->manager->n_in_gc_queue--;
         }
 
+        unit_untrack_all_pids(u);
+        set_free(u->pids);
+
         cgroup_bonding_free_list(u->cgroup_bondings, u->manager->n_reloading <= 0);
         cgroup_attribute_free_list(u->cgroup_attributes);
 
@@ -409,6 +420,7 @@ void unit_free(Unit *u) {
         free(u->fragment_path);
         free(u->source_path);
         strv_free(u->dropin_paths);
+        strv_free(u->dependency_links);
         free(u->instance);
 
         set_free_free(u->names);
@@ -482,22 +494,22 @@ static void merge_dependencies(Unit *u, Unit *other, UnitDependency d) {
         assert(d < _UNIT_DEPENDENCY_MAX);
 
         /* Fix backwards pointers */
-        SET_FOREACH(back, other->dependencies[d], i) {
+        UNIT_FOREACH_DEPENDENCY(back, other, d, i) {
                 UnitDependency k;
 
                 for (k = 0; k < _UNIT_DEPENDENCY_MAX; k++)
-                        if ((r = set_remove_and_put(back->dependencies[k], other, u)) < 0) {
+                        if ((r = dependency_list_replace(back->dependencies[k], other, u)) < 0) {
 
                                 if (r == -EEXIST)
-                                        set_remove(back->dependencies[k], other);
+                                        dependency_list_remove(back->dependencies[k], other);
                                 else
                                         assert(r == -ENOENT);
                         }
         }
 
-        complete_move(&u->dependencies[d], &other->dependencies[d]);
+        dependency_list_move(&u->dependencies[d], &other->dependencies[d]);
 
-        set_free(other->dependencies[d]);
+        dependency_list_free(other->dependencies[d]);
         other->dependencies[d] = NULL;
 }
 
@@ -715,7 +727,7 @@ void unit_dump(Unit *u, FILE *f, const char *prefix) {
         for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++) {
                 Unit *other;
 
-                SET_FOREACH(other, u->dependencies[d], i)
+                UNIT_FOREACH_DEPENDENCY(other, u, d, i)
                         fprintf(f, "%s\t%s: %s\n", prefix, unit_dependency_to_string(d), other->id);
         }
 
@@ -846,7 +858,7 @@ int unit_add_default_target_dependency(Unit *u, Unit *target) {
                 return 0;
 
         /* Don't create loops */
-        if (set_get(target->dependencies[UNIT_BEFORE], u))
+        if (dependency_list_contains(target->dependencies[UNIT_BEFORE], u))
                 return 0;
 
         return unit_add_dependency(target, UNIT_AFTER, u, true);
@@ -868,7 +880,7 @@ static int unit_add_default_dependencies(Unit *u) {
         assert(u);
 
         for (k = 0; k < ELEMENTSOF(deps); k++)
-                SET_FOREACH(target, u->dependencies[deps[k]], i)
+                UNIT_FOREACH_DEPENDENCY(target, u, deps[k], i)
                         if ((r = unit_add_default_target_dependency(u, target)) < 0)
                                 return r;
 
@@ -912,7 +924,7 @@ int unit_load(Unit *u) {
         }
 
         if (u->on_failure_isolate &&
-            set_size(u->dependencies[UNIT_ON_FAILURE]) > 1) {
+            dependency_list_size(u->dependencies[UNIT_ON_FAILURE]) > 1) {
 
                 log_error_unit(u->id,
                                "More than one OnFailure= dependencies specified for %s but OnFailureIsolate= enabled. Refusing.", u->id);
@@ -1205,19 +1217,19 @@ static void unit_check_unneeded(Unit *u) {
         if (!UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(u)))
                 return;
 
-        SET_FOREACH(other, u->dependencies[UNIT_REQUIRED_BY], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUIRED_BY, i)
                 if (unit_active_or_pending(other))
                         return;
 
-        SET_FOREACH(other, u->dependencies[UNIT_REQUIRED_BY_OVERRIDABLE], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUIRED_BY_OVERRIDABLE, i)
                 if (unit_active_or_pending(other))
                         return;
 
-        SET_FOREACH(other, u->dependencies[UNIT_WANTED_BY], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_WANTED_BY, i)
                 if (unit_active_or_pending(other))
                         return;
 
-        SET_FOREACH(other, u->dependencies[UNIT_BOUND_BY], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_BOUND_BY, i)
                 if (unit_active_or_pending(other))
                         return;
 
@@ -1234,31 +1246,31 @@ static void retroactively_start_dependencies(Unit *u) {
         assert(u);
         assert(UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(u)));
 
-        SET_FOREACH(other, u->dependencies[UNIT_REQUIRES], i)
-                if (!set_get(u->dependencies[UNIT_AFTER], other) &&
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUIRES, i)
+                if (!dependency_list_contains(u->dependencies[UNIT_AFTER], other) &&
                     !UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_START, other, JOB_REPLACE, true, NULL, NULL);
 
-        SET_FOREACH(other, u->dependencies[UNIT_BINDS_TO], i)
-                if (!set_get(u->dependencies[UNIT_AFTER], other) &&
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_BINDS_TO, i)
+                if (!dependency_list_contains(u->dependencies[UNIT_AFTER], other) &&
                     !UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_START, other, JOB_REPLACE, true, NULL, NULL);
 
-        SET_FOREACH(other, u->dependencies[UNIT_REQUIRES_OVERRIDABLE], i)
-                if (!set_get(u->dependencies[UNIT_AFTER], other) &&
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUIRES_OVERRIDABLE, i)
+                if (!dependency_list_contains(u->dependencies[UNIT_AFTER], other) &&
                     !UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_START, other, JOB_FAIL, false, NULL, NULL);
 
-        SET_FOREACH(other, u->dependencies[UNIT_WANTS], i)
-                if (!set_get(u->dependencies[UNIT_AFTER], other) &&
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_WANTS, i)
+                if (!dependency_list_contains(u->dependencies[UNIT_AFTER], other) &&
                     !UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_START, other, JOB_FAIL, false, NULL, NULL);
 
-        SET_FOREACH(other, u->dependencies[UNIT_CONFLICTS], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_CONFLICTS, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_STOP, other, JOB_REPLACE, true, NULL, NULL);
 
-        SET_FOREACH(other, u->dependencies[UNIT_CONFLICTED_BY], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_CONFLICTED_BY, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_STOP, other, JOB_REPLACE, true, NULL, NULL);
 }
@@ -1271,7 +1283,7 @@ static void retroactively_stop_dependencies(Unit *u) {
         assert(UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(u)));
 
         /* Pull down units which are bound to us recursively if enabled */
-        SET_FOREACH(other, u->dependencies[UNIT_BOUND_BY], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_BOUND_BY, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_STOP, other, JOB_REPLACE, true, NULL, NULL);
 }
@@ -1284,22 +1296,22 @@ static void check_unneeded_dependencies(Unit *u) {
         assert(UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(u)));
 
         /* Garbage collect services that might not be needed anymore, if enabled */
-        SET_FOREACH(other, u->dependencies[UNIT_REQUIRES], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUIRES, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         unit_check_unneeded(other);
-        SET_FOREACH(other, u->dependencies[UNIT_REQUIRES_OVERRIDABLE], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUIRES_OVERRIDABLE, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         unit_check_unneeded(other);
-        SET_FOREACH(other, u->dependencies[UNIT_WANTS], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_WANTS, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         unit_check_unneeded(other);
-        SET_FOREACH(other, u->dependencies[UNIT_REQUISITE], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUISITE, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         unit_check_unneeded(other);
-        SET_FOREACH(other, u->dependencies[UNIT_REQUISITE_OVERRIDABLE], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_REQUISITE_OVERRIDABLE, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         unit_check_unneeded(other);
-        SET_FOREACH(other, u->dependencies[UNIT_BINDS_TO], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_BINDS_TO, i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         unit_check_unneeded(other);
 }
@@ -1310,12 +1322,12 @@ void unit_start_on_failure(Unit *u) {
 
         assert(u);
 
-        if (set_size(u->dependencies[UNIT_ON_FAILURE]) <= 0)
+        if (dependency_list_size(u->dependencies[UNIT_ON_FAILURE]) <= 0)
                 return;
 
         log_info_unit(u->id, "Triggering OnFailure= dependencies of %s.", u->id);
 
-        SET_FOREACH(other, u->dependencies[UNIT_ON_FAILURE], i) {
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_ON_FAILURE, i) {
                 int r;
 
                 r = manager_add_job(u->manager, JOB_START, other, u->on_failure_isolate ? JOB_ISOLATE : JOB_REPLACE, true, NULL, NULL);
@@ -1330,7 +1342,7 @@ void unit_trigger_notify(Unit *u) {
 
         assert(u);
 
-        SET_FOREACH(other, u->dependencies[UNIT_TRIGGERED_BY], i)
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_TRIGGERED_BY, i)
                 if (UNIT_VTABLE(other)->trigger_notify)
                         UNIT_VTABLE(other)->trigger_notify(other, u);
 }
@@ -1367,9 +1379,15 @@ void unit_notify(Unit *u, UnitActiveState os, UnitActiveState ns, bool reload_su
                         u->active_exit_timestamp = ts;
         }
 
-        if (UNIT_IS_INACTIVE_OR_FAILED(ns))
+        if (UNIT_IS_INACTIVE_OR_FAILED(ns)) {
                 cgroup_bonding_trim_list(u->cgroup_bondings, true);
 
+                /* Whatever we killed and did not reap ourselves
+                 * has been reaped by somebody else by now, hence
+                 * forget about it before the PID is reused */
+                unit_untrack_all_pids(u);
+        }
+
         if (UNIT_IS_INACTIVE_OR_FAILED(os) != UNIT_IS_INACTIVE_OR_FAILED(ns)) {
                 ExecContext *ec = unit_get_exec_context(u);
                 if (ec && exec_context_may_touch_console(ec)) {
@@ -1565,6 +1583,7 @@ void unit_unwatch_fd(Unit *u, Watch *w) {
         assert(w->type == WATCH_FD);
         assert(w->data.unit == u);
         assert_se(epoll_ctl(u->manager->epoll_fd, EPOLL_CTL_DEL, w->fd, NULL) >= 0);
+        u->manager->watch_generation++;
 
         w->fd = -1;
         w->type = WATCH_INVALID;
@@ -1572,13 +1591,22 @@ void unit_unwatch_fd(Unit *u, Watch *w) {
 }
 
 int unit_watch_pid(Unit *u, pid_t pid) {
+        int r;
+
         assert(u);
         assert(pid >= 1);
 
         /* Watch a specific PID. We only support one unit watching
          * each PID for now. */
 
-        return hashmap_put(u->manager->watch_pids, LONG_TO_PTR(pid), u);
+        r = hashmap_put(u->manager->watch_pids, LONG_TO_PTR(pid), u);
+        if (r < 0)
+                return r;
+
+        /* Keep track of it even after it is not watched anymore */
+        unit_track_pid(u, pid);
+
+        return r;
 }
 
 void unit_unwatch_pid(Unit *u, pid_t pid) {
@@ -1588,69 +1616,83 @@ void unit_unwatch_pid(Unit *u, pid_t pid) {
         hashmap_remove_value(u->manager->watch_pids, LONG_TO_PTR(pid), u);
 }
 
-int unit_watch_timer(Unit *u, clockid_t clock_id, bool relative, usec_t usec, Watch *w) {
-        struct itimerspec its = {};
-        int flags, fd;
-        bool ours;
+int unit_track_pid(Unit *u, pid_t pid) {
+        Unit *other;
+        int r;
 
         assert(u);
-        assert(w);
-        assert(w->type == WATCH_INVALID || (w->type == WATCH_UNIT_TIMER && w->data.unit == u));
-
-        /* This will try to reuse the old timer if there is one */
+        assert(pid >= 1);
 
-        if (w->type == WATCH_UNIT_TIMER) {
-                assert(w->data.unit == u);
-                assert(w->fd >= 0);
+        /* Remember that a PID belongs to us, so that it can be
+         * looked up cheaply when it dies. Unlike unit_watch_pid()
+         * this has no effect on whether we get notified. */
 
-                ours = false;
-                fd = w->fd;
-        } else if (w->type == WATCH_INVALID) {
+        other = hashmap_get(u->manager->pid_units, LONG_TO_PTR(pid));
+        if (other == u)
+                return 0;
+        if (other)
+                unit_untrack_pid(other, pid);
 
-                ours = true;
-                fd = timerfd_create(clock_id, TFD_NONBLOCK|TFD_CLOEXEC);
-                if (fd < 0)
-                        return -errno;
-        } else
-                assert_not_reached("Invalid watch type");
+        r = set_ensure_allocated(&u->pids, trivial_hash_func, trivial_compare_func);
+        if (r < 0)
+                return r;
 
-        if (usec <= 0) {
-                /* Set absolute time in the past, but not 0, since we
-                 * don't want to disarm the timer */
-                its.it_value.tv_sec = 0;
-                its.it_value.tv_nsec = 1;
+        r = set_put(u->pids, LONG_TO_PTR(pid));
+        if (r < 0)
+                return r;
 
-                flags = TFD_TIMER_ABSTIME;
-        } else {
-                timespec_store(&its.it_value, usec);
-                flags = relative ? 0 : TFD_TIMER_ABSTIME;
+        r = hashmap_put(u->manager->pid_units, LONG_TO_PTR(pid), u);
+        if (r < 0) {
+                set_remove(u->pids, LONG_TO_PTR(pid));
+                return r;
         }
 
-        /* This will also flush the elapse counter */
-        if (timerfd_settime(fd, flags, &its, NULL) < 0)
-                goto fail;
+        return 0;
+}
 
-        if (w->type == WATCH_INVALID) {
-                struct epoll_event ev = {
-                        .data.ptr = w,
-                        .events = EPOLLIN,
-                };
+void unit_untrack_pid(Unit *u, pid_t pid) {
+        assert(u);
+        assert(pid >= 1);
 
-                if (epoll_ctl(u->manager->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
-                        goto fail;
+        if (hashmap_remove_value(u->manager->pid_units, LONG_TO_PTR(pid), u))
+                set_remove(u->pids, LONG_TO_PTR(pid));
+}
+
+void unit_untrack_all_pids(Unit *u) {
+        void *p;
+
+        assert(u);
+
+        while ((p = set_steal_first(u->pids)))
+                hashmap_remove_value(u->manager->pid_units, p, u);
+}
+
+int unit_watch_timer(Unit *u, clockid_t clock_id, bool relative, usec_t usec, Watch *w) {
+        int r;
+
+        assert(u);
+        assert(w);
+        assert(w->type == WATCH_INVALID || (w->type == WATCH_UNIT_TIMER && w->data.unit == u));
+
+        /* This will reschedule the old timer if there is one. A
+         * time of 0 means the timer elapses right away. */
+
+        if (usec > 0 && relative) {
+                usec_t n;
+
+                n = now(clock_id);
+                usec = usec < (usec_t) -1 - n ? n + usec : (usec_t) -1;
         }
 
+        r = manager_watch_timer(u->manager, w, clock_id, usec);
+        if (r < 0)
+                return r;
+
         w->type = WATCH_UNIT_TIMER;
-        w->fd = fd;
+        w->fd = -1;
         w->data.unit = u;
 
         return 0;
-
-fail:
-        if (ours)
-                close_nointr_nofail(fd);
-
-        return -errno;
 }
 
 void unit_unwatch_timer(Unit *u, Watch *w) {
@@ -1662,12 +1704,9 @@ void unit_unwatch_timer(Unit *u, Watch *w) {
 
         assert(w->type == WATCH_UNIT_TIMER);
         assert(w->data.unit == u);
-        assert(w->fd >= 0);
 
-        assert_se(epoll_ctl(u->manager->epoll_fd, EPOLL_CTL_DEL, w->fd, NULL) >= 0);
-        close_nointr_nofail(w->fd);
+        manager_unwatch_timer(u->manager, w);
 
-        w->fd = -1;
         w->type = WATCH_INVALID;
         w->data.unit = NULL;
 }
@@ -1740,34 +1779,22 @@ int unit_add_dependency(Unit *u, UnitDependency d, Unit *other, bool add_referen
         if (u == other)
                 return 0;
 
-        if ((r = set_ensure_allocated(&u->dependencies[d], trivial_hash_func, trivial_compare_func)) < 0)
-                return r;
-
-        if (inverse_table[d] != _UNIT_DEPENDENCY_INVALID)
-                if ((r = set_ensure_allocated(&other->dependencies[inverse_table[d]], trivial_hash_func, trivial_compare_func)) < 0)
-                        return r;
-
-        if (add_reference)
-                if ((r = set_ensure_allocated(&u->dependencies[UNIT_REFERENCES], trivial_hash_func, trivial_compare_func)) < 0 ||
-                    (r = set_ensure_allocated(&other->dependencies[UNIT_REFERENCED_BY], trivial_hash_func, trivial_compare_func)) < 0)
-                        return r;
-
-        if ((q = set_put(u->dependencies[d], other)) < 0)
+        if ((q = dependency_list_put(&u->dependencies[d], other)) < 0)
                 return q;
 
         if (inverse_table[d] != _UNIT_DEPENDENCY_INVALID)
-                if ((v = set_put(other->dependencies[inverse_table[d]], u)) < 0) {
+                if ((v = dependency_list_put(&other->dependencies[inverse_table[d]], u)) < 0) {
                         r = v;
                         goto fail;
                 }
 
         if (add_reference) {
-                if ((w = set_put(u->dependencies[UNIT_REFERENCES], other)) < 0) {
+                if ((w = dependency_list_put(&u->dependencies[UNIT_REFERENCES], other)) < 0) {
                         r = w;
                         goto fail;
                 }
 
-                if ((r = set_put(other->dependencies[UNIT_REFERENCED_BY], u)) < 0)
+                if ((r = dependency_list_put(&other->dependencies[UNIT_REFERENCED_BY], u)) < 0)
                         goto fail;
         }
 
@@ -1776,13 +1803,13 @@ int unit_add_dependency(Unit *u, UnitDependency d, Unit *other, bool add_referen
 
 fail:
         if (q > 0)
-                set_remove(u->dependencies[d], other);
+                dependency_list_remove(u->dependencies[d], other);
 
         if (v > 0)
-                set_remove(other->dependencies[inverse_table[d]], u);
+                dependency_list_remove(other->dependencies[inverse_table[d]], u);
 
         if (w > 0)
-                set_remove(u->dependencies[UNIT_REFERENCES], other);
+                dependency_list_remove(u->dependencies[UNIT_REFERENCES], other);
 
         return r;
 }
@@ -2054,6 +2081,8 @@ int unit_add_cgroup_from_text(Unit *u, const char *name, bool overwrite, CGroupB
                 if (overwrite && !b->essential) {
                         free(controller);
 
+                        cgroup_bonding_close_fds(b);
+
                         free(b->path);
                         b->path = path;
 
@@ -2081,6 +2110,7 @@ int unit_add_cgroup_from_text(Unit *u, const char *name, bool overwrite, CGroupB
         b->path = path;
         b->ours = ours;
         b->essential = streq(controller, SYSTEMD_CGROUP_CONTROLLER);
+        b->dir_fd = -1;
 
         r = unit_add_cgroup(u, b);
         if (r < 0)
@@ -2128,6 +2158,7 @@ static int unit_add_one_default_cgroup(Unit *u, const char *controller) {
 
         b->ours = true;
         b->essential = streq(controller, SYSTEMD_CGROUP_CONTROLLER);
+        b->dir_fd = -1;
 
         r = unit_add_cgroup(u, b);
         if (r < 0)
@@ -2350,6 +2381,7 @@ bool unit_can_serialize(Unit *u) {
 }
 
 int unit_serialize(Unit *u, FILE *f, FDSet *fds, bool serialize_jobs) {
+        Serializer *s = u->manager->serializer;
         int r;
 
         assert(u);
@@ -2365,27 +2397,27 @@ int unit_serialize(Unit *u, FILE *f, FDSet *fds, bool serialize_jobs) {
 
         if (serialize_jobs) {
                 if (u->job) {
-                        fprintf(f, "job\n");
+                        serialize_marker(s, f, "job");
                         job_serialize(u->job, f, fds);
                 }
 
                 if (u->nop_job) {
-                        fprintf(f, "job\n");
+                        serialize_marker(s, f, "job");
                         job_serialize(u->nop_job, f, fds);
                 }
         }
 
-        dual_timestamp_serialize(f, "inactive-exit-timestamp", &u->inactive_exit_timestamp);
-        dual_timestamp_serialize(f, "active-enter-timestamp", &u->active_enter_timestamp);
-        dual_timestamp_serialize(f, "active-exit-timestamp", &u->active_exit_timestamp);
-        dual_timestamp_serialize(f, "inactive-enter-timestamp", &u->inactive_enter_timestamp);
-        dual_timestamp_serialize(f, "condition-timestamp", &u->condition_timestamp);
+        unit_serialize_dual_timestamp(u, f, "inactive-exit-timestamp", &u->inactive_exit_timestamp);
+        unit_serialize_dual_timestamp(u, f, "active-enter-timestamp", &u->active_enter_timestamp);
+        unit_serialize_dual_timestamp(u, f, "active-exit-timestamp", &u->active_exit_timestamp);
+        unit_serialize_dual_timestamp(u, f, "inactive-enter-timestamp", &u->inactive_enter_timestamp);
+        unit_serialize_dual_timestamp(u, f, "condition-timestamp", &u->condition_timestamp);
 
         if (dual_timestamp_is_set(&u->condition_timestamp))
                 unit_serialize_item(u, f, "condition-result", yes_no(u->condition_result));
 
         /* End marker */
-        fputc('\n', f);
+        serialize_end(s, f);
         return 0;
 }
 
@@ -2397,14 +2429,9 @@ void unit_serialize_item_format(Unit *u, FILE *f, const char *key, const char *f
         assert(key);
         assert(format);
 
-        fputs(key, f);
-        fputc('=', f);
-
         va_start(ap, format);
-        vfprintf(f, format, ap);
+        serialize_item_formatv(u->manager->serializer, f, key, format, ap);
         va_end(ap);
-
-        fputc('\n', f);
 }
 
 void unit_serialize_item(Unit *u, FILE *f, const char *key, const char *value) {
@@ -2413,43 +2440,36 @@ void unit_serialize_item(Unit *u, FILE *f, const char *key, const char *value) {
         assert(key);
         assert(value);
 
-        fprintf(f, "%s=%s\n", key, value);
+        serialize_item(u->manager->serializer, f, key, value);
+}
+
+void unit_serialize_dual_timestamp(Unit *u, FILE *f, const char *key, dual_timestamp *t) {
+        assert(u);
+        assert(f);
+        assert(key);
+        assert(t);
+
+        serialize_dual_timestamp(u->manager->serializer, f, key, t);
 }
 
 int unit_deserialize(Unit *u, FILE *f, FDSet *fds) {
+        Deserializer *d = u->manager->deserializer;
         int r;
 
         assert(u);
         assert(f);
         assert(fds);
+        assert(d);
 
         if (!unit_can_serialize(u))
                 return 0;
 
         for (;;) {
-                char line[LINE_MAX], *l, *v;
-                size_t k;
-
-                if (!fgets(line, sizeof(line), f)) {
-                        if (feof(f))
-                                return 0;
-                        return -errno;
-                }
-
-                char_array_0(line);
-                l = strstrip(line);
-
-                /* End marker */
-                if (l[0] == 0)
-                        return 0;
-
-                k = strcspn(l, "=");
+                char *l, *v;
 
-                if (l[k] == '=') {
-                        l[k] = 0;
-                        v = l+k+1;
-                } else
-                        v = l+k;
+                r = deserialize_next(d, f, &l, &v);
+                if (r <= 0)
+                        return r;
 
                 if (streq(l, "job")) {
                         if (v[0] == '\0') {
@@ -2823,6 +2843,60 @@ void unit_ref_unset(UnitRef *ref) {
         ref->unit = NULL;
 }
 
+int unit_add_indexed_path(Unit *u, const char *path, bool owner) {
+        int r;
+
+        assert(u);
+        assert(path);
+
+        if (strv_contains(u->indexed_paths, path))
+                return 0;
+
+        r = strv_extend(&u->indexed_paths, path);
+        if (r < 0)
+                return r;
+
+        return path_index_add(&u->manager->units_by_path_prefix, path, u, owner);
+}
+
+int unit_get_mounts_for_paths(Unit *u, Mount ***mounts) {
+        _cleanup_free_ Mount **l = NULL;
+        size_t allocated = 0;
+        unsigned n = 0;
+        char **i;
+
+        assert(u);
+        assert(mounts);
+
+        /* Returns the mount units mounted on or above the paths the
+         * unit has put in the index, possibly with duplicates */
+
+        STRV_FOREACH(i, u->indexed_paths) {
+                char *p;
+
+                p = strdupa(*i);
+                path_kill_slashes(p);
+
+                do {
+                        Unit *other;
+
+                        other = path_index_get_owner(u->manager->units_by_path_prefix, p);
+                        if (!other || other == u)
+                                continue;
+
+                        if (!GREEDY_REALLOC(l, allocated, n + 1))
+                                return -ENOMEM;
+
+                        l[n++] = MOUNT(other);
+                } while (path_strip_last_component(p));
+        }
+
+        *mounts = l;
+        l = NULL;
+
+        return (int) n;
+}
+
 int unit_add_one_mount_link(Unit *u, Mount *m) {
         char **i;
 
@@ -2848,13 +2922,24 @@ int unit_add_one_mount_link(Unit *u, Mount *m) {
 }
 
 int unit_add_mount_links(Unit *u) {
-        Unit *other;
-        int r;
+        _cleanup_free_ Mount **mounts = NULL;
+        char **i;
+        int n, k, r;
 
         assert(u);
 
-        LIST_FOREACH(units_by_type, other, u->manager->units_by_type[UNIT_MOUNT]) {
-                r = unit_add_one_mount_link(u, MOUNT(other));
+        STRV_FOREACH(i, u->requires_mounts_for) {
+                r = unit_add_indexed_path(u, *i, false);
+                if (r < 0)
+                        return r;
+        }
+
+        n = unit_get_mounts_for_paths(u, &mounts);
+        if (n < 0)
+                return n;
+
+        for (k = 0; k < n; k++) {
+                r = unit_add_one_mount_link(u, mounts[k]);
                 if (r < 0)
                         return r;
         }
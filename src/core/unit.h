@@ -41,6 +41,7 @@ typedef struct UnitStatusMessageFormats UnitStatusMessageFormats;
 #include "install.h"
 #include "unit-name.h"
 #include "cgroup-semantics.h"
+#include "dependency-list.h"
 
 enum UnitActiveState {
         UNIT_ACTIVE,
@@ -129,20 +130,27 @@ struct Unit {
         char *instance;
 
         Set *names;
-        Set *dependencies[_UNIT_DEPENDENCY_MAX];
+        DependencyList *dependencies[_UNIT_DEPENDENCY_MAX];
 
         char **requires_mounts_for;
 
+        /* The paths this unit has put in the manager's path index */
+        char **indexed_paths;
+
         char *description;
         char **documentation;
 
         char *fragment_path; /* if loaded from a config file this is the primary path to it */
         char *source_path; /* if converted, the source file */
         char **dropin_paths;
+        char **dependency_links; /* the .wants/ and .requires/ symlinks, sorted */
         usec_t fragment_mtime;
         usec_t source_mtime;
         usec_t dropin_mtime;
 
+        /* How long the last unit_load() took */
+        usec_t load_usec;
+
         /* If there is something to do with this unit, then this is the installed job for it */
         Job *job;
 
@@ -168,12 +176,13 @@ struct Unit {
         CGroupBonding *cgroup_bondings;
         CGroupAttribute *cgroup_attributes;
 
+        /* Processes we found in our cgroups, so that we can map
+         * them back to us without looking at /proc when they die */
+        Set *pids;
+
         /* Per type list */
         LIST_FIELDS(Unit, units_by_type);
 
-        /* All units which have requires_mounts_for set */
-        LIST_FIELDS(Unit, has_requires_mounts_for);
-
         /* Load queue */
         LIST_FIELDS(Unit, load_queue);
 
@@ -229,6 +238,7 @@ struct Unit {
         bool condition_result;
 
         bool in_load_queue:1;
+        bool load_prefetched:1;
         bool in_dbus_queue:1;
         bool in_cleanup_queue:1;
         bool in_gc_queue:1;
@@ -421,7 +431,10 @@ extern const UnitVTable * const unit_vtable[_UNIT_TYPE_MAX];
 /* For casting the various unit types into a unit */
 #define UNIT(u) (&(u)->meta)
 
-#define UNIT_TRIGGER(u) ((Unit*) set_first((u)->dependencies[UNIT_TRIGGERS]))
+#define UNIT_TRIGGER(u) dependency_list_first((u)->dependencies[UNIT_TRIGGERS])
+
+#define UNIT_FOREACH_DEPENDENCY(other, u, d, i) \
+        DEPENDENCY_LIST_FOREACH(other, (u)->dependencies[d], i)
 
 DEFINE_CAST(SOCKET, Socket);
 DEFINE_CAST(TIMER, Timer);
@@ -503,6 +516,10 @@ void unit_unwatch_fd(Unit *u, Watch *w);
 int unit_watch_pid(Unit *u, pid_t pid);
 void unit_unwatch_pid(Unit *u, pid_t pid);
 
+int unit_track_pid(Unit *u, pid_t pid);
+void unit_untrack_pid(Unit *u, pid_t pid);
+void unit_untrack_all_pids(Unit *u);
+
 int unit_watch_timer(Unit *u, clockid_t, bool relative, usec_t usec, Watch *w);
 void unit_unwatch_timer(Unit *u, Watch *w);
 
@@ -522,6 +539,7 @@ bool unit_can_serialize(Unit *u) _pure_;
 int unit_serialize(Unit *u, FILE *f, FDSet *fds, bool serialize_jobs);
 void unit_serialize_item_format(Unit *u, FILE *f, const char *key, const char *value, ...) _printf_attr_(4,5);
 void unit_serialize_item(Unit *u, FILE *f, const char *key, const char *value);
+void unit_serialize_dual_timestamp(Unit *u, FILE *f, const char *key, dual_timestamp *t);
 int unit_deserialize(Unit *u, FILE *f, FDSet *fds);
 
 int unit_add_node_link(Unit *u, const char *what, bool wants);
@@ -558,6 +576,9 @@ void unit_ref_unset(UnitRef *ref);
 
 #define UNIT_DEREF(ref) ((ref).unit)
 
+int unit_add_indexed_path(Unit *u, const char *path, bool owner);
+int unit_get_mounts_for_paths(Unit *u, Mount ***mounts);
+
 int unit_add_one_mount_link(Unit *u, Mount *m);
 int unit_add_mount_links(Unit *u);
 
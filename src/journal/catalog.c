@@ -21,6 +21,7 @@
 
 #include <fcntl.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
@@ -38,6 +39,7 @@
 #include "strxcpyx.h"
 #include "conf-files.h"
 #include "mkdir.h"
+#include "lookup3.h"
 #include "catalog.h"
 
 const char * const catalog_file_dirs[] = {
@@ -55,14 +57,54 @@ typedef struct CatalogHeader {
         le64_t header_size;
         le64_t n_items;
         le64_t catalog_item_size;
+        /* Added with CATALOG_HEADER_COMPATIBLE_HASH_TABLE */
+        le64_t hash_table_offset;
+        le64_t n_buckets;
 } CatalogHeader;
 
+#define CATALOG_HEADER_SIZE_MIN offsetof(CatalogHeader, hash_table_offset)
+
+enum {
+        /* The database carries a minimal perfect hash table over
+         * the (id, language) pairs, old readers may ignore it and
+         * bisect the sorted item array instead. */
+        CATALOG_HEADER_COMPATIBLE_HASH_TABLE = 1
+};
+
+/* Average number of items per bucket of the hash table, and the
+ * number of seeds we try per bucket before giving up */
+#define CATALOG_BUCKET_SIZE 4U
+#define CATALOG_SEED_MAX (1U << 20)
+
 typedef struct CatalogItem {
         sd_id128_t id;
         char language[32];
         le64_t offset;
 } CatalogItem;
 
+struct Catalog {
+        void *p;
+        size_t size;
+
+        const uint8_t *items;
+        uint64_t n_items;
+        uint64_t item_size;
+        const char *strings;
+
+        const le32_t *seeds;
+        const le32_t *slots;
+        uint64_t n_buckets;
+
+        /* The LC_MESSAGES locale the language below was derived from */
+        char *locale;
+        char language[32];
+
+        /* Consecutive journal entries frequently carry the same
+         * message ID, hence remember the last lookup */
+        sd_id128_t last_id;
+        const char *last_text;
+};
+
 unsigned catalog_hash_func(const void *p) {
         const CatalogItem *i = p;
 
@@ -101,6 +143,14 @@ int catalog_compare_func(const void *a, const void *b) {
         return strcmp(i->language, j->language);
 }
 
+static uint32_t catalog_item_hash(const CatalogItem *i, uint32_t seed) {
+
+        /* This ends up on disk, hence needs to be stable across
+         * architectures, which jenkins_hashlittle() is */
+        return jenkins_hashlittle(i->language, strnlen(i->language, sizeof(i->language)),
+                                  jenkins_hashlittle(i->id.bytes, sizeof(i->id.bytes), seed));
+}
+
 static int finish_item(
                 Hashmap *h,
                 struct strbuf *sb,
@@ -272,13 +322,107 @@ int catalog_import_file(Hashmap *h, struct strbuf *sb, const char *path) {
         return 0;
 }
 
+static int build_hash_table(const CatalogItem *items, unsigned n,
+                            le32_t **_seeds, le32_t **_slots, unsigned *_n_buckets) {
+        _cleanup_free_ unsigned *first = NULL, *next = NULL, *size = NULL;
+        _cleanup_free_ bool *taken = NULL;
+        le32_t *seeds = NULL, *slots = NULL;
+        unsigned n_buckets, max_size = 0, s, b, k;
+
+        assert(items);
+        assert(n > 0);
+        assert(_seeds);
+        assert(_slots);
+        assert(_n_buckets);
+
+        /* Builds a minimal perfect hash table following the
+         * "hash, displace and compress" scheme: the items are split
+         * into buckets by their unseeded hash, and then for each
+         * bucket, largest first, we look for a seed that places all
+         * of its items in slots not taken yet. A lookup hence needs
+         * exactly two hash calculations and a single comparison. */
+
+        n_buckets = (n + CATALOG_BUCKET_SIZE - 1) / CATALOG_BUCKET_SIZE;
+
+        first = new(unsigned, n_buckets);
+        size = new0(unsigned, n_buckets);
+        next = new(unsigned, n);
+        taken = new0(bool, n);
+        seeds = new0(le32_t, n_buckets);
+        slots = new0(le32_t, n);
+        if (!first || !size || !next || !taken || !seeds || !slots)
+                goto oom;
+
+        for (b = 0; b < n_buckets; b++)
+                first[b] = (unsigned) -1;
+
+        for (k = 0; k < n; k++) {
+                b = catalog_item_hash(items + k, 0) % n_buckets;
+
+                next[k] = first[b];
+                first[b] = k;
+
+                if (++size[b] > max_size)
+                        max_size = size[b];
+        }
+
+        for (s = max_size; s > 0; s--)
+                for (b = 0; b < n_buckets; b++) {
+                        uint32_t seed;
+
+                        if (size[b] != s)
+                                continue;
+
+                        for (seed = 1; seed < CATALOG_SEED_MAX; seed++) {
+                                unsigned l;
+
+                                for (k = first[b]; k != (unsigned) -1; k = next[k]) {
+                                        l = catalog_item_hash(items + k, seed) % n;
+                                        if (taken[l])
+                                                break;
+
+                                        taken[l] = true;
+                                        slots[l] = htole32(k);
+                                }
+
+                                if (k == (unsigned) -1)
+                                        break;
+
+                                /* Collision, release what we took so far */
+                                for (l = first[b]; l != k; l = next[l])
+                                        taken[catalog_item_hash(items + l, seed) % n] = false;
+                        }
+
+                        if (seed >= CATALOG_SEED_MAX) {
+                                free(seeds);
+                                free(slots);
+                                return -E2BIG;
+                        }
+
+                        seeds[b] = htole32(seed);
+                }
+
+        *_seeds = seeds;
+        *_slots = slots;
+        *_n_buckets = n_buckets;
+
+        return 0;
+
+oom:
+        free(seeds);
+        free(slots);
+        return log_oom();
+}
+
 static long write_catalog(const char *database, Hashmap *h, struct strbuf *sb,
-                          CatalogItem *items, size_t n) {
+                          CatalogItem *items, size_t n,
+                          le32_t *seeds, le32_t *slots, size_t n_buckets) {
         CatalogHeader header;
         _cleanup_fclose_ FILE *w = NULL;
         int r;
         _cleanup_free_ char *d, *p = NULL;
         size_t k;
+        uint64_t offset;
 
         d = dirname_malloc(database);
         if (!d)
@@ -303,6 +447,15 @@ static long write_catalog(const char *database, Hashmap *h, struct strbuf *sb,
         header.catalog_item_size = htole64(sizeof(CatalogItem));
         header.n_items = htole64(hashmap_size(h));
 
+        /* The hash table comes last, so that readers which do not
+         * know about it find the strings where they always were */
+        offset = ALIGN_TO(sizeof(CatalogHeader), 8) + n * sizeof(CatalogItem) + sb->len;
+        if (seeds) {
+                header.compatible_flags = htole32(CATALOG_HEADER_COMPATIBLE_HASH_TABLE);
+                header.hash_table_offset = htole64(ALIGN_TO(offset, 8));
+                header.n_buckets = htole64(n_buckets);
+        }
+
         r = -EIO;
 
         k = fwrite(&header, 1, sizeof(header), w);
@@ -323,6 +476,18 @@ static long write_catalog(const char *database, Hashmap *h, struct strbuf *sb,
                 goto error;
         }
 
+        if (seeds) {
+                static const uint8_t padding[8] = {};
+
+                k = ALIGN_TO(offset, 8) - offset;
+                if (fwrite(padding, 1, k, w) != k ||
+                    fwrite(seeds, sizeof(le32_t), n_buckets, w) != n_buckets ||
+                    fwrite(slots, sizeof(le32_t), n, w) != n) {
+                        log_error("%s: failed to write hash table.", p);
+                        goto error;
+                }
+        }
+
         fflush(w);
 
         if (ferror(w)) {
@@ -351,6 +516,8 @@ int catalog_update(const char* database, const char* root, const char* const* di
         Hashmap *h;
         struct strbuf *sb = NULL;
         _cleanup_free_ CatalogItem *items = NULL;
+        _cleanup_free_ le32_t *seeds = NULL, *slots = NULL;
+        unsigned n_buckets = 0;
         CatalogItem *i;
         Iterator j;
         unsigned n;
@@ -401,7 +568,14 @@ int catalog_update(const char* database, const char* root, const char* const* di
         assert(n == hashmap_size(h));
         qsort(items, n, sizeof(CatalogItem), catalog_compare_func);
 
-        r = write_catalog(database, h, sb, items, n);
+        r = build_hash_table(items, n, &seeds, &slots, &n_buckets);
+        if (r == -ENOMEM)
+                goto finish;
+        if (r < 0)
+                log_warning("Failed to build hash table, readers will fall back to bisection: %s",
+                            strerror(-r));
+
+        r = write_catalog(database, h, sb, items, n, seeds, slots, n_buckets);
         if (r < 0)
                 log_error("Failed to write %s: %s", database, strerror(-r));
         else
@@ -419,109 +593,186 @@ finish:
         return r < 0 ? r : 0;
 }
 
-static int open_mmap(const char *database, int *_fd, struct stat *_st, void **_p) {
+int catalog_open(const char *database, Catalog **ret) {
+        _cleanup_close_ int fd = -1;
         const CatalogHeader *h;
-        int fd;
-        void *p;
         struct stat st;
+        Catalog *c;
+        void *p;
+        uint64_t header_size, n_items, item_size;
 
-        assert(_fd);
-        assert(_st);
-        assert(_p);
+        assert(database);
+        assert(ret);
 
         fd = open(database, O_RDONLY|O_CLOEXEC);
         if (fd < 0)
                 return -errno;
 
-        if (fstat(fd, &st) < 0) {
-                close_nointr_nofail(fd);
+        if (fstat(fd, &st) < 0)
                 return -errno;
-        }
 
-        if (st.st_size < (off_t) sizeof(CatalogHeader)) {
-                close_nointr_nofail(fd);
+        if (st.st_size < (off_t) CATALOG_HEADER_SIZE_MIN)
                 return -EINVAL;
-        }
 
         p = mmap(NULL, PAGE_ALIGN(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
-        if (p == MAP_FAILED) {
-                close_nointr_nofail(fd);
+        if (p == MAP_FAILED)
                 return -errno;
-        }
 
         h = p;
+        header_size = le64toh(h->header_size);
+        n_items = le64toh(h->n_items);
+        item_size = le64toh(h->catalog_item_size);
+
         if (memcmp(h->signature, CATALOG_SIGNATURE, sizeof(h->signature)) != 0 ||
-            le64toh(h->header_size) < sizeof(CatalogHeader) ||
-            le64toh(h->catalog_item_size) < sizeof(CatalogItem) ||
+            header_size < CATALOG_HEADER_SIZE_MIN ||
+            item_size < sizeof(CatalogItem) ||
             h->incompatible_flags != 0 ||
-            le64toh(h->n_items) <= 0 ||
-            st.st_size < (off_t) (le64toh(h->header_size) + le64toh(h->catalog_item_size) * le64toh(h->n_items))) {
-                close_nointr_nofail(fd);
+            n_items <= 0 ||
+            st.st_size < (off_t) (header_size + item_size * n_items)) {
                 munmap(p, st.st_size);
                 return -EBADMSG;
         }
 
-        *_fd = fd;
-        *_st = st;
-        *_p = p;
+        c = new0(Catalog, 1);
+        if (!c) {
+                munmap(p, st.st_size);
+                return -ENOMEM;
+        }
+
+        c->p = p;
+        c->size = st.st_size;
+        c->items = (const uint8_t*) p + header_size;
+        c->n_items = n_items;
+        c->item_size = item_size;
+        c->strings = (const char*) c->items + n_items * item_size;
+
+        if ((le32toh(h->compatible_flags) & CATALOG_HEADER_COMPATIBLE_HASH_TABLE) &&
+            header_size >= sizeof(CatalogHeader)) {
+                uint64_t offset, n_buckets;
+
+                offset = le64toh(h->hash_table_offset);
+                n_buckets = le64toh(h->n_buckets);
+
+                /* If the table looks bogus we can still bisect */
+                if (n_buckets > 0 &&
+                    offset % 8 == 0 &&
+                    offset >= header_size + item_size * n_items &&
+                    offset + (n_buckets + n_items) * sizeof(le32_t) <= (uint64_t) st.st_size) {
+                        c->seeds = (const le32_t*) ((const uint8_t*) p + offset);
+                        c->slots = c->seeds + n_buckets;
+                        c->n_buckets = n_buckets;
+                }
+        }
 
+        *ret = c;
         return 0;
 }
 
-static const char *find_id(void *p, sd_id128_t id) {
-        CatalogItem key, *f = NULL;
-        const CatalogHeader *h = p;
+void catalog_close(Catalog *c) {
+        if (!c)
+                return;
+
+        munmap(c->p, c->size);
+        free(c->locale);
+        free(c);
+}
+
+static const CatalogItem *find_item(Catalog *c, const CatalogItem *key) {
+        const CatalogItem *f;
+        uint32_t k;
+
+        if (!c->seeds)
+                return bsearch(key, c->items, c->n_items, c->item_size, catalog_compare_func);
+
+        k = le32toh(c->seeds[catalog_item_hash(key, 0) % c->n_buckets]);
+        k = le32toh(c->slots[catalog_item_hash(key, k) % c->n_items]);
+        if (k >= c->n_items)
+                return NULL;
+
+        /* The table is only perfect for the keys it was built
+         * for, anything else needs to be weeded out here */
+        f = (const CatalogItem*) (c->items + k * c->item_size);
+        if (catalog_compare_func(key, f) != 0)
+                return NULL;
+
+        return f;
+}
+
+static void update_language(Catalog *c) {
         const char *loc;
 
+        loc = setlocale(LC_MESSAGES, NULL);
+        if (c->locale && streq_ptr(loc, c->locale))
+                return;
+
+        free(c->locale);
+        c->locale = loc ? strdup(loc) : NULL;
+
+        zero(c->language);
+        if (loc && loc[0] && !streq(loc, "C") && !streq(loc, "POSIX")) {
+                strncpy(c->language, loc, sizeof(c->language) - 1);
+                c->language[strcspn(c->language, ".@")] = 0;
+        }
+
+        c->last_text = NULL;
+}
+
+const char *catalog_find(Catalog *c, sd_id128_t id) {
+        const CatalogItem *f = NULL;
+        CatalogItem key;
+
+        assert(c);
+
+        update_language(c);
+
+        if (c->last_text && sd_id128_equal(c->last_id, id))
+                return c->last_text;
+
         zero(key);
         key.id = id;
 
-        loc = setlocale(LC_MESSAGES, NULL);
-        if (loc && loc[0] && !streq(loc, "C") && !streq(loc, "POSIX")) {
-                strncpy(key.language, loc, sizeof(key.language));
-                key.language[strcspn(key.language, ".@")] = 0;
+        if (c->language[0]) {
+                memcpy(key.language, c->language, sizeof(key.language));
 
-                f = bsearch(&key, (const uint8_t*) p + le64toh(h->header_size), le64toh(h->n_items), le64toh(h->catalog_item_size), catalog_compare_func);
+                f = find_item(c, &key);
                 if (!f) {
                         char *e;
 
                         e = strchr(key.language, '_');
                         if (e) {
                                 *e = 0;
-                                f = bsearch(&key, (const uint8_t*) p + le64toh(h->header_size), le64toh(h->n_items), le64toh(h->catalog_item_size), catalog_compare_func);
+                                f = find_item(c, &key);
                         }
                 }
         }
 
         if (!f) {
                 zero(key.language);
-                f = bsearch(&key, (const uint8_t*) p + le64toh(h->header_size), le64toh(h->n_items), le64toh(h->catalog_item_size), catalog_compare_func);
+                f = find_item(c, &key);
         }
 
         if (!f)
                 return NULL;
 
-        return (const char*) p +
-                le64toh(h->header_size) +
-                le64toh(h->n_items) * le64toh(h->catalog_item_size) +
-                le64toh(f->offset);
+        c->last_id = id;
+        c->last_text = c->strings + le64toh(f->offset);
+
+        return c->last_text;
 }
 
 int catalog_get(const char* database, sd_id128_t id, char **_text) {
-        _cleanup_close_ int fd = -1;
-        void *p = NULL;
-        struct stat st;
-        char *text = NULL;
-        int r;
+        Catalog *c;
         const char *s;
+        char *text;
+        int r;
 
         assert(_text);
 
-        r = open_mmap(database, &fd, &st, &p);
+        r = catalog_open(database, &c);
         if (r < 0)
                 return r;
 
-        s = find_id(p, id);
+        s = catalog_find(c, id);
         if (!s) {
                 r = -ENOENT;
                 goto finish;
@@ -537,8 +788,7 @@ int catalog_get(const char* database, sd_id128_t id, char **_text) {
         r = 0;
 
 finish:
-        if (p)
-                munmap(p, st.st_size);
+        catalog_close(c);
 
         return r;
 }
@@ -584,38 +834,34 @@ static void dump_catalog_entry(FILE *f, sd_id128_t id, const char *s, bool oneli
 
 
 int catalog_list(FILE *f, const char *database, bool oneline) {
-        _cleanup_close_ int fd = -1;
-        void *p = NULL;
-        struct stat st;
-        const CatalogHeader *h;
-        const CatalogItem *items;
+        Catalog *c;
         int r;
         unsigned n;
         sd_id128_t last_id;
         bool last_id_set = false;
 
-        r = open_mmap(database, &fd, &st, &p);
+        r = catalog_open(database, &c);
         if (r < 0)
                 return r;
 
-        h = p;
-        items = (const CatalogItem*) ((const uint8_t*) p + le64toh(h->header_size));
-
-        for (n = 0; n < le64toh(h->n_items); n++) {
+        for (n = 0; n < c->n_items; n++) {
+                const CatalogItem *i;
                 const char *s;
 
-                if (last_id_set && sd_id128_equal(last_id, items[n].id))
+                i = (const CatalogItem*) (c->items + n * c->item_size);
+
+                if (last_id_set && sd_id128_equal(last_id, i->id))
                         continue;
 
-                assert_se(s = find_id(p, items[n].id));
+                assert_se(s = catalog_find(c, i->id));
 
-                dump_catalog_entry(f, items[n].id, s, oneline);
+                dump_catalog_entry(f, i->id, s, oneline);
 
                 last_id_set = true;
-                last_id = items[n].id;
+                last_id = i->id;
         }
 
-        munmap(p, st.st_size);
+        catalog_close(c);
 
         return 0;
 }
@@ -77,8 +77,20 @@ int journal_file_append_tag(JournalFile *f) {
         return 0;
 }
 
-int journal_file_hmac_start(JournalFile *f) {
+static void journal_file_hmac_prepare(JournalFile *f) {
         uint8_t key[256 / 8]; /* Let's pass 256 bit from FSPRG to HMAC */
+
+        assert(f);
+
+        gcry_md_reset(f->hmac);
+        FSPRG_GetKey(f->fsprg_state, key, sizeof(key), 0);
+        gcry_md_setkey(f->hmac, key, sizeof(key));
+
+        f->hmac_prepared = true;
+        f->hmac_prepared_epoch = FSPRG_GetEpoch(f->fsprg_state);
+}
+
+int journal_file_hmac_start(JournalFile *f) {
         assert(f);
 
         if (!f->seal)
@@ -87,11 +99,15 @@ int journal_file_hmac_start(JournalFile *f) {
         if (f->hmac_running)
                 return 0;
 
-        /* Prepare HMAC for next cycle */
-        gcry_md_reset(f->hmac);
-        FSPRG_GetKey(f->fsprg_state, key, sizeof(key), 0);
-        gcry_md_setkey(f->hmac, key, sizeof(key));
+        /* Prepare HMAC for next cycle, unless this has been done
+         * already when the key was evolved. Note that the FSPRG
+         * state might be shared with other files, hence check the
+         * epoch. */
+        if (!f->hmac_prepared ||
+            f->hmac_prepared_epoch != FSPRG_GetEpoch(f->fsprg_state))
+                journal_file_hmac_prepare(f);
 
+        f->hmac_prepared = false;
         f->hmac_running = true;
 
         return 0;
@@ -226,6 +242,11 @@ int journal_file_maybe_append_tag(JournalFile *f, uint64_t realtime) {
         if (r < 0)
                 return r;
 
+        /* Derive the key for the new epoch right away, so that this
+         * is done when we are called from journald's evolution
+         * timer, and not when the next entry is appended */
+        journal_file_hmac_prepare(f);
+
         return 0;
 }
 
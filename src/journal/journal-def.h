@@ -214,3 +214,16 @@ struct FSSHeader {
         le16_t reserved[3];
         le64_t fsprg_state_size;
 } _packed_;
+
+/* journald updates this small file in /run after each batch of
+ * writes, so that local readers can sleep on a futex instead of
+ * getting woken up for each inotify event. It is never written to
+ * disk and only shared between processes on the same machine, hence
+ * it uses native endianess. */
+#define JOURNAL_TAIL_PATH "/run/systemd/journal/tail"
+
+typedef struct JournalTail {
+        uint32_t change;      /* futex word, increased after each batch of writes */
+        uint32_t reserved;
+        uint64_t seqnum;      /* seqnum of the last entry written */
+} JournalTail;
@@ -115,6 +115,9 @@ int journal_file_set_offline(JournalFile *f) {
 void journal_file_close(JournalFile *f) {
         assert(f);
 
+        if (f->post_change_pending)
+                journal_file_post_change(f);
+
 #ifdef HAVE_GCRYPT
         /* Write the final tag */
         if (f->seal && f->writable)
@@ -1285,6 +1288,8 @@ void journal_file_post_change(JournalFile *f) {
 
         __sync_synchronize();
 
+        f->post_change_pending = false;
+
         if (ftruncate(f->fd, f->last_stat.st_size) < 0)
                 log_error("Failed to truncate file to its own size: %m");
 }
@@ -1346,7 +1351,10 @@ int journal_file_append_entry(JournalFile *f, const dual_timestamp *ts, const st
 
         r = journal_file_append_entry_internal(f, ts, xor_hash, items, n_iovec, seqnum, ret, offset);
 
-        journal_file_post_change(f);
+        if (f->defer_post_change)
+                f->post_change_pending = true;
+        else
+                journal_file_post_change(f);
 
         return r;
 }
@@ -1767,6 +1775,29 @@ int journal_file_move_to_entry_by_seqnum(
                 Object **ret,
                 uint64_t *offset) {
 
+        /* Seqnums are strictly increasing within a file, hence
+         * if the seqnum is outside of the range the header tells
+         * us about we can avoid the bisection. This matters when
+         * seeking across many archived files. */
+        if (f->header->n_entries > 0) {
+                uint64_t head, tail;
+
+                head = le64toh(f->header->head_entry_seqnum);
+                tail = le64toh(f->header->tail_entry_seqnum);
+
+                if (direction == DIRECTION_DOWN) {
+                        if (seqnum > tail)
+                                return 0;
+                        if (seqnum <= head)
+                                return journal_file_next_entry(f, NULL, 0, DIRECTION_DOWN, ret, offset);
+                } else {
+                        if (seqnum < head)
+                                return 0;
+                        if (seqnum >= tail)
+                                return journal_file_next_entry(f, NULL, 0, DIRECTION_UP, ret, offset);
+                }
+        }
+
         return generic_array_bisect(f,
                                     le64toh(f->header->entry_array_offset),
                                     le64toh(f->header->n_entries),
@@ -2386,6 +2417,8 @@ int journal_file_open(
 #ifdef HAVE_GCRYPT
         f->seal = seal;
 #endif
+        if (template)
+                f->defer_post_change = template->defer_post_change;
 
         if (mmap_cache)
                 f->mmap = mmap_cache_ref(mmap_cache);
@@ -56,6 +56,13 @@ typedef struct JournalFile {
 
         bool tail_entry_monotonic_valid;
 
+        /* If set, appending an entry only marks the file as
+         * changed, and the owner is expected to call
+         * journal_file_post_change() later on, so that the
+         * notification for many entries can be coalesced. */
+        bool defer_post_change;
+        bool post_change_pending;
+
         Header *header;
         HashItem *data_hash_table;
         HashItem *field_hash_table;
@@ -76,6 +83,11 @@ typedef struct JournalFile {
         gcry_md_hd_t hmac;
         bool hmac_running;
 
+        /* The HMAC has already been keyed for this epoch, but
+         * nothing has been written to it yet */
+        bool hmac_prepared;
+        uint64_t hmac_prepared_epoch;
+
         FSSHeader *fss_file;
         size_t fss_file_size;
 
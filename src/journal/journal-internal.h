@@ -32,6 +32,7 @@
 #include "hashmap.h"
 #include "set.h"
 #include "journal-file.h"
+#include "catalog.h"
 
 typedef struct Match Match;
 typedef struct Location Location;
@@ -78,6 +79,7 @@ struct Location {
         bool realtime_set;
         bool monotonic_set;
         bool xor_hash_set;
+        bool offset_set;
 
         uint64_t seqnum;
         sd_id128_t seqnum_id;
@@ -88,6 +90,10 @@ struct Location {
         sd_id128_t boot_id;
 
         uint64_t xor_hash;
+
+        /* Where the entry was found the last time, only a hint */
+        sd_id128_t file_id;
+        uint64_t offset;
 };
 
 struct Directory {
@@ -114,6 +120,9 @@ struct sd_journal {
 
         int inotify_fd;
 
+        const JournalTail *tail;
+        uint32_t tail_change;
+
         Match *level0, *level1, *level2;
 
         unsigned current_invalidate_counter, last_invalidate_counter;
@@ -129,6 +138,8 @@ struct sd_journal {
         Set *errors;
 
         usec_t last_process_usec;
+
+        Catalog *catalog;
 };
 
 char *journal_make_match_string(sd_journal *j);
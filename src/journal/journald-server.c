@@ -25,6 +25,8 @@
 #include <sys/statvfs.h>
 #include <sys/mman.h>
 #include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include <libudev.h>
 #include <systemd/sd-journal.h>
@@ -288,6 +290,8 @@ static JournalFile* find_journal(Server *s, uid_t uid) {
         if (r < 0)
                 return s->system_journal;
 
+        f->defer_post_change = true;
+
         server_fix_perms(s, f, uid);
 
         r = hashmap_put(s->user_journals, UINT32_TO_PTR(uid), f);
@@ -817,6 +821,13 @@ static int system_journal_open(Server *s) {
                 if (r >= 0) {
                         char fb[FORMAT_BYTES_MAX];
 
+                        s->system_journal->defer_post_change = true;
+
+                        /* If we have not been running for a while,
+                         * catch up with the key evolution now, and
+                         * not when the first message comes in */
+                        server_maybe_append_tags(s);
+
                         server_fix_perms(s, s->system_journal, 0);
                         server_driver_message(s, SD_ID128_NULL, "Allowing system journal files to grow to %s.",
                                               format_bytes(fb, sizeof(fb), s->system_metrics.max_use));
@@ -871,6 +882,7 @@ static int system_journal_open(Server *s) {
                 if (s->runtime_journal) {
                         char fb[FORMAT_BYTES_MAX];
 
+                        s->runtime_journal->defer_post_change = true;
                         server_fix_perms(s, s->runtime_journal, 0);
                         server_driver_message(s, SD_ID128_NULL, "Allowing runtime journal files to grow to %s.",
                                               format_bytes(fb, sizeof(fb), s->runtime_metrics.max_use));
@@ -1349,6 +1361,75 @@ int server_schedule_sync(Server *s) {
         return 0;
 }
 
+static int server_open_tail(Server *s) {
+        int fd;
+        JournalTail *t;
+
+        assert(s);
+
+        /* The file is kept across restarts of journald, so that
+         * readers which already mapped it continue to be woken
+         * up. */
+
+        fd = open(JOURNAL_TAIL_PATH, O_RDWR|O_CREAT|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW, 0644);
+        if (fd < 0) {
+                log_error("Failed to open "JOURNAL_TAIL_PATH", ignoring: %m");
+                return 0;
+        }
+
+        if (posix_fallocate(fd, 0, sizeof(JournalTail)) < 0) {
+                log_error("Failed to allocate journal tail file, ignoring: %m");
+                close_nointr_nofail(fd);
+                return 0;
+        }
+
+        t = mmap(NULL, sizeof(JournalTail), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        if (t == MAP_FAILED) {
+                log_error("Failed to map journal tail file, ignoring: %m");
+                close_nointr_nofail(fd);
+                return 0;
+        }
+
+        close_nointr_nofail(fd);
+        s->tail = t;
+
+        return 0;
+}
+
+static bool post_change_one(JournalFile *f) {
+        if (!f || !f->post_change_pending)
+                return false;
+
+        journal_file_post_change(f);
+        return true;
+}
+
+void server_post_change(Server *s) {
+        JournalFile *f;
+        Iterator i;
+        bool changed;
+
+        assert(s);
+
+        /* Notify readers once for all entries written since the
+         * last invocation, instead of once per entry */
+
+        changed = post_change_one(s->system_journal);
+        changed = post_change_one(s->runtime_journal) || changed;
+
+        HASHMAP_FOREACH(f, s->user_journals, i)
+                changed = post_change_one(f) || changed;
+
+        if (!changed || !s->tail)
+                return;
+
+        s->tail->seqnum = s->seqnum;
+        __sync_fetch_and_add(&s->tail->change, 1);
+
+        if (syscall(SYS_futex, &s->tail->change, FUTEX_WAKE, INT_MAX, NULL, NULL, 0) < 0)
+                log_debug("Failed to wake up journal readers: %m");
+}
+
 int server_init(Server *s) {
         int n, r, fd;
 
@@ -1462,6 +1543,10 @@ int server_init(Server *s) {
         if (r < 0)
                 return r;
 
+        r = server_open_tail(s);
+        if (r < 0)
+                return r;
+
         r = server_open_sync_timer(s);
         if (r < 0)
                 return r;
@@ -1547,6 +1632,9 @@ void server_done(Server *s) {
         if (s->kernel_seqnum)
                 munmap(s->kernel_seqnum, sizeof(uint64_t));
 
+        if (s->tail)
+                munmap(s->tail, sizeof(JournalTail));
+
         free(s->buffer);
         free(s->tty_path);
 
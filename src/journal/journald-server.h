@@ -119,6 +119,8 @@ typedef struct Server {
 
         uint64_t *kernel_seqnum;
 
+        JournalTail *tail;
+
         struct udev *udev;
 
         int sync_timer_fd;
@@ -156,3 +158,4 @@ int server_schedule_sync(Server *s);
 int server_flush_to_var(Server *s);
 int process_event(Server *s, struct epoll_event *ev);
 void server_maybe_append_tags(Server *s);
+void server_post_change(Server *s);
@@ -103,6 +103,10 @@ int main(int argc, char *argv[]) {
                 }
 #endif
 
+                /* Tell readers about everything written since we
+                 * went to sleep the last time */
+                server_post_change(&server);
+
                 r = epoll_wait(server.epoll_fd, &event, 1, t);
                 if (r < 0) {
 
@@ -26,7 +26,10 @@
 #include <sys/inotify.h>
 #include <sys/poll.h>
 #include <sys/vfs.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <linux/magic.h>
+#include <linux/futex.h>
 
 #include "sd-journal.h"
 #include "journal-def.h"
@@ -99,6 +102,7 @@ static void init_location(Location *l, LocationType type, JournalFile *f, Object
         l->xor_hash = le64toh(o->entry.xor_hash);
 
         l->seqnum_set = l->realtime_set = l->monotonic_set = l->xor_hash_set = true;
+        l->offset_set = false;
 }
 
 static void set_location(sd_journal *j, LocationType type, JournalFile *f, Object *o, uint64_t offset) {
@@ -754,6 +758,39 @@ static int find_location_for_match(
         }
 }
 
+static int find_location_by_offset(
+                sd_journal *j,
+                JournalFile *f,
+                Object **ret,
+                uint64_t *offset) {
+
+        Object *o;
+        int r;
+
+        assert(j);
+        assert(f);
+
+        /* The cursor told us where the entry was, check if it is
+         * still there. If it is not, the caller bisects. */
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY, j->current_location.offset, &o);
+        if (r < 0)
+                return 0;
+
+        if (j->current_location.seqnum_set &&
+            (!sd_id128_equal(j->current_location.seqnum_id, f->header->seqnum_id) ||
+             le64toh(o->entry.seqnum) != j->current_location.seqnum))
+                return 0;
+
+        if (compare_with_location(f, o, &j->current_location) != 0)
+                return 0;
+
+        *ret = o;
+        *offset = j->current_location.offset;
+
+        return 1;
+}
+
 static int find_location_with_matches(
                 sd_journal *j,
                 JournalFile *f,
@@ -771,6 +808,13 @@ static int find_location_with_matches(
         if (!j->level0) {
                 /* No matches is simple */
 
+                if (j->current_location.offset_set &&
+                    sd_id128_equal(j->current_location.file_id, f->header->file_id)) {
+                        r = find_location_by_offset(j, f, ret, offset);
+                        if (r != 0)
+                                return r;
+                }
+
                 if (j->current_location.type == LOCATION_HEAD)
                         return journal_file_next_entry(f, NULL, 0, DIRECTION_DOWN, ret, offset);
                 if (j->current_location.type == LOCATION_TAIL)
@@ -977,7 +1021,7 @@ _public_ int sd_journal_previous_skip(sd_journal *j, uint64_t skip) {
 _public_ int sd_journal_get_cursor(sd_journal *j, char **cursor) {
         Object *o;
         int r;
-        char bid[33], sid[33];
+        char bid[33], sid[33], fid[33];
 
         if (!j)
                 return -EINVAL;
@@ -993,13 +1037,18 @@ _public_ int sd_journal_get_cursor(sd_journal *j, char **cursor) {
 
         sd_id128_to_string(j->current_file->header->seqnum_id, sid);
         sd_id128_to_string(o->entry.boot_id, bid);
+        sd_id128_to_string(j->current_file->header->file_id, fid);
 
+        /* The file ID and offset are only a hint that allows
+         * seeking back to the entry without bisecting, in case
+         * the file is still around when the cursor is used. */
         if (asprintf(cursor,
-                     "s=%s;i=%llx;b=%s;m=%llx;t=%llx;x=%llx",
+                     "s=%s;i=%llx;b=%s;m=%llx;t=%llx;x=%llx;f=%s;o=%llx",
                      sid, (unsigned long long) le64toh(o->entry.seqnum),
                      bid, (unsigned long long) le64toh(o->entry.monotonic),
                      (unsigned long long) le64toh(o->entry.realtime),
-                     (unsigned long long) le64toh(o->entry.xor_hash)) < 0)
+                     (unsigned long long) le64toh(o->entry.xor_hash),
+                     fid, (unsigned long long) j->current_file->current_offset) < 0)
                 return -ENOMEM;
 
         return 0;
@@ -1008,15 +1057,17 @@ _public_ int sd_journal_get_cursor(sd_journal *j, char **cursor) {
 _public_ int sd_journal_seek_cursor(sd_journal *j, const char *cursor) {
         char *w, *state;
         size_t l;
-        unsigned long long seqnum, monotonic, realtime, xor_hash;
+        unsigned long long seqnum, monotonic, realtime, xor_hash, offset;
         bool
                 seqnum_id_set = false,
                 seqnum_set = false,
                 boot_id_set = false,
                 monotonic_set = false,
                 realtime_set = false,
-                xor_hash_set = false;
-        sd_id128_t seqnum_id, boot_id;
+                xor_hash_set = false,
+                file_id_set = false,
+                offset_set = false;
+        sd_id128_t seqnum_id, boot_id, file_id;
 
         if (!j)
                 return -EINVAL;
@@ -1069,6 +1120,17 @@ _public_ int sd_journal_seek_cursor(sd_journal *j, const char *cursor) {
                         if (sscanf(item+2, "%llx", &xor_hash) != 1)
                                 k = -EINVAL;
                         break;
+
+                case 'f':
+                        file_id_set = true;
+                        k = sd_id128_from_string(item+2, &file_id);
+                        break;
+
+                case 'o':
+                        offset_set = true;
+                        if (sscanf(item+2, "%llx", &offset) != 1)
+                                k = -EINVAL;
+                        break;
                 }
 
                 free(item);
@@ -1108,6 +1170,12 @@ _public_ int sd_journal_seek_cursor(sd_journal *j, const char *cursor) {
                 j->current_location.xor_hash_set = true;
         }
 
+        if (file_id_set && offset_set && offset > 0) {
+                j->current_location.file_id = file_id;
+                j->current_location.offset = (uint64_t) offset;
+                j->current_location.offset_set = true;
+        }
+
         return 0;
 }
 
@@ -1706,9 +1774,14 @@ _public_ void sd_journal_close(sd_journal *j) {
         if (j->inotify_fd >= 0)
                 close_nointr_nofail(j->inotify_fd);
 
+        if (j->tail)
+                munmap((void*) j->tail, sizeof(JournalTail));
+
         if (j->mmap)
                 mmap_cache_unref(j->mmap);
 
+        catalog_close(j->catalog);
+
         free(j->path);
         free(j->unique_field);
         set_free(j->errors);
@@ -2162,6 +2235,84 @@ _public_ int sd_journal_process(sd_journal *j) {
         return determine_change(j);
 }
 
+static void open_tail(sd_journal *j) {
+        int fd;
+        void *p;
+
+        assert(j);
+
+        /* journald only announces changes to the journal files it
+         * writes itself, so this is of no use if we were asked to
+         * read some other directory */
+        if (j->path)
+                return;
+
+        fd = open(JOURNAL_TAIL_PATH, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return;
+
+        p = mmap(NULL, sizeof(JournalTail), PROT_READ, MAP_SHARED, fd, 0);
+        close_nointr_nofail(fd);
+
+        if (p == MAP_FAILED)
+                return;
+
+        j->tail = p;
+        j->tail_change = ACCESS_ONCE(j->tail->change);
+}
+
+static int wait_for_tail(sd_journal *j, uint64_t timeout_usec) {
+        usec_t until = (usec_t) -1;
+        int r;
+
+        assert(j);
+        assert(j->tail);
+
+        if (timeout_usec != (uint64_t) -1)
+                until = now(CLOCK_MONOTONIC) + timeout_usec;
+
+        for (;;) {
+                struct timespec ts;
+                uint32_t c;
+                usec_t n, t;
+
+                c = ACCESS_ONCE(j->tail->change);
+                if (c != j->tail_change) {
+                        j->tail_change = c;
+
+                        /* journald already truncated the files
+                         * before bumping the counter, so this will
+                         * not block */
+                        r = sd_journal_process(j);
+                        if (r != SD_JOURNAL_NOP)
+                                return r;
+
+                        return determine_change(j);
+                }
+
+                n = now(CLOCK_MONOTONIC);
+                if (until != (usec_t) -1 && n >= until)
+                        return SD_JOURNAL_NOP;
+
+                /* Files might get added or removed without
+                 * journald bumping the counter, so check the
+                 * inotify queue every now and then anyway */
+                t = JOURNAL_FILES_RECHECK_USEC;
+                if (until != (usec_t) -1)
+                        t = MIN(t, until - n);
+
+                r = syscall(SYS_futex, &j->tail->change, FUTEX_WAIT, c, timespec_store(&ts, t), NULL, 0);
+                if (r < 0) {
+                        if (errno == ETIMEDOUT) {
+                                r = sd_journal_process(j);
+                                if (r != SD_JOURNAL_NOP)
+                                        return r;
+                        } else if (errno != EAGAIN && errno != EINTR)
+                                return -errno;
+                }
+        }
+}
+
 _public_ int sd_journal_wait(sd_journal *j, uint64_t timeout_usec) {
         int r;
         uint64_t t;
@@ -2176,6 +2327,8 @@ _public_ int sd_journal_wait(sd_journal *j, uint64_t timeout_usec) {
                 if (r < 0)
                         return r;
 
+                open_tail(j);
+
                 /* The journal might have changed since the context
                  * object was created and we weren't watching before,
                  * hence don't wait for anything, and return
@@ -2183,6 +2336,12 @@ _public_ int sd_journal_wait(sd_journal *j, uint64_t timeout_usec) {
                 return determine_change(j);
         }
 
+        /* If journald tells us about new entries via shared memory
+         * we can sleep on that, and only need to look at the
+         * inotify events when something actually changed */
+        if (j->tail && !j->on_network)
+                return wait_for_tail(j, timeout_usec);
+
         r = sd_journal_get_timeout(j, &t);
         if (r < 0)
                 return r;
@@ -2493,7 +2652,8 @@ _public_ int sd_journal_get_catalog(sd_journal *j, char **ret) {
         const void *data;
         size_t size;
         sd_id128_t id;
-        _cleanup_free_ char *text = NULL, *cid = NULL;
+        _cleanup_free_ char *cid = NULL;
+        const char *text;
         char *t;
         int r;
 
@@ -2514,9 +2674,17 @@ _public_ int sd_journal_get_catalog(sd_journal *j, char **ret) {
         if (r < 0)
                 return r;
 
-        r = catalog_get(CATALOG_DATABASE, id, &text);
-        if (r < 0)
-                return r;
+        /* Keep the database mapped, "journalctl -x" asks for one
+         * text per entry */
+        if (!j->catalog) {
+                r = catalog_open(CATALOG_DATABASE, &j->catalog);
+                if (r < 0)
+                        return r;
+        }
+
+        text = catalog_find(j->catalog, id);
+        if (!text)
+                return -ENOENT;
 
         t = replace_var(text, lookup_field, j);
         if (!t)
@@ -0,0 +1,90 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "util.h"
+#include "log.h"
+#include "catalog.h"
+
+/* Measures how long lookups in the hash table of a catalog database
+ * take, for a database with the given number of message ids.
+ *
+ * Usage: test-catalog-lookup [IDS] [LOOKUPS] */
+
+int main(int argc, char *argv[]) {
+        char dir[] = "/tmp/test-catalog-lookup.XXXXXX";
+        char name[] = "/tmp/test-catalog.XXXXXX";
+        _cleanup_free_ char *path = NULL, *dir_slash = NULL;
+        _cleanup_free_ sd_id128_t *ids = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_close_ int fd = -1;
+        unsigned n_ids = 5000, n_lookups = 1000000, i;
+        const char *dirs[2] = {};
+        char buf[FORMAT_TIMESPAN_MAX];
+        Catalog *c;
+        usec_t t;
+
+        log_parse_environment();
+        log_open();
+
+        if ((argc > 1 && safe_atou(argv[1], &n_ids) < 0) ||
+            (argc > 2 && safe_atou(argv[2], &n_lookups) < 0) ||
+            n_ids <= 0) {
+                log_error("Usage: %s [IDS] [LOOKUPS]", program_invocation_short_name);
+                return EXIT_FAILURE;
+        }
+
+        assert_se(mkdtemp(dir));
+        fd = mkstemp(name);
+        assert_se(fd >= 0);
+
+        assert_se(path = strappend(dir, "/test.catalog"));
+        assert_se(dir_slash = strappend(dir, "/"));
+        assert_se(f = fopen(path, "we"));
+        assert_se(ids = new(sd_id128_t, n_ids));
+
+        for (i = 0; i < n_ids; i++) {
+                assert_se(sd_id128_randomize(&ids[i]) >= 0);
+                fprintf(f, "-- " SD_ID128_FORMAT_STR "\nSubject: C %u\n\n", SD_ID128_FORMAT_VAL(ids[i]), i);
+        }
+        assert_se(fflush(f) == 0);
+
+        dirs[0] = dir_slash;
+        assert_se(catalog_update(name, NULL, dirs) >= 0);
+        assert_se(catalog_open(name, &c) >= 0);
+
+        t = now(CLOCK_MONOTONIC);
+        for (i = 0; i < n_lookups; i++)
+                assert_se(catalog_find(c, ids[(i * 7919) % n_ids]));
+        t = now(CLOCK_MONOTONIC) - t;
+
+        log_info("%u lookups among %u ids took %s.", n_lookups, n_ids,
+                 format_timespan(buf, sizeof(buf), t, USEC_PER_MSEC));
+
+        catalog_close(c);
+        unlink(name);
+        unlink(path);
+        rmdir(dir);
+
+        return EXIT_SUCCESS;
+}
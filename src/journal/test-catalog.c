@@ -29,6 +29,7 @@
 #include "log.h"
 #include "macro.h"
 #include "sd-messages.h"
+#include "strv.h"
 #include "catalog.h"
 
 static void test_import(Hashmap *h, struct strbuf *sb,
@@ -106,6 +107,74 @@ static void test_catalog_update(void) {
         assert(r >= 0);
 }
 
+#define N_IDS 5000
+
+static void test_catalog_lookup(void) {
+        char dir[] = "/tmp/test-catalog-lookup.XXXXXX";
+        char name[] = "/tmp/test-catalog.XXXXXX";
+        _cleanup_free_ char *path = NULL, *dir_slash = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_close_ int fd = -1;
+        const char *dirs[2] = {};
+        sd_id128_t *ids;
+        Catalog *c;
+        const char *loc;
+        bool de;
+        unsigned i;
+
+        /* Builds a database larger than any real one, and checks
+         * that every single item can be found through the hash
+         * table */
+
+        assert_se(mkdtemp(dir));
+        fd = mkstemp(name);
+        assert_se(fd >= 0);
+
+        assert_se(path = strappend(dir, "/test.catalog"));
+        assert_se(dir_slash = strappend(dir, "/"));
+        assert_se(f = fopen(path, "we"));
+        assert_se(ids = new(sd_id128_t, N_IDS));
+
+        for (i = 0; i < N_IDS; i++) {
+                assert_se(sd_id128_randomize(&ids[i]) >= 0);
+
+                fprintf(f, "-- " SD_ID128_FORMAT_STR "\nSubject: C %u\n\n", SD_ID128_FORMAT_VAL(ids[i]), i);
+                if (i % 2 == 0)
+                        fprintf(f, "-- " SD_ID128_FORMAT_STR " de\nSubject: de %u\n\n", SD_ID128_FORMAT_VAL(ids[i]), i);
+                if (i % 4 == 0)
+                        fprintf(f, "-- " SD_ID128_FORMAT_STR " de_AT\nSubject: de_AT %u\n\n", SD_ID128_FORMAT_VAL(ids[i]), i);
+        }
+        fclose(f);
+        f = NULL;
+
+        dirs[0] = dir_slash;
+        assert_se(catalog_update(name, NULL, dirs) >= 0);
+        assert_se(catalog_open(name, &c) >= 0);
+
+        /* de_DE.UTF-8 might not be installed */
+        loc = setlocale(LC_MESSAGES, NULL);
+        de = loc && startswith(loc, "de_DE");
+
+        for (i = 0; i < N_IDS; i++) {
+                char expected[LINE_MAX];
+                const char *s;
+
+                snprintf(expected, sizeof(expected), "Subject: %s %u\n",
+                         de && i % 2 == 0 ? "de" : "C", i);
+
+                assert_se(s = catalog_find(c, ids[i]));
+                assert_se(streq(s, expected));
+        }
+
+        assert_se(!catalog_find(c, SD_MESSAGE_COREDUMP));
+
+        catalog_close(c);
+        free(ids);
+        unlink(name);
+        unlink(path);
+        rmdir(dir);
+}
+
 int main(int argc, char *argv[]) {
         _cleanup_free_ char *text = NULL;
         int r;
@@ -118,6 +187,8 @@ int main(int argc, char *argv[]) {
 
         test_catalog_update();
 
+        test_catalog_lookup();
+
         r = catalog_list(stdout, database, true);
         assert_se(r >= 0);
 
@@ -71,6 +71,55 @@ static void verify_contents(sd_journal *j, unsigned skip) {
                 assert_se(i == N_ENTRIES);
 }
 
+static void verify_seek_cursor(sd_journal *j, bool hint) {
+        char **cursors;
+        unsigned i = 0, n;
+
+        assert(j);
+
+        /* Resolves every cursor of the journal once with and once
+         * without the file ID/offset hint */
+
+        assert_se(cursors = new0(char*, N_ENTRIES));
+
+        SD_JOURNAL_FOREACH(j) {
+                char *c;
+
+                assert_se(i < N_ENTRIES);
+                assert_se(sd_journal_get_cursor(j, &c) >= 0);
+
+                if (!hint) {
+                        char *e;
+
+                        e = strstr(c, ";f=");
+                        assert_se(e);
+                        *e = 0;
+                }
+
+                cursors[i++] = c;
+        }
+
+        n = i;
+
+        for (i = 0; i < n; i++) {
+                const void *d;
+                size_t l;
+                char number[LINE_MAX];
+
+                assert_se(sd_journal_seek_cursor(j, cursors[i]) >= 0);
+                assert_se(sd_journal_next(j) > 0);
+                assert_se(sd_journal_test_cursor(j, cursors[i]) > 0);
+
+                snprintf(number, sizeof(number), "NUMBER=%u", i);
+                assert_se(sd_journal_get_data(j, "NUMBER", &d, &l) >= 0);
+                assert_se(l == strlen(number) && memcmp(d, number, l) == 0);
+        }
+
+        for (i = 0; i < n; i++)
+                free(cursors[i]);
+        free(cursors);
+}
+
 int main(int argc, char *argv[]) {
         JournalFile *one, *two, *three;
         char t[] = "/tmp/journal-stream-XXXXXX";
@@ -149,6 +198,20 @@ int main(int argc, char *argv[]) {
 
         verify_contents(j, 1);
 
+        verify_seek_cursor(j, true);
+        verify_seek_cursor(j, false);
+
+        /* A stale hint must not confuse us */
+        assert_se(sd_journal_seek_head(j) >= 0);
+        assert_se(sd_journal_next(j) > 0);
+        assert_se(sd_journal_next(j) > 0);
+        assert_se(sd_journal_get_cursor(j, &z) >= 0);
+        strcpy(strstr(z, ";o="), ";o=8");
+        assert_se(sd_journal_seek_cursor(j, z) >= 0);
+        assert_se(sd_journal_next(j) > 0);
+        assert_se(sd_journal_test_cursor(j, z) > 0);
+        free(z);
+
         printf("NEXT TEST\n");
         assert_se(sd_journal_add_match(j, "MAGIC=quux", 0) >= 0);
 
@@ -65,26 +65,14 @@ static int raw_verify(const char *fn, const char *verification_key) {
         return r;
 }
 
-int main(int argc, char *argv[]) {
-        char t[] = "/tmp/journal-XXXXXX";
-        unsigned n;
+static usec_t generate(const char *fn, bool seal) {
         JournalFile *f;
-        const char *verification_key = argv[1];
-        usec_t from = 0, to = 0, total = 0;
-        char a[FORMAT_TIMESTAMP_MAX];
-        char b[FORMAT_TIMESTAMP_MAX];
-        char c[FORMAT_TIMESPAN_MAX];
-        struct stat st;
-        uint64_t p;
-
-        log_set_max_level(LOG_DEBUG);
-
-        assert_se(mkdtemp(t));
-        assert_se(chdir(t) >= 0);
+        unsigned n;
+        usec_t t;
 
-        log_info("Generating...");
+        assert_se(journal_file_open(fn, O_RDWR|O_CREAT, 0666, true, seal, NULL, NULL, NULL, &f) == 0);
 
-        assert_se(journal_file_open("test.journal", O_RDWR|O_CREAT, 0666, true, !!verification_key, NULL, NULL, NULL, &f) == 0);
+        t = now(CLOCK_MONOTONIC);
 
         for (n = 0; n < N_ENTRIES; n++) {
                 struct iovec iovec;
@@ -103,8 +91,43 @@ int main(int argc, char *argv[]) {
                 free(test);
         }
 
+        t = now(CLOCK_MONOTONIC) - t;
+
         journal_file_close(f);
 
+        return t;
+}
+
+int main(int argc, char *argv[]) {
+        char t[] = "/tmp/journal-XXXXXX";
+        JournalFile *f;
+        const char *verification_key = argv[1];
+        usec_t from = 0, to = 0, total = 0, sealed, unsealed;
+        char a[FORMAT_TIMESTAMP_MAX];
+        char b[FORMAT_TIMESTAMP_MAX];
+        char c[FORMAT_TIMESPAN_MAX];
+        struct stat st;
+        uint64_t p;
+
+        log_set_max_level(LOG_DEBUG);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        log_info("Generating...");
+
+        sealed = generate("test.journal", !!verification_key);
+
+        if (verification_key) {
+                unsealed = generate("unsealed.journal", false);
+
+                log_info("Appending %u entries took %s sealed, and %s unsealed.", N_ENTRIES,
+                         format_timespan(a, sizeof(a), sealed, 1),
+                         format_timespan(b, sizeof(b), unsealed, 1));
+        } else
+                log_info("Appending %u entries took %s.", N_ENTRIES,
+                         format_timespan(a, sizeof(a), sealed, 1));
+
         log_info("Verifying...");
 
         assert_se(journal_file_open("test.journal", O_RDONLY, 0666, true, !!verification_key, NULL, NULL, NULL, &f) == 0);
@@ -32,9 +32,23 @@
 #include "util.h"
 #include "build.h"
 
+/* Number of slots in the per-reader cache of field name objects. There
+ * are only a few dozen distinct field names in a typical journal, so a
+ * small direct-mapped table catches nearly all lookups. */
+#define FIELD_NAME_CACHE_SIZE 64
+
+typedef struct FieldName {
+    char *name;
+    size_t len;
+    PyObject *key;
+} FieldName;
+
 typedef struct {
     PyObject_HEAD
     sd_journal *j;
+    FieldName field_names[FIELD_NAME_CACHE_SIZE];
+    sd_id128_t boot_id;
+    PyObject *boot_id_bytes;
 } Reader;
 static PyTypeObject ReaderType;
 
@@ -80,6 +94,14 @@ static PyStructSequence_Desc Monotonic_desc = {
 
 static void Reader_dealloc(Reader* self)
 {
+    unsigned i;
+
+    for (i = 0; i < FIELD_NAME_CACHE_SIZE; i++) {
+        free(self->field_names[i].name);
+        Py_XDECREF(self->field_names[i].key);
+    }
+    Py_XDECREF(self->boot_id_bytes);
+
     sd_journal_close(self->j);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -336,7 +358,55 @@ static PyObject* Reader_previous(Reader *self, PyObject *args)
 }
 
 
-static int extract(const char* msg, size_t msg_len,
+static unsigned field_name_hash(const char *p, size_t l)
+{
+    unsigned h = 5381;
+
+    while (l-- > 0)
+        h = (h << 5) + h + (unsigned char) *p++;
+
+    return h;
+}
+
+/* Returns a new reference to an interned string object for the field
+ * name, reusing the object from the previous lookup when possible. */
+static PyObject* get_field_name(Reader *self, const char *name, size_t len)
+{
+    FieldName *f;
+    PyObject *k;
+    char *n;
+
+    f = self->field_names + field_name_hash(name, len) % FIELD_NAME_CACHE_SIZE;
+    if (f->key && f->len == len && memcmp(f->name, name, len) == 0) {
+        Py_INCREF(f->key);
+        return f->key;
+    }
+
+    k = unicode_FromStringAndSize(name, len);
+    if (!k)
+        return NULL;
+#if PY_MAJOR_VERSION >= 3
+    PyUnicode_InternInPlace(&k);
+#else
+    PyString_InternInPlace(&k);
+#endif
+
+    n = strndup(name, len);
+    if (!n)
+        /* The cache is only an optimization */
+        return k;
+
+    free(f->name);
+    Py_XDECREF(f->key);
+    f->name = n;
+    f->len = len;
+    Py_INCREF(k);
+    f->key = k;
+
+    return k;
+}
+
+static int extract(Reader *self, const char* msg, size_t msg_len,
                    PyObject **key, PyObject **value) {
     PyObject *k = NULL, *v;
     const char *delim_ptr;
@@ -349,7 +419,7 @@ static int extract(const char* msg, size_t msg_len,
     }
 
     if (key) {
-        k = unicode_FromStringAndSize(msg, delim_ptr - (const char*) msg);
+        k = get_field_name(self, msg, delim_ptr - (const char*) msg);
         if (!k)
             return -1;
     }
@@ -371,6 +441,87 @@ static int extract(const char* msg, size_t msg_len,
     return 0;
 }
 
+/* Stores value under key, turning the value into a list if the
+ * field occurs more than once in the entry. */
+static int add_field(PyObject *dict, PyObject *key, PyObject *value)
+{
+    PyObject *cur_value;
+    _cleanup_Py_DECREF_ PyObject *tmp_list = NULL;
+
+    cur_value = PyDict_GetItem(dict, key);
+    if (!cur_value)
+        return PyDict_SetItem(dict, key, value);
+
+    if (PyList_CheckExact(cur_value))
+        return PyList_Append(cur_value, value);
+
+    tmp_list = PyList_New(0);
+    if (!tmp_list)
+        return -1;
+
+    if (PyList_Append(tmp_list, cur_value) < 0 ||
+        PyList_Append(tmp_list, value) < 0)
+        return -1;
+
+    return PyDict_SetItem(dict, key, tmp_list);
+}
+
+/* Fills dict with the requested fields of the current entry,
+ * fields is NULL or a tuple of field names. */
+static int get_entry_fields(Reader *self, PyObject *fields, PyObject *dict)
+{
+    const void *msg;
+    size_t msg_len;
+    int r;
+
+    if (!fields) {
+        SD_JOURNAL_FOREACH_DATA(self->j, msg, msg_len) {
+            _cleanup_Py_DECREF_ PyObject *key = NULL, *value = NULL;
+
+            r = extract(self, msg, msg_len, &key, &value);
+            if (r < 0)
+                return -1;
+
+            r = add_field(dict, key, value);
+            if (r < 0)
+                return -1;
+        }
+    } else {
+        Py_ssize_t i, n;
+
+        n = PyTuple_Size(fields);
+        for (i = 0; i < n; i++) {
+            PyObject *key = PyTuple_GetItem(fields, i);
+            _cleanup_Py_DECREF_ PyObject *value = NULL;
+            const char *field;
+
+#if PY_MAJOR_VERSION >= 3
+            field = PyUnicode_AsUTF8(key);
+#else
+            field = PyString_AsString(key);
+#endif
+            if (!field)
+                return -1;
+
+            r = sd_journal_get_data(self->j, field, &msg, &msg_len);
+            if (r == -ENOENT)
+                continue;
+            else if (set_error(r, NULL, "field name is not valid"))
+                return -1;
+
+            r = extract(self, msg, msg_len, NULL, &value);
+            if (r < 0)
+                return -1;
+
+            r = PyDict_SetItem(dict, key, value);
+            if (r < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
 PyDoc_STRVAR(Reader_get__doc__,
              "get(str) -> str\n\n"
              "Return data associated with this key in current log entry.\n"
@@ -396,7 +547,7 @@ static PyObject* Reader_get(Reader *self, PyObject *args)
     } else if (set_error(r, NULL, "field name is not valid"))
         return NULL;
 
-    r = extract(msg, msg_len, NULL, &value);
+    r = extract(self, msg, msg_len, NULL, &value);
     if (r < 0)
         return NULL;
     return value;
@@ -409,57 +560,17 @@ PyDoc_STRVAR(Reader_get_all__doc__,
 static PyObject* Reader_get_all(Reader *self, PyObject *args)
 {
     PyObject *dict;
-    const void *msg;
-    size_t msg_len;
-    int r;
 
     dict = PyDict_New();
     if (!dict)
             return NULL;
 
-    SD_JOURNAL_FOREACH_DATA(self->j, msg, msg_len) {
-        _cleanup_Py_DECREF_ PyObject *key = NULL, *value = NULL;
-
-        r = extract(msg, msg_len, &key, &value);
-        if (r < 0)
-            goto error;
-
-        if (PyDict_Contains(dict, key)) {
-            PyObject *cur_value = PyDict_GetItem(dict, key);
-
-            if (PyList_CheckExact(cur_value)) {
-                r = PyList_Append(cur_value, value);
-                if (r < 0)
-                    goto error;
-            } else {
-                _cleanup_Py_DECREF_ PyObject *tmp_list = PyList_New(0);
-                if (!tmp_list)
-                    goto error;
-
-                r = PyList_Append(tmp_list, cur_value);
-                if (r < 0)
-                    goto error;
-
-                r = PyList_Append(tmp_list, value);
-                if (r < 0)
-                    goto error;
-
-                r = PyDict_SetItem(dict, key, tmp_list);
-                if (r < 0)
-                    goto error;
-            }
-        } else {
-            r = PyDict_SetItem(dict, key, value);
-            if (r < 0)
-                goto error;
-        }
+    if (get_entry_fields(self, NULL, dict) < 0) {
+        Py_DECREF(dict);
+        return NULL;
     }
 
     return dict;
-
-error:
-    Py_DECREF(dict);
-    return NULL;
 }
 
 
@@ -508,7 +619,20 @@ static PyObject* Reader_get_monotonic(Reader *self, PyObject *args)
 
     assert_cc(sizeof(unsigned long long) == sizeof(timestamp));
     monotonic = PyLong_FromUnsignedLongLong(timestamp);
-    bootid = PyBytes_FromStringAndSize((const char*) &id.bytes, sizeof(id.bytes));
+
+    /* Consecutive entries almost always share the boot ID */
+    if (!self->boot_id_bytes || !sd_id128_equal(id, self->boot_id)) {
+        bootid = PyBytes_FromStringAndSize((const char*) &id.bytes, sizeof(id.bytes));
+        if (bootid) {
+            Py_XDECREF(self->boot_id_bytes);
+            Py_INCREF(bootid);
+            self->boot_id_bytes = bootid;
+            self->boot_id = id;
+        }
+    } else {
+        bootid = self->boot_id_bytes;
+        Py_INCREF(bootid);
+    }
 #if PY_MAJOR_VERSION >= 3
     tuple = PyStructSequence_New(&MonotonicType);
 #else
@@ -806,6 +930,110 @@ static PyObject* Reader_test_cursor(Reader *self, PyObject *args)
     return PyBool_FromLong(r);
 }
 
+static PyObject *realtime_key, *monotonic_key, *cursor_key;
+
+static int add_entry_metadata(Reader *self, PyObject *dict)
+{
+    _cleanup_Py_DECREF_ PyObject *realtime = NULL, *monotonic = NULL, *cursor = NULL;
+
+    if (!realtime_key) {
+        realtime_key = unicode_FromString("__REALTIME_TIMESTAMP");
+        monotonic_key = unicode_FromString("__MONOTONIC_TIMESTAMP");
+        cursor_key = unicode_FromString("__CURSOR");
+        if (!realtime_key || !monotonic_key || !cursor_key) {
+            Py_CLEAR(realtime_key);
+            Py_CLEAR(monotonic_key);
+            Py_CLEAR(cursor_key);
+            return -1;
+        }
+    }
+
+    realtime = Reader_get_realtime(self, NULL);
+    if (!realtime)
+        return -1;
+
+    monotonic = Reader_get_monotonic(self, NULL);
+    if (!monotonic)
+        return -1;
+
+    cursor = Reader_get_cursor(self, NULL);
+    if (!cursor)
+        return -1;
+
+    if (PyDict_SetItem(dict, realtime_key, realtime) < 0 ||
+        PyDict_SetItem(dict, monotonic_key, monotonic) < 0 ||
+        PyDict_SetItem(dict, cursor_key, cursor) < 0)
+        return -1;
+
+    return 0;
+}
+
+PyDoc_STRVAR(Reader_get_next_batch__doc__,
+             "_get_next_batch(count[, fields]) -> list\n\n"
+             "Advance by up to `count` entries and return them as a list of\n"
+             "dictionaries in the format of _get_all(), each also carrying\n"
+             "the __REALTIME_TIMESTAMP, __MONOTONIC_TIMESTAMP and __CURSOR\n"
+             "fields. If `fields` is given, it must be a sequence of field\n"
+             "names and only the first value of each of those fields is\n"
+             "retrieved. The returned list is shorter than `count` if the\n"
+             "end of the journal was reached.");
+static PyObject* Reader_get_next_batch(Reader *self, PyObject *args, PyObject *keywds)
+{
+    Py_ssize_t count, i;
+    PyObject *fields_arg = Py_None;
+    _cleanup_Py_DECREF_ PyObject *fields = NULL;
+    PyObject *list;
+    int r;
+
+    static const char* const kwlist[] = {"count", "fields", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "n|O:_get_next_batch",
+                                     (char**) kwlist, &count, &fields_arg))
+        return NULL;
+
+    if (count <= 0) {
+        PyErr_SetString(PyExc_ValueError, "count must be positive");
+        return NULL;
+    }
+
+    if (fields_arg != Py_None) {
+        fields = PySequence_Tuple(fields_arg);
+        if (!fields)
+            return NULL;
+    }
+
+    list = PyList_New(0);
+    if (!list)
+        return NULL;
+
+    for (i = 0; i < count; i++) {
+        _cleanup_Py_DECREF_ PyObject *dict = NULL;
+
+        r = sd_journal_next(self->j);
+        if (set_error(r, NULL, NULL) < 0)
+            goto error;
+        if (r == 0)
+            break;
+
+        dict = PyDict_New();
+        if (!dict)
+            goto error;
+
+        if (get_entry_fields(self, fields, dict) < 0 ||
+            add_entry_metadata(self, dict) < 0)
+            goto error;
+
+        if (PyList_Append(list, dict) < 0)
+            goto error;
+    }
+
+    return list;
+
+error:
+    Py_DECREF(list);
+    return NULL;
+}
+
+
 PyDoc_STRVAR(Reader_query_unique__doc__,
              "query_unique(field) -> a set of values\n\n"
              "Return a set of unique values appearing in journal for the\n"
@@ -985,6 +1213,7 @@ static PyMethodDef Reader_methods[] = {
     {"_previous",       (PyCFunction) Reader_previous, METH_VARARGS, Reader_previous__doc__},
     {"_get",            (PyCFunction) Reader_get, METH_VARARGS, Reader_get__doc__},
     {"_get_all",        (PyCFunction) Reader_get_all, METH_NOARGS, Reader_get_all__doc__},
+    {"_get_next_batch", (PyCFunction) Reader_get_next_batch, METH_VARARGS|METH_KEYWORDS, Reader_get_next_batch__doc__},
     {"_get_realtime",   (PyCFunction) Reader_get_realtime, METH_NOARGS, Reader_get_realtime__doc__},
     {"_get_monotonic",  (PyCFunction) Reader_get_monotonic, METH_NOARGS, Reader_get_monotonic__doc__},
     {"add_match",       (PyCFunction) Reader_add_match, METH_VARARGS|METH_KEYWORDS, Reader_add_match__doc__},
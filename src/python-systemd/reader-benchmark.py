@@ -0,0 +1,64 @@
+#  -*- Mode: python; coding: utf-8; indent-tabs-mode: nil -*- */
+#
+#  This file is part of systemd.
+#
+#  systemd is free software; you can redistribute it and/or modify it
+#  under the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation; either version 2.1 of the License, or
+#  (at your option) any later version.
+#
+#  systemd is distributed in the hope that it will be useful, but
+#  WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+#  Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+
+# Compare the entry-at-a-time and batched interfaces of the journal
+# reader. Usage: reader-benchmark.py [DIRECTORY [BATCH-SIZE]]
+
+from __future__ import print_function
+
+import sys
+import time
+from systemd import journal
+
+def open_reader(path):
+    if path:
+        return journal._Reader(path=path)
+    return journal._Reader()
+
+def single(j, fields):
+    n = 0
+    while j._next():
+        entry = j._get_all()
+        entry['__REALTIME_TIMESTAMP'] = j._get_realtime()
+        entry['__MONOTONIC_TIMESTAMP'] = j._get_monotonic()
+        entry['__CURSOR'] = j._get_cursor()
+        n += 1
+    return n
+
+def batched(j, fields):
+    n = 0
+    while True:
+        entries = j._get_next_batch(batch_size, fields)
+        n += len(entries)
+        if len(entries) < batch_size:
+            return n
+
+def run(name, func, fields=None):
+    j = open_reader(path)
+    start = time.time()
+    n = func(j, fields)
+    elapsed = time.time() - start
+    j.close()
+    print('{:<24} {:>10} entries {:>12.0f} entries/s'.format(
+        name, n, n / elapsed if elapsed > 0 else 0))
+
+path = sys.argv[1] if len(sys.argv) > 1 else None
+batch_size = int(sys.argv[2]) if len(sys.argv) > 2 else 1024
+
+run('_next() + _get_all()', single)
+run('_get_next_batch()', batched)
+run('_get_next_batch(fields)', batched, ('MESSAGE', 'PRIORITY'))
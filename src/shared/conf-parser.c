@@ -298,55 +298,103 @@ static int parse_line(const char* unit,
                                userdata);
 }
 
-/* Go through the file and parse each line */
-int config_parse(const char *unit,
-                 const char *filename,
-                 FILE *f,
-                 const char *sections,
-                 ConfigItemLookup lookup,
-                 void *table,
-                 bool relaxed,
-                 bool allow_include,
-                 void *userdata) {
+void config_file_free(ConfigFile *c) {
+        unsigned i;
+
+        if (!c)
+                return;
+
+        for (i = 0; i < c->n_lines; i++)
+                free(c->lines[i].text);
+
+        free(c->lines);
+        free(c->filename);
+        free(c);
+}
+
+static int config_file_push(ConfigFile *c, size_t *allocated, unsigned line, const char *l) {
+        char *t;
+
+        /* parse_line() would ignore these anyway */
+        if (!*l || strchr(COMMENTS "\n", *l))
+                return 0;
+
+        if (!GREEDY_REALLOC(c->lines, *allocated, c->n_lines + 1))
+                return -ENOMEM;
+
+        t = strdup(l);
+        if (!t)
+                return -ENOMEM;
+
+        c->lines[c->n_lines].line = line;
+        c->lines[c->n_lines].text = t;
+        c->n_lines++;
 
-        _cleanup_free_ char *section = NULL, *continuation = NULL;
+        return 0;
+}
+
+/* Read a configuration file, without interpreting it */
+int config_file_read(const char *filename, FILE *f, ConfigFile **ret) {
+        _cleanup_free_ char *continuation = NULL;
         _cleanup_fclose_ FILE *ours = NULL;
+        ConfigFile *c;
+        size_t allocated = 0;
         unsigned line = 0;
+        struct stat st;
         int r;
 
         assert(filename);
-        assert(lookup);
+        assert(ret);
 
         if (!f) {
                 f = ours = fopen(filename, "re");
-                if (!f) {
-                        log_error("Failed to open configuration file '%s': %m", filename);
+                if (!f)
                         return -errno;
-                }
+        }
+
+        if (fstat(fileno(f), &st) < 0)
+                return -errno;
+
+        c = new0(ConfigFile, 1);
+        if (!c)
+                return -ENOMEM;
+
+        c->dev = st.st_dev;
+        c->ino = st.st_ino;
+        c->mtime = timespec_load(&st.st_mtim);
+        c->size = st.st_size;
+
+        c->filename = strdup(filename);
+        if (!c->filename) {
+                r = -ENOMEM;
+                goto fail;
         }
 
         while (!feof(f)) {
-                char l[LINE_MAX], *p, *c = NULL, *e;
+                char l[LINE_MAX], *p, *e;
+                _cleanup_free_ char *j = NULL;
                 bool escaped = false;
 
                 if (!fgets(l, sizeof(l), f)) {
                         if (feof(f))
                                 break;
 
-                        log_error("Failed to read configuration file '%s': %m", filename);
-                        return -errno;
+                        r = -errno;
+                        goto fail;
                 }
 
                 truncate_nl(l);
 
                 if (continuation) {
-                        c = strappend(continuation, l);
-                        if (!c)
-                                return -ENOMEM;
+                        j = strappend(continuation, l);
+                        if (!j) {
+                                r = -ENOMEM;
+                                goto fail;
+                        }
 
                         free(continuation);
                         continuation = NULL;
-                        p = c;
+                        p = j;
                 } else
                         p = l;
 
@@ -360,30 +408,99 @@ int config_parse(const char *unit,
                 if (escaped) {
                         *(e-1) = ' ';
 
-                        if (c)
-                                continuation = c;
-                        else {
+                        if (j) {
+                                continuation = j;
+                                j = NULL;
+                        } else {
                                 continuation = strdup(l);
-                                if (!continuation)
-                                        return -ENOMEM;
+                                if (!continuation) {
+                                        r = -ENOMEM;
+                                        goto fail;
+                                }
                         }
 
                         continue;
                 }
 
+                r = config_file_push(c, &allocated, ++line, strstrip(p));
+                if (r < 0)
+                        goto fail;
+        }
+
+        *ret = c;
+        return 0;
+
+fail:
+        config_file_free(c);
+        return r;
+}
+
+bool config_file_is_current(const ConfigFile *c, const struct stat *st) {
+        assert(c);
+        assert(st);
+
+        return
+                c->dev == st->st_dev &&
+                c->ino == st->st_ino &&
+                c->mtime == timespec_load(&st->st_mtim) &&
+                c->size == st->st_size;
+}
+
+/* Compares the contents only, not where they were read from */
+bool config_file_equal(const ConfigFile *a, const ConfigFile *b) {
+        unsigned i;
+
+        assert(a);
+        assert(b);
+
+        if (a->n_lines != b->n_lines)
+                return false;
+
+        for (i = 0; i < a->n_lines; i++)
+                if (a->lines[i].line != b->lines[i].line ||
+                    !streq(a->lines[i].text, b->lines[i].text))
+                        return false;
+
+        return true;
+}
+
+/* Apply a configuration file read earlier */
+int config_file_parse(const char *unit,
+                      const ConfigFile *c,
+                      const char *sections,
+                      ConfigItemLookup lookup,
+                      void *table,
+                      bool relaxed,
+                      bool allow_include,
+                      void *userdata) {
+
+        _cleanup_free_ char *section = NULL;
+        unsigned i;
+        int r;
+
+        assert(c);
+        assert(lookup);
+
+        for (i = 0; i < c->n_lines; i++) {
+                _cleanup_free_ char *l = NULL;
+
+                /* parse_line() modifies the line, but c must stay
+                 * untouched */
+                l = strdup(c->lines[i].text);
+                if (!l)
+                        return -ENOMEM;
+
                 r = parse_line(unit,
-                               filename,
-                               ++line,
+                               c->filename,
+                               c->lines[i].line,
                                sections,
                                lookup,
                                table,
                                relaxed,
                                allow_include,
                                &section,
-                               p,
+                               l,
                                userdata);
-                free(c);
-
                 if (r < 0)
                         return r;
         }
@@ -391,6 +508,44 @@ int config_parse(const char *unit,
         return 0;
 }
 
+/* Go through the file and parse each line */
+int config_parse(const char *unit,
+                 const char *filename,
+                 FILE *f,
+                 const char *sections,
+                 ConfigItemLookup lookup,
+                 void *table,
+                 bool relaxed,
+                 bool allow_include,
+                 void *userdata) {
+
+        _cleanup_fclose_ FILE *ours = NULL;
+        ConfigFile *c;
+        int r;
+
+        assert(filename);
+        assert(lookup);
+
+        if (!f) {
+                f = ours = fopen(filename, "re");
+                if (!f) {
+                        log_error("Failed to open configuration file '%s': %m", filename);
+                        return -errno;
+                }
+        }
+
+        r = config_file_read(filename, f, &c);
+        if (r < 0) {
+                log_error("Failed to read configuration file '%s': %s", filename, strerror(-r));
+                return r;
+        }
+
+        r = config_file_parse(unit, c, sections, lookup, table, relaxed, allow_include, userdata);
+        config_file_free(c);
+
+        return r;
+}
+
 #define DEFINE_PARSER(type, vartype, conv_func)                         \
         int config_parse_##type(const char *unit,                       \
                                 const char *filename,                   \
@@ -23,8 +23,10 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <sys/stat.h>
 
 #include "macro.h"
+#include "time-util.h"
 
 /* An abstract parser for simple, line based, shallow configuration
  * files consisting of variable assignments only. */
@@ -90,6 +92,43 @@ int config_parse(const char *unit,
                  bool allow_include,
                  void *userdata);
 
+/* A configuration file as read from disk, with comments and empty
+ * lines dropped and continuation lines joined, but nothing
+ * interpreted yet. Reading does not log and may hence be done from
+ * any thread; the result is immutable and may be applied any number
+ * of times. */
+typedef struct ConfigLine {
+        unsigned line;
+        char *text;
+} ConfigLine;
+
+typedef struct ConfigFile {
+        char *filename;
+
+        /* Identifies the file contents this was read from */
+        dev_t dev;
+        ino_t ino;
+        usec_t mtime;
+        off_t size;
+
+        ConfigLine *lines;
+        unsigned n_lines;
+} ConfigFile;
+
+int config_file_read(const char *filename, FILE *f, ConfigFile **ret);
+void config_file_free(ConfigFile *c);
+bool config_file_is_current(const ConfigFile *c, const struct stat *st);
+bool config_file_equal(const ConfigFile *a, const ConfigFile *b);
+
+int config_file_parse(const char *unit,
+                      const ConfigFile *c,
+                      const char *sections,  /* nulstr */
+                      ConfigItemLookup lookup,
+                      void *table,
+                      bool relaxed,
+                      bool allow_include,
+                      void *userdata);
+
 /* Generic parsers */
 int config_parse_int(const char *unit, const char *filename, unsigned line, const char *section, const char *lvalue, int ltype, const char *rvalue, void *data, void *userdata);
 int config_parse_unsigned(const char *unit, const char *filename, unsigned line, const char *section, const char *lvalue, int ltype, const char *rvalue, void *data, void *userdata);
@@ -29,7 +29,12 @@
 
 #define DEFAULT_EXIT_USEC (5*USEC_PER_MINUTE)
 
+#define DEFAULT_TIMER_ACCURACY_USEC (250*USEC_PER_MSEC)
+
+#define DEFAULT_GENERATOR_TIMEOUT_USEC (10*USEC_PER_SEC)
+
 #define SYSTEMD_CGROUP_CONTROLLER "name=systemd"
+#define SYSTEMD_CGROUP_AGENT_SOCKET "/run/systemd/cgroups-agent"
 
 #define SIGNALS_CRASH_HANDLER SIGSEGV,SIGILL,SIGFPE,SIGBUS,SIGQUIT,SIGABRT
 #define SIGNALS_IGNORE SIGKILL,SIGPIPE
@@ -44,11 +44,24 @@ typedef struct {
         Hashmap *have_installed;
 } InstallContext;
 
+/* Set by the manager, which keeps it up to date. Paths not covered
+ * by it are looked up on disk. */
+static PathCache *unit_file_path_cache = NULL;
+
 #define _cleanup_lookup_paths_free_ \
         __attribute__((cleanup(lookup_paths_free)))
 #define _cleanup_install_context_done_ \
         __attribute__((cleanup(install_context_done)))
 
+void unit_file_set_path_cache(PathCache *cache) {
+        unit_file_path_cache = cache;
+}
+
+static void flush_path_cache(void) {
+        if (unit_file_path_cache)
+                path_cache_flush(unit_file_path_cache);
+}
+
 static int lookup_paths_init_from_scope(LookupPaths *paths, UnitFileScope scope) {
         assert(paths);
         assert(scope >= 0);
@@ -1004,6 +1017,9 @@ static int unit_file_load(
         assert(info);
         assert(path);
 
+        if (path_cache_lookup(unit_file_path_cache, path) == 0)
+                return -ENOENT;
+
         fd = open(path, O_RDONLY|O_CLOEXEC|O_NOCTTY|(allow_symlink ? 0 : O_NOFOLLOW));
         if (fd < 0)
                 return -errno;
@@ -1044,6 +1060,8 @@ static int unit_file_search(
 
         assert(info->name);
 
+        flush_path_cache();
+
         STRV_FOREACH(p, paths->unit_path) {
                 char *path = NULL;
 
@@ -1595,6 +1613,8 @@ UnitFileState unit_file_get_state(
         if (r < 0)
                 return r;
 
+        flush_path_cache();
+
         STRV_FOREACH(i, paths.unit_path) {
                 struct stat st;
 
@@ -1609,6 +1629,11 @@ UnitFileState unit_file_get_state(
                 if (!path)
                         return -ENOMEM;
 
+                if (path_cache_lookup(unit_file_path_cache, path) == 0) {
+                        r = -ENOENT;
+                        continue;
+                }
+
                 if (lstat(path, &st) < 0) {
                         r = -errno;
                         if (errno == ENOENT)
@@ -22,6 +22,7 @@
 ***/
 
 #include "hashmap.h"
+#include "path-cache.h"
 
 typedef enum UnitFileScope {
         UNIT_FILE_SYSTEM,
@@ -81,6 +82,8 @@ int unit_file_preset(UnitFileScope scope, bool runtime, const char *root_dir, ch
 int unit_file_mask(UnitFileScope scope, bool runtime, const char *root_dir, char *files[], bool force, UnitFileChange **changes, unsigned *n_changes);
 int unit_file_unmask(UnitFileScope scope, bool runtime, const char *root_dir, char *files[], UnitFileChange **changes, unsigned *n_changes);
 
+void unit_file_set_path_cache(PathCache *cache);
+
 UnitFileState unit_file_get_state(UnitFileScope scope, const char *root_dir, const char *filename);
 
 int unit_file_get_list(UnitFileScope scope, const char *root_dir, Hashmap *h);
@@ -79,6 +79,10 @@ static inline size_t ALIGN_TO(size_t l, size_t ali) {
 
 #define ELEMENTSOF(x) (sizeof(x)/sizeof((x)[0]))
 
+/* Forces a single read from memory, for variables other processes
+ * might modify concurrently, e.g. in shared mappings */
+#define ACCESS_ONCE(x) (*(volatile typeof(x) *) &(x))
+
 /*
  * container_of - cast a member of a structure out to the containing structure
  * @ptr: the pointer to the member.
@@ -0,0 +1,374 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mount-table.h"
+#include "hashmap.h"
+#include "set.h"
+#include "strv.h"
+#include "util.h"
+
+struct MountTable {
+        /* In file order */
+        MountTableEntry **entries;
+        size_t entries_allocated;
+        unsigned n_entries;
+
+        /* mount id => MountTableEntry */
+        Hashmap *by_id;
+
+        unsigned generation;
+
+        MountTableEntry **changed;
+        size_t changed_allocated;
+        unsigned n_changed;
+
+        char **removed;
+};
+
+static void mount_table_entry_free(MountTableEntry *e) {
+        if (!e)
+                return;
+
+        free(e->line);
+        free(e->what);
+        free(e->where);
+        free(e->options);
+        free(e->fstype);
+        free(e);
+}
+
+static int mount_table_entry_new(const char *line, MountTableEntry **ret) {
+        _cleanup_free_ char *path = NULL, *options = NULL, *options2 = NULL, *fstype = NULL, *device = NULL;
+        MountTableEntry *e;
+        unsigned id;
+
+        assert(line);
+        assert(ret);
+
+        if (sscanf(line,
+                   "%u "        /* (1) mount id */
+                   "%*s "       /* (2) parent id */
+                   "%*s "       /* (3) major:minor */
+                   "%*s "       /* (4) root */
+                   "%ms "       /* (5) mount point */
+                   "%ms"        /* (6) mount options */
+                   "%*[^-]"     /* (7) optional fields */
+                   "- "         /* (8) separator */
+                   "%ms "       /* (9) file system type */
+                   "%ms"        /* (10) mount source */
+                   "%ms",       /* (11) mount options 2 */
+                   &id,
+                   &path,
+                   &options,
+                   &fstype,
+                   &device,
+                   &options2) != 6)
+                return -EINVAL;
+
+        e = new0(MountTableEntry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        e->id = id;
+        e->line = strdup(line);
+        e->what = cunescape(device);
+        e->where = cunescape(path);
+        e->options = strjoin(options, ",", options2, NULL);
+        e->fstype = fstype;
+        fstype = NULL;
+
+        if (!e->line || !e->what || !e->where || !e->options) {
+                mount_table_entry_free(e);
+                return -ENOMEM;
+        }
+
+        *ret = e;
+        return 0;
+}
+
+int mount_table_new(MountTable **ret) {
+        MountTable *t;
+
+        assert(ret);
+
+        t = new0(MountTable, 1);
+        if (!t)
+                return -ENOMEM;
+
+        t->by_id = hashmap_new(trivial_hash_func, trivial_compare_func);
+        if (!t->by_id) {
+                free(t);
+                return -ENOMEM;
+        }
+
+        *ret = t;
+        return 0;
+}
+
+void mount_table_clear(MountTable *t) {
+        unsigned k;
+
+        assert(t);
+
+        for (k = 0; k < t->n_entries; k++)
+                mount_table_entry_free(t->entries[k]);
+        t->n_entries = 0;
+
+        hashmap_clear(t->by_id);
+
+        t->n_changed = 0;
+        strv_free(t->removed);
+        t->removed = NULL;
+}
+
+void mount_table_free(MountTable *t) {
+        if (!t)
+                return;
+
+        mount_table_clear(t);
+
+        free(t->entries);
+        hashmap_free(t->by_id);
+        free(t->changed);
+        free(t);
+}
+
+unsigned mount_table_size(MountTable *t) {
+        assert(t);
+
+        return t->n_entries;
+}
+
+static int mount_table_add_changed(MountTable *t, MountTableEntry *e) {
+        assert(t);
+        assert(e);
+
+        if (!GREEDY_REALLOC(t->changed, t->changed_allocated, t->n_changed + 1))
+                return -ENOMEM;
+
+        t->changed[t->n_changed++] = e;
+        return 0;
+}
+
+/* Finds the entry for an unchanged line, first right where we are in
+ * the old table, then by its mount ID */
+static MountTableEntry *mount_table_find_unchanged(MountTable *t, unsigned *cursor, unsigned id, const char *line) {
+        MountTableEntry *e;
+
+        assert(t);
+        assert(cursor);
+        assert(line);
+
+        if (*cursor < t->n_entries) {
+                e = t->entries[*cursor];
+
+                if (e->generation != t->generation && streq(e->line, line)) {
+                        (*cursor)++;
+                        return e;
+                }
+        }
+
+        e = hashmap_get(t->by_id, UINT_TO_PTR(id));
+        if (e && e->generation != t->generation && streq(e->line, line)) {
+                *cursor = e->idx + 1;
+                return e;
+        }
+
+        return NULL;
+}
+
+int mount_table_update(MountTable *t, FILE *f) {
+        _cleanup_free_ MountTableEntry **entries = NULL;
+        _cleanup_free_ char *line = NULL;
+        _cleanup_set_free_ Set *gone = NULL;
+        size_t allocated = 0, size = 0;
+        unsigned n_entries = 0, cursor = 0, n, k;
+        int r;
+
+        assert(t);
+        assert(f);
+
+        t->n_changed = 0;
+        strv_free(t->removed);
+        t->removed = NULL;
+
+        /* Entries that are part of the new table are tagged with the
+         * new generation */
+        t->generation++;
+
+        rewind(f);
+
+        for (n = 1;; n++) {
+                MountTableEntry *e;
+                ssize_t l;
+                unsigned id;
+
+                errno = 0;
+                l = getline(&line, &size, f);
+                if (l < 0) {
+                        if (ferror(f)) {
+                                r = errno ? -errno : -EIO;
+                                goto fail;
+                        }
+
+                        break;
+                }
+
+                if (l > 0 && line[l-1] == '\n')
+                        line[l-1] = 0;
+
+                if (sscanf(line, "%u", &id) != 1) {
+                        log_warning("Failed to parse /proc/self/mountinfo:%u.", n);
+                        continue;
+                }
+
+                if (!GREEDY_REALLOC(entries, allocated, n_entries + 1)) {
+                        r = -ENOMEM;
+                        goto fail;
+                }
+
+                e = mount_table_find_unchanged(t, &cursor, id, line);
+                if (e)
+                        e->changed = false;
+                else {
+                        r = mount_table_entry_new(line, &e);
+                        if (r == -EINVAL) {
+                                log_warning("Failed to parse /proc/self/mountinfo:%u.", n);
+                                continue;
+                        }
+                        if (r < 0)
+                                goto fail;
+
+                        e->changed = true;
+                        e->generation = t->generation;
+                        entries[n_entries++] = e;
+
+                        r = hashmap_replace(t->by_id, UINT_TO_PTR(id), e);
+                        if (r < 0)
+                                goto fail;
+
+                        r = mount_table_add_changed(t, e);
+                        if (r < 0)
+                                goto fail;
+
+                        continue;
+                }
+
+                e->generation = t->generation;
+                entries[n_entries++] = e;
+        }
+
+        /* Whatever is left over from the last time is gone */
+        for (k = 0; k < t->n_entries; k++) {
+                MountTableEntry *e = t->entries[k], *other;
+
+                if (e->generation == t->generation)
+                        continue;
+
+                /* A mount that merely changed its options does not
+                 * leave its mount point */
+                other = hashmap_get(t->by_id, UINT_TO_PTR(e->id));
+                if (other == e)
+                        hashmap_remove(t->by_id, UINT_TO_PTR(e->id));
+                else if (streq(other->where, e->where))
+                        continue;
+
+                if (!gone) {
+                        gone = set_new(string_hash_func, string_compare_func);
+                        if (!gone) {
+                                r = -ENOMEM;
+                                goto fail;
+                        }
+                }
+
+                if (set_get(gone, e->where))
+                        continue;
+
+                r = set_put(gone, e->where);
+                if (r < 0)
+                        goto fail;
+
+                r = strv_extend(&t->removed, e->where);
+                if (r < 0)
+                        goto fail;
+        }
+
+        /* The entries still left on these mount points need to be
+         * applied again, in file order, since the last one for each
+         * mount point wins */
+        if (gone) {
+                t->n_changed = 0;
+
+                for (k = 0; k < n_entries; k++) {
+                        if (!entries[k]->changed && !set_get(gone, entries[k]->where))
+                                continue;
+
+                        r = mount_table_add_changed(t, entries[k]);
+                        if (r < 0)
+                                goto fail;
+                }
+        }
+
+        for (k = 0; k < t->n_entries; k++)
+                if (t->entries[k]->generation != t->generation)
+                        mount_table_entry_free(t->entries[k]);
+
+        for (k = 0; k < n_entries; k++)
+                entries[k]->idx = k;
+
+        free(t->entries);
+        t->entries = entries;
+        t->entries_allocated = allocated;
+        t->n_entries = n_entries;
+        entries = NULL;
+
+        return 0;
+
+fail:
+        /* Drop the entries that were new in this round, the others
+         * are still in the old table */
+        for (k = 0; k < n_entries; k++)
+                if (entries[k]->changed)
+                        mount_table_entry_free(entries[k]);
+
+        mount_table_clear(t);
+
+        return r;
+}
+
+MountTableEntry **mount_table_get_changed(MountTable *t, unsigned *n) {
+        assert(t);
+        assert(n);
+
+        *n = t->n_changed;
+        return t->changed;
+}
+
+char **mount_table_get_removed(MountTable *t) {
+        assert(t);
+
+        return t->removed;
+}
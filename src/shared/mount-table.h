@@ -0,0 +1,81 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "macro.h"
+
+/* A copy of /proc/self/mountinfo, keyed by mount ID, so that
+ * rereading it yields only the entries that were added, changed or
+ * removed since the last time. Unchanged lines are compared as
+ * strings and not parsed again. */
+
+typedef struct MountTable MountTable;
+
+typedef struct MountTableEntry {
+        unsigned id;
+        char *line;
+
+        /* Unescaped */
+        char *what;
+        char *where;
+
+        /* Per mount and per superblock options, joined */
+        char *options;
+        char *fstype;
+
+        /* Added or changed in the last update */
+        bool changed;
+
+        /* Bookkeeping of the table */
+        unsigned idx;
+        unsigned generation;
+} MountTableEntry;
+
+int mount_table_new(MountTable **ret);
+void mount_table_free(MountTable *t);
+
+/* Forgets all entries, so that the next update reports everything
+ * as new */
+void mount_table_clear(MountTable *t);
+
+unsigned mount_table_size(MountTable *t) _pure_;
+
+/* Rereads the table from the start of the file. On failure the
+ * table is cleared. */
+int mount_table_update(MountTable *t, FILE *f);
+
+/* The entries that were added or changed in the last update, plus
+ * all entries for mount points that lost one, in file order. Valid
+ * until the next update. */
+MountTableEntry **mount_table_get_changed(MountTable *t, unsigned *n);
+
+/* The mount points that lost an entry in the last update */
+char **mount_table_get_removed(MountTable *t);
+
+static inline void mount_table_freep(MountTable **t) {
+        mount_table_free(*t);
+}
+
+#define _cleanup_mount_table_free_ _cleanup_(mount_table_freep)
@@ -0,0 +1,660 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "path-cache.h"
+#include "hashmap.h"
+#include "set.h"
+#include "strv.h"
+#include "util.h"
+#include "log.h"
+
+#define ROOT_MASK (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR)
+#define ANCESTOR_MASK (IN_CREATE|IN_MOVED_TO|IN_ONLYDIR|IN_MASK_ADD)
+
+typedef struct PathCacheDir {
+        char *path;
+        int wd;
+
+        /* The names of the entries of this directory */
+        Set *entries;
+
+        /* One of the roots, as opposed to one of their
+         * subdirectories */
+        bool root:1;
+
+        /* A root that does not exist */
+        bool missing:1;
+} PathCacheDir;
+
+struct PathCache {
+        int fd;
+
+        char **roots;
+
+        Hashmap *dirs;
+        Hashmap *dirs_by_wd;
+
+        /* Watches on the closest existing parents of missing roots,
+         * mapped to the names of the entries that lead to them */
+        Hashmap *ancestors;
+
+        /* Unset when we lost track, in which case nothing is known
+         * until the next flush */
+        bool valid;
+
+        /* Bumped whenever an entry comes or goes */
+        unsigned generation;
+};
+
+static void dir_free(PathCache *c, PathCacheDir *d) {
+        assert(c);
+
+        if (!d)
+                return;
+
+        hashmap_remove_value(c->dirs, d->path, d);
+
+        if (d->wd >= 0) {
+                if (hashmap_remove_value(c->dirs_by_wd, INT_TO_PTR(d->wd), d))
+                        inotify_rm_watch(c->fd, d->wd);
+        }
+
+        set_free_free(d->entries);
+        free(d->path);
+        free(d);
+}
+
+static void path_cache_clear(PathCache *c) {
+        PathCacheDir *d;
+        void *k;
+
+        assert(c);
+
+        c->generation++;
+
+        while ((d = hashmap_first(c->dirs)))
+                dir_free(c, d);
+
+        while ((k = hashmap_first_key(c->ancestors))) {
+                strv_free(hashmap_remove(c->ancestors, k));
+                inotify_rm_watch(c->fd, PTR_TO_INT(k));
+        }
+}
+
+int path_cache_new(PathCache **ret) {
+        PathCache *c;
+
+        assert(ret);
+
+        c = new0(PathCache, 1);
+        if (!c)
+                return -ENOMEM;
+
+        c->dirs = hashmap_new(string_hash_func, string_compare_func);
+        c->dirs_by_wd = hashmap_new(trivial_hash_func, trivial_compare_func);
+        c->ancestors = hashmap_new(trivial_hash_func, trivial_compare_func);
+        if (!c->dirs || !c->dirs_by_wd || !c->ancestors) {
+                path_cache_free(c);
+                return -ENOMEM;
+        }
+
+        c->fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if (c->fd < 0) {
+                int r = -errno;
+
+                path_cache_free(c);
+                return r;
+        }
+
+        *ret = c;
+        return 0;
+}
+
+void path_cache_free(PathCache *c) {
+        if (!c)
+                return;
+
+        if (c->dirs)
+                path_cache_clear(c);
+
+        hashmap_free(c->dirs);
+        hashmap_free(c->dirs_by_wd);
+        hashmap_free(c->ancestors);
+        strv_free(c->roots);
+
+        if (c->fd >= 0)
+                close_nointr_nofail(c->fd);
+
+        free(c);
+}
+
+int path_cache_fd(PathCache *c) {
+        assert(c);
+
+        return c->fd;
+}
+
+static int watch_ancestor(PathCache *c, const char *path) {
+        _cleanup_free_ char *p = NULL, *name = NULL;
+        char **l;
+        int wd, r;
+
+        assert(c);
+        assert(path);
+
+        p = strdup(path);
+        if (!p)
+                return -ENOMEM;
+
+        /* Wait for the missing directory to show up, i.e. for the
+         * next component of its path to be created in the closest
+         * parent that exists */
+        for (;;) {
+                char *e;
+
+                e = strrchr(p, '/');
+                if (!e || e[1] == 0)
+                        return -EINVAL;
+
+                free(name);
+                name = strdup(e + 1);
+                if (!name)
+                        return -ENOMEM;
+
+                if (e == p)
+                        e[1] = 0;
+                else
+                        e[0] = 0;
+
+                wd = inotify_add_watch(c->fd, p, ANCESTOR_MASK);
+                if (wd >= 0)
+                        break;
+
+                if (errno != ENOENT || streq(p, "/"))
+                        return -errno;
+        }
+
+        /* Several missing roots may share the same parent */
+        l = hashmap_get(c->ancestors, INT_TO_PTR(wd));
+        if (strv_contains(l, name))
+                return 0;
+
+        if (!l) {
+                l = strv_new(name, NULL);
+                if (!l)
+                        return -ENOMEM;
+
+                r = hashmap_put(c->ancestors, INT_TO_PTR(wd), l);
+                if (r < 0)
+                        strv_free(l);
+
+                return r;
+        }
+
+        r = strv_extend(&l, name);
+        if (r < 0)
+                return r;
+
+        return hashmap_replace(c->ancestors, INT_TO_PTR(wd), l);
+}
+
+static int add_entry(PathCache *c, PathCacheDir *d, const char *name, bool is_dir);
+
+static int add_dir(PathCache *c, const char *path, bool root) {
+        _cleanup_closedir_ DIR *dir = NULL;
+        PathCacheDir *d;
+        int r;
+
+        assert(c);
+        assert(path);
+
+        if (hashmap_get(c->dirs, path))
+                return 0;
+
+        d = new0(PathCacheDir, 1);
+        if (!d)
+                return -ENOMEM;
+
+        d->wd = -1;
+        d->root = root;
+        d->path = strdup(path);
+        d->entries = set_new(string_hash_func, string_compare_func);
+        if (!d->path || !d->entries) {
+                r = -ENOMEM;
+                goto fail;
+        }
+
+        r = hashmap_put(c->dirs, d->path, d);
+        if (r < 0)
+                goto fail;
+
+        /* Watch first, so that nothing gets lost between reading
+         * the directory and watching it */
+        d->wd = inotify_add_watch(c->fd, path, ROOT_MASK);
+        if (d->wd < 0) {
+                if (errno == ENOENT && root) {
+                        d->missing = true;
+                        r = watch_ancestor(c, path);
+                        if (r < 0)
+                                goto fail;
+
+                        return 0;
+                }
+
+                /* Unknown then, we'll ask the file system */
+                r = errno == ENOMEM ? -ENOMEM : 0;
+                goto fail;
+        }
+
+        /* Two paths for the same directory, we cannot tell their
+         * events apart. Don't cache the second one. */
+        r = hashmap_put(c->dirs_by_wd, INT_TO_PTR(d->wd), d);
+        if (r < 0) {
+                d->wd = -1;
+                if (r == -EEXIST)
+                        r = 0;
+                goto fail;
+        }
+
+        dir = opendir(path);
+        if (!dir) {
+                r = errno == ENOENT ? 0 : -errno;
+                goto fail;
+        }
+
+        for (;;) {
+                struct dirent *de;
+                union dirent_storage buf;
+                bool is_dir;
+
+                r = readdir_r(dir, &buf.de, &de);
+                if (r != 0) {
+                        r = -r;
+                        goto fail;
+                }
+
+                if (!de)
+                        break;
+
+                if (ignore_file(de->d_name))
+                        continue;
+
+                if (!root)
+                        is_dir = false;
+                else if (de->d_type == DT_DIR)
+                        is_dir = true;
+                else if (de->d_type == DT_UNKNOWN || de->d_type == DT_LNK) {
+                        struct stat st;
+
+                        is_dir =
+                                fstatat(dirfd(dir), de->d_name, &st, 0) >= 0 &&
+                                S_ISDIR(st.st_mode);
+                } else
+                        is_dir = false;
+
+                r = add_entry(c, d, de->d_name, is_dir);
+                if (r < 0)
+                        goto fail;
+        }
+
+        return 0;
+
+fail:
+        dir_free(c, d);
+        return r;
+}
+
+static int add_entry(PathCache *c, PathCacheDir *d, const char *name, bool is_dir) {
+        _cleanup_free_ char *p = NULL;
+        char *n;
+        int r;
+
+        assert(c);
+        assert(d);
+        assert(name);
+
+        if (!set_get(d->entries, (char*) name)) {
+                n = strdup(name);
+                if (!n)
+                        return -ENOMEM;
+
+                r = set_consume(d->entries, n);
+                if (r < 0)
+                        return r;
+
+                c->generation++;
+        }
+
+        /* Only one level of subdirectories */
+        if (!d->root || !is_dir)
+                return 0;
+
+        p = strjoin(d->path, "/", name, NULL);
+        if (!p)
+                return -ENOMEM;
+
+        return add_dir(c, p, false);
+}
+
+static void remove_entry(PathCache *c, PathCacheDir *d, const char *name) {
+        _cleanup_free_ char *p = NULL;
+
+        assert(c);
+        assert(d);
+        assert(name);
+
+        free(set_remove(d->entries, (char*) name));
+        c->generation++;
+
+        if (!d->root)
+                return;
+
+        p = strjoin(d->path, "/", name, NULL);
+        if (!p) {
+                c->valid = false;
+                return;
+        }
+
+        dir_free(c, hashmap_get(c->dirs, p));
+}
+
+static int path_cache_rebuild(PathCache *c) {
+        char **i;
+        int r;
+
+        assert(c);
+
+        path_cache_clear(c);
+        c->valid = true;
+
+        STRV_FOREACH(i, c->roots) {
+                r = add_dir(c, *i, true);
+                if (r == -ENOMEM) {
+                        path_cache_clear(c);
+                        c->valid = false;
+                        return r;
+                }
+
+                /* Trying again on every flush won't make this go
+                 * away, leave the root to the file system until the
+                 * roots are set again */
+                if (r < 0)
+                        log_warning("Failed to cache %s, not caching it: %s", *i, strerror(-r));
+        }
+
+        return 0;
+}
+
+static void process_event(PathCache *c, const struct inotify_event *e) {
+        PathCacheDir *d;
+        char **l;
+
+        assert(c);
+        assert(e);
+
+        if (e->mask & IN_Q_OVERFLOW) {
+                c->valid = false;
+                return;
+        }
+
+        l = hashmap_get(c->ancestors, INT_TO_PTR(e->wd));
+        if (l) {
+                /* One of the missing roots is on its way, or we
+                 * cannot wait for it here anymore */
+                if ((e->mask & IN_IGNORED) ||
+                    ((e->mask & (IN_CREATE|IN_MOVED_TO)) && e->len > 0 && strv_contains(l, e->name))) {
+                        c->valid = false;
+                        return;
+                }
+        }
+
+        d = hashmap_get(c->dirs_by_wd, INT_TO_PTR(e->wd));
+        if (!d)
+                return;
+
+        if (e->mask & (IN_DELETE_SELF|IN_MOVE_SELF|IN_UNMOUNT|IN_IGNORED)) {
+                /* For subdirectories the root will tell us
+                 * about the entry itself */
+                if (d->root)
+                        c->valid = false;
+                else
+                        dir_free(c, d);
+
+                return;
+        }
+
+        if (e->len <= 0)
+                return;
+
+        if (e->mask & (IN_CREATE|IN_MOVED_TO)) {
+                if (add_entry(c, d, e->name, !!(e->mask & IN_ISDIR)) < 0)
+                        c->valid = false;
+        } else if (e->mask & (IN_DELETE|IN_MOVED_FROM))
+                remove_entry(c, d, e->name);
+}
+
+static int drain(PathCache *c) {
+        union {
+                struct inotify_event ev;
+                uint8_t raw[4096];
+        } buffer;
+
+        assert(c);
+
+        for (;;) {
+                struct inotify_event *e;
+                ssize_t l;
+
+                l = read(c->fd, &buffer, sizeof(buffer));
+                if (l < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        if (errno == EAGAIN)
+                                return 0;
+
+                        return -errno;
+                }
+
+                e = &buffer.ev;
+                while (l > 0) {
+                        size_t step;
+
+                        step = sizeof(struct inotify_event) + e->len;
+                        assert(step <= (size_t) l);
+
+                        if (c->valid)
+                                process_event(c, e);
+
+                        e = (struct inotify_event*) ((uint8_t*) e + step);
+                        l -= step;
+                }
+        }
+}
+
+int path_cache_set_roots(PathCache *c, char **roots) {
+        char **l;
+        int r;
+
+        assert(c);
+
+        l = strv_copy(roots);
+        if (!l)
+                return -ENOMEM;
+
+        strv_free(c->roots);
+        c->roots = l;
+
+        r = drain(c);
+        if (r < 0)
+                return r;
+
+        return path_cache_rebuild(c);
+}
+
+int path_cache_flush(PathCache *c) {
+        int r;
+
+        assert(c);
+
+        r = drain(c);
+        if (r < 0)
+                return r;
+
+        if (c->valid)
+                return 0;
+
+        return path_cache_rebuild(c);
+}
+
+unsigned path_cache_generation(PathCache *c) {
+        assert(c);
+
+        return c->generation;
+}
+
+int path_cache_lookup(PathCache *c, const char *path) {
+        PathCacheDir *d;
+        const char *e;
+        char *dir;
+        int r;
+
+        assert(path);
+
+        if (!c || !c->valid)
+                return -ENODATA;
+
+        e = strrchr(path, '/');
+        if (!e || e == path || e[1] == 0)
+                return -ENODATA;
+
+        dir = strndupa(path, e - path);
+
+        d = hashmap_get(c->dirs, dir);
+        if (d) {
+                if (d->missing)
+                        return 0;
+
+                return !!set_get(d->entries, (char*) e + 1);
+        }
+
+        /* Everything below a directory that doesn't exist doesn't
+         * exist either */
+        r = path_cache_lookup(c, dir);
+        return r == 0 ? 0 : -ENODATA;
+}
+
+bool path_cache_exists(PathCache *c, const char *path) {
+        struct stat st;
+        int r;
+
+        assert(path);
+
+        r = path_cache_lookup(c, path);
+        if (r >= 0)
+                return r > 0;
+
+        return lstat(path, &st) >= 0;
+}
+
+int path_cache_list(PathCache *c, const char *dir, char ***ret) {
+        _cleanup_strv_free_ char **l = NULL;
+        _cleanup_closedir_ DIR *d = NULL;
+        PathCacheDir *cd;
+        Iterator i;
+        char *n;
+
+        assert(dir);
+        assert(ret);
+
+        cd = c && c->valid ? hashmap_get(c->dirs, dir) : NULL;
+        if (cd) {
+                SET_FOREACH(n, cd->entries, i) {
+                        char *p;
+
+                        p = strjoin(dir, "/", n, NULL);
+                        if (!p)
+                                return -ENOMEM;
+
+                        if (strv_push(&l, p) < 0) {
+                                free(p);
+                                return -ENOMEM;
+                        }
+                }
+
+                *ret = l;
+                l = NULL;
+                return 0;
+        }
+
+        if (path_cache_lookup(c, dir) == 0) {
+                *ret = NULL;
+                return 0;
+        }
+
+        d = opendir(dir);
+        if (!d) {
+                if (errno == ENOENT) {
+                        *ret = NULL;
+                        return 0;
+                }
+
+                return -errno;
+        }
+
+        for (;;) {
+                struct dirent *de;
+                union dirent_storage buf;
+                char *p;
+                int k;
+
+                k = readdir_r(d, &buf.de, &de);
+                if (k != 0)
+                        return -k;
+
+                if (!de)
+                        break;
+
+                if (ignore_file(de->d_name))
+                        continue;
+
+                p = strjoin(dir, "/", de->d_name, NULL);
+                if (!p)
+                        return -ENOMEM;
+
+                if (strv_push(&l, p) < 0) {
+                        free(p);
+                        return -ENOMEM;
+                }
+        }
+
+        *ret = l;
+        l = NULL;
+        return 0;
+}
@@ -0,0 +1,62 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdbool.h>
+
+#include "macro.h"
+
+/* Knows which entries the unit directories and their immediate
+ * subdirectories (.wants/, .requires/, .d/) contain, and keeps track
+ * of changes with inotify, so that looking for unit files does not
+ * need to go to disk. */
+
+typedef struct PathCache PathCache;
+
+int path_cache_new(PathCache **ret);
+void path_cache_free(PathCache *c);
+
+/* The inotify fd, becomes readable when path_cache_flush() should
+ * be called */
+int path_cache_fd(PathCache *c);
+
+int path_cache_set_roots(PathCache *c, char **roots);
+int path_cache_flush(PathCache *c);
+
+/* Returns > 0 if the path exists, 0 if it does not, and -ENODATA if
+ * it is not covered by the cache. Never touches the disk, and may be
+ * called from multiple threads as long as nobody flushes. */
+int path_cache_lookup(PathCache *c, const char *path);
+
+/* Changes whenever the result of a lookup might have changed */
+unsigned path_cache_generation(PathCache *c);
+
+/* Like path_cache_lookup(), but asks the file system for paths not
+ * covered by the cache */
+bool path_cache_exists(PathCache *c, const char *path);
+int path_cache_list(PathCache *c, const char *dir, char ***ret);
+
+static inline void path_cache_freep(PathCache **c) {
+        path_cache_free(*c);
+}
+
+#define _cleanup_path_cache_free_ _cleanup_(path_cache_freep)
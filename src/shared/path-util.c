@@ -98,6 +98,28 @@ int path_get_parent(const char *path, char **_r) {
         return 0;
 }
 
+bool path_strip_last_component(char *path) {
+        char *e;
+
+        assert(path);
+
+        /* Truncates the path to its parent directory in place,
+         * expects a path with redundant slashes removed. Returns
+         * false if there is no parent left, i.e. for the root
+         * directory or a single relative component. */
+
+        e = strrchr(path, '/');
+        if (!e || e[1] == 0)
+                return false;
+
+        if (e == path)
+                e[1] = 0;
+        else
+                *e = 0;
+
+        return true;
+}
+
 char **path_split_and_make_absolute(const char *p) {
         char **l;
         assert(p);
@@ -217,7 +217,7 @@ _pure_ static struct prioq_item* find_item(Prioq *q, void *data, unsigned *idx)
         assert(q);
 
         if (idx) {
-                if (*idx > q->n_items)
+                if (*idx >= q->n_items)
                         return NULL;
 
                 i = q->items + *idx;
@@ -0,0 +1,261 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <errno.h>
+#include <sys/timerfd.h>
+
+#include "util.h"
+#include "prioq.h"
+#include "timer-queue.h"
+
+/* What we consider "never" */
+#define TIMER_QUEUE_DISARMED ((usec_t) -1)
+
+struct TimerQueue {
+        clockid_t clock_id;
+        int fd;
+
+        Prioq *prioq;
+
+        /* How much later than requested we may wake up, in order
+         * to dispatch more timers at once */
+        usec_t accuracy;
+
+        /* What the timerfd is currently programmed for */
+        usec_t armed;
+
+        /* While timers are popped, what they are popped up to.
+         * Timers put meanwhile for that time or earlier are pushed
+         * behind it, so that a handler which requeues its timer for
+         * "now" does not get it back in the same loop. Disarmed
+         * otherwise. */
+        usec_t popping;
+};
+
+static int entry_compare(const void *a, const void *b) {
+        const TimerQueueEntry *x = a, *y = b;
+
+        if (x->next_elapse < y->next_elapse)
+                return -1;
+        if (x->next_elapse > y->next_elapse)
+                return 1;
+
+        return 0;
+}
+
+int timer_queue_new(clockid_t clock_id, TimerQueue **ret) {
+        TimerQueue *q;
+
+        assert(ret);
+
+        q = new0(TimerQueue, 1);
+        if (!q)
+                return -ENOMEM;
+
+        q->clock_id = clock_id;
+        q->armed = TIMER_QUEUE_DISARMED;
+        q->popping = TIMER_QUEUE_DISARMED;
+
+        q->prioq = prioq_new(entry_compare);
+        if (!q->prioq) {
+                free(q);
+                return -ENOMEM;
+        }
+
+        q->fd = timerfd_create(clock_id, TFD_NONBLOCK|TFD_CLOEXEC);
+        if (q->fd < 0) {
+                prioq_free(q->prioq);
+                free(q);
+                return -errno;
+        }
+
+        *ret = q;
+        return 0;
+}
+
+void timer_queue_free(TimerQueue *q) {
+        TimerQueueEntry *e;
+
+        if (!q)
+                return;
+
+        while ((e = prioq_pop(q->prioq)))
+                e->queue = NULL;
+
+        prioq_free(q->prioq);
+        close_nointr_nofail(q->fd);
+        free(q);
+}
+
+int timer_queue_get_fd(TimerQueue *q) {
+        assert(q);
+
+        return q->fd;
+}
+
+clockid_t timer_queue_get_clock(TimerQueue *q) {
+        assert(q);
+
+        return q->clock_id;
+}
+
+unsigned timer_queue_size(TimerQueue *q) {
+        assert(q);
+
+        return prioq_size(q->prioq);
+}
+
+void timer_queue_set_accuracy(TimerQueue *q, usec_t usec) {
+        assert(q);
+
+        q->accuracy = usec;
+}
+
+int timer_queue_put(TimerQueue *q, TimerQueueEntry *e, usec_t usec) {
+        int r;
+
+        assert(q);
+        assert(e);
+
+        if (usec <= q->popping && q->popping < TIMER_QUEUE_DISARMED - 1)
+                usec = q->popping + 1;
+
+        if (e->queue == q) {
+                e->next_elapse = usec;
+                assert_se(prioq_reshuffle(q->prioq, e, &e->idx) > 0);
+                return 0;
+        }
+
+        if (e->queue)
+                timer_queue_remove(e);
+
+        e->next_elapse = usec;
+
+        r = prioq_put(q->prioq, e, &e->idx);
+        if (r < 0)
+                return r;
+
+        e->queue = q;
+        return 0;
+}
+
+void timer_queue_remove(TimerQueueEntry *e) {
+        assert(e);
+
+        if (!e->queue)
+                return;
+
+        assert_se(prioq_remove(e->queue->prioq, e, &e->idx) > 0);
+        e->queue = NULL;
+}
+
+static usec_t sleep_between(usec_t a, usec_t b) {
+        static const usec_t steps[] = {
+                USEC_PER_MINUTE,
+                10 * USEC_PER_SEC,
+                USEC_PER_SEC,
+                250 * USEC_PER_MSEC,
+        };
+        unsigned i;
+
+        /* Find a good time to wake up between a and b. We prefer
+         * waking up on round boundaries, so that timers that elapse
+         * at about the same time are dispatched in one go, and try
+         * the coarsest step first. If no boundary fits, we wake up
+         * as late as allowed. */
+
+        if (b <= a)
+                return a;
+
+        for (i = 0; i < ELEMENTSOF(steps); i++) {
+                usec_t c;
+
+                c = b - b % steps[i];
+                if (c >= a)
+                        return c;
+        }
+
+        return b;
+}
+
+int timer_queue_arm(TimerQueue *q) {
+        struct itimerspec its = {};
+        TimerQueueEntry *e;
+        usec_t t;
+
+        assert(q);
+
+        e = prioq_peek(q->prioq);
+        if (!e || e->next_elapse == TIMER_QUEUE_DISARMED)
+                t = TIMER_QUEUE_DISARMED;
+        else if (e->next_elapse >= TIMER_QUEUE_DISARMED - q->accuracy)
+                t = e->next_elapse;
+        else
+                t = sleep_between(e->next_elapse, e->next_elapse + q->accuracy);
+
+        if (t == q->armed)
+                return 0;
+
+        if (t != TIMER_QUEUE_DISARMED) {
+                if (t <= 0)
+                        /* Set absolute time in the past, but not 0,
+                         * since we don't want to disarm the timer */
+                        its.it_value.tv_nsec = 1;
+                else
+                        timespec_store(&its.it_value, t);
+        }
+
+        if (timerfd_settime(q->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+                return -errno;
+
+        q->armed = t;
+        return 0;
+}
+
+void timer_queue_flush(TimerQueue *q) {
+        uint64_t v;
+
+        assert(q);
+
+        /* The timerfd is one-shot, hence after it elapsed it needs
+         * to be programmed again, whatever it was set to. */
+        if (read(q->fd, &v, sizeof(v)) == sizeof(v))
+                q->armed = TIMER_QUEUE_DISARMED;
+}
+
+TimerQueueEntry *timer_queue_pop_elapsed(TimerQueue *q, usec_t n) {
+        TimerQueueEntry *e;
+
+        assert(q);
+
+        e = prioq_peek(q->prioq);
+        if (!e || e->next_elapse > n) {
+                q->popping = TIMER_QUEUE_DISARMED;
+                return NULL;
+        }
+
+        q->popping = n;
+
+        assert_se(prioq_pop(q->prioq) == e);
+        e->queue = NULL;
+
+        return e;
+}
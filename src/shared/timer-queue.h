@@ -0,0 +1,59 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <time.h>
+
+#include "time-util.h"
+#include "macro.h"
+
+/* A priority queue of timers on one clock, multiplexed onto a single
+ * timerfd. Entries are embedded in the objects that own them. */
+
+typedef struct TimerQueue TimerQueue;
+typedef struct TimerQueueEntry TimerQueueEntry;
+
+struct TimerQueueEntry {
+        TimerQueue *queue; /* NULL if not queued */
+        usec_t next_elapse;
+        unsigned idx;
+};
+
+int timer_queue_new(clockid_t clock_id, TimerQueue **ret);
+void timer_queue_free(TimerQueue *q);
+
+int timer_queue_get_fd(TimerQueue *q) _pure_;
+clockid_t timer_queue_get_clock(TimerQueue *q) _pure_;
+unsigned timer_queue_size(TimerQueue *q) _pure_;
+
+void timer_queue_set_accuracy(TimerQueue *q, usec_t usec);
+
+int timer_queue_put(TimerQueue *q, TimerQueueEntry *e, usec_t usec);
+void timer_queue_remove(TimerQueueEntry *e);
+
+int timer_queue_arm(TimerQueue *q);
+void timer_queue_flush(TimerQueue *q);
+
+/* Returns the timers due at n one after the other, and NULL at the
+ * end. Timers put before the end are never returned in the same
+ * loop, even if they are put for n or earlier. */
+TimerQueueEntry *timer_queue_pop_elapsed(TimerQueue *q, usec_t n);
@@ -300,6 +300,7 @@ unsigned long long random_ull(void);
 int fd_nonblock(int fd, bool nonblock);
 int fd_cloexec(int fd, bool cloexec);
 
+bool fd_in_set(int fd, const int fdset[], unsigned n_fdset) _pure_;
 int close_all_fds(const int except[], unsigned n_except);
 
 bool fstype_is_network(const char *fstype);
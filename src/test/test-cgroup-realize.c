@@ -0,0 +1,208 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#include "util.h"
+#include "log.h"
+#include "cgroup.h"
+#include "cgroup-attr.h"
+#include "cgroup-util.h"
+
+/* Measures how many units per second can be put into their cpu and
+ * memory groups, the way exec_spawn() does it: realize the groups,
+ * write the attributes of the unit, and move a process into them.
+ * Once going by path only, and once with the group directories open
+ * while spawning. Needs to run as root, with cpu and memory controllers
+ * mounted. */
+
+#define N_UNITS 500
+
+typedef struct TestUnit {
+        CGroupBonding bondings[2];
+        CGroupAttribute attributes[3];
+        LIST_HEAD(CGroupBonding, cgroup_bondings);
+        LIST_HEAD(CGroupAttribute, cgroup_attributes);
+} TestUnit;
+
+static void test_unit_init(TestUnit *t, unsigned i) {
+        static char *controllers[] = { (char*) "cpu", (char*) "memory" };
+        static char *attributes[][3] = {
+                { (char*) "cpu", (char*) "cpu.shares", (char*) "512" },
+                { (char*) "memory", (char*) "memory.limit_in_bytes", (char*) "536870912" },
+                { (char*) "memory", (char*) "memory.soft_limit_in_bytes", (char*) "268435456" },
+        };
+        unsigned j;
+
+        zero(*t);
+
+        for (j = 0; j < ELEMENTSOF(t->bondings); j++) {
+                CGroupBonding *b = t->bondings + j;
+
+                b->controller = controllers[j];
+                assert_se(asprintf(&b->path, "/test-cgroup-realize/unit-%u", i) >= 0);
+                b->ours = true;
+                b->essential = true;
+                b->dir_fd = -1;
+
+                LIST_PREPEND(CGroupBonding, by_unit, t->cgroup_bondings, b);
+        }
+
+        for (j = 0; j < ELEMENTSOF(t->attributes); j++) {
+                CGroupAttribute *a = t->attributes + j;
+
+                a->controller = attributes[j][0];
+                a->name = attributes[j][1];
+                a->value = attributes[j][2];
+
+                LIST_PREPEND(CGroupAttribute, by_unit, t->cgroup_attributes, a);
+        }
+}
+
+static void test_unit_done(TestUnit *t) {
+        unsigned j;
+
+        for (j = 0; j < ELEMENTSOF(t->bondings); j++) {
+                cgroup_bonding_close_fds(t->bondings + j);
+                free(t->bondings[j].path);
+        }
+}
+
+/* Makes sure we really go through the open directories, and don't
+ * silently fall back to paths */
+static void assert_groups_open(CGroupBonding *first) {
+        CGroupBonding *b;
+
+        LIST_FOREACH(by_unit, b, first) {
+                _cleanup_free_ char *fs = NULL;
+                struct stat a, c;
+
+                assert_se(b->dir_fd >= 0);
+                assert_se(fstat(b->dir_fd, &a) >= 0);
+
+                assert_se(cg_get_path(b->controller, b->path, NULL, &fs) >= 0);
+                assert_se(stat(fs, &c) >= 0);
+
+                assert_se(a.st_dev == c.st_dev && a.st_ino == c.st_ino);
+        }
+}
+
+static double start_units(TestUnit *units, pid_t pid, bool keep_open) {
+        usec_t t = 0, start;
+        unsigned i;
+
+        for (i = 0; i < N_UNITS; i++) {
+                TestUnit *u = units + i;
+                CGroupBonding *b;
+
+                start = now(CLOCK_MONOTONIC);
+
+                assert_se(cgroup_bonding_realize_list(u->cgroup_bondings) >= 0);
+
+                if (!keep_open)
+                        cgroup_bonding_close_fds_list(u->cgroup_bondings);
+
+                assert_se(cgroup_attribute_apply_list(u->cgroup_attributes, u->cgroup_bondings) >= 0);
+                assert_se(cgroup_bonding_install_list(u->cgroup_bondings, pid, NULL) >= 0);
+
+                t += now(CLOCK_MONOTONIC) - start;
+
+                if (keep_open)
+                        assert_groups_open(u->cgroup_bondings);
+
+                /* Like exec_spawn(), don't keep anything open once
+                 * the process is in the groups */
+                start = now(CLOCK_MONOTONIC);
+                cgroup_bonding_close_fds_list(u->cgroup_bondings);
+                t += now(CLOCK_MONOTONIC) - start;
+
+                LIST_FOREACH(by_unit, b, u->cgroup_bondings)
+                        assert_se(b->dir_fd < 0);
+        }
+
+        return (double) N_UNITS * USEC_PER_SEC / t;
+}
+
+static void trim_units(TestUnit *units) {
+        unsigned i;
+
+        for (i = 0; i < N_UNITS; i++)
+                cgroup_bonding_trim_list(units[i].cgroup_bondings, true);
+}
+
+int main(int argc, char *argv[]) {
+        TestUnit *units;
+        double by_path, cached, again;
+        siginfo_t si = {};
+        unsigned i;
+        pid_t pid;
+
+        log_parse_environment();
+        log_open();
+
+        units = new(TestUnit, N_UNITS);
+        assert_se(units);
+
+        for (i = 0; i < N_UNITS; i++)
+                test_unit_init(units + i, i);
+
+        /* The process to move around between the groups */
+        pid = fork();
+        assert_se(pid >= 0);
+        if (pid == 0) {
+                pause();
+                _exit(EXIT_SUCCESS);
+        }
+
+        by_path = start_units(units, pid, false);
+        assert_se(cg_attach("cpu", "/", pid) >= 0);
+        assert_se(cg_attach("memory", "/", pid) >= 0);
+        trim_units(units);
+
+        cached = start_units(units, pid, true);
+
+        /* Restarting units whose groups are still around */
+        again = start_units(units, pid, true);
+
+        assert_se(cg_attach("cpu", "/", pid) >= 0);
+        assert_se(cg_attach("memory", "/", pid) >= 0);
+        trim_units(units);
+
+        assert_se(kill(pid, SIGKILL) >= 0);
+        assert_se(waitid(P_PID, pid, &si, WEXITED) >= 0);
+
+        for (i = 0; i < N_UNITS; i++)
+                test_unit_done(units + i);
+        free(units);
+
+        cg_trim("cpu", "/test-cgroup-realize", true);
+        cg_trim("memory", "/test-cgroup-realize", true);
+
+        log_info("%u units: %.0f units/s by path, %.0f units/s with open groups, %.0f units/s restarting",
+                 N_UNITS, by_path, cached, again);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "util.h"
+#include "cgroup.h"
+#include "cgroup-util.h"
+
+static const char io_service_bytes[] =
+        "8:16 Read 1048576\n"
+        "8:16 Write 4096\n"
+        "8:16 Sync 1048576\n"
+        "8:16 Async 4096\n"
+        "8:16 Total 1052672\n"
+        "8:0 Read 12288\n"
+        "8:0 Write 8192\n"
+        "8:0 Sync 0\n"
+        "8:0 Async 20480\n"
+        "8:0 Total 20480\n"
+        "Total 1073152\n";
+
+static void test_parse(void) {
+        CGroupUsage usage = {};
+
+        assert_se(cgroup_usage_parse(&usage, "cpuacct.usage", "123456789\n") >= 0);
+        assert_se(usage.cpu_nsec == 123456789ULL);
+
+        assert_se(cgroup_usage_parse(&usage, "memory.usage_in_bytes", "536870912\n") >= 0);
+        assert_se(usage.memory_bytes == 536870912ULL);
+
+        assert_se(cgroup_usage_parse(&usage, "blkio.io_service_bytes", io_service_bytes) >= 0);
+        assert_se(usage.io_read_bytes == 1048576ULL + 12288ULL);
+        assert_se(usage.io_write_bytes == 4096ULL + 8192ULL);
+
+        /* A group that has not done any I/O yet */
+        assert_se(cgroup_usage_parse(&usage, "blkio.io_service_bytes", "Total 0\n") >= 0);
+        assert_se(usage.io_read_bytes == 0);
+        assert_se(usage.io_write_bytes == 0);
+
+        assert_se(cgroup_usage_parse(&usage, "cpuacct.usage", "") < 0);
+        assert_se(cgroup_usage_parse(&usage, "cpuacct.usage", "12ab\n") < 0);
+        assert_se(cgroup_usage_parse(&usage, "blkio.io_service_bytes", "8:0 Read\n") < 0);
+        assert_se(cgroup_usage_parse(&usage, "memory.stat", "cache 0\n") == -ENOENT);
+}
+
+static void test_get_usage_list(void) {
+        CGroupBonding cpu = {
+                .controller = (char*) "cpu",
+                .path = (char*) "/",
+                .dir_fd = -1,
+        }, memory = {
+                .controller = (char*) "memory",
+                .path = (char*) "/",
+                .dir_fd = -1,
+        };
+        _cleanup_free_ char *fs = NULL;
+        LIST_HEAD(CGroupBonding, first);
+        CGroupUsage usage;
+
+        LIST_HEAD_INIT(CGroupBonding, first);
+        assert_se(cgroup_bonding_get_usage_list(first, &usage) == 0);
+        assert_se(usage.cpu_nsec == (uint64_t) -1);
+        assert_se(usage.memory_bytes == (uint64_t) -1);
+        assert_se(usage.io_read_bytes == (uint64_t) -1);
+        assert_se(usage.io_write_bytes == (uint64_t) -1);
+
+        /* Groups that have not been created yet are never read */
+        LIST_PREPEND(CGroupBonding, by_unit, first, &cpu);
+        LIST_PREPEND(CGroupBonding, by_unit, first, &memory);
+        assert_se(cgroup_bonding_get_usage_list(first, &usage) == 0);
+        assert_se(usage.cpu_nsec == (uint64_t) -1);
+        assert_se(usage.memory_bytes == (uint64_t) -1);
+
+        /* The root group always exists, cpuacct is looked up through
+         * the cpu bonding */
+        cpu.realized = memory.realized = true;
+        if (cg_get_path("cpuacct", "/", "cpuacct.usage", &fs) < 0 || access(fs, R_OK) < 0) {
+                puts("cpuacct not available, skipping sampling the root group.");
+                return;
+        }
+
+        assert_se(cgroup_bonding_get_usage_list(first, &usage) > 0);
+        assert_se(usage.cpu_nsec != (uint64_t) -1);
+        assert_se(usage.io_read_bytes == (uint64_t) -1);
+        assert_se(usage.io_write_bytes == (uint64_t) -1);
+}
+
+int main(int argc, char *argv[]) {
+        test_parse();
+        test_get_usage_list();
+
+        return 0;
+}
@@ -0,0 +1,186 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sched.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "util.h"
+#include "log.h"
+#include "set.h"
+#include "def.h"
+
+/* Measures how many release notifications per second get from the
+ * cgroups agent to the socket PID 1 listens on, when many groups run
+ * empty at the same time. The agent is spawned the way the kernel
+ * would do it, a number of instances at a time, and the socket is
+ * drained in batches like PID 1 does. Needs to run as root, and
+ * uses its own mount namespace, so that it doesn't get in the way
+ * of a running systemd.
+ *
+ * Usage: test-cgroups-agent [AGENT] [NOTIFICATIONS] [GROUPS] */
+
+#define N_PARALLEL 64
+
+static int open_socket(void) {
+        union {
+                struct sockaddr sa;
+                struct sockaddr_un un;
+        } sa = {
+                .un.sun_family = AF_UNIX,
+                .un.sun_path = SYSTEMD_CGROUP_AGENT_SOCKET,
+        };
+        int fd, one = 1;
+
+        assert_se(unshare(CLONE_NEWNS) >= 0);
+        assert_se(mount(NULL, "/", NULL, MS_PRIVATE|MS_REC, NULL) >= 0);
+        assert_se(mount("tmpfs", "/run/systemd", "tmpfs", MS_NOSUID|MS_NODEV, "mode=755") >= 0);
+
+        fd = socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC|SOCK_NONBLOCK, 0);
+        assert_se(fd >= 0);
+
+        fd_inc_rcvbuf(fd, 8*1024*1024);
+
+        assert_se(bind(fd, &sa.sa, offsetof(struct sockaddr_un, sun_path) + strlen(sa.un.sun_path)) >= 0);
+        assert_se(setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &one, sizeof(one)) >= 0);
+
+        return fd;
+}
+
+static unsigned drain(int fd, Set *groups) {
+        unsigned n = 0;
+
+        for (;;) {
+                char buf[PATH_MAX+1];
+                ssize_t k;
+
+                k = recv(fd, buf, sizeof(buf)-1, MSG_DONTWAIT);
+                if (k < 0) {
+                        assert_se(errno == EAGAIN || errno == EINTR);
+                        break;
+                }
+
+                buf[k] = 0;
+                n++;
+
+                if (!set_get(groups, buf))
+                        assert_se(set_put(groups, strdup(buf)) >= 0);
+        }
+
+        return n;
+}
+
+int main(int argc, char *argv[]) {
+        const char *agent = SYSTEMD_CGROUP_AGENT_PATH;
+        unsigned n_notifications = 5000, n_groups = 1000;
+        unsigned n_spawned = 0, n_running = 0, n_received = 0, n_wakeups = 0;
+        Set *groups;
+        usec_t start, t;
+        int fd;
+
+        log_parse_environment();
+        log_open();
+
+        if ((argc > 1 && !(agent = argv[1])) ||
+            (argc > 2 && safe_atou(argv[2], &n_notifications) < 0) ||
+            (argc > 3 && safe_atou(argv[3], &n_groups) < 0) ||
+            n_groups <= 0) {
+                log_error("Usage: %s [AGENT] [NOTIFICATIONS] [GROUPS]", program_invocation_short_name);
+                return EXIT_FAILURE;
+        }
+
+        fd = open_socket();
+
+        groups = set_new(string_hash_func, string_compare_func);
+        assert_se(groups);
+
+        start = now(CLOCK_MONOTONIC);
+
+        while (n_received < n_notifications) {
+                struct pollfd pollfd = {
+                        .fd = fd,
+                        .events = POLLIN,
+                };
+                unsigned k;
+
+                while (n_running < N_PARALLEL && n_spawned < n_notifications) {
+                        char group[sizeof("/system/test-.service") + DECIMAL_STR_MAX(unsigned)];
+                        pid_t pid;
+
+                        snprintf(group, sizeof(group), "/system/test-%u.service", n_spawned % n_groups);
+
+                        pid = fork();
+                        assert_se(pid >= 0);
+
+                        if (pid == 0) {
+                                execl(agent, agent, group, NULL);
+                                _exit(EXIT_FAILURE);
+                        }
+
+                        n_spawned++;
+                        n_running++;
+                }
+
+                for (;;) {
+                        siginfo_t si = {};
+
+                        if (waitid(P_ALL, 0, &si, WEXITED|WNOHANG) < 0 || si.si_pid <= 0)
+                                break;
+
+                        assert_se(si.si_code == CLD_EXITED && si.si_status == EXIT_SUCCESS);
+                        n_running--;
+                }
+
+                assert_se(poll(&pollfd, 1, 10) >= 0);
+
+                k = drain(fd, groups);
+                if (k > 0) {
+                        n_received += k;
+                        n_wakeups++;
+                }
+        }
+
+        t = now(CLOCK_MONOTONIC) - start;
+
+        while (n_running > 0) {
+                siginfo_t si = {};
+
+                assert_se(waitid(P_ALL, 0, &si, WEXITED) >= 0);
+                n_running--;
+        }
+
+        log_info("%u notifications for %u groups in %llu ms, %.0f notifications/s, %.1f per wakeup",
+                 n_received, set_size(groups),
+                 (unsigned long long) (t / USEC_PER_MSEC),
+                 (double) n_received * USEC_PER_SEC / t,
+                 (double) n_received / n_wakeups);
+
+        set_free_free(groups);
+        close_nointr_nofail(fd);
+
+        return EXIT_SUCCESS;
+}
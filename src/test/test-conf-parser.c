@@ -0,0 +1,153 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "util.h"
+#include "conf-parser.h"
+#include "strv.h"
+
+static const char config[] =
+        "# comment\n"
+        "[Section]\n"
+        "\n"
+        "  One = one  \n"
+        "Two=two \\\n"
+        "    continued\n"
+        "; comment\n"
+        "Three=3\n";
+
+static void test_read(const char *fn) {
+        ConfigFile *c;
+
+        assert_se(config_file_read(fn, NULL, &c) >= 0);
+
+        /* Comments and empty lines are dropped, but still count */
+        assert_se(c->n_lines == 4);
+        assert_se(c->lines[0].line == 2);
+        assert_se(streq(c->lines[0].text, "[Section]"));
+        assert_se(c->lines[1].line == 4);
+        assert_se(streq(c->lines[1].text, "One = one"));
+        assert_se(c->lines[2].line == 5);
+        assert_se(streq(c->lines[2].text, "Two=two      continued"));
+        assert_se(c->lines[3].line == 7);
+        assert_se(streq(c->lines[3].text, "Three=3"));
+
+        config_file_free(c);
+}
+
+static void test_parse(const char *fn) {
+        _cleanup_free_ char *one = NULL, *two = NULL;
+        unsigned three = 0, i;
+        const ConfigTableItem items[] = {
+                { "Section", "One",   config_parse_string,   0, &one   },
+                { "Section", "Two",   config_parse_string,   0, &two   },
+                { "Section", "Three", config_parse_unsigned, 0, &three },
+                {}
+        };
+        ConfigFile *c;
+
+        assert_se(config_file_read(fn, NULL, &c) >= 0);
+
+        /* Applying the file must leave it untouched, so that it can
+         * be applied again */
+        for (i = 0; i < 2; i++) {
+                free(one);
+                free(two);
+                one = two = NULL;
+                three = 0;
+
+                assert_se(config_file_parse(NULL, c, "Section\0", config_item_table_lookup, (void*) items, false, false, NULL) >= 0);
+                assert_se(streq(one, "one"));
+                assert_se(streq(two, "two      continued"));
+                assert_se(three == 3);
+        }
+
+        config_file_free(c);
+}
+
+static void test_is_current(const char *fn) {
+        ConfigFile *c;
+        struct stat st;
+        FILE *f;
+
+        assert_se(config_file_read(fn, NULL, &c) >= 0);
+
+        assert_se(stat(fn, &st) >= 0);
+        assert_se(config_file_is_current(c, &st));
+
+        f = fopen(fn, "ae");
+        assert_se(f);
+        fputs("Four=4\n", f);
+        fclose(f);
+
+        assert_se(stat(fn, &st) >= 0);
+        assert_se(!config_file_is_current(c, &st));
+
+        config_file_free(c);
+}
+
+static void test_equal(const char *fn) {
+        ConfigFile *a, *b;
+        FILE *f;
+
+        assert_se(config_file_read(fn, NULL, &a) >= 0);
+        assert_se(config_file_read(fn, NULL, &b) >= 0);
+        assert_se(config_file_equal(a, b));
+        config_file_free(b);
+
+        f = fopen(fn, "ae");
+        assert_se(f);
+        fputs("Five=5\n", f);
+        fclose(f);
+
+        assert_se(config_file_read(fn, NULL, &b) >= 0);
+        assert_se(!config_file_equal(a, b));
+        config_file_free(b);
+
+        config_file_free(a);
+}
+
+int main(int argc, char *argv[]) {
+        char fn[] = "/tmp/test-conf-parser-XXXXXX";
+        FILE *f;
+        int fd;
+
+        fd = mkostemp(fn, O_CLOEXEC);
+        assert_se(fd >= 0);
+
+        f = fdopen(fd, "w");
+        assert_se(f);
+        fputs(config, f);
+        fclose(f);
+
+        test_read(fn);
+        test_parse(fn);
+        test_is_current(fn);
+        test_equal(fn);
+
+        unlink(fn);
+
+        return 0;
+}
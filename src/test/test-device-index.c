@@ -0,0 +1,161 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "manager.h"
+#include "device.h"
+#include "unit-name.h"
+#include "strv.h"
+#include "util.h"
+#include "log.h"
+
+/* Replays a hotplug storm of many disks, each with a sysfs path, a
+ * device node and two symlinks, and measures how long looking up
+ * the units of their paths takes per device: once the way udev
+ * events do it, and once by escaping the unit name and asking the
+ * units hashmap.
+ *
+ * Usage: test-device-index [DEVICES] */
+
+#define N_PATHS 4
+
+static char **device_paths(unsigned i) {
+        char **l;
+
+        l = new0(char*, N_PATHS + 1);
+        assert_se(l);
+
+        assert_se(asprintf(&l[0], "/sys/devices/pci0000:00/0000:00:1d.0/host%u/target%u:0:0/%u:0:0:0/block/sdx%u", i, i, i, i) >= 0);
+        assert_se(asprintf(&l[1], "/dev/sdx%u", i) >= 0);
+        assert_se(asprintf(&l[2], "/dev/disk/by-id/usb-Test_Disk_%08u-0:0", i) >= 0);
+        assert_se(asprintf(&l[3], "/dev/disk/by-path/pci-0000:00:1d.0-scsi-0:0:0:%u", i) >= 0);
+
+        return l;
+}
+
+static Unit *add_device(Manager *m, const char *path) {
+        _cleanup_free_ char *e = NULL;
+        Unit *u;
+
+        u = unit_new(m, sizeof(Device));
+        assert_se(u);
+
+        e = unit_name_from_path(path, ".device");
+        assert_se(e);
+        assert_se(unit_add_name(u, e) >= 0);
+        assert_se(device_index_path(DEVICE(u), path) >= 0);
+
+        return u;
+}
+
+static Unit *find_escaped(Manager *m, const char *path) {
+        _cleanup_free_ char *e = NULL;
+
+        e = unit_name_from_path(path, ".device");
+        assert_se(e);
+
+        return manager_get_unit(m, e);
+}
+
+int main(int argc, char *argv[]) {
+        char ***paths;
+        Unit **units;
+        unsigned n_devices = 10000, i, j;
+        usec_t add, indexed, escaped, removed;
+        Manager *m;
+        int r;
+
+        log_parse_environment();
+        log_open();
+
+        if ((argc > 1 && safe_atou(argv[1], &n_devices) < 0) || n_devices <= 0) {
+                log_error("Usage: %s [DEVICES]", program_invocation_short_name);
+                return EXIT_FAILURE;
+        }
+
+        r = manager_new(SYSTEMD_USER, &m);
+        if (r == -EPERM) {
+                puts("manager_new: Permission denied. Skipping test.");
+                return EXIT_TEST_SKIP;
+        }
+        assert_se(r >= 0);
+
+        paths = new(char**, n_devices);
+        units = new(Unit*, n_devices * N_PATHS);
+        assert_se(paths && units);
+
+        for (i = 0; i < n_devices; i++)
+                paths[i] = device_paths(i);
+
+        /* Everything shows up */
+        add = now(CLOCK_MONOTONIC);
+        for (i = 0; i < n_devices; i++)
+                for (j = 0; j < N_PATHS; j++) {
+                        Unit *u = NULL;
+
+                        assert_se(device_find_escape_name(m, paths[i][j], &u) == 0);
+                        units[i * N_PATHS + j] = add_device(m, paths[i][j]);
+                }
+        add = now(CLOCK_MONOTONIC) - add;
+
+        /* Everything changes */
+        indexed = now(CLOCK_MONOTONIC);
+        for (i = 0; i < n_devices; i++)
+                for (j = 0; j < N_PATHS; j++) {
+                        Unit *u = NULL;
+
+                        assert_se(device_find_escape_name(m, paths[i][j], &u) > 0);
+                        assert_se(u == units[i * N_PATHS + j]);
+                }
+        indexed = now(CLOCK_MONOTONIC) - indexed;
+
+        escaped = now(CLOCK_MONOTONIC);
+        for (i = 0; i < n_devices; i++)
+                for (j = 0; j < N_PATHS; j++)
+                        assert_se(find_escaped(m, paths[i][j]) == units[i * N_PATHS + j]);
+        escaped = now(CLOCK_MONOTONIC) - escaped;
+
+        /* Everything goes away */
+        removed = now(CLOCK_MONOTONIC);
+        for (i = 0; i < n_devices * N_PATHS; i++)
+                unit_free(units[i]);
+        removed = now(CLOCK_MONOTONIC) - removed;
+
+        log_info("%u devices with %u paths each, per device: "
+                 "%.2f us adding, %.2f us looking up through the index, "
+                 "%.2f us looking up escaped names, %.2f us removing",
+                 n_devices, N_PATHS,
+                 (double) add / n_devices,
+                 (double) indexed / n_devices,
+                 (double) escaped / n_devices,
+                 (double) removed / n_devices);
+
+        for (i = 0; i < n_devices; i++)
+                strv_free(paths[i]);
+        free(paths);
+        free(units);
+
+        manager_free(m);
+
+        return EXIT_SUCCESS;
+}
@@ -23,10 +23,244 @@
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
+#include <malloc.h>
+#include <sys/stat.h>
 
 #include "manager.h"
+#include "fileio.h"
+
+static void test_many_units(unsigned n) {
+        char dir[] = "/tmp/test-engine.XXXXXX";
+        char timespan[FORMAT_TIMESPAN_MAX];
+        struct mallinfo before, after;
+        usec_t ts;
+        Manager *m = NULL;
+        Unit *root = NULL;
+        Job *j;
+        unsigned k;
+        int l;
+
+        /* Every service pulls in and orders itself after its
+         * parent in a binary tree, the target wants all of them.
+         * Every thousandth service is also ordered before its
+         * grandparent, which makes a cycle of three jobs that needs
+         * to be broken. */
+
+        assert_se(mkdtemp(dir));
+
+        for (k = 0; k < n; k++) {
+                _cleanup_free_ char *p = NULL, *t = NULL, *cycle = NULL;
+
+                assert_se(asprintf(&p, "%s/bench-%u.service", dir, k) >= 0);
+
+                if (k % 1000 == 500)
+                        assert_se(asprintf(&cycle, "Before=bench-%u.service\n", ((k - 1) / 2 - 1) / 2) >= 0);
+
+                if (k > 0)
+                        assert_se(asprintf(&t,
+                                           "[Unit]\n"
+                                           "DefaultDependencies=no\n"
+                                           "Wants=bench-%u.service\n"
+                                           "After=bench-%u.service\n"
+                                           "%s"
+                                           "[Service]\n"
+                                           "ExecStart=/bin/true\n",
+                                           (k - 1) / 2, (k - 1) / 2, strempty(cycle)) >= 0);
+                else
+                        assert_se(t = strdup("[Unit]\n"
+                                             "DefaultDependencies=no\n"
+                                             "[Service]\n"
+                                             "ExecStart=/bin/true\n"));
+
+                assert_se(write_string_file(p, t) >= 0);
+        }
+
+        {
+                _cleanup_free_ char *p = NULL;
+
+                assert_se(asprintf(&p, "%s/bench.target", dir) >= 0);
+                assert_se(write_string_file(p, "[Unit]\nDefaultDependencies=no\nAllowIsolate=yes\n") >= 0);
+
+                free(p);
+                p = NULL;
+                assert_se(asprintf(&p, "%s/bench.target.wants", dir) >= 0);
+                assert_se(mkdir(p, 0755) >= 0);
+        }
+
+        for (k = 0; k < n; k++) {
+                _cleanup_free_ char *p = NULL, *t = NULL;
+
+                assert_se(asprintf(&p, "%s/bench.target.wants/bench-%u.service", dir, k) >= 0);
+                assert_se(asprintf(&t, "../bench-%u.service", k) >= 0);
+                assert_se(symlink(t, p) >= 0);
+        }
+
+        assert_se(set_unit_path(dir) >= 0);
+        assert_se(manager_new(SYSTEMD_SYSTEM, &m) >= 0);
+
+        before = mallinfo();
+        ts = now(CLOCK_MONOTONIC);
+        assert_se(manager_load_unit(m, "bench.target", NULL, NULL, &root) >= 0);
+        ts = now(CLOCK_MONOTONIC) - ts;
+        after = mallinfo();
+
+        assert_se(hashmap_size(m->units) == n + 1);
+
+        /* The hashmap pools are large enough to be mmap()ed */
+        l = (after.uordblks + after.hblkhd) - (before.uordblks + before.hblkhd);
+        printf("Loaded %u units in %s, %i bytes on heap per unit.\n",
+               n, format_timespan(timespan, sizeof(timespan), ts, 0), l / (int) (n + 1));
+
+        ts = now(CLOCK_MONOTONIC);
+        assert_se(manager_add_job(m, JOB_START, root, JOB_REPLACE, false, NULL, &j) == 0);
+        ts = now(CLOCK_MONOTONIC) - ts;
+
+        assert_se(hashmap_size(m->jobs) == n + 1 - (n + 499) / 1000);
+
+        printf("Built transaction of %u jobs for %u units in %s.\n",
+               hashmap_size(m->jobs), n, format_timespan(timespan, sizeof(timespan), ts, 0));
+
+        manager_clear_jobs(m);
+
+        ts = now(CLOCK_MONOTONIC);
+        assert_se(manager_add_job(m, JOB_START, root, JOB_ISOLATE, false, NULL, &j) == 0);
+        ts = now(CLOCK_MONOTONIC) - ts;
+
+        printf("Built isolate transaction of %u jobs for %u units in %s.\n",
+               hashmap_size(m->jobs), n, format_timespan(timespan, sizeof(timespan), ts, 0));
+
+        manager_free(m);
+        assert_se(rm_rf_dangerous(dir, false, true, false) >= 0);
+}
+
+static char *bench_mount_path(unsigned k) {
+        _cleanup_free_ char *parent = NULL;
+        char *p;
+
+        if (k == 0)
+                return strdup("/srv/bench");
+
+        parent = bench_mount_path((k - 1) / 4);
+        assert_se(parent);
+
+        assert_se(asprintf(&p, "%s/m%u", parent, k) >= 0);
+        return p;
+}
+
+static void test_many_mounts(unsigned n) {
+        char dir[] = "/tmp/test-engine.XXXXXX";
+        char timespan[FORMAT_TIMESPAN_MAX];
+        usec_t ts;
+        Manager *m = NULL;
+        Unit *root = NULL;
+        unsigned k;
+
+        /* Mounts nested four wide below each other, and a socket
+         * on every tenth one. Each must be ordered after the mount
+         * point it lies on. */
+
+        assert_se(mkdtemp(dir));
+
+        {
+                _cleanup_free_ char *p = NULL;
+
+                assert_se(asprintf(&p, "%s/bench.target", dir) >= 0);
+                assert_se(write_string_file(p, "[Unit]\nDefaultDependencies=no\n") >= 0);
+
+                free(p);
+                p = NULL;
+                assert_se(asprintf(&p, "%s/bench.target.wants", dir) >= 0);
+                assert_se(mkdir(p, 0755) >= 0);
+        }
+
+        for (k = 0; k < n; k++) {
+                _cleanup_free_ char *where = NULL, *name = NULL, *p = NULL, *t = NULL, *l = NULL;
+
+                assert_se(where = bench_mount_path(k));
+                assert_se(name = unit_name_from_path(where, ".mount"));
+
+                assert_se(asprintf(&p, "%s/%s", dir, name) >= 0);
+                assert_se(asprintf(&t,
+                                   "[Unit]\n"
+                                   "DefaultDependencies=no\n"
+                                   "[Mount]\n"
+                                   "What=tmpfs\n"
+                                   "Where=%s\n",
+                                   where) >= 0);
+                assert_se(write_string_file(p, t) >= 0);
+
+                assert_se(asprintf(&l, "%s/bench.target.wants/%s", dir, name) >= 0);
+                assert_se(symlink(p, l) >= 0);
+
+                if (k % 10 != 0)
+                        continue;
+
+                free(p);
+                free(t);
+                free(l);
+
+                assert_se(asprintf(&p, "%s/bench-%u.socket", dir, k) >= 0);
+                assert_se(asprintf(&t,
+                                   "[Unit]\n"
+                                   "DefaultDependencies=no\n"
+                                   "[Socket]\n"
+                                   "ListenStream=%s/socket\n",
+                                   where) >= 0);
+                assert_se(write_string_file(p, t) >= 0);
+
+                assert_se(asprintf(&l, "%s/bench.target.wants/bench-%u.socket", dir, k) >= 0);
+                assert_se(symlink(p, l) >= 0);
+
+                free(p);
+                p = NULL;
+                assert_se(asprintf(&p, "%s/bench-%u.service", dir, k) >= 0);
+                assert_se(write_string_file(p, "[Unit]\nDefaultDependencies=no\n[Service]\nExecStart=/bin/true\n") >= 0);
+        }
+
+        assert_se(set_unit_path(dir) >= 0);
+        assert_se(manager_new(SYSTEMD_SYSTEM, &m) >= 0);
+
+        ts = now(CLOCK_MONOTONIC);
+        assert_se(manager_load_unit(m, "bench.target", NULL, NULL, &root) >= 0);
+        ts = now(CLOCK_MONOTONIC) - ts;
+
+        printf("Loaded %u mounts and %u sockets in %s.\n",
+               n, (n + 9) / 10, format_timespan(timespan, sizeof(timespan), ts, 0));
+
+        for (k = 0; k < n; k++) {
+                _cleanup_free_ char *where = NULL, *name = NULL, *parent = NULL, *parent_name = NULL;
+                Unit *u, *p;
+
+                assert_se(where = bench_mount_path(k));
+                assert_se(name = unit_name_from_path(where, ".mount"));
+                assert_se(u = manager_get_unit(m, name));
+                assert_se(u->load_state == UNIT_LOADED);
+
+                if (k > 0) {
+                        assert_se(parent = bench_mount_path((k - 1) / 4));
+                        assert_se(parent_name = unit_name_from_path(parent, ".mount"));
+                        assert_se(p = manager_get_unit(m, parent_name));
+
+                        assert_se(dependency_list_contains(u->dependencies[UNIT_AFTER], p));
+                        assert_se(dependency_list_contains(u->dependencies[UNIT_REQUIRES], p));
+                }
+
+                if (k % 10 == 0) {
+                        _cleanup_free_ char *socket = NULL;
+                        Unit *s;
+
+                        assert_se(asprintf(&socket, "bench-%u.socket", k) >= 0);
+                        assert_se(s = manager_get_unit(m, socket));
+                        assert_se(dependency_list_contains(s->dependencies[UNIT_AFTER], u));
+                }
+        }
+
+        manager_free(m);
+        assert_se(rm_rf_dangerous(dir, false, true, false) >= 0);
+}
 
 int main(int argc, char *argv[]) {
+        unsigned n = 0;
         Manager *m = NULL;
         Unit *a = NULL, *b = NULL, *c = NULL, *d = NULL, *e = NULL, *g = NULL, *h = NULL;
         Job *j;
@@ -95,5 +329,23 @@ int main(int argc, char *argv[]) {
 
         manager_free(m);
 
+        if (argc > 1) {
+                assert_se(safe_atou(argv[1], &n) >= 0);
+
+                printf("Test11: (%u units)\n", n);
+                test_many_units(n);
+
+                printf("Test12: (%u mounts)\n", n);
+                test_many_mounts(n);
+        } else {
+                printf("Test11: (1000, 10000, 50000 units)\n");
+                test_many_units(1000);
+                test_many_units(10000);
+                test_many_units(50000);
+
+                printf("Test12: (5000 mounts)\n");
+                test_many_mounts(5000);
+        }
+
         return 0;
 }
@@ -0,0 +1,102 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "util.h"
+#include "log.h"
+#include "execute.h"
+
+/* Measures how many services per second exec_spawn() can start when
+ * spawning with CLONE_VM|CLONE_VFORK, and when forking, with a small
+ * and a large heap in the spawning process, since copying the page
+ * tables is what makes fork() slow for a big PID 1. */
+
+#define N_SPAWNS 2000
+#define LARGE_HEAP (512*1024*1024)
+
+static double spawn(bool use_fork) {
+        static char *args[] = { (char*) "/bin/true", NULL };
+        ExecCommand command = {
+                .path = args[0],
+                .argv = args,
+        };
+        ExecContext context = {};
+        int idle_pipe[2] = { -1, -1 };
+        usec_t start;
+        unsigned i;
+
+        exec_context_init(&context);
+
+        start = now(CLOCK_MONOTONIC);
+
+        for (i = 0; i < N_SPAWNS; i++) {
+                siginfo_t si = {};
+                pid_t pid;
+
+                /* Passing an (unused) idle pipe forces the fork() path */
+                assert_se(exec_spawn(&command, NULL, &context, NULL, 0, NULL,
+                                     true, true, true, false,
+                                     NULL, NULL, NULL, "test.service",
+                                     use_fork ? idle_pipe : NULL,
+                                     &pid) >= 0);
+
+                assert_se(waitid(P_PID, pid, &si, WEXITED) >= 0);
+                assert_se(si.si_code == CLD_EXITED && si.si_status == EXIT_SUCCESS);
+        }
+
+        exec_context_done(&context, false);
+
+        return (double) N_SPAWNS * USEC_PER_SEC / (now(CLOCK_MONOTONIC) - start);
+}
+
+static void run(const char *heap) {
+        double vfork, fork;
+
+        vfork = spawn(false);
+        fork = spawn(true);
+
+        log_info("%s heap: %.0f services/s with CLONE_VFORK, %.0f services/s with fork()",
+                 heap, vfork, fork);
+}
+
+int main(int argc, char *argv[]) {
+        void *p;
+
+        log_parse_environment();
+        log_open();
+
+        run("Small");
+
+        /* Touch the memory, so that it is actually mapped */
+        p = malloc(LARGE_HEAP);
+        assert_se(p);
+        memset(p, 0x55, LARGE_HEAP);
+
+        run("Large");
+
+        free(p);
+
+        return 0;
+}
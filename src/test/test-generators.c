@@ -0,0 +1,227 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "manager.h"
+#include "fileio.h"
+#include "def.h"
+#include "util.h"
+#include "log.h"
+
+/* Runs generators the way manager_run_generators() does, and checks
+ * that no more of them than the worker bound run at a time, that a
+ * hanging generator is killed after the timeout, that failing ones
+ * are reported as such, and that the SIGCHLD of some other child
+ * that exits meanwhile is not swallowed. Takes a while.
+ *
+ * Usage: test-generators */
+
+#define N_WORKERS 3
+#define N_SLEEPERS 12
+#define SLEEP_USEC (200 * USEC_PER_MSEC)
+#define TIMEOUT_USEC (500 * USEC_PER_MSEC)
+
+static void add_generator(const char *dir, const char *name, const char *script) {
+        _cleanup_free_ char *p = NULL;
+
+        p = strjoin(dir, "/", name, NULL);
+        assert_se(p);
+
+        assert_se(write_string_file(p, script) >= 0);
+        assert_se(chmod(p, 0755) >= 0);
+}
+
+static usec_t read_usec(const char *dir, const char *name, const char *suffix) {
+        _cleanup_free_ char *p = NULL, *line = NULL;
+        unsigned long long nsec;
+
+        p = strjoin(dir, "/", name, suffix, NULL);
+        assert_se(p);
+
+        assert_se(read_one_line_file(p, &line) >= 0);
+        assert_se(safe_atollu(line, &nsec) >= 0);
+
+        return (usec_t) nsec / NSEC_PER_USEC;
+}
+
+static void drain_sigchld(void) {
+        struct timespec ts = {};
+        sigset_t mask;
+
+        assert_se(sigemptyset(&mask) == 0);
+        assert_se(sigaddset(&mask, SIGCHLD) == 0);
+
+        while (sigtimedwait(&mask, NULL, &ts) == SIGCHLD)
+                ;
+}
+
+static bool sigchld_pending(void) {
+        sigset_t pending;
+
+        assert_se(sigpending(&pending) == 0);
+        return sigismember(&pending, SIGCHLD) > 0;
+}
+
+static void test_worker_bound(Manager *m, const char *dir) {
+        usec_t start[N_SLEEPERS], end[N_SLEEPERS];
+        unsigned i, j, max_running = 0;
+        char name[N_SLEEPERS][sizeof("sleeper-") + DECIMAL_STR_MAX(unsigned)];
+
+        /* Each one notes when it started and ended in the output
+         * directory */
+        for (i = 0; i < N_SLEEPERS; i++) {
+                snprintf(name[i], sizeof(name[i]), "sleeper-%02u", i);
+                add_generator(dir, name[i],
+                              "#!/bin/sh\n"
+                              "n=$(basename $0)\n"
+                              "date +%s%N > $1/$n.start\n"
+                              "sleep 0.2\n"
+                              "date +%s%N > $1/$n.end");
+        }
+
+        manager_run_generators_from(m, dir, N_WORKERS, TIMEOUT_USEC);
+
+        assert_se(m->n_generator_times == N_SLEEPERS);
+        assert_se(m->generator_unit_path);
+
+        for (i = 0; i < N_SLEEPERS; i++) {
+                assert_se(streq(m->generator_times[i].name, name[i]));
+                assert_se(m->generator_times[i].result == GENERATOR_SUCCESS);
+                assert_se(m->generator_times[i].usec >= SLEEP_USEC);
+
+                start[i] = read_usec(m->generator_unit_path, name[i], ".start");
+                end[i] = read_usec(m->generator_unit_path, name[i], ".end");
+                assert_se(start[i] <= end[i]);
+        }
+
+        /* A generator is only started once an earlier one has been
+         * reaped, i.e. after it noted its end */
+        for (i = 0; i < N_SLEEPERS; i++) {
+                unsigned running = 0;
+
+                for (j = 0; j < N_SLEEPERS; j++)
+                        if (start[j] <= start[i] && start[i] < end[j])
+                                running++;
+
+                max_running = MAX(max_running, running);
+        }
+
+        log_info("%u generators with %u workers: at most %u running at a time, %llu ms altogether",
+                 N_SLEEPERS, N_WORKERS, max_running,
+                 (unsigned long long) m->generators_usec / USEC_PER_MSEC);
+
+        assert_se(max_running <= N_WORKERS);
+        assert_se(max_running > 1);
+        assert_se(m->generators_usec >= (N_SLEEPERS / N_WORKERS) * SLEEP_USEC);
+
+        /* manager_undo_generators() only removes what is left on a
+         * tmpfs */
+        assert_se(rm_rf_dangerous(m->generator_unit_path, false, true, false) >= 0);
+        manager_undo_generators(m);
+}
+
+static void test_timeout_and_failure(Manager *m, const char *dir) {
+        siginfo_t si = {};
+        pid_t pid;
+
+        add_generator(dir, "crash", "#!/bin/sh\nkill -SEGV $$");
+        add_generator(dir, "fail", "#!/bin/sh\nexit 1");
+        add_generator(dir, "hang", "#!/bin/sh\nexec sleep 1000");
+        add_generator(dir, "ok", "#!/bin/sh\nexit 0");
+
+        /* Some other child of ours, exiting while the generators
+         * run */
+        drain_sigchld();
+        pid = fork();
+        assert_se(pid >= 0);
+        if (pid == 0) {
+                usleep(TIMEOUT_USEC / 5);
+                _exit(EXIT_SUCCESS);
+        }
+
+        manager_run_generators_from(m, dir, N_WORKERS, TIMEOUT_USEC);
+
+        assert_se(m->n_generator_times == 4);
+
+        assert_se(streq(m->generator_times[0].name, "crash"));
+        assert_se(m->generator_times[0].result == GENERATOR_FAILURE);
+
+        assert_se(streq(m->generator_times[1].name, "fail"));
+        assert_se(m->generator_times[1].result == GENERATOR_FAILURE);
+
+        assert_se(streq(m->generator_times[2].name, "hang"));
+        assert_se(m->generator_times[2].result == GENERATOR_TIMEOUT);
+        assert_se(m->generator_times[2].usec >= TIMEOUT_USEC);
+
+        assert_se(streq(m->generator_times[3].name, "ok"));
+        assert_se(m->generator_times[3].result == GENERATOR_SUCCESS);
+
+        /* The hanging one must not hold up the others much longer
+         * than the timeout */
+        assert_se(m->generators_usec >= TIMEOUT_USEC);
+        assert_se(m->generators_usec < DEFAULT_GENERATOR_TIMEOUT_USEC);
+
+        /* The other child is left alone for the manager to reap, and
+         * the manager is told about it */
+        assert_se(sigchld_pending());
+        assert_se(waitid(P_PID, pid, &si, WEXITED|WNOHANG) >= 0);
+        assert_se(si.si_pid == pid);
+        assert_se(si.si_code == CLD_EXITED && si.si_status == EXIT_SUCCESS);
+
+        manager_undo_generators(m);
+}
+
+int main(int argc, char *argv[]) {
+        char a[] = "/tmp/test-generators-bound-XXXXXX";
+        char b[] = "/tmp/test-generators-timeout-XXXXXX";
+        Manager *m;
+        int r;
+
+        log_parse_environment();
+        log_open();
+
+        r = manager_new(SYSTEMD_USER, &m);
+        if (r == -EPERM) {
+                puts("manager_new: Permission denied. Skipping test.");
+                return EXIT_TEST_SKIP;
+        }
+        assert_se(r >= 0);
+
+        assert_se(mkdtemp(a));
+        assert_se(mkdtemp(b));
+
+        test_worker_bound(m, a);
+        test_timeout_and_failure(m, b);
+
+        assert_se(rm_rf_dangerous(a, false, true, false) >= 0);
+        assert_se(rm_rf_dangerous(b, false, true, false) >= 0);
+
+        manager_free(m);
+
+        return EXIT_SUCCESS;
+}
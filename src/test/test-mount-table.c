@@ -0,0 +1,151 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "util.h"
+#include "strv.h"
+#include "mount-table.h"
+
+#define N_ENTRIES 10000
+
+/* Writes a mountinfo with the entries whose generation is not 0 */
+static void write_table(FILE *f, const unsigned *generation) {
+        unsigned k;
+
+        assert_se(ftruncate(fileno(f), 0) >= 0);
+        rewind(f);
+
+        for (k = 0; k < N_ENTRIES; k++) {
+                if (generation[k] <= 0)
+                        continue;
+
+                fprintf(f,
+                        "%u 1 0:%u / /var/lib/containers/c%u/rootfs\\040%u rw,relatime%s shared:%u - tmpfs tmpfs rw,size=%uk\n",
+                        k + 20, k, k / 10, k % 10, generation[k] % 2 ? "" : ",nosuid", k, generation[k]);
+        }
+
+        assert_se(fflush(f) == 0);
+}
+
+static unsigned n_changed(MountTable *t) {
+        unsigned n;
+
+        mount_table_get_changed(t, &n);
+        return n;
+}
+
+int main(int argc, char *argv[]) {
+        char fn[] = "/tmp/test-mount-table.XXXXXX";
+        char timespan[FORMAT_TIMESPAN_MAX];
+        _cleanup_mount_table_free_ MountTable *t = NULL;
+        _cleanup_free_ unsigned *generation = NULL;
+        MountTableEntry **changed;
+        unsigned k, n, round;
+        usec_t full, incremental = 0;
+        FILE *f;
+        int fd;
+
+        fd = mkostemp(fn, O_RDWR|O_CLOEXEC);
+        assert_se(fd >= 0);
+        assert_se(f = fdopen(fd, "w+"));
+        unlink(fn);
+
+        assert_se(generation = new0(unsigned, N_ENTRIES));
+        for (k = 0; k < N_ENTRIES; k++)
+                generation[k] = 1;
+
+        assert_se(mount_table_new(&t) >= 0);
+
+        write_table(f, generation);
+        full = now(CLOCK_MONOTONIC);
+        assert_se(mount_table_update(t, f) >= 0);
+        full = now(CLOCK_MONOTONIC) - full;
+
+        assert_se(mount_table_size(t) == N_ENTRIES);
+        assert_se(n_changed(t) == N_ENTRIES);
+        assert_se(strv_isempty(mount_table_get_removed(t)));
+
+        changed = mount_table_get_changed(t, &n);
+        assert_se(changed[42]->id == 62);
+        assert_se(streq(changed[42]->where, "/var/lib/containers/c4/rootfs 2"));
+        assert_se(streq(changed[42]->what, "tmpfs"));
+        assert_se(streq(changed[42]->fstype, "tmpfs"));
+        assert_se(streq(changed[42]->options, "rw,relatime,rw,size=1k"));
+
+        /* Nothing happened */
+        assert_se(mount_table_update(t, f) >= 0);
+        assert_se(n_changed(t) == 0);
+        assert_se(strv_isempty(mount_table_get_removed(t)));
+
+        /* Replay some churn: in every round one container goes
+         * away, one comes back and one gets remounted */
+        for (round = 0; round < 100; round++) {
+                unsigned gone = (round * 7919) % (N_ENTRIES / 10), remounted = (gone + 1) % (N_ENTRIES / 10);
+                usec_t ts;
+                bool back;
+
+                back = round > 0;
+                for (k = 0; k < 10; k++) {
+                        generation[gone * 10 + k] = 0;
+                        generation[remounted * 10 + k]++;
+                        if (back)
+                                generation[((round - 1) * 7919) % (N_ENTRIES / 10) * 10 + k] = 1;
+                }
+
+                write_table(f, generation);
+
+                ts = now(CLOCK_MONOTONIC);
+                assert_se(mount_table_update(t, f) >= 0);
+                incremental += now(CLOCK_MONOTONIC) - ts;
+
+                assert_se(strv_length(mount_table_get_removed(t)) == 10);
+                assert_se(n_changed(t) == (back ? 20u : 10u));
+                assert_se(mount_table_size(t) == N_ENTRIES - 10);
+        }
+
+        /* Overmounts: removing the top one applies the one below
+         * again */
+        write_table(f, generation);
+        assert_se(mount_table_update(t, f) >= 0);
+        fprintf(f, "1 1 0:1 / /var/lib/containers/c1/rootfs\\0400 rw - ext4 /dev/sda1 rw\n");
+        assert_se(fflush(f) == 0);
+        assert_se(mount_table_update(t, f) >= 0);
+        changed = mount_table_get_changed(t, &n);
+        assert_se(n == 1 && changed[0]->id == 1);
+
+        write_table(f, generation);
+        assert_se(mount_table_update(t, f) >= 0);
+        changed = mount_table_get_changed(t, &n);
+        assert_se(n == 1 && changed[0]->id == 30);
+        assert_se(strv_length(mount_table_get_removed(t)) == 1);
+        assert_se(streq(mount_table_get_removed(t)[0], "/var/lib/containers/c1/rootfs 0"));
+
+        printf("Read %u entries in %s, ", N_ENTRIES, format_timespan(timespan, sizeof(timespan), full, 0));
+        printf("100 incremental updates in %s.\n", format_timespan(timespan, sizeof(timespan), incremental, 0));
+
+        fclose(f);
+        return 0;
+}
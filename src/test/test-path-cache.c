@@ -0,0 +1,126 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "util.h"
+#include "path-cache.h"
+#include "strv.h"
+#include "path-util.h"
+#include "mkdir.h"
+
+static void touch_at(const char *dir, const char *name) {
+        _cleanup_free_ char *p = NULL;
+
+        p = strjoin(dir, "/", name, NULL);
+        assert_se(p);
+        assert_se(touch(p) >= 0);
+}
+
+static int lookup(PathCache *c, const char *dir, const char *name) {
+        _cleanup_free_ char *p = NULL;
+
+        p = strjoin(dir, "/", name, NULL);
+        assert_se(p);
+        return path_cache_lookup(c, p);
+}
+
+int main(int argc, char *argv[]) {
+        char t[] = "/tmp/test-path-cache-XXXXXX";
+        _cleanup_free_ char *a = NULL, *b = NULL, *wants = NULL;
+        _cleanup_path_cache_free_ PathCache *c = NULL;
+        _cleanup_strv_free_ char **roots = NULL, **l = NULL;
+        unsigned generation;
+
+        assert_se(mkdtemp(t));
+
+        a = strappend(t, "/a");
+        b = strappend(t, "/b/system");
+        wants = strappend(a, "/foo.target.wants");
+        assert_se(a && b && wants);
+
+        assert_se(mkdir(a, 0755) >= 0);
+        assert_se(mkdir(wants, 0755) >= 0);
+        touch_at(a, "foo.service");
+        touch_at(wants, "bar.service");
+
+        roots = strv_new(a, b, NULL);
+        assert_se(roots);
+
+        assert_se(path_cache_new(&c) >= 0);
+        assert_se(path_cache_set_roots(c, roots) >= 0);
+
+        assert_se(lookup(c, a, "foo.service") > 0);
+        assert_se(lookup(c, a, "bar.service") == 0);
+        assert_se(lookup(c, wants, "bar.service") > 0);
+        assert_se(lookup(c, wants, "foo.service") == 0);
+        assert_se(lookup(c, b, "foo.service") == 0);
+        assert_se(lookup(c, a, "bar.target.wants/foo.service") == 0);
+        assert_se(path_cache_lookup(c, "/etc/passwd") == -ENODATA);
+
+        assert_se(path_cache_list(c, wants, &l) >= 0);
+        assert_se(strv_length(l) == 1);
+        assert_se(path_startswith(l[0], wants));
+        strv_free(l);
+        l = NULL;
+
+        /* Changes are only seen after flushing */
+        generation = path_cache_generation(c);
+        touch_at(a, "bar.service");
+        assert_se(unlink(strappenda(a, "/foo.service")) >= 0);
+        assert_se(lookup(c, a, "bar.service") == 0);
+        assert_se(path_cache_generation(c) == generation);
+        assert_se(path_cache_flush(c) >= 0);
+        assert_se(lookup(c, a, "bar.service") > 0);
+        assert_se(lookup(c, a, "foo.service") == 0);
+        assert_se(path_cache_generation(c) != generation);
+
+        /* New subdirectories are watched too */
+        assert_se(mkdir(strappenda(a, "/bar.service.d"), 0755) >= 0);
+        assert_se(path_cache_flush(c) >= 0);
+        touch_at(strappenda(a, "/bar.service.d"), "x.conf");
+        assert_se(path_cache_flush(c) >= 0);
+        assert_se(lookup(c, a, "bar.service.d/x.conf") > 0);
+
+        assert_se(rm_rf_dangerous(wants, false, true, false) >= 0);
+        assert_se(path_cache_flush(c) >= 0);
+        assert_se(lookup(c, wants, "bar.service") == 0);
+        assert_se(lookup(c, a, "foo.target.wants") == 0);
+
+        /* Unrelated entries next to a missing root don't matter */
+        generation = path_cache_generation(c);
+        touch_at(t, "b.conf");
+        assert_se(path_cache_flush(c) >= 0);
+        assert_se(path_cache_generation(c) == generation);
+
+        /* A missing root showing up */
+        assert_se(mkdir_p(b, 0755) >= 0);
+        touch_at(b, "baz.service");
+        assert_se(path_cache_flush(c) >= 0);
+        assert_se(lookup(c, b, "baz.service") > 0);
+
+        assert_se(rm_rf_dangerous(t, false, true, false) >= 0);
+
+        return 0;
+}
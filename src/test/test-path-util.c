@@ -69,6 +69,19 @@ static void test_path(void) {
         test_parent("/aa///file...", "/aa///");
         test_parent("file.../", NULL);
 
+        {
+                char p1[] = "/aa/bb/cc";
+                char p2[] = "aa/bb";
+
+                assert_se(path_strip_last_component(p1) && streq(p1, "/aa/bb"));
+                assert_se(path_strip_last_component(p1) && streq(p1, "/aa"));
+                assert_se(path_strip_last_component(p1) && streq(p1, "/"));
+                assert_se(!path_strip_last_component(p1) && streq(p1, "/"));
+
+                assert_se(path_strip_last_component(p2) && streq(p2, "aa"));
+                assert_se(!path_strip_last_component(p2) && streq(p2, "aa"));
+        }
+
         assert_se(path_is_mount_point("/", true));
         assert_se(path_is_mount_point("/", false));
 
@@ -0,0 +1,152 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "manager.h"
+#include "service.h"
+#include "util.h"
+#include "log.h"
+
+/* Forks many children, and measures how many of them per second
+ * can be mapped back to their unit and reaped the way
+ * manager_dispatch_sigchld() does it: once with the children tracked
+ * with unit_track_pid(), and once without, in which case their
+ * cgroup is looked up in /proc.
+ *
+ * Usage: test-reap [CHILDREN] */
+
+#define N_UNITS 100
+#define BATCH 1000
+
+static void fork_batch(Unit **units, pid_t pids[], bool track) {
+        unsigned i;
+
+        for (i = 0; i < BATCH; i++) {
+                pids[i] = fork();
+                assert_se(pids[i] >= 0);
+
+                if (pids[i] == 0) {
+                        /* Wait until our parent is ready to reap us */
+                        kill(getpid(), SIGSTOP);
+                        _exit(EXIT_SUCCESS);
+                }
+
+                if (track)
+                        assert_se(unit_track_pid(units[i % N_UNITS], pids[i]) >= 0);
+        }
+
+        for (i = 0; i < BATCH; i++) {
+                siginfo_t si = {};
+
+                assert_se(waitid(P_PID, pids[i], &si, WSTOPPED) >= 0);
+        }
+}
+
+static usec_t reap_batch(Manager *m, Unit **units, pid_t pids[], bool track) {
+        unsigned i, n = 0;
+        usec_t start;
+
+        for (i = 0; i < BATCH; i++)
+                kill(pids[i], SIGCONT);
+
+        start = now(CLOCK_MONOTONIC);
+
+        while (n < BATCH) {
+                siginfo_t si = {};
+                Unit *u;
+
+                assert_se(waitid(P_ALL, 0, &si, WEXITED|WNOWAIT) >= 0);
+
+                u = manager_get_unit_by_child(m, si.si_pid);
+                if (track) {
+                        assert_se(u);
+                        unit_untrack_pid(u, si.si_pid);
+                }
+
+                assert_se(waitid(P_PID, si.si_pid, &si, WEXITED) >= 0);
+                n++;
+        }
+
+        return now(CLOCK_MONOTONIC) - start;
+}
+
+static double reap(Manager *m, Unit **units, unsigned n_children, bool track) {
+        pid_t pids[BATCH];
+        usec_t t = 0;
+        unsigned i;
+
+        for (i = 0; i < n_children; i += BATCH) {
+                fork_batch(units, pids, track);
+                t += reap_batch(m, units, pids, track);
+        }
+
+        return (double) i * USEC_PER_SEC / t;
+}
+
+int main(int argc, char *argv[]) {
+        Unit *units[N_UNITS];
+        unsigned n_children = 100000, i;
+        double tracked, untracked;
+        Manager *m;
+        int r;
+
+        log_parse_environment();
+        log_open();
+
+        if ((argc > 1 && safe_atou(argv[1], &n_children) < 0) || n_children <= 0) {
+                log_error("Usage: %s [CHILDREN]", program_invocation_short_name);
+                return EXIT_FAILURE;
+        }
+
+        r = manager_new(SYSTEMD_USER, &m);
+        if (r == -EPERM) {
+                puts("manager_new: Permission denied. Skipping test.");
+                return EXIT_TEST_SKIP;
+        }
+        assert_se(r >= 0);
+
+        for (i = 0; i < N_UNITS; i++) {
+                char name[sizeof("test-reap-.service") + DECIMAL_STR_MAX(unsigned)];
+
+                snprintf(name, sizeof(name), "test-reap-%u.service", i);
+
+                units[i] = unit_new(m, sizeof(Service));
+                assert_se(units[i]);
+                assert_se(unit_add_name(units[i], name) >= 0);
+        }
+
+        tracked = reap(m, units, n_children, true);
+        assert_se(hashmap_size(m->pid_units) == 0);
+
+        untracked = reap(m, units, n_children, false);
+
+        log_info("%u children: %.0f reaps/s tracked, %.0f reaps/s looked up in /proc",
+                 n_children, tracked, untracked);
+
+        manager_free(m);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "util.h"
+#include "log.h"
+#include "serialize.h"
+
+/* Writes and reads back the state of many services in both formats,
+ * and reports the size and how long that took.
+ *
+ * Usage: test-serialize-speed [UNITS] */
+
+/* Roughly what manager_serialize() writes for a service */
+static void serialize_units(Serializer *s, FILE *f, unsigned n) {
+        dual_timestamp ts = {
+                .realtime = 1371234567890123ULL,
+                .monotonic = 4567890123ULL,
+        };
+        char name[sizeof("test-.service") + DECIMAL_STR_MAX(unsigned)];
+        unsigned i;
+
+        serialize_item_format(s, f, "current-job-id", "%i", 4711);
+        serialize_item(s, f, "taint-usr", "no");
+        serialize_dual_timestamp(s, f, "kernel-timestamp", &ts);
+        serialize_item(s, f, "env", "LANG=C");
+        serialize_end(s, f);
+
+        for (i = 0; i < n; i++) {
+                snprintf(name, sizeof(name), "test-%u.service", i);
+                serialize_marker(s, f, name);
+
+                serialize_item(s, f, "state", "running");
+                serialize_item(s, f, "result", "success");
+                serialize_item(s, f, "reload-result", "success");
+                serialize_item_format(s, f, "main-pid", "%u", i + 100);
+                serialize_item_format(s, f, "control-pid", "%u", 0);
+                serialize_item(s, f, "main-pid-known", "yes");
+                serialize_item(s, f, "status-text", "Processing requests...");
+                serialize_item_format(s, f, "main-exec-status-pid", "%u", i + 100);
+                serialize_dual_timestamp(s, f, "main-exec-status-start", &ts);
+
+                if (i % 100 == 0) {
+                        serialize_marker(s, f, "job");
+                        serialize_item_format(s, f, "job-id", "%u", i);
+                        serialize_item(s, f, "job-type", "restart");
+                        serialize_item(s, f, "job-state", "waiting");
+                        serialize_end(s, f);
+                }
+
+                serialize_dual_timestamp(s, f, "inactive-exit-timestamp", &ts);
+                serialize_dual_timestamp(s, f, "active-enter-timestamp", &ts);
+                serialize_dual_timestamp(s, f, "active-exit-timestamp", &ts);
+                serialize_dual_timestamp(s, f, "inactive-enter-timestamp", &ts);
+                serialize_dual_timestamp(s, f, "condition-timestamp", &ts);
+                serialize_item(s, f, "condition-result", "yes");
+                serialize_end(s, f);
+        }
+}
+
+static void deserialize_section(Deserializer *d, FILE *f, unsigned *n_items) {
+        char *k, *v;
+        int r;
+
+        while ((r = deserialize_next(d, f, &k, &v)) > 0) {
+                assert_se(!isempty(k));
+                (*n_items)++;
+
+                if (streq(k, "job")) {
+                        assert_se(isempty(v));
+                        deserialize_section(d, f, n_items);
+                } else if (streq(k, "status-text"))
+                        assert_se(streq(v, "Processing requests..."));
+                else if (streq(k, "condition-timestamp")) {
+                        dual_timestamp ts = {};
+
+                        dual_timestamp_deserialize(v, &ts);
+                        assert_se(ts.realtime == 1371234567890123ULL);
+                        assert_se(ts.monotonic == 4567890123ULL);
+                }
+        }
+
+        assert_se(r == 0);
+}
+
+static void deserialize_units(Deserializer *d, FILE *f, unsigned *n_units, unsigned *n_items) {
+        char *k, *v;
+        int r;
+
+        deserialize_section(d, f, n_items);
+
+        for (;;) {
+                r = deserialize_next(d, f, &k, &v);
+                assert_se(r >= 0);
+                if (r == 0) {
+                        assert_se(feof(f));
+                        break;
+                }
+
+                assert_se(startswith(k, "test-"));
+                assert_se(isempty(v));
+                (*n_units)++;
+
+                deserialize_section(d, f, n_items);
+        }
+}
+
+static void test_format(SerializeFormat format, unsigned n) {
+        Serializer *s;
+        Deserializer *d;
+        FILE *f;
+        usec_t start, ts, td;
+        unsigned n_units = 0, n_items = 0;
+        long size;
+
+        f = tmpfile();
+        assert_se(f);
+
+        start = now(CLOCK_MONOTONIC);
+
+        assert_se(serializer_new(&s, f, format) >= 0);
+        serialize_units(s, f, n);
+        serializer_free(s);
+        assert_se(fflush(f) == 0);
+
+        ts = now(CLOCK_MONOTONIC) - start;
+
+        size = ftell(f);
+        assert_se(fseeko(f, 0, SEEK_SET) == 0);
+
+        start = now(CLOCK_MONOTONIC);
+
+        assert_se(deserializer_new(&d, f) >= 0);
+        assert_se(deserializer_format(d) == format);
+        deserialize_units(d, f, &n_units, &n_items);
+        deserializer_free(d);
+
+        td = now(CLOCK_MONOTONIC) - start;
+
+        assert_se(n_units == n);
+        assert_se(n_items == 4 + n * 15 + (n + 99) / 100 * 4);
+
+        log_info("%s: %u units, %u items, %li bytes, serialized in %llu ms, deserialized in %llu ms",
+                 serialize_format_to_string(format), n_units, n_items, size,
+                 (unsigned long long) (ts / USEC_PER_MSEC),
+                 (unsigned long long) (td / USEC_PER_MSEC));
+
+        fclose(f);
+}
+
+int main(int argc, char *argv[]) {
+        unsigned n_units = 20000;
+
+        log_parse_environment();
+        log_open();
+
+        if ((argc > 1 && safe_atou(argv[1], &n_units) < 0) || n_units <= 0) {
+                log_error("Usage: %s [UNITS]", program_invocation_short_name);
+                return EXIT_FAILURE;
+        }
+
+        test_format(SERIALIZE_TEXT, n_units);
+        test_format(SERIALIZE_BINARY, n_units);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,351 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util.h"
+#include "log.h"
+#include "serialize.h"
+
+static dual_timestamp ts = {
+        .realtime = 1371234567890123ULL,
+        .monotonic = 4567890123ULL,
+};
+
+/* What manager_serialize(), unit_serialize() and job_serialize()
+ * wrote before they went through the serializer */
+static void write_old(FILE *f) {
+        unsigned i;
+
+        fprintf(f, "current-job-id=%i\n", 4711);
+        fprintf(f, "taint-usr=%s\n", "no");
+        fprintf(f, "%s=%llu %llu\n", "kernel-timestamp",
+                (unsigned long long) ts.realtime,
+                (unsigned long long) ts.monotonic);
+        fprintf(f, "env=%s\n", "LANG=C");
+        fputc('\n', f);
+
+        for (i = 0; i < 3; i++) {
+                fprintf(f, "test-%u.service\n", i);
+                fprintf(f, "%s=%s\n", "state", "running");
+                fputs("main-pid", f);
+                fputc('=', f);
+                fprintf(f, "%u", i + 100);
+                fputc('\n', f);
+                fprintf(f, "%s=%s\n", "status-text", "Processing requests... = \\ \xc3\xa4");
+
+                if (i == 1) {
+                        fputs("job\n", f);
+                        fprintf(f, "job-id=%u\n", i);
+                        fprintf(f, "job-type=%s\n", "restart");
+                        fputc('\n', f);
+                }
+
+                fprintf(f, "%s=%llu %llu\n", "active-enter-timestamp",
+                        (unsigned long long) ts.realtime,
+                        (unsigned long long) ts.monotonic);
+                fputc('\n', f);
+        }
+}
+
+static void write_new(Serializer *s, FILE *f) {
+        dual_timestamp unset = {};
+        unsigned i;
+
+        serialize_item_format(s, f, "current-job-id", "%i", 4711);
+        serialize_item(s, f, "taint-usr", "no");
+        serialize_dual_timestamp(s, f, "kernel-timestamp", &ts);
+        serialize_dual_timestamp(s, f, "loader-timestamp", &unset);
+        serialize_item(s, f, "env", "LANG=C");
+        serialize_end(s, f);
+
+        for (i = 0; i < 3; i++) {
+                char name[sizeof("test-.service") + DECIMAL_STR_MAX(unsigned)];
+
+                snprintf(name, sizeof(name), "test-%u.service", i);
+                serialize_marker(s, f, name);
+
+                serialize_item(s, f, "state", "running");
+                serialize_item_format(s, f, "main-pid", "%u", i + 100);
+                serialize_item(s, f, "status-text", "Processing requests... = \\ \xc3\xa4");
+
+                if (i == 1) {
+                        serialize_marker(s, f, "job");
+                        serialize_item_format(s, f, "job-id", "%u", i);
+                        serialize_item(s, f, "job-type", "restart");
+                        serialize_end(s, f);
+                }
+
+                serialize_dual_timestamp(s, f, "active-enter-timestamp", &ts);
+                serialize_end(s, f);
+        }
+}
+
+static char *read_all(FILE *f, long *size) {
+        char *p;
+
+        assert_se(fflush(f) == 0);
+        *size = ftell(f);
+        assert_se(*size > 0);
+
+        p = malloc(*size);
+        assert_se(p);
+
+        rewind(f);
+        assert_se(fread(p, 1, *size, f) == (size_t) *size);
+
+        return p;
+}
+
+static void test_text_identical(void) {
+        _cleanup_free_ char *a = NULL, *b = NULL, *c = NULL;
+        long size_a, size_b, size_c;
+        Serializer *s;
+        FILE *f;
+
+        /* Older versions have to be able to read what we pass on to
+         * them in the text format, hence it must not change */
+        f = tmpfile();
+        assert_se(f);
+        write_old(f);
+        a = read_all(f, &size_a);
+        fclose(f);
+
+        f = tmpfile();
+        assert_se(f);
+        assert_se(serializer_new(&s, f, SERIALIZE_TEXT) >= 0);
+        write_new(s, f);
+        serializer_free(s);
+        b = read_all(f, &size_b);
+        fclose(f);
+
+        /* Same without a serializer */
+        f = tmpfile();
+        assert_se(f);
+        write_new(NULL, f);
+        c = read_all(f, &size_c);
+        fclose(f);
+
+        assert_se(size_a == size_b && memcmp(a, b, size_a) == 0);
+        assert_se(size_a == size_c && memcmp(a, c, size_a) == 0);
+}
+
+static void test_roundtrip(SerializeFormat format) {
+        Serializer *s;
+        Deserializer *d;
+        FILE *f;
+        char *k, *v;
+        unsigned i;
+
+        f = tmpfile();
+        assert_se(f);
+
+        assert_se(serializer_new(&s, f, format) >= 0);
+        write_new(s, f);
+        serializer_free(s);
+        rewind(f);
+
+        assert_se(deserializer_new(&d, f) >= 0);
+        assert_se(deserializer_format(d) == format);
+
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "current-job-id") && streq(v, "4711"));
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "taint-usr") && streq(v, "no"));
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "kernel-timestamp") && streq(v, "1371234567890123 4567890123"));
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "env") && streq(v, "LANG=C"));
+        assert_se(deserialize_next(d, f, &k, &v) == 0 && !feof(f));
+
+        /* Keys repeat from here on, which the binary format sends
+         * by index */
+        for (i = 0; i < 3; i++) {
+                char name[sizeof("test-.service") + DECIMAL_STR_MAX(unsigned)];
+                dual_timestamp t = {};
+                unsigned pid;
+
+                snprintf(name, sizeof(name), "test-%u.service", i);
+
+                assert_se(deserialize_next(d, f, &k, &v) == 1);
+                assert_se(streq(k, name) && isempty(v));
+                assert_se(deserialize_next(d, f, &k, &v) == 1);
+                assert_se(streq(k, "state") && streq(v, "running"));
+                assert_se(deserialize_next(d, f, &k, &v) == 1);
+                assert_se(streq(k, "main-pid") && safe_atou(v, &pid) >= 0 && pid == i + 100);
+                assert_se(deserialize_next(d, f, &k, &v) == 1);
+                assert_se(streq(k, "status-text") && streq(v, "Processing requests... = \\ \xc3\xa4"));
+
+                if (i == 1) {
+                        assert_se(deserialize_next(d, f, &k, &v) == 1);
+                        assert_se(streq(k, "job") && isempty(v));
+                        assert_se(deserialize_next(d, f, &k, &v) == 1);
+                        assert_se(streq(k, "job-id") && streq(v, "1"));
+                        assert_se(deserialize_next(d, f, &k, &v) == 1);
+                        assert_se(streq(k, "job-type") && streq(v, "restart"));
+                        assert_se(deserialize_next(d, f, &k, &v) == 0 && !feof(f));
+                }
+
+                assert_se(deserialize_next(d, f, &k, &v) == 1);
+                assert_se(streq(k, "active-enter-timestamp"));
+                dual_timestamp_deserialize(v, &t);
+                assert_se(t.realtime == ts.realtime && t.monotonic == ts.monotonic);
+                assert_se(deserialize_next(d, f, &k, &v) == 0 && !feof(f));
+        }
+
+        assert_se(deserialize_next(d, f, &k, &v) == 0 && feof(f));
+
+        deserializer_free(d);
+        fclose(f);
+}
+
+static void test_text_compat(void) {
+        Deserializer *d;
+        FILE *f;
+        char *k, *v;
+
+        /* What older versions write has to be readable */
+        f = tmpfile();
+        assert_se(f);
+        fputs("current-job-id=5\n\nfoo.service\nstate=dead\njob\njob-id=7\n\n\n", f);
+        rewind(f);
+
+        assert_se(deserializer_new(&d, f) >= 0);
+        assert_se(deserializer_format(d) == SERIALIZE_TEXT);
+
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "current-job-id") && streq(v, "5"));
+        assert_se(deserialize_next(d, f, &k, &v) == 0 && !feof(f));
+
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "foo.service") && streq(v, ""));
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "state") && streq(v, "dead"));
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "job") && streq(v, ""));
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "job-id") && streq(v, "7"));
+        assert_se(deserialize_next(d, f, &k, &v) == 0 && !feof(f));
+        assert_se(deserialize_next(d, f, &k, &v) == 0 && !feof(f));
+        assert_se(deserialize_next(d, f, &k, &v) == 0 && feof(f));
+
+        deserializer_free(d);
+        fclose(f);
+
+        /* An empty file is an empty text serialization */
+        f = tmpfile();
+        assert_se(f);
+
+        assert_se(deserializer_new(&d, f) >= 0);
+        assert_se(deserializer_format(d) == SERIALIZE_TEXT);
+        assert_se(deserialize_next(d, f, &k, &v) == 0 && feof(f));
+
+        deserializer_free(d);
+        fclose(f);
+}
+
+static void test_binary_invalid(void) {
+        Deserializer *d;
+        Serializer *s;
+        FILE *f;
+        char *k, *v;
+        long size;
+
+        /* Newer versions are refused */
+        f = tmpfile();
+        assert_se(f);
+        fwrite(SERIALIZE_MAGIC, 1, sizeof(SERIALIZE_MAGIC) - 1, f);
+        fputc(SERIALIZE_VERSION + 1, f);
+        rewind(f);
+
+        assert_se(deserializer_new(&d, f) == -EPROTONOSUPPORT);
+        fclose(f);
+
+        /* Truncated files are refused */
+        f = tmpfile();
+        assert_se(f);
+
+        assert_se(serializer_new(&s, f, SERIALIZE_BINARY) >= 0);
+        serialize_item(s, f, "foo", "bar");
+        serialize_item(s, f, "foo", "waldo");
+        serializer_free(s);
+        assert_se(fflush(f) == 0);
+
+        size = ftell(f);
+        assert_se(ftruncate(fileno(f), size - 2) == 0);
+        rewind(f);
+
+        assert_se(deserializer_new(&d, f) >= 0);
+        assert_se(deserializer_format(d) == SERIALIZE_BINARY);
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "foo") && streq(v, "bar"));
+        assert_se(deserialize_next(d, f, &k, &v) == -EBADMSG);
+
+        deserializer_free(d);
+        fclose(f);
+}
+
+static void test_long_value(void) {
+        Serializer *s;
+        Deserializer *d;
+        FILE *f;
+        char *k, *v, *p;
+        size_t l = LINE_MAX * 4;
+
+        p = malloc(l + 1);
+        assert_se(p);
+        memset(p, 'x', l);
+        p[l] = 0;
+
+        f = tmpfile();
+        assert_se(f);
+
+        assert_se(serializer_new(&s, f, SERIALIZE_BINARY) >= 0);
+        serialize_item_format(s, f, "long", "%s", p);
+        serializer_free(s);
+        rewind(f);
+
+        assert_se(deserializer_new(&d, f) >= 0);
+        assert_se(deserialize_next(d, f, &k, &v) == 1);
+        assert_se(streq(k, "long") && streq(v, p));
+        assert_se(deserialize_next(d, f, &k, &v) == 0 && feof(f));
+
+        deserializer_free(d);
+        fclose(f);
+        free(p);
+}
+
+int main(int argc, char *argv[]) {
+        log_parse_environment();
+        log_open();
+
+        test_text_identical();
+        test_roundtrip(SERIALIZE_TEXT);
+        test_roundtrip(SERIALIZE_BINARY);
+        test_text_compat();
+        test_binary_invalid();
+        test_long_value();
+
+        return 0;
+}
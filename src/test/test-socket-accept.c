@@ -0,0 +1,127 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "util.h"
+#include "log.h"
+#include "socket-util.h"
+
+/* Measures how many connections per second an Accept=yes socket of
+ * the running systemd instance can take. Each client connects to the
+ * address given on the command line, and waits until the service
+ * spawned for it closed the connection, e.g. for a socket like this:
+ *
+ *   # test-accept.socket
+ *   [Socket]
+ *   ListenStream=127.0.0.1:4711
+ *   Accept=yes
+ *
+ *   # test-accept@.service
+ *   [Service]
+ *   ExecStart=/bin/true
+ *   StandardInput=socket
+ *
+ * Usage: test-socket-accept ADDRESS [CLIENTS] [CONNECTIONS] */
+
+static void client(const SocketAddress *a, unsigned n) {
+        unsigned i;
+
+        for (i = 0; i < n; i++) {
+                char buf[64];
+                int fd;
+
+                fd = socket(socket_address_family(a), SOCK_STREAM|SOCK_CLOEXEC, 0);
+                assert_se(fd >= 0);
+
+                if (connect(fd, &a->sockaddr.sa, a->size) < 0) {
+                        log_error("Failed to connect: %m");
+                        _exit(EXIT_FAILURE);
+                }
+
+                /* Wait for the service to exit */
+                while (read(fd, buf, sizeof(buf)) > 0)
+                        ;
+
+                close_nointr_nofail(fd);
+        }
+
+        _exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[]) {
+        unsigned n_clients = 8, n_connections = 500, i;
+        SocketAddress a;
+        usec_t start, t;
+        bool failed = false;
+
+        log_parse_environment();
+        log_open();
+
+        if (argc < 2) {
+                log_error("Usage: %s ADDRESS [CLIENTS] [CONNECTIONS]", program_invocation_short_name);
+                return EXIT_FAILURE;
+        }
+
+        if (socket_address_parse(&a, argv[1]) < 0) {
+                log_error("Failed to parse address %s.", argv[1]);
+                return EXIT_FAILURE;
+        }
+
+        if ((argc > 2 && safe_atou(argv[2], &n_clients) < 0) ||
+            (argc > 3 && safe_atou(argv[3], &n_connections) < 0) ||
+            n_clients <= 0) {
+                log_error("Failed to parse arguments.");
+                return EXIT_FAILURE;
+        }
+
+        start = now(CLOCK_MONOTONIC);
+
+        for (i = 0; i < n_clients; i++) {
+                pid_t pid;
+
+                pid = fork();
+                assert_se(pid >= 0);
+
+                if (pid == 0)
+                        client(&a, n_connections);
+        }
+
+        for (i = 0; i < n_clients; i++) {
+                siginfo_t si = {};
+
+                assert_se(waitid(P_ALL, 0, &si, WEXITED) >= 0);
+                if (si.si_code != CLD_EXITED || si.si_status != EXIT_SUCCESS)
+                        failed = true;
+        }
+
+        t = now(CLOCK_MONOTONIC) - start;
+
+        log_info("%u clients, %u connections in %llu ms, %.0f connections/s",
+                 n_clients, n_clients * n_connections,
+                 (unsigned long long) (t / USEC_PER_MSEC),
+                 (double) n_clients * n_connections * USEC_PER_SEC / t);
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -160,6 +160,19 @@ static void test_strv_overlap(void) {
         assert_se(!strv_overlap((char **)input_table, (char**)input_table_unique));
 }
 
+static void test_strv_equal(void) {
+        const char * const a[] = { "one", "two", NULL };
+        const char * const b[] = { "one", "two", NULL };
+        const char * const c[] = { "one", NULL };
+        const char * const empty[] = { NULL };
+
+        assert_se(strv_equal((char**) a, (char**) b));
+        assert_se(!strv_equal((char**) a, (char**) c));
+        assert_se(!strv_equal((char**) c, (char**) a));
+        assert_se(strv_equal(NULL, (char**) empty));
+        assert_se(!strv_equal((char**) a, NULL));
+}
+
 static void test_strv_sort(void) {
         const char* input_table[] = {
                 "durian",
@@ -256,6 +269,7 @@ int main(int argc, char *argv[]) {
         test_strv_split_nulstr();
         test_strv_parse_nulstr();
         test_strv_overlap();
+        test_strv_equal();
         test_strv_sort();
         test_strv_merge();
         test_strv_merge_concat();
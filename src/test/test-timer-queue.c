@@ -0,0 +1,188 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2026 agent
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <dirent.h>
+#include <sys/poll.h>
+
+#include "util.h"
+#include "log.h"
+#include "timer-queue.h"
+
+#define N_TIMERS 10000
+
+static unsigned count_fds(void) {
+        _cleanup_closedir_ DIR *d = NULL;
+        struct dirent *de;
+        unsigned n = 0;
+
+        d = opendir("/proc/self/fd");
+        assert_se(d);
+
+        while ((de = readdir(d)))
+                if (!ignore_file(de->d_name))
+                        n++;
+
+        return n;
+}
+
+static void test_order(void) {
+        TimerQueueEntry entries[1000] = {};
+        TimerQueueEntry *e;
+        TimerQueue *q;
+        usec_t previous = 0;
+        unsigned i, n = 0;
+
+        srand(0);
+
+        assert_se(timer_queue_new(CLOCK_MONOTONIC, &q) >= 0);
+
+        for (i = 0; i < ELEMENTSOF(entries); i++)
+                assert_se(timer_queue_put(q, entries + i, (usec_t) rand()) >= 0);
+
+        /* Remove every third entry, and reschedule every fifth */
+        for (i = 0; i < ELEMENTSOF(entries); i += 3)
+                timer_queue_remove(entries + i);
+        for (i = 0; i < ELEMENTSOF(entries); i += 5)
+                assert_se(timer_queue_put(q, entries + i, (usec_t) rand()) >= 0);
+
+        while ((e = timer_queue_pop_elapsed(q, (usec_t) -2))) {
+                assert_se(!e->queue);
+                assert_se(e->next_elapse >= previous);
+                previous = e->next_elapse;
+                n++;
+        }
+
+        assert_se(timer_queue_size(q) == 0);
+        assert_se(n == ELEMENTSOF(entries) - (ELEMENTSOF(entries) + 2) / 3 + (ELEMENTSOF(entries) + 14) / 15);
+
+        timer_queue_free(q);
+}
+
+static void test_requeue(void) {
+        TimerQueueEntry a = {}, b = {};
+        TimerQueueEntry *e;
+        TimerQueue *q;
+        unsigned n = 0;
+
+        assert_se(timer_queue_new(CLOCK_MONOTONIC, &q) >= 0);
+
+        /* A handler requeuing its timer for right away, like a
+         * service restarting with RestartSec=0, must not get it
+         * back before the loop is done */
+        assert_se(timer_queue_put(q, &a, 0) >= 0);
+        assert_se(timer_queue_put(q, &b, 100) >= 0);
+
+        while ((e = timer_queue_pop_elapsed(q, 100))) {
+                assert_se(n++ < 2);
+                assert_se(timer_queue_put(q, e, 0) >= 0);
+        }
+
+        assert_se(n == 2);
+        assert_se(timer_queue_size(q) == 2);
+        assert_se(a.next_elapse == 101 && b.next_elapse == 101);
+
+        /* Next time round they are due again, and outside of the
+         * loop times are taken as they are */
+        assert_se(timer_queue_pop_elapsed(q, 101));
+        assert_se(timer_queue_pop_elapsed(q, 101));
+        assert_se(!timer_queue_pop_elapsed(q, 101));
+
+        assert_se(timer_queue_put(q, &a, 0) >= 0);
+        assert_se(a.next_elapse == 0);
+
+        timer_queue_free(q);
+}
+
+static unsigned test_elapse(usec_t accuracy) {
+        TimerQueueEntry *entries, *e;
+        TimerQueue *q;
+        usec_t start, late = 0;
+        unsigned n_fds, i, n = 0, wakeups = 0;
+
+        srand(0);
+
+        entries = new0(TimerQueueEntry, N_TIMERS);
+        assert_se(entries);
+
+        n_fds = count_fds();
+        assert_se(timer_queue_new(CLOCK_MONOTONIC, &q) >= 0);
+        timer_queue_set_accuracy(q, accuracy);
+
+        /* 10k timers elapsing within the next 300ms */
+        start = now(CLOCK_MONOTONIC);
+        for (i = 0; i < N_TIMERS; i++)
+                assert_se(timer_queue_put(q, entries + i, start + 50 * USEC_PER_MSEC + (usec_t) rand() % (300 * USEC_PER_MSEC)) >= 0);
+
+        /* No matter how many timers there are, we only need one fd */
+        assert_se(count_fds() == n_fds + 1);
+
+        while (n < N_TIMERS) {
+                struct pollfd p = {
+                        .fd = timer_queue_get_fd(q),
+                        .events = POLLIN,
+                };
+                usec_t t;
+
+                assert_se(timer_queue_arm(q) >= 0);
+                assert_se(poll(&p, 1, -1) == 1);
+                wakeups++;
+
+                timer_queue_flush(q);
+                t = now(CLOCK_MONOTONIC);
+
+                while ((e = timer_queue_pop_elapsed(q, t))) {
+                        assert_se(e->next_elapse <= t);
+                        late = MAX(late, t - e->next_elapse);
+                        n++;
+                }
+        }
+
+        assert_se(timer_queue_size(q) == 0);
+
+        log_info("%u timers, accuracy %llu us: %u wakeups, at most %llu us late, %u fds",
+                 N_TIMERS, (unsigned long long) accuracy, wakeups,
+                 (unsigned long long) late, count_fds() - n_fds);
+
+        timer_queue_free(q);
+        free(entries);
+
+        assert_se(count_fds() == n_fds);
+
+        return wakeups;
+}
+
+int main(int argc, char* argv[]) {
+        unsigned exact, coalesced;
+
+        log_parse_environment();
+        log_open();
+
+        test_order();
+        test_requeue();
+
+        exact = test_elapse(0);
+        coalesced = test_elapse(250 * USEC_PER_MSEC);
+
+        assert_se(coalesced < exact);
+
+        return 0;
+}